@@ -0,0 +1,61 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file build_driver.h
+ * \author Hyunsu Cho
+ * \brief In-process driver that builds generated code into a shared library
+ */
+#ifndef TREELITE_BUILD_DRIVER_H_
+#define TREELITE_BUILD_DRIVER_H_
+
+#include <string>
+#include <vector>
+
+namespace treelite {
+namespace compiler {
+
+/*! \brief time spent on one step of a build */
+struct BuildStep {
+  /*! \brief name of the source file compiled, or of the library linked */
+  std::string name;
+  /*! \brief wall-clock time, in seconds */
+  double seconds;
+};
+
+/*! \brief summary of a build, returned by BuildSharedLib() */
+struct BuildReport {
+  /*! \brief one entry per source file, in the order of recipe.json */
+  std::vector<BuildStep> units;
+  /*! \brief the link step */
+  BuildStep link;
+  /*! \brief wall-clock time of the whole build, in seconds */
+  double total_seconds;
+  /*! \brief serialize the report as a JSON object */
+  std::string ToJSON() const;
+};
+
+/*!
+ * \brief Compile the sources listed in recipe.json of a directory, then link
+ *        them into a shared library. This does the same as create_shared() of
+ *        the Python package, without requiring Python: the toolchain is invoked
+ *        directly, with at most [nthread] compiler processes at a time. Sources
+ *        are compiled longest first, so that a long unit doesn't start last.
+ * \param dirpath directory holding the code generated by
+ *                TreeliteCompilerGenerateCode(); object files are placed there
+ * \param toolchain 'gcc', 'clang' or a variant thereof (e.g. 'gcc-7'), or 'msvc'.
+ *                  With 'msvc', the environment of Visual C++ must already be
+ *                  set up (e.g. by running vcvarsall.bat).
+ * \param libpath location of the shared library to create
+ * \param nthread maximum number of sources to compile at a time; use all cores
+ *                if nthread <= 0
+ * \param options additional options to pass to the toolchain
+ * \param verbose whether to log the time spent on each unit
+ * \return timings of the build
+ */
+BuildReport BuildSharedLib(const std::string& dirpath, const std::string& toolchain,
+                           const std::string& libpath, int nthread,
+                           const std::vector<std::string>& options, bool verbose);
+
+}  // namespace compiler
+}  // namespace treelite
+
+#endif  // TREELITE_BUILD_DRIVER_H_
@@ -209,6 +209,49 @@ TREELITE_DLL int TreeliteCompilerGenerateCode(CompilerHandle compiler,
                                               ModelHandle model,
                                               int verbose,
                                               const char* dirpath);
+/*!
+ * \brief generate prediction code from a tree ensemble model, then build it
+ *        into a dynamic shared library (.so/.dll/.dylib), without requiring
+ *        Python. The source files are compiled in parallel by invoking the
+ *        toolchain directly, with at most [nthread] compiler processes at a
+ *        time.
+ *
+ * Usage example:
+ * \code
+ *   const char* build_log;
+ *   TreeliteCompilerExportLib(compiler, model, "gcc", "./my/model", "./mymodel.so",
+ *                             0, NULL, 0, 1, &build_log);
+ *   // build_log: {"units": {"main.c": 0.41, "tu0.c": 1.73, ...},
+ *   //             "link": "./mymodel.so", "link_seconds": 0.05, ...}
+ * \endcode
+ * \param compiler handle for compiler
+ * \param model handle for tree ensemble model
+ * \param toolchain which toolchain to use: 'gcc', 'clang' or a variant
+ *                  thereof (e.g. 'gcc-7'), or 'msvc'. With 'msvc', the
+ *                  environment of Visual C++ must already be set up.
+ * \param dirpath directory to store header, source and object files
+ * \param libpath location to save the dynamic shared library
+ * \param nthread maximum number of source files to compile at a time; set to
+ *                0 to use all cores
+ * \param options additional options to pass to the toolchain
+ * \param num_option number of elements in options
+ * \param verbose whether to produce extra messages
+ * \param out_build_log if not NULL, set to a JSON string holding the time spent
+ *                      on each source file and on linking, in seconds. The
+ *                      string is valid until the next call to this function
+ *                      on the same thread.
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreeliteCompilerExportLib(CompilerHandle compiler,
+                                           ModelHandle model,
+                                           const char* toolchain,
+                                           const char* dirpath,
+                                           const char* libpath,
+                                           int nthread,
+                                           const char** options,
+                                           size_t num_option,
+                                           int verbose,
+                                           const char** out_build_log);
 /*!
  * \brief delete compiler from memory
  * \param handle compiler to remove
@@ -280,6 +323,15 @@ TREELITE_DLL int TreeliteQueryNumOutputGroups(ModelHandle handle, size_t* out);
  */
 TREELITE_DLL int TreeliteSetTreeLimit(ModelHandle handle, size_t limit);
 
+/*!
+ * \brief serialize a model to a file, so that it can be scored later by the
+ *        runtime without being compiled (see TreelitePredictorLoadModelFile())
+ * \param handle model to serialize
+ * \param filename name of the file to write
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreeliteSerializeModel(ModelHandle handle, const char* filename);
+
 /*!
  * \brief delete model from memory
  * \param handle model to remove
@@ -26,8 +26,26 @@ typedef void* PredictorHandle;
 typedef void* CSRBatchHandle;
 /*! \brief handle to batch of dense data rows */
 typedef void* DenseBatchHandle;
+/*! \brief handle to batch of pre-quantized data rows */
+typedef void* QuantizedBatchHandle;
+/*! \brief handle to the result of an asynchronous prediction */
+typedef void* PredictionFutureHandle;
 /*! \} */
 
+/*!
+ * \brief callback to be invoked when an asynchronous batch prediction
+ *        completes. It runs on a worker thread, after the prediction is
+ *        marked complete: TreelitePredictionFutureWait() may be called from
+ *        inside the callback, and may return before the callback finishes.
+ * \param status 0 for success, -1 for failure. In case of failure, call
+ *               TreeliteGetLastError() from inside the callback to obtain the
+ *               error message.
+ * \param out_result_size length of the output vector
+ * \param callback_data the pointer given to TreelitePredictorPredictBatchAsync()
+ */
+typedef void (*TreelitePredictionCallback)(int status, size_t out_result_size,
+                                           void* callback_data);
+
 /*!
  * \defgroup predictor
  * Predictor interface
@@ -73,11 +91,34 @@ TREELITE_DLL int TreeliteAssembleDenseBatch(const float* data,
  * \return 0 for success, -1 for failure
  */
 TREELITE_DLL int TreeliteDeleteDenseBatch(DenseBatchHandle handle);
+/*!
+ * \brief assemble a batch of rows whose features were already converted into
+ *        bins; see TreelitePredictorQueryBinSize() and
+ *        TreelitePredictorQueryCutPoints() for the encoding of the bins
+ * \param data bins, in row-major order
+ * \param bin_size width of each bin in bytes (1, 2 or 4)
+ * \param num_row number of data rows in the batch
+ * \param num_col number of columns (features) in the batch
+ * \param out handle to quantized batch
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreeliteAssembleQuantizedBatch(const void* data,
+                                                size_t bin_size,
+                                                size_t num_row, size_t num_col,
+                                                QuantizedBatchHandle* out);
+/*!
+ * \brief delete a quantized batch from memory
+ * \param handle quantized batch
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreeliteDeleteQuantizedBatch(QuantizedBatchHandle handle);
 
 /*!
  * \brief get dimensions of a batch
- * \param handle a batch of rows (must be of type SparseBatch or DenseBatch)
- * \param batch_sparse whether the batch is sparse (true) or dense (false)
+ * \param handle a batch of rows (must be of type SparseBatch, DenseBatch or
+ *               QuantizedBatch)
+ * \param batch_sparse whether the batch is sparse (1), dense (0) or
+ *                     quantized (2)
  * \param out_num_row used to set number of rows
  * \param out_num_col used to set number of columns
  * \return 0 for success, -1 for failure
@@ -92,19 +133,95 @@ TREELITE_DLL int TreeliteBatchGetDimension(void* handle,
  * This function assumes that the prediction code has been already compiled into
  * a dynamic shared library object (.so/.dll/.dylib).
  * \param library_path path to library object file containing prediction code
- * \param num_worker_thread number of worker threads (-1 to use max number)
+ * \param num_worker_thread number of worker threads (-1 to use one thread per
+ *                          CPU available to the process, as limited by its
+ *                          affinity mask and CPU quota)
  * \param out handle to predictor
  * \return 0 for success, -1 for failure
  */
 TREELITE_DLL int TreelitePredictorLoad(const char* library_path,
                                        int num_worker_thread,
                                        PredictorHandle* out);
+/*!
+ * \brief load prediction code into memory, with runtime parameters that take
+ *        effect before the worker threads start (e.g. ``wait_policy``). See
+ *        PredictorParam for the list of available parameters.
+ * \param library_path path to library object file containing prediction code
+ * \param num_worker_thread number of worker threads (-1 to use one thread per
+ *                          CPU available to the process, as limited by its
+ *                          affinity mask and CPU quota)
+ * \param num_param number of parameters
+ * \param param_names names of parameters
+ * \param param_values values of parameters
+ * \param out handle to predictor
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictorLoadWithParams(const char* library_path,
+                                                 int num_worker_thread,
+                                                 size_t num_param,
+                                                 const char** param_names,
+                                                 const char** param_values,
+                                                 PredictorHandle* out);
+/*!
+ * \brief create a predictor that scores a model in-process, without compiling
+ *        it into a shared library first. Predictions are identical to those
+ *        of a library compiled from the same model. The predictor makes its
+ *        own copy of the trees, so the model may be freed afterwards.
+ * \param model the model to load, given as a handle obtained from the main
+ *              treelite library (ModelHandle)
+ * \param num_worker_thread number of worker threads (-1 to use one thread per
+ *                          CPU available to the process)
+ * \param num_param number of parameters
+ * \param param_names names of parameters
+ * \param param_values values of parameters
+ * \param out handle to predictor
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictorLoadModel(void* model,
+                                            int num_worker_thread,
+                                            size_t num_param,
+                                            const char** param_names,
+                                            const char** param_values,
+                                            PredictorHandle* out);
+/*!
+ * \brief create a predictor that scores a serialized model in-process; see
+ *        TreelitePredictorLoadModel(). Models are serialized with
+ *        TreeliteSerializeModel().
+ * \param model_path path to the serialized model
+ * \param num_worker_thread number of worker threads (-1 to use one thread per
+ *                          CPU available to the process)
+ * \param num_param number of parameters
+ * \param param_names names of parameters
+ * \param param_values values of parameters
+ * \param out handle to predictor
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictorLoadModelFile(const char* model_path,
+                                                int num_worker_thread,
+                                                size_t num_param,
+                                                const char** param_names,
+                                                const char** param_values,
+                                                PredictorHandle* out);
+/*!
+ * \brief Set a runtime parameter for a predictor. See PredictorParam for the
+ *        list of available parameters.
+ * \param handle predictor
+ * \param name name of parameter
+ * \param value value of parameter
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictorSetParam(PredictorHandle handle,
+                                           const char* name,
+                                           const char* value);
 /*!
  * \brief Make predictions on a batch of data rows (synchronously). This
  *        function internally divides the workload among all worker threads.
+ *        It is safe to call this function from multiple threads at once
+ *        with the same predictor.
  * \param handle predictor
- * \param batch a batch of rows (must be of type SparseBatch or DenseBatch)
- * \param batch_sparse whether batch is sparse (1) or dense (0)
+ * \param batch a batch of rows (must be of type SparseBatch, DenseBatch or
+ *              QuantizedBatch)
+ * \param batch_sparse whether batch is sparse (1), dense (0) or quantized (2)
  * \param verbose whether to produce extra messages
  * \param pred_margin whether to produce raw margin scores instead of
  *                    transformed probabilities
@@ -124,6 +241,68 @@ TREELITE_DLL int TreelitePredictorPredictBatch(PredictorHandle handle,
                                                float* out_result,
                                                size_t* out_result_size);
 
+/*!
+ * \brief Make predictions on a batch of data rows (asynchronously). The work
+ *        is handed off to the worker threads and this function returns right
+ *        away. The arrays referred to by the batch and out_result must remain
+ *        valid until the prediction completes; the batch handle itself may be
+ *        deleted as soon as this function returns. The predictor must not be
+ *        freed before the prediction completes.
+ * \param handle predictor
+ * \param batch a batch of rows (must be of type SparseBatch, DenseBatch or
+ *              QuantizedBatch)
+ * \param batch_sparse whether batch is sparse (1), dense (0) or quantized (2)
+ * \param verbose whether to produce extra messages
+ * \param pred_margin whether to produce raw margin scores instead of
+ *                    transformed probabilities
+ * \param out_result resulting output vector; use
+ *                   TreelitePredictorQueryResultSize() to allocate sufficient
+ *                   space
+ * \param callback (optional) function to be invoked once the prediction
+ *                 completes; set to NULL if not needed
+ * \param callback_data pointer to be passed to the callback
+ * \param out_future (optional) used to save the handle to the result, to be
+ *                   used with TreelitePredictionFutureWait(); set to NULL if
+ *                   not needed. The handle must be freed with
+ *                   TreelitePredictionFutureFree().
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictorPredictBatchAsync(PredictorHandle handle,
+                                                    void* batch,
+                                                    int batch_sparse,
+                                                    int verbose,
+                                                    int pred_margin,
+                                                    float* out_result,
+                                                    TreelitePredictionCallback callback,
+                                                    void* callback_data,
+                                                    PredictionFutureHandle* out_future);
+/*!
+ * \brief Block until an asynchronous prediction completes
+ * \param future handle to the result of the prediction
+ * \param out_result_size used to save length of the output vector,
+ *                        which is guaranteed to be less than or equal to
+ *                        TreelitePredictorQueryResultSize()
+ * \return 0 for success, -1 for failure (including failure of the prediction)
+ */
+TREELITE_DLL int TreelitePredictionFutureWait(PredictionFutureHandle future,
+                                              size_t* out_result_size);
+/*!
+ * \brief Check whether an asynchronous prediction has completed, without
+ *        blocking
+ * \param future handle to the result of the prediction
+ * \param out used to save whether the prediction has completed (1) or not (0)
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictionFutureIsReady(PredictionFutureHandle future,
+                                                 int* out);
+/*!
+ * \brief delete a handle to the result of an asynchronous prediction. It is
+ *        safe to do so before the prediction completes.
+ * \param future handle to remove
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictionFutureFree(PredictionFutureHandle future);
+
 /*!
  * \brief Make predictions on a single data row (synchronously). The work
  *        will be scheduled to the calling thread.
@@ -146,8 +325,9 @@ TREELITE_DLL int TreelitePredictorPredictInst(PredictorHandle handle,
  * \brief Given a batch of data rows, query the necessary size of array to
  *        hold predictions for all data points.
  * \param handle predictor
- * \param batch a batch of rows (must be of type SparseBatch or DenseBatch)
- * \param batch_sparse whether batch is sparse (1) or dense (0)
+ * \param batch a batch of rows (must be of type SparseBatch, DenseBatch or
+ *              QuantizedBatch)
+ * \param batch_sparse whether batch is sparse (1), dense (0) or quantized (2)
  * \param out used to store the length of prediction array
  * \return 0 for success, -1 for failure
  */
@@ -212,6 +392,44 @@ TREELITE_DLL int TreelitePredictorQuerySigmoidAlpha(PredictorHandle handle,
  */
 TREELITE_DLL int TreelitePredictorQueryGlobalBias(PredictorHandle handle,
                                                   float* out);
+/*!
+ * \brief Get the width in bytes of the bins accepted in a quantized batch
+ * \param handle predictor
+ * \param out width of bins (1, 2 or 4); 0 if the loaded library does not accept
+ *            pre-quantized input (it was not compiled with quantize=1)
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictorQueryBinSize(PredictorHandle handle, size_t* out);
+/*!
+ * \brief Get the cut points of a feature, used to convert its values into
+ *        bins. For a numerical feature, the bin of value x is twice the number
+ *        of cut points less than x, plus one if x is a cut point. For a
+ *        categorical feature, the bin is the category itself. A missing value
+ *        is represented by a bin with all bits set.
+ * \param handle predictor
+ * \param fid feature index
+ * \param out_cut_points used to save the ascending list of cut points. The
+ *                       array is valid until the next call to this function
+ *                       from the same thread.
+ * \param out_len used to save the number of cut points
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictorQueryCutPoints(PredictorHandle handle, unsigned int fid,
+                                                 const float** out_cut_points,
+                                                 size_t* out_len);
+/*!
+ * \brief Get the number of threads (including the calling thread) among which
+ *        a batch prediction with the given number of rows would be divided.
+ *        Batches whose estimated cost is small are scored on the calling
+ *        thread alone; see the predictor parameters min_work_per_thread_us and
+ *        row_cost_ns.
+ * \param handle predictor
+ * \param num_row number of rows in the batch
+ * \param out number of threads
+ * \return 0 for success, -1 for failure
+ */
+TREELITE_DLL int TreelitePredictorQueryBatchPlan(PredictorHandle handle,
+                                                 size_t num_row, int* out);
 /*!
  * \brief delete predictor from memory
  * \param handle predictor to remove
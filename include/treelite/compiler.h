@@ -60,6 +60,18 @@ class Compiler {
    * \return compiled model
    */
   virtual compiler::CompiledModel Compile(const Model& model) = 0;
+  /*!
+   * \brief convert tree ensemble model and write the files into a directory.
+   *        Files identical to those already in the directory are left
+   *        untouched. By default, all files are generated with Compile() before
+   *        any is written; a compiler may instead write each file as soon as
+   *        it is complete, to reduce memory usage.
+   * \param model tree ensemble model
+   * \param dirpath directory to write the files into; must exist
+   * \param verbose whether to produce extra messages
+   */
+  virtual void CompileToDirectory(const Model& model, const std::string& dirpath,
+                                  bool verbose);
   /*!
    * \brief create a compiler from given name
    * \param name name of compiler
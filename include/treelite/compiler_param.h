@@ -30,8 +30,27 @@ struct CompilerParam : public dmlc::Parameter<CompilerParam> {
              if set to nonzero, the trees will be evely distributed
              into ``[parallel_comp]`` files. Set this option to improve
              compilation time and reduce memory consumption during
-             compilation. */
+             compilation. By default, tree ``i`` goes to file
+             ``i % parallel_comp``, so that adding trees changes only a few
+             files; see ``unit_partition``. With ``quantize``, a new threshold
+             changes the bin numbers in every file that tests its feature, so
+             most files change anyway. */
   int parallel_comp;
+  /*! \brief how trees are divided into the files of ``parallel_comp``:
+
+             - ``round_robin``: tree ``i`` goes to file ``i % parallel_comp``.
+             - ``balanced``: the files get about the same number of nodes, so
+               that a file with the deepest trees doesn't take much longer to
+               compile than the others.
+             - ``feature``: like ``balanced``, but trees that test the same
+               features are put in the same file, for memory locality.
+
+             With ``balanced`` and ``feature``, adding a tree may move other
+             trees to different files. Each file adds up the outputs of its
+             own trees, so the order of summation, and hence the last bits of
+             the predictions, depend on this setting and on
+             ``parallel_comp``. */
+  std::string unit_partition;
   /*! \brief if >0, produce extra messages */
   int verbose;
   /*! \brief native lib name (without extension) */
@@ -47,6 +66,28 @@ struct CompilerParam : public dmlc::Parameter<CompilerParam> {
              the arrays will be emitted as an ELF binary (Linux only). For large arrays, it is
              much faster to directly dump ELF binaries than to pass them to a C compiler. */
   int dump_array_as_elf;
+  /*! \brief if set to a positive value, also emit the function ``predict_batch_dense()``,
+             which reads rows of a dense matrix directly, treating NaN and a given sentinel
+             value as missing. This lets the runtime skip copying dense input, at the cost of
+             emitting the code for the trees twice. Not applicable when ``quantize`` is set.
+             The ``failsafe`` compiler always emits ``predict_batch_dense()``. */
+  int dense_input;
+  /*! \brief if set to a positive value, lay out the node arrays (the ``nodes[]`` array of the
+             ``failsafe`` compiler and the arrays of folded subtrees) compactly: each node takes
+             12 bytes, nodes are stored in depth-first order so that the left child of a node
+             is the next node, and the default direction for missing values is packed into the
+             feature index. The arrays are aligned to cache lines. */
+  int compact_nodes;
+  /*! \brief if set to a positive value, use the data counts of the nodes (from the model or
+             from ``annotate_in``) to lay out the code: the more frequently taken branch of
+             each test is emitted first, so that it directly follows the test, and subtrees
+             reached by less than 1% of the rows reaching the tree root are moved into
+             functions that are marked cold and placed in a separate file. */
+  int profile_layout;
+  /*! \brief number of threads to use for code generation; use all cores if set to 0. The
+             trees are converted in parallel, and with ``parallel_comp``, so are the
+             translation units. The generated code doesn't depend on the number of threads. */
+  int nthread;
   /*! \} */
 
   // declare parameters
@@ -59,6 +100,8 @@ struct CompilerParam : public dmlc::Parameter<CompilerParam> {
       .describe("option to enable parallel compilation;"
                 "if set to nonzero, the trees will be evely distributed"
                 "into [parallel_comp] files.");
+    DMLC_DECLARE_FIELD(unit_partition).set_default("round_robin")
+      .describe("how trees are divided into files: round_robin, balanced or feature");
     DMLC_DECLARE_FIELD(verbose).set_default(0)
       .describe("if >0, produce extra messages");
     DMLC_DECLARE_FIELD(native_lib_name).set_default("predictor");
@@ -66,6 +109,14 @@ struct CompilerParam : public dmlc::Parameter<CompilerParam> {
        .set_default(std::numeric_limits<double>::infinity())
        .set_lower_bound(0);
     DMLC_DECLARE_FIELD(dump_array_as_elf).set_lower_bound(0).set_default(0);
+    DMLC_DECLARE_FIELD(dense_input).set_lower_bound(0).set_default(0)
+      .describe("if >0, also emit a prediction function that reads dense rows directly");
+    DMLC_DECLARE_FIELD(compact_nodes).set_lower_bound(0).set_default(0)
+      .describe("if >0, lay out node arrays compactly in depth-first order");
+    DMLC_DECLARE_FIELD(profile_layout).set_lower_bound(0).set_default(0)
+      .describe("if >0, use data counts to place hot branches first and outline cold subtrees");
+    DMLC_DECLARE_FIELD(nthread).set_lower_bound(0).set_default(0)
+      .describe("number of threads to use for code generation; 0 to use all cores");
   }
 };
 
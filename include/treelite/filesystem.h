@@ -34,6 +34,30 @@ void WriteToFile(const std::string& filename, const std::string& content);
  */
 void WriteToFile(const std::string& filename, const std::vector<char>& content);
 
+/*!
+ * \brief Check whether a file exists and holds exactly the given bytes
+ * \param filename name of file
+ * \param content bytes to compare against
+ * \param size number of bytes
+ * \return whether the file content is identical
+ */
+bool FileHasContent(const std::string& filename, const char* content, size_t size);
+
+/*!
+ * \brief Check whether two files exist and have identical content
+ * \param filename1 name of first file
+ * \param filename2 name of second file
+ * \return whether the files are identical
+ */
+bool FilesHaveSameContent(const std::string& filename1, const std::string& filename2);
+
+/*!
+ * \brief Rename a file, replacing the destination if it exists already
+ * \param src current name of file
+ * \param dst new name of file
+ */
+void ReplaceFile(const std::string& src, const std::string& dst);
+
 }  // namespace filesystem
 }  // namespace treelite
 
@@ -9,7 +9,13 @@
 
 #include <dmlc/logging.h>
 #include <treelite/entry.h>
+#include <treelite/predictor_param.h>
 #include <string>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <functional>
+#include <exception>
 #include <cstdint>
 
 namespace treelite {
@@ -40,6 +46,74 @@ struct DenseBatch {
   size_t num_col;
 };
 
+/*!
+ * \brief batch of rows whose features were already converted into bins, to be
+ *        scored by a library compiled with CompilerParam::quantize. Each bin
+ *        is an unsigned integer of [bin_size] bytes (see
+ *        Predictor::QueryBinSize()):
+ *          - for a numerical feature with cut points t_0 < t_1 < ... (see
+ *            Predictor::QueryCutPoints()), the bin of value x is twice the
+ *            number of cut points less than x, plus one if x is a cut point;
+ *          - for a categorical feature, the bin is the category itself;
+ *          - a missing value has all bits set.
+ */
+struct QuantizedBatch {
+  /*! \brief bins, in row-major order */
+  const void* data;
+  /*! \brief width of each bin in bytes (1, 2 or 4) */
+  size_t bin_size;
+  /*! \brief number of rows */
+  size_t num_row;
+  /*! \brief number of columns; must equal the number of features */
+  size_t num_col;
+};
+
+struct BatchContext;
+struct Model;
+class Interpreter;
+class MicroBatcher;
+class BatchPlanner;
+
+/*!
+ * \brief callback to be invoked when an asynchronous batch prediction
+ *        completes. The first argument is the length of the output vector;
+ *        the second argument holds the error if the prediction failed, and is
+ *        null otherwise. The callback runs on a worker thread (or on the
+ *        calling thread if the predictor has no worker thread) and must not
+ *        throw. The prediction is already complete when the callback is
+ *        invoked, so PredictionFuture::Wait() may be called from inside the
+ *        callback; conversely, Wait() may return before the callback
+ *        finishes.
+ */
+typedef std::function<void(size_t, std::exception_ptr)> PredictionCallback;
+
+/*! \brief handle to the result of an asynchronous batch prediction */
+class PredictionFuture {
+ public:
+  PredictionFuture() = default;
+  /*!
+   * \brief check whether the prediction has completed (successfully or not),
+   *        without blocking
+   */
+  bool IsReady() const;
+  /*!
+   * \brief block until the prediction completes. If the prediction failed,
+   *        the error is re-thrown.
+   * \return length of the output vector
+   */
+  size_t Wait() const;
+  /*! \brief whether this object refers to a prediction */
+  inline bool Valid() const {
+    return context_ != nullptr;
+  }
+
+ private:
+  friend class Predictor;
+  explicit PredictionFuture(std::shared_ptr<BatchContext> context)
+    : context_(std::move(context)) {}
+  std::shared_ptr<BatchContext> context_;
+};
+
 /*! \brief predictor class: wrapper for optimized prediction code */
 class Predictor {
  public:
@@ -49,21 +123,67 @@ class Predictor {
   typedef void* LibraryHandle;
   typedef void* ThreadPoolHandle;
 
-  explicit Predictor(int num_worker_thread = -1);
+  /*!
+   * \brief create a predictor; call Load() to load the prediction code, or
+   *        LoadModel() to score a model without compiling it
+   * \param num_worker_thread number of worker threads (-1 to use one thread
+   *                          per CPU available to the process). It may not
+   *                          exceed the number of CPUs available; see
+   *                          PredictorParam::cpu_list.
+   * \param params runtime parameters (name-value pairs) to set before the
+   *               worker threads start; see PredictorParam. Parameters can
+   *               also be changed later with SetParam().
+   */
+  explicit Predictor(int num_worker_thread = -1,
+                     const std::vector<std::pair<std::string, std::string>>& params = {});
   ~Predictor();
+  Predictor(const Predictor&) = delete;
+  Predictor& operator=(const Predictor&) = delete;
   /*!
    * \brief load the prediction function from dynamic shared library.
    * \param name name of dynamic shared library (.so/.dll/.dylib).
    */
   void Load(const char* name);
+  /*!
+   * \brief load a model to be scored in-process by an interpreter, without
+   *        compiling it into a shared library first. The predictor makes its
+   *        own copy of the trees, so the model may be discarded afterwards.
+   *        Predictions are identical to those made by a library compiled from
+   *        the same model, but are slower to compute.
+   * \param model model to load
+   */
+  void LoadModel(const Model& model);
+  /*!
+   * \brief load a model serialized with Model::ReferenceSerialize() (or
+   *        TreeliteSerializeModel()), to be scored in-process by an
+   *        interpreter; see LoadModel()
+   * \param path path to the serialized model
+   */
+  void LoadModelFile(const char* path);
   /*!
    * \brief unload the prediction function
    */
   void Free();
+  /*!
+   * \brief set a runtime parameter; see PredictorParam for the list of
+   *        available parameters. Do not call this function while another
+   *        thread is making predictions with this predictor.
+   * \param name name of parameter
+   * \param value value of parameter
+   */
+  void SetParam(const std::string& name, const std::string& value);
 
   /*!
    * \brief Make predictions on a batch of data rows (synchronously). This
    *        function internally divides the workload among all worker threads.
+   *        Worker threads claim rows in chunks of PredictorParam::chunk_size
+   *        rows, and idle threads steal unclaimed rows from busy ones.
+   *        If the library exports predict_batch(), each chunk is scored in
+   *        blocks of rows, one tree at a time. If the library exports
+   *        predict_batch_dense() (see CompilerParam::dense_input), the rows of
+   *        a dense batch are read in place instead of being copied.
+   *        This function is thread-safe: multiple threads may call it at
+   *        once, in which case they share the same pool of worker threads.
    * \param batch a batch of rows
    * \param verbose whether to produce extra messages
    * \param pred_margin whether to produce raw margin scores instead of
@@ -77,9 +197,49 @@ class Predictor {
                       bool pred_margin, float* out_result);
   size_t PredictBatch(const DenseBatch* batch, int verbose,
                       bool pred_margin, float* out_result);
+  size_t PredictBatch(const QuantizedBatch* batch, int verbose,
+                      bool pred_margin, float* out_result);
+  /*!
+   * \brief Make predictions on a batch of data rows (asynchronously). The
+   *        work is handed off to the worker threads and this function returns
+   *        right away, so that the calling thread may do other work in the
+   *        meantime. The arrays referred to by the batch and out_result must
+   *        remain valid until the prediction completes; the batch object
+   *        itself may be discarded as soon as this function returns. The
+   *        predictor must not be freed before the prediction completes.
+   *        Likewise, do not call Load(), LoadModel(), LoadModelFile(), Free()
+   *        or SetParam() while asynchronous predictions are outstanding: wait
+   *        for them to complete first. (Should one of these functions restart
+   *        the worker threads anyway, it blocks until the outstanding
+   *        predictions complete, instead of abandoning them.)
+   * \param batch a batch of rows
+   * \param verbose whether to produce extra messages
+   * \param pred_margin whether to produce raw margin scores instead of
+   *                    transformed probabilities
+   * \param out_result resulting output vector; use
+   *                   QueryResultSize() to allocate sufficient space
+   * \param callback (optional) function to be invoked once the prediction
+   *                 completes
+   * \return future to be used to wait for the prediction and to obtain the
+   *         length of the output vector
+   */
+  PredictionFuture PredictBatchAsync(const CSRBatch* batch, int verbose,
+                                     bool pred_margin, float* out_result,
+                                     PredictionCallback callback = nullptr);
+  PredictionFuture PredictBatchAsync(const DenseBatch* batch, int verbose,
+                                     bool pred_margin, float* out_result,
+                                     PredictionCallback callback = nullptr);
+  PredictionFuture PredictBatchAsync(const QuantizedBatch* batch, int verbose,
+                                     bool pred_margin, float* out_result,
+                                     PredictionCallback callback = nullptr);
   /*!
    * \brief Make predictions on a single data row (synchronously). The work
-   *        will be scheduled to the calling thread.
+   *        will be scheduled to the calling thread. If micro-batching is
+   *        enabled (see PredictorParam::microbatch_max_rows), rows submitted
+   *        concurrently by multiple threads are instead collected into a
+   *        batch, which is scored with the worker threads. Otherwise, if
+   *        PredictorParam::inst_num_thread is not 1, the trees are divided
+   *        among the calling thread and the worker threads.
    * \param inst single data row
    * \param pred_margin whether to produce raw margin scores instead of
    *                    transformed probabilities
@@ -98,8 +258,8 @@ class Predictor {
    * \return length of prediction array
    */
   inline size_t QueryResultSize(const CSRBatch* batch) const {
-    CHECK(pred_func_handle_ != nullptr)
-      << "A shared library needs to be loaded first using Load()";
+    CHECK(IsLoaded_())
+      << "A model needs to be loaded first using Load() or LoadModel()";
     return batch->num_row * num_output_group_;
   }
   /*!
@@ -109,8 +269,19 @@ class Predictor {
    * \return length of prediction array
    */
   inline size_t QueryResultSize(const DenseBatch* batch) const {
-    CHECK(pred_func_handle_ != nullptr)
-      << "A shared library needs to be loaded first using Load()";
+    CHECK(IsLoaded_())
+      << "A model needs to be loaded first using Load() or LoadModel()";
+    return batch->num_row * num_output_group_;
+  }
+  /*!
+   * \brief Given a batch of data rows, query the necessary size of array to
+   *        hold predictions for all data points.
+   * \param batch a batch of rows
+   * \return length of prediction array
+   */
+  inline size_t QueryResultSize(const QuantizedBatch* batch) const {
+    CHECK(IsLoaded_())
+      << "A model needs to be loaded first using Load() or LoadModel()";
     return batch->num_row * num_output_group_;
   }
   /*!
@@ -123,8 +294,8 @@ class Predictor {
    */
   inline size_t QueryResultSize(const CSRBatch* batch,
                                 size_t rbegin, size_t rend) const {
-    CHECK(pred_func_handle_ != nullptr)
-      << "A shared library needs to be loaded first using Load()";
+    CHECK(IsLoaded_())
+      << "A model needs to be loaded first using Load() or LoadModel()";
     CHECK(rbegin < rend && rend <= batch->num_row);
     return (rend - rbegin) * num_output_group_;
   }
@@ -138,8 +309,23 @@ class Predictor {
    */
   inline size_t QueryResultSize(const DenseBatch* batch,
                                 size_t rbegin, size_t rend) const {
-    CHECK(pred_func_handle_ != nullptr)
-      << "A shared library needs to be loaded first using Load()";
+    CHECK(IsLoaded_())
+      << "A model needs to be loaded first using Load() or LoadModel()";
+    CHECK(rbegin < rend && rend <= batch->num_row);
+    return (rend - rbegin) * num_output_group_;
+  }
+  /*!
+   * \brief Given a batch of data rows, query the necessary size of array to
+   *        hold predictions for all data points.
+   * \param batch a batch of rows
+   * \param rbegin beginning of range of rows
+   * \param rend end of range of rows
+   * \return length of prediction array
+   */
+  inline size_t QueryResultSize(const QuantizedBatch* batch,
+                                size_t rbegin, size_t rend) const {
+    CHECK(IsLoaded_())
+      << "A model needs to be loaded first using Load() or LoadModel()";
     CHECK(rbegin < rend && rend <= batch->num_row);
     return (rend - rbegin) * num_output_group_;
   }
@@ -149,8 +335,8 @@ class Predictor {
    * \return length of prediction array
    */
   inline size_t QueryResultSizeSingleInst() const {
-    CHECK(pred_func_handle_ != nullptr)
-      << "A shared library needs to be loaded first using Load()";
+    CHECK(IsLoaded_())
+      << "A model needs to be loaded first using Load() or LoadModel()";
     return num_output_group_;
   }
   /*!
@@ -196,6 +382,35 @@ class Predictor {
     return global_bias_;
   }
 
+  /*!
+   * \brief Get the number of threads (including the calling thread) among
+   *        which PredictBatch() would divide a batch of the given size. The
+   *        number is chosen from the estimated cost of the batch; see
+   *        PredictorParam::min_work_per_thread_us and
+   *        PredictorParam::row_cost_ns.
+   * \param num_row number of rows in the batch
+   * \return number of threads; 1 means that the batch would be scored on
+   *         the calling thread alone
+   */
+  int PlanBatch(size_t num_row) const;
+
+  /*!
+   * \brief Get the width in bytes of the bins accepted by
+   *        PredictBatch(const QuantizedBatch*, ...)
+   * \return 1, 2 or 4; 0 if the loaded library does not accept pre-quantized
+   *         input, i.e. it was not compiled with CompilerParam::quantize
+   */
+  size_t QueryBinSize() const;
+  /*!
+   * \brief Get the cut points of a feature, used to convert its values into
+   *        bins; see QuantizedBatch
+   * \param fid feature index
+   * \return ascending list of cut points; empty if the feature is not used by
+   *         any numerical split, or if the library does not accept
+   *         pre-quantized input
+   */
+  std::vector<float> QueryCutPoints(unsigned fid) const;
+
  private:
   LibraryHandle lib_handle_;
   QueryFuncHandle num_output_group_query_func_handle_;
@@ -204,6 +419,25 @@ class Predictor {
   QueryFuncHandle sigmoid_alpha_query_func_handle_;
   QueryFuncHandle global_bias_query_func_handle_;
   PredFuncHandle pred_func_handle_;
+  PredFuncHandle batch_pred_func_handle_;
+    // predict_batch() function, which scores a block of rows at a time;
+    // null if the library does not export one
+  PredFuncHandle dense_batch_pred_func_handle_;
+    // predict_batch_dense() function, which reads rows of a dense matrix
+    // directly; null if the library does not export one
+  PredFuncHandle quantized_batch_pred_func_handle_;
+  QueryFuncHandle bin_size_query_func_handle_;
+  QueryFuncHandle cut_points_query_func_handle_;
+    // predict_batch_quantized(), get_bin_size() and get_cut_points()
+    // functions, for rows of pre-quantized bins; null if the library does
+    // not export them
+  PredFuncHandle unit_pred_func_handle_;
+  PredFuncHandle preprocess_func_handle_;
+  PredFuncHandle postprocess_func_handle_;
+    // predict_margin_unit(), preprocess_batch() and postprocess_batch()
+    // functions, used to score the translation units of a single instance in
+    // parallel; null if the library does not export them
+  size_t num_unit_;  // number of translation units; 0 if not available
   ThreadPoolHandle thread_pool_handle_;
   size_t num_output_group_;
   size_t num_feature_;
@@ -211,10 +445,30 @@ class Predictor {
   float sigmoid_alpha_;
   float global_bias_;
   int num_worker_thread_;
+  bool auto_num_worker_thread_;
+    // whether num_worker_thread_ is chosen from the CPUs available to the process
+  std::unique_ptr<Interpreter> interpreter_;
+    // interpreter used in place of the prediction functions when a model was
+    // loaded with LoadModel(); null otherwise
+  PredictorParam param_;
+  std::vector<std::pair<std::string, std::string>> cfg_;
+  std::unique_ptr<MicroBatcher> micro_batcher_;
+  std::shared_ptr<BatchPlanner> batch_planner_;
+    // shared with batch contexts, which report the time spent scoring rows
 
+  inline bool IsLoaded_() const {
+    return pred_func_handle_ != nullptr || interpreter_ != nullptr;
+  }
+  void ConfigureMicroBatcher_();
+  void StartThreadPool_(const std::vector<int>& cpus);
   template <typename BatchType>
-  size_t PredictBatchBase_(const BatchType* batch, int verbose,
-                           bool pred_margin, float* out_result);
+  std::shared_ptr<BatchContext> PredictBatchBase_(const BatchType* batch, int verbose,
+                                                  bool pred_margin, float* out_result,
+                                                  PredictionCallback callback, bool async);
+  /*! \brief check that a quantized batch can be scored by the loaded library */
+  void CheckQuantizedBatch_(const QuantizedBatch* batch) const;
+  size_t PredictInstParallel_(TreelitePredictorEntry* inst, bool pred_margin,
+                              float* out_result, size_t num_thread);
 };
 
 }  // namespace treelite
@@ -0,0 +1,149 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file predictor_param.h
+ * \brief Parameters for prediction runtime
+ * \author Hyunsu Cho
+ */
+#ifndef TREELITE_PREDICTOR_PARAM_H_
+#define TREELITE_PREDICTOR_PARAM_H_
+
+#include <dmlc/parameter.h>
+#include <string>
+
+namespace treelite {
+
+/*! \brief how idle threads wait; see PredictorParam::wait_policy */
+enum class WaitPolicy : int {
+  kSpin = 0, kSpinThenPark = 1, kPark = 2, kFutex = 3
+};
+
+/*! \brief parameters for prediction runtime */
+struct PredictorParam : public dmlc::Parameter<PredictorParam> {
+  /*!
+  * \defgroup predictor_param
+  * parameters for prediction runtime
+  * \{
+  */
+  /*! \brief number of rows a worker thread claims at a time during batch
+             prediction. Each thread starts with an equal share of the batch;
+             a thread that finishes its share early steals half of the rows
+             not yet claimed by another thread. Smaller chunks balance the
+             workload better, at the cost of more synchronization. Set to 0
+             to choose the chunk size automatically from the batch size. */
+  int chunk_size;
+  /*! \brief if greater than 1, single-instance predictions made concurrently
+             by multiple threads are collected into micro-batches of up to
+             [microbatch_max_rows] rows, which are scored together with the
+             batch prediction path. Set to 0 to make each single-instance
+             prediction on its calling thread. */
+  int microbatch_max_rows;
+  /*! \brief maximum time (in microseconds) that a single-instance prediction
+             waits for other requests to join its micro-batch. The prediction
+             does not wait at all when no other thread is making one. Only
+             applicable when microbatch_max_rows is greater than 1. */
+  int microbatch_timeout_us;
+  /*! \brief number of threads (including the calling thread) among which the
+             trees are divided when making a single-instance prediction. The
+             trees of a model are divided into as many translation units as
+             given by the ``parallel_comp`` compiler parameter, and each
+             thread scores a subset of the units; the partial margin scores
+             are then added together. This reduces the latency of
+             single-instance prediction for large ensembles. Set to 1 to score
+             all trees on the calling thread, or to 0 to use all worker
+             threads. Not applicable when micro-batching is enabled, or when
+             the library was compiled without ``parallel_comp``. */
+  int inst_num_thread;
+  /*! \brief list of CPUs to which the worker threads are bound, in the format
+             used by Linux (e.g. "0-3,8,10-11"). Worker thread i is bound to
+             the (i+1)-th CPU in the list; the first CPU is left for the
+             calling thread, which is never bound. Leave empty to use the CPUs
+             in the affinity mask that the process inherited (e.g. from
+             ``taskset`` or a container runtime), without binding the worker
+             threads to any of them unless numa_node is set. The number of
+             worker threads may not exceed the number of CPUs in this list,
+             capped by the CPU quota of the control group of the process; when
+             it is not given explicitly, it is set to that number. Set the
+             environment variable TREELITE_BIND_THREADS to 0 to disable
+             binding altogether. */
+  std::string cpu_list;
+  /*! \brief if non-negative, only the CPUs that belong to this NUMA node are
+             used (among those given by cpu_list), and the worker threads are
+             bound to them as described for cpu_list. Running one process per
+             NUMA node keeps both the threads and the memory they allocate
+             local to the node. Set to -1 to use CPUs on all nodes. */
+  int numa_node;
+  /*! \brief how threads wait when there is nothing to do: worker threads
+             waiting for prediction tasks, and callers waiting for worker
+             threads to finish. Possible values:
+
+             - ``spin``: keep checking for work without ever going to sleep.
+               Gives the lowest latency, at the cost of keeping one CPU core
+               busy per thread, even when the predictor is idle.
+             - ``spin_then_park``: spin [spin_count] times, then go to sleep
+               until woken up.
+             - ``park``: go to sleep immediately. An idle predictor uses no
+               CPU time, but each task incurs the latency of a wakeup.
+             - ``futex``: like ``spin_then_park``, but sleep on a futex instead
+               of a mutex and condition variable, which makes waking up
+               cheaper. Only available on Linux; elsewhere it behaves like
+               ``spin_then_park``. */
+  int wait_policy;
+  /*! \brief number of times a thread checks for work (yielding the CPU in
+             between) before going to sleep. Only applicable when
+             wait_policy is ``spin_then_park`` or ``futex``. */
+  int spin_count;
+  /*! \brief minimum amount of work (in microseconds) worth handing to one more
+             thread during batch prediction. The rows of a batch are divided
+             among as many threads as the estimated cost of the batch allows,
+             so that a batch of a few rows is scored on the calling thread
+             alone, without waking up any worker thread. The cost of a batch
+             is the number of rows times the cost of scoring one row (see
+             row_cost_ns). Set to 0 to always use all worker threads. */
+  float min_work_per_thread_us;
+  /*! \brief cost (in nanoseconds) of scoring one row on one thread, which
+             grows with the number of trees and their depth. Set to 0 to
+             measure the cost from the batch predictions made so far; until
+             the first batch prediction completes, all worker threads are
+             used. */
+  float row_cost_ns;
+  /*! \} */
+
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(PredictorParam) {
+    DMLC_DECLARE_FIELD(chunk_size).set_lower_bound(0).set_default(0)
+      .describe("number of rows a worker thread claims at a time during batch "
+                "prediction; set to 0 to choose automatically");
+    DMLC_DECLARE_FIELD(microbatch_max_rows).set_lower_bound(0).set_default(0)
+      .describe("maximum number of single-instance predictions to collect into "
+                "a micro-batch; set to 0 to disable micro-batching");
+    DMLC_DECLARE_FIELD(microbatch_timeout_us).set_lower_bound(0).set_default(100)
+      .describe("maximum time (in microseconds) to wait for a micro-batch to fill up");
+    DMLC_DECLARE_FIELD(inst_num_thread).set_lower_bound(0).set_default(1)
+      .describe("number of threads among which the trees are divided when making a "
+                "single-instance prediction; set to 0 to use all threads");
+    DMLC_DECLARE_FIELD(cpu_list).set_default("")
+      .describe("list of CPUs to which the worker threads are bound, e.g. \"0-3,8\"; "
+                "leave empty to use the CPUs in the affinity mask of the process, "
+                "without binding");
+    DMLC_DECLARE_FIELD(numa_node).set_lower_bound(-1).set_default(-1)
+      .describe("NUMA node whose CPUs the worker threads are bound to; "
+                "set to -1 to use all nodes");
+    DMLC_DECLARE_FIELD(wait_policy).set_default(static_cast<int>(WaitPolicy::kSpinThenPark))
+      .add_enum("spin", static_cast<int>(WaitPolicy::kSpin))
+      .add_enum("spin_then_park", static_cast<int>(WaitPolicy::kSpinThenPark))
+      .add_enum("park", static_cast<int>(WaitPolicy::kPark))
+      .add_enum("futex", static_cast<int>(WaitPolicy::kFutex))
+      .describe("how threads wait when there is nothing to do");
+    DMLC_DECLARE_FIELD(spin_count).set_lower_bound(0).set_default(300000)
+      .describe("number of times to check for work before going to sleep");
+    DMLC_DECLARE_FIELD(min_work_per_thread_us).set_lower_bound(0.0f).set_default(20.0f)
+      .describe("minimum amount of work (in microseconds) worth handing to one more "
+                "thread; set to 0 to always use all threads");
+    DMLC_DECLARE_FIELD(row_cost_ns).set_lower_bound(0.0f).set_default(0.0f)
+      .describe("cost (in nanoseconds) of scoring one row; set to 0 to measure it");
+  }
+};
+
+}  // namespace treelite
+
+#endif  // TREELITE_PREDICTOR_PARAM_H_
@@ -341,6 +341,11 @@ class Tree {
   inline void SetGain(int nid, double gain);
 
   void ReferenceSerialize(dmlc::Stream* fo) const;
+  /*!
+   * \brief read a tree written by ReferenceSerialize()
+   * \param fi input stream
+   */
+  void ReferenceDeserialize(dmlc::Stream* fi);
 };
 
 struct ModelParam {
@@ -432,6 +437,11 @@ struct Model {
   Model& operator=(Model&&) = default;
 
   void ReferenceSerialize(dmlc::Stream* fo) const;
+  /*!
+   * \brief read a model written by ReferenceSerialize()
+   * \param fi input stream
+   */
+  void ReferenceDeserialize(dmlc::Stream* fi);
 
   inline std::vector<PyBufferFrame> GetPyBuffer();
   inline void InitFromPyBuffer(std::vector<PyBufferFrame> frames);
@@ -109,8 +109,8 @@ def generate_makefile(dirpath, platform, toolchain, options=None):  # pylint: di
                                          toolchain=toolchain,
                                          options=options)))
         for source in recipe['sources']:
-            f.write('{}: {}\n'.format(source['name'] + obj_ext,
-                                      source['name'] + '.c'))
+            f.write('{}: {} header.h\n'.format(source['name'] + obj_ext,
+                                               source['name'] + '.c'))
             f.write('\t{}\n'.format(_obj_cmd(source=source['name'],
                                              toolchain=toolchain,
                                              options=options)))
@@ -179,7 +179,8 @@ def generate_cmakelists(dirpath, options=None):
         ''', file=f)
 
 
-def create_shared(toolchain, dirpath, nthread=None, verbose=False, options=None):
+def create_shared(toolchain, dirpath, nthread=None, verbose=False, options=None,
+                  cache_dir=None):
     """Create shared library.
 
     Parameters
@@ -199,6 +200,11 @@ def create_shared(toolchain, dirpath, nthread=None, verbose=False, options=None)
     options : :py:class:`list <python:list>` of :py:class:`str <python:str>`, \
               optional
         Additional options to pass to toolchain
+    cache_dir : :py:class:`str <python:str>`, optional
+        directory of the compile cache. Object files are looked up by the digest
+        of their source, of the headers and of the compile command, and only
+        the missing ones are compiled (and then added to the cache). The cache
+        is not used if ``cache_dir`` is not given.
 
     Returns
     -------
@@ -272,8 +278,11 @@ def create_shared(toolchain, dirpath, nthread=None, verbose=False, options=None)
         from .msvc import _create_shared
     else:
         from .gcc import _create_shared
+    if cache_dir is not None:
+        cache_dir = os.path.abspath(expand_windows_path(cache_dir))
+        os.makedirs(cache_dir, exist_ok=True)
     libpath = \
-        _create_shared(dirpath, toolchain, recipe, nthread, options, verbose)
+        _create_shared(dirpath, toolchain, recipe, nthread, options, verbose, cache_dir)
     if verbose:
         log_info(__file__, lineno(),
                  'Generated shared library in ' + \
@@ -3,7 +3,7 @@
 Tools to interact with toolchains GCC, Clang, and other UNIX compilers
 """
 
-from .util import _create_shared_base, _libext
+from .util import _create_shared_base, _libext, _toolchain_version
 
 LIBEXT = _libext()
 
@@ -24,7 +24,8 @@ def _lib_cmd(objects, target, lib_ext, toolchain, options):
                 ' '.join(objects), ' '.join(options))
 
 
-def _create_shared(dirpath, toolchain, recipe, nthread, options, verbose):  # pylint: disable=R0913
+def _create_shared(dirpath, toolchain, recipe, nthread, options, verbose,  # pylint: disable=R0913
+                   cache_dir=None):
     options += ['-lm']
     # Specify command to compile an object file
     recipe['object_ext'] = _obj_ext()
@@ -40,7 +41,9 @@ def _create_shared(dirpath, toolchain, recipe, nthread, options, verbose):  # py
     recipe['create_object_cmd'] = obj_cmd
     recipe['create_library_cmd'] = lib_cmd
     recipe['initial_cmd'] = ''
-    return _create_shared_base(dirpath, recipe, nthread, verbose)
+    if cache_dir is not None:
+        recipe['toolchain_version'] = _toolchain_version(toolchain)
+    return _create_shared_base(dirpath, recipe, nthread, verbose, cache_dir)
 
 
 __all__ = []
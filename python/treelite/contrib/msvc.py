@@ -8,7 +8,7 @@ import os
 import glob
 import re
 from distutils.version import StrictVersion
-from .util import _create_shared_base, _libext
+from .util import _create_shared_base, _libext, _toolchain_version
 
 LIBEXT = _libext()
 
@@ -97,7 +97,8 @@ def _lib_cmd(objects, target, lib_ext, toolchain, options):
 
 
 # pylint: disable=R0913
-def _create_shared(dirpath, toolchain, recipe, nthread, options, verbose):
+def _create_shared(dirpath, toolchain, recipe, nthread, options, verbose,  # pylint: disable=R0913
+                   cache_dir=None):
     # Specify command to compile an object file
     recipe['object_ext'] = _obj_ext()
     recipe['library_ext'] = LIBEXT
@@ -114,7 +115,9 @@ def _create_shared(dirpath, toolchain, recipe, nthread, options, verbose):
     recipe['initial_cmd'] = '\"{}\" {}\n' \
         .format(_varsall_bat_path(),
                 'amd64' if _is_64bit_windows() else 'x86')
-    return _create_shared_base(dirpath, recipe, nthread, verbose)
+    if cache_dir is not None:
+        recipe['toolchain_version'] = _toolchain_version(toolchain)
+    return _create_shared_base(dirpath, recipe, nthread, verbose, cache_dir)
 
 
 __all__ = []
@@ -3,6 +3,8 @@
 
 from __future__ import absolute_import as _abs
 import os
+import shutil
+import hashlib
 import subprocess
 from sys import platform as _platform
 from multiprocessing import cpu_count
@@ -23,6 +25,58 @@ def _toolchain_exist_check(toolchain):
                              + 'that it is a variant of GCC or Clang.')
 
 
+def _toolchain_version(toolchain):
+    """Identify the exact toolchain build, so that cached objects are not reused
+    after the toolchain is upgraded"""
+    if toolchain == 'msvc':
+        return 'msvc'
+    try:
+        return subprocess.check_output(f'{toolchain} --version', shell=True,
+                                       stdin=subprocess.DEVNULL,
+                                       stderr=subprocess.DEVNULL).decode()
+    except subprocess.CalledProcessError:
+        return toolchain
+
+
+def _hash_file(hasher, path):
+    with open(path, 'rb') as f:
+        for chunk in iter(lambda: f.read(1 << 20), b''):
+            hasher.update(chunk)
+
+
+def _cache_fetch(cache_path, dest):
+    """Copy an entry of the compile cache to dest; return False on a miss"""
+    if not os.path.isfile(cache_path):
+        return False
+    shutil.copyfile(cache_path, dest)
+    return True
+
+
+def _cache_store(src, cache_path):
+    """Add a file to the compile cache. The file is renamed into place, so that
+    concurrent builds never observe a partially written entry."""
+    temp_path = '{}.{}.tmp'.format(cache_path, os.getpid())
+    shutil.copyfile(src, temp_path)
+    os.replace(temp_path, cache_path)
+
+
+def _object_cache_keys(dirpath, recipe):
+    """Compute the cache key of every object file: the digest of its source,
+    of all headers in dirpath and of the command that compiles it"""
+    header_hasher = hashlib.sha256()
+    for header in sorted(x for x in os.listdir(dirpath) if x.endswith('.h')):
+        header_hasher.update(header.encode())
+        _hash_file(header_hasher, os.path.join(dirpath, header))
+    keys = {}
+    for source in recipe['sources']:
+        hasher = header_hasher.copy()
+        hasher.update(recipe.get('toolchain_version', '').encode())
+        hasher.update(recipe['create_object_cmd'](source['name']).encode())
+        _hash_file(hasher, os.path.join(dirpath, source['name'] + '.c'))
+        keys[source['name']] = hasher.hexdigest()
+    return keys
+
+
 def _shell():
     if _is_windows():
         return 'cmd.exe'
@@ -89,8 +143,8 @@ def _wait(proc, args):
     return {'stdout': stdout.decode(), 'retcode': retcode}
 
 
-# pylint: disable=R0914
-def _create_shared_base(dirpath, recipe, nthread, verbose):
+# pylint: disable=R0912,R0914
+def _create_shared_base(dirpath, recipe, nthread, verbose, cache_dir=None):
     # Fetch toolchain-specific commands
     obj_cmd = recipe['create_object_cmd']
     lib_cmd = recipe['create_library_cmd']
@@ -99,13 +153,28 @@ def _create_shared_base(dirpath, recipe, nthread, verbose):
     save_retcode_cmd \
         = _save_retcode_cmd_windows if _is_windows() else _save_retcode_cmd_unix
 
-    # 1. Compile sources in parallel
+    # 1. Fetch object files from the compile cache, if any
+    sources = recipe['sources']
+    if cache_dir is not None:
+        cache_keys = _object_cache_keys(dirpath, recipe)
+        sources = [x for x in recipe['sources']
+                   if not _cache_fetch(os.path.join(cache_dir, cache_keys[x['name']]
+                                                    + recipe['object_ext']),
+                                       os.path.join(dirpath, x['name'] + recipe['object_ext']))]
+        if verbose:
+            log_info(__file__, lineno(),
+                     'Found {} of {} object files in the compile cache {}' \
+                     .format(len(recipe['sources']) - len(sources),
+                             len(recipe['sources']), cache_dir))
+
+    # 2. Compile sources in parallel
     if verbose:
         log_info(__file__, lineno(),
                  'Compiling sources files in directory {} '.format(dirpath) + \
                  'into object files (*{})...'.format(recipe['object_ext']))
     ncore = cpu_count()
     ncpu = min(ncore, nthread) if nthread is not None else ncore
+    ncpu = max(min(ncpu, len(sources)), 1)
     workqueue = [{
         'tid': tid,
         'queue': [],
@@ -114,7 +183,7 @@ def _create_shared_base(dirpath, recipe, nthread, verbose):
         'create_log_cmd': create_log_cmd,
         'save_retcode_cmd': save_retcode_cmd
     } for tid in range(ncpu)]
-    for i, source in enumerate(recipe['sources']):
+    for i, source in enumerate(sources):
         workqueue[i % ncpu]['queue'].append(obj_cmd(source['name']))
     proc = [_enqueue(workqueue[tid]) for tid in range(ncpu)]
     result = []
@@ -127,8 +196,13 @@ def _create_shared_base(dirpath, recipe, nthread, verbose):
                 f.write(result[tid]['stdout'] + '\n')
             raise TreeliteError('Error occured in worker #{}: '.format(tid) + \
                                 '{}'.format(result[tid]['stdout']))
+    if cache_dir is not None:
+        for source in sources:
+            _cache_store(os.path.join(dirpath, source['name'] + recipe['object_ext']),
+                         os.path.join(cache_dir, cache_keys[source['name']]
+                                      + recipe['object_ext']))
 
-    # 2. Package objects into a dynamic shared library
+    # 3. Package objects into a dynamic shared library
     if verbose:
         log_info(__file__, lineno(),
                  'Generating dynamic shared library {}...' \
@@ -154,7 +228,7 @@ def _create_shared_base(dirpath, recipe, nthread, verbose):
         raise TreeliteError('Error occured while creating dynamic library: ' + \
                             '{}'.format(result['stdout']))
 
-    # 3. Clean up
+    # 4. Clean up
     for tid in range(ncpu):
         os.remove(os.path.join(dirpath, 'retcode_cpu{}.txt').format(tid))
 
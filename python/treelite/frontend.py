@@ -3,13 +3,16 @@
 from __future__ import absolute_import as _abs
 import ctypes
 import collections
+import hashlib
+import json
 import shutil
 import os
 from tempfile import TemporaryDirectory
 
-from .util import c_str, TreeliteError
+from .util import c_str, TreeliteError, lineno, log_info
 from .core import _LIB, c_array, _check_call
 from .contrib import create_shared, generate_makefile, generate_cmakelists, _toolchain_exist_check
+from .contrib.util import _libext, _toolchain_version, _hash_file, _cache_fetch, _cache_store
 
 
 def _isascii(string):
@@ -51,6 +54,21 @@ class Model():
             raise AttributeError('Model not loaded yet')
         _check_call(_LIB.TreeliteSetTreeLimit(self.handle, ctypes.c_size_t(tree_limit)))
 
+    def serialize(self, filename):
+        """
+        Serialize the model to a file. The runtime can score the serialized
+        model in-process, without compiling it first; see the ``model``
+        argument of :py:class:`treelite_runtime.Predictor`.
+
+        Parameters
+        ----------
+        filename : :py:class:`str <python:str>`
+            name of the file to write
+        """
+        if self.handle is None:
+            raise AttributeError('Model not loaded yet')
+        _check_call(_LIB.TreeliteSerializeModel(self.handle, c_str(filename)))
+
     @property
     def num_tree(self):
         """Number of decision trees in the model"""
@@ -80,7 +98,7 @@ class Model():
 
     # pylint: disable=R0913
     def export_lib(self, toolchain, libpath, params=None, compiler='ast_native',
-                   verbose=False, nthread=None, options=None):
+                   verbose=False, nthread=None, options=None, cache_dir=None):
         """
         Convenience function: Generate prediction code and immediately turn it
         into a dynamic shared library. A temporary directory will be created to
@@ -107,6 +125,12 @@ class Model():
         options : :py:class:`list <python:list>` of :py:class:`str <python:str>`, \
                   optional
             Additional options to pass to toolchain
+        cache_dir : :py:class:`str <python:str>`, optional
+            directory of the compile cache. The library is looked up by the
+            digest of the serialized model, the compiler, its parameters, the
+            toolchain and the options; on a hit, it is copied to ``libpath``
+            without generating or compiling any code. On a miss, unchanged
+            object files are still reused (see :py:meth:`create_shared`).
 
         Example
         -------
@@ -129,13 +153,52 @@ class Model():
         """
         _toolchain_exist_check(toolchain)
         with TemporaryDirectory(dir=os.path.dirname(libpath)) as temp_dir:
+            cached_libpath = None
+            if cache_dir is not None:
+                os.makedirs(cache_dir, exist_ok=True)
+                cache_key = self._cache_key(temp_dir, params, compiler, toolchain, options)
+                cached_libpath = os.path.join(cache_dir, cache_key + _libext())
+                if os.path.exists(libpath) and os.path.isfile(libpath):
+                    os.remove(libpath)
+                if _cache_fetch(cached_libpath, libpath):
+                    if verbose:
+                        log_info(__file__, lineno(),
+                                 'Found library {} in the compile cache'.format(cached_libpath))
+                    return
             self.compile(temp_dir, params, compiler, verbose)
             temp_libpath = create_shared(toolchain, temp_dir, nthread,
-                                         verbose, options)
+                                         verbose, options, cache_dir)
+            if cached_libpath is not None:
+                _cache_store(temp_libpath, cached_libpath)
             if os.path.exists(libpath) and os.path.isfile(libpath):
                 os.remove(libpath)
             shutil.move(temp_libpath, libpath)
 
+    def _cache_key(self, temp_dir, params, compiler, toolchain, options):
+        """
+        Compute the key of the library in the compile cache: the digest of the
+        serialized model, along with everything else that affects the library
+        """
+        from . import __version__  # pylint: disable=C0415
+        _params = dict(params) if isinstance(params, list) else params
+        hasher = hashlib.sha256()
+        hasher.update(json.dumps({
+            'version': __version__,
+            'compiler': compiler,
+            'params': {str(k): str(v) for k, v in (_params or {}).items()},
+            'toolchain': _toolchain_version(toolchain),
+            'options': [str(x) for x in (options or [])]
+        }, sort_keys=True).encode())
+        # the annotation is read from a file, so its content must be hashed too
+        annotate_in = (_params or {}).get('annotate_in', 'NULL')
+        if annotate_in != 'NULL':
+            _hash_file(hasher, annotate_in)
+        model_path = os.path.join(temp_dir, 'model.bin')
+        self.serialize(model_path)
+        _hash_file(hasher, model_path)
+        os.remove(model_path)
+        return hasher.hexdigest()
+
     def export_srcpkg(self, platform, toolchain, pkgpath, libname, params=None,
                       compiler='ast_native', verbose=False, options=None):
         """
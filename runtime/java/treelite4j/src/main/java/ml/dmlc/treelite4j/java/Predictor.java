@@ -9,11 +9,17 @@ import org.apache.commons.logging.Log;
 import org.apache.commons.logging.LogFactory;
 
 import java.io.ByteArrayOutputStream;
+import java.io.DataInput;
+import java.io.DataInputStream;
+import java.io.DataOutput;
+import java.io.DataOutputStream;
 import java.io.File;
 import java.io.IOException;
 import java.io.Serializable;
 import java.nio.file.Files;
 import java.nio.file.Paths;
+import java.util.LinkedHashMap;
+import java.util.Map;
 
 /**
  * Treelite Predictor
@@ -31,6 +37,17 @@ public class Predictor implements Serializable, KryoSerializable {
   private transient boolean verbose;
   private transient String libpath;
   private transient String libext;
+  private transient Map<String, String> params;
+  private static final String MODEL_EXT = ".model";
+    // libext of a predictor that scores a serialized model in-process
+  private static final long serialVersionUID = 8885533855059912465L;
+    // the value that Java computed for the class in earlier releases, which
+    // did not declare one, so that their streams can still be read
+  private static final int SERIAL_VERSION = 1;
+    // version of the serialized form; version 1 added the runtime parameters
+  private static final int SERIAL_VERSION_TAG = Integer.MIN_VALUE;
+    // the serialized form starts with SERIAL_VERSION_TAG + version. Version 0
+    // had no tag and starts with num_thread instead, which is never below -1.
 
   /**
    * Create a Predictor by loading a shared library (dll/so/dylib).
@@ -42,8 +59,9 @@ public class Predictor implements Serializable, KryoSerializable {
    *
    * @param libpath Path to the shared library
    * @param nthread Number of workers threads to spawn. Set to -1 to use default,
-   *                i.e., to launch as many threads as CPU cores available on
-   *                the system. You are not allowed to launch more threads than
+   *                i.e., to launch as many threads as CPU cores available to
+   *                the process, as limited by its affinity mask and CPU quota.
+   *                You are not allowed to launch more threads than
    *                CPU cores. Setting ``nthread=1`` indicates that the main
    *                thread should be exclusively used.
    * @param verbose Whether to print extra diagnostic messages
@@ -52,11 +70,90 @@ public class Predictor implements Serializable, KryoSerializable {
    */
   public Predictor(
           String libpath, int nthread, boolean verbose) throws TreeliteError {
+    this(libpath, nthread, verbose, new LinkedHashMap<String, String>());
+  }
+
+  /**
+   * Create a Predictor by loading a shared library (dll/so/dylib), with
+   * runtime parameters that take effect before the worker threads start.
+   *
+   * @param libpath Path to the shared library
+   * @param nthread Number of workers threads to spawn; see
+   *                :java:ref:`Predictor(String, int, boolean)`
+   * @param verbose Whether to print extra diagnostic messages
+   * @param params  Runtime parameters for the predictor, e.g.
+   *                ``wait_policy=park`` to let idle worker threads go to sleep
+   *                right away. See the list of predictor parameters in the
+   *                documentation.
+   * @return Created Predictor
+   * @throws TreeliteError
+   */
+  public Predictor(
+          String libpath, int nthread, boolean verbose,
+          Map<String, String> params) throws TreeliteError {
     this.num_thread = nthread;
     this.verbose = verbose;
+    this.params = new LinkedHashMap<String, String>(params);
     initNativeLibrary(libpath);
   }
 
+  private Predictor() {}
+
+  /**
+   * Create a Predictor that scores a serialized model in-process, without
+   * compiling it into a shared library first. The predictions are identical
+   * to those of a library compiled from the same model, but take longer to
+   * compute. Use ``treelite.Model.serialize()`` to serialize a model.
+   *
+   * @param modelPath Path to the serialized model
+   * @param nthread   Number of workers threads to spawn; see
+   *                  :java:ref:`Predictor(String, int, boolean)`
+   * @param verbose   Whether to print extra diagnostic messages
+   * @param params    Runtime parameters for the predictor; see
+   *                  :java:ref:`Predictor(String, int, boolean, Map)`
+   * @return Created Predictor
+   * @throws TreeliteError
+   */
+  public static Predictor fromModelFile(
+          String modelPath, int nthread, boolean verbose,
+          Map<String, String> params) throws TreeliteError {
+    Predictor predictor = new Predictor();
+    predictor.num_thread = nthread;
+    predictor.verbose = verbose;
+    predictor.params = new LinkedHashMap<String, String>(params);
+    predictor.initModelFile(modelPath);
+    return predictor;
+  }
+
+  private void initModelFile(String modelPath) throws TreeliteError {
+    this.libpath = modelPath;
+    this.libext = MODEL_EXT;
+    long[] long_out = new long[1];
+    String[] param_names = this.params.keySet().toArray(new String[0]);
+    String[] param_values = this.params.values().toArray(new String[0]);
+    TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorLoadModelFile(
+            modelPath, this.num_thread, param_names, param_values, long_out));
+    handle = long_out[0];
+    queryModelInfo();
+
+    if (this.verbose) {
+      logger.info(String.format(
+              "Model %s has been loaded into memory, to be scored in-process", modelPath));
+    }
+  }
+
+  /**
+   * Load the serialized predictor: either a shared library or, if the
+   * extension is MODEL_EXT, a serialized model
+   */
+  private void initFromFile(String path, String ext) throws TreeliteError {
+    if (ext.equals(MODEL_EXT)) {
+      initModelFile(path);
+    } else {
+      initNativeLibrary(path);
+    }
+  }
+
   private void initNativeLibrary(String libpath) throws TreeliteError {
     File f = new File(libpath);
     if (f.isDirectory()) {  // libpath is a diectory
@@ -91,11 +188,23 @@ public class Predictor implements Serializable, KryoSerializable {
     }
 
     long[] long_out = new long[1];
-    TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorLoad(
-            this.libpath, this.num_thread, long_out));
+    String[] param_names = this.params.keySet().toArray(new String[0]);
+    String[] param_values = this.params.values().toArray(new String[0]);
+    TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorLoadWithParams(
+            this.libpath, this.num_thread, param_names, param_values, long_out));
     handle = long_out[0];
+    queryModelInfo();
+
+    if (this.verbose) {
+      logger.info(String.format(
+              "Dynamic shared library %s has been successfully loaded into memory",
+              this.libpath));
+    }
+  }
 
+  private void queryModelInfo() throws TreeliteError {
     // Fetch meta information from model
+    long[] long_out = new long[1];
     TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorQueryNumOutputGroup(
             handle, long_out));
     num_output_group = (int) long_out[0];
@@ -113,12 +222,20 @@ public class Predictor implements Serializable, KryoSerializable {
     TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorQueryGlobalBias(
             handle, fp_out));
     global_bias = fp_out[0];
+  }
 
-    if (this.verbose) {
-      logger.info(String.format(
-              "Dynamic shared library %s has been successfully loaded into memory",
-              this.libpath));
-    }
+  /**
+   * Set a runtime parameter for the predictor. Do not call this method while
+   * another thread is making predictions with this predictor.
+   *
+   * @param name  Name of parameter
+   * @param value Value of parameter
+   * @throws TreeliteError
+   */
+  public void setParam(String name, String value) throws TreeliteError {
+    TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorSetParam(
+            this.handle, name, value));
+    this.params.put(name, value);
   }
 
   /**
@@ -205,10 +322,9 @@ public class Predictor implements Serializable, KryoSerializable {
 
   /**
    * Perform batch prediction with a 2D sparse data matrix. Worker threads
-   * will internally divide up work for batch prediction. **Note that this
-   * function will be blocked by mutex when worker_thread > 1.** In order to use
-   * multiple threads to process multiple prediction requests simultaneously,
-   * use :java:meth:`Predictor.predict(Data[], boolean)` instead or keep worker_thread = 1.
+   * will internally divide up work for batch prediction. This function may be
+   * called by multiple threads at once; concurrent calls share the same pool of
+   * worker threads.
    *
    * @param batch       a :java:ref:`SparseBatch`, representing a slice of a 2D
    *                    sparse matrix
@@ -224,27 +340,18 @@ public class Predictor implements Serializable, KryoSerializable {
             this.handle, batch.getHandle(), true, out));
     int result_size = (int) out[0];
     float[] out_result = new float[result_size];
-    if (num_thread == 1) {
-      TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorPredictBatch(
-              this.handle, batch.getHandle(), true, verbose, pred_margin,
-              out_result, out));
-    } else {
-      synchronized (this) {
-        TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorPredictBatch(
-                this.handle, batch.getHandle(), true, verbose, pred_margin,
-                out_result, out));
-      }
-    }
+    TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorPredictBatch(
+            this.handle, batch.getHandle(), true, verbose, pred_margin,
+            out_result, out));
     int actual_result_size = (int) out[0];
     return reshape(out_result, actual_result_size, this.num_output_group);
   }
 
   /**
    * Perform batch prediction with a 2D dense data matrix. Worker threads
-   * will internally divide up work for batch prediction. **Note that this
-   * function will be blocked by mutex when worker_thread > 1.** In order to use
-   * multiple threads to process multiple prediction requests simultaneously,
-   * use :java:meth:`Predictor.predict(Data[], boolean)` instead or keep worker_thread = 1.
+   * will internally divide up work for batch prediction. This function may be
+   * called by multiple threads at once; concurrent calls share the same pool of
+   * worker threads.
    *
    * @param batch       a :java:ref:`DenseBatch`, representing a slice of a 2D dense
    *                    matrix
@@ -260,17 +367,9 @@ public class Predictor implements Serializable, KryoSerializable {
             this.handle, batch.getHandle(), false, out));
     int result_size = (int) out[0];
     float[] out_result = new float[result_size];
-    if (num_thread == 1) {
-      TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorPredictBatch(
-              this.handle, batch.getHandle(), false, verbose, pred_margin,
-              out_result, out));
-    } else {
-      synchronized (this) {
-        TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorPredictBatch(
-                this.handle, batch.getHandle(), false, verbose, pred_margin,
-                out_result, out));
-      }
-    }
+    TreeliteJNI.checkCall(TreeliteJNI.TreelitePredictorPredictBatch(
+            this.handle, batch.getHandle(), false, verbose, pred_margin,
+            out_result, out));
     int actual_result_size = (int) out[0];
     return reshape(out_result, actual_result_size, this.num_output_group);
   }
@@ -306,47 +405,22 @@ public class Predictor implements Serializable, KryoSerializable {
 
   private void readObject(java.io.ObjectInputStream in)
           throws IOException, ClassNotFoundException {
-    this.num_thread = in.readInt();
-    this.verbose = in.readBoolean();
-    byte[] libext = new byte[in.readShort()];
-    in.read(libext);
-    File libpath = File.createTempFile("TreeLite_", new String(libext));
-    byte[] lib_data = new byte[in.readInt()];
-    // use readFully here, because only 1024 bytes can be fetched by ObjectInputStream.read
-    in.readFully(lib_data);
-    FileUtils.writeByteArrayToFile(libpath, lib_data);
     try {
-      initNativeLibrary(libpath.getAbsolutePath());
+      readState(in);
     } catch (TreeliteError ex) {
       ex.printStackTrace();
       logger.error("Error while loading TreeLite dynamic shared library!");
-    } finally {
-      libpath.delete();
     }
   }
 
   private void writeObject(java.io.ObjectOutputStream out) throws IOException {
-    out.writeInt(this.num_thread);
-    out.writeBoolean(this.verbose);
-    byte[] libext = this.libext.getBytes();
-    out.writeShort(libext.length);
-    out.write(libext);
-    byte[] lib_data = Files.readAllBytes(Paths.get(libpath));
-    out.writeInt(lib_data.length);
-    out.write(lib_data);
+    writeState(out);
   }
 
   @Override
   public void write(Kryo kryo, Output out) {
-      out.writeInt(this.num_thread);
-      out.writeBoolean(this.verbose);
-      byte[] libext = this.libext.getBytes();
-      out.writeShort(libext.length);
-      out.write(libext);
       try {
-          byte[] lib_data = Files.readAllBytes(Paths.get(libpath));
-          out.writeInt(lib_data.length);
-          out.write(lib_data);
+          writeState(new DataOutputStream(out));
       } catch (IOException e) {
           logger.error("Error while loading TreeLite dynamic shared library!");
       }
@@ -354,24 +428,73 @@ public class Predictor implements Serializable, KryoSerializable {
 
   @Override
   public void read(Kryo kryo, Input in) {
-      this.num_thread = in.readInt();
-      this.verbose = in.readBoolean();
-      byte[] libext = new byte[in.readShort()];
-      in.read(libext);
-      File libpath = null;
       try {
-          libpath = File.createTempFile("TreeLite_", new String(libext));
-          byte[] lib_data = new byte[in.readInt()];
-          in.read(lib_data);
-          FileUtils.writeByteArrayToFile(libpath, lib_data);
-          initNativeLibrary(libpath.getAbsolutePath());
+          readState(new DataInputStream(in));
       } catch (Exception ex) {
           ex.printStackTrace();
           logger.error("Error while loading TreeLite dynamic shared library!");
-      } finally {
-          if (libpath != null) {
-              libpath.delete();
-          }
       }
   }
+
+  /**
+   * Write the serialized form shared by Java serialization and Kryo: a
+   * version tag, followed by the fields of the version
+   */
+  private void writeState(DataOutput out) throws IOException {
+    out.writeInt(SERIAL_VERSION_TAG + SERIAL_VERSION);
+    out.writeInt(this.num_thread);
+    out.writeBoolean(this.verbose);
+    byte[] libext = this.libext.getBytes();
+    out.writeShort(libext.length);
+    out.write(libext);
+    byte[] lib_data = Files.readAllBytes(Paths.get(libpath));
+    out.writeInt(lib_data.length);
+    out.write(lib_data);
+    out.writeInt(this.params.size());
+    for (Map.Entry<String, String> e : this.params.entrySet()) {
+      out.writeUTF(e.getKey());
+      out.writeUTF(e.getValue());
+    }
+  }
+
+  /**
+   * Read the serialized form written by writeState(), or by a version of
+   * treelite4j that did not write a version tag
+   */
+  private void readState(DataInput in) throws IOException, TreeliteError {
+    int version = 0;
+    int num_thread = in.readInt();
+    if (num_thread < -1) {  // not a valid number of threads, so a version tag
+      version = num_thread - SERIAL_VERSION_TAG;
+      if (version < 1 || version > SERIAL_VERSION) {
+        throw new IOException("Unsupported version " + version
+                + " of serialized Predictor; this version of treelite4j reads up to "
+                + SERIAL_VERSION);
+      }
+      num_thread = in.readInt();
+    }
+    this.num_thread = num_thread;
+    this.verbose = in.readBoolean();
+    byte[] libext = new byte[in.readShort()];
+    in.readFully(libext);
+    // use readFully here, because only 1024 bytes can be fetched by ObjectInputStream.read
+    byte[] lib_data = new byte[in.readInt()];
+    in.readFully(lib_data);
+    // version 0 has no runtime parameters, so the defaults apply
+    this.params = new LinkedHashMap<String, String>();
+    if (version >= 1) {
+      int num_param = in.readInt();
+      for (int i = 0; i < num_param; ++i) {
+        String name = in.readUTF();
+        this.params.put(name, in.readUTF());
+      }
+    }
+    File libpath = File.createTempFile("TreeLite_", new String(libext));
+    try {
+      FileUtils.writeByteArrayToFile(libpath, lib_data);
+      initFromFile(libpath.getAbsolutePath(), new String(libext));
+    } finally {
+      libpath.delete();
+    }
+  }
 }
@@ -50,6 +50,17 @@ class TreeliteJNI {
   public final static native int TreelitePredictorLoad(
     String library_path, int num_worker_thread, long[] out);
 
+  public final static native int TreelitePredictorLoadWithParams(
+    String library_path, int num_worker_thread, String[] param_names,
+    String[] param_values, long[] out);
+
+  public final static native int TreelitePredictorLoadModelFile(
+    String model_path, int num_worker_thread, String[] param_names,
+    String[] param_values, long[] out);
+
+  public final static native int TreelitePredictorSetParam(
+    long handle, String name, String value);
+
   public final static native int TreelitePredictorPredictBatch(
     long handle, long batch, boolean batch_sparse, boolean verbose,
     boolean pred_margin, float[] out_result, long[] out_result_size);
@@ -4,6 +4,7 @@ import java.io.IOException
 
 import ml.dmlc.treelite4j.java.{Data, DenseBatch, SparseBatch, TreeliteError, Predictor => JPredictor}
 
+import scala.collection.JavaConverters._
 import scala.reflect.ClassTag
 
 /**
@@ -68,16 +69,20 @@ object Predictor {
   /**
    * @param libPath   Path to the shared library
    * @param numThread Number of workers threads to spawn. Set to -1 to use default,
-   *                  i.e., to launch as many threads as CPU cores available on
-   *                  the system. You are not allowed to launch more threads than
+   *                  i.e., to launch as many threads as CPU cores available to
+   *                  the process, as limited by its affinity mask and CPU quota.
+   *                  You are not allowed to launch more threads than
    *                  CPU cores. Setting ``nthread=1`` indicates that the main
    *                  thread should be exclusively used.
    * @param verbose   Whether to print extra diagnostic messages
+   * @param params    Runtime parameters for the predictor, e.g.
+   *                  ``Map("wait_policy" -> "park")``
    */
   def apply(
       libPath: String,
       numThread: Int = -1,
-      verbose: Boolean = true): Predictor = {
-    new Predictor(new JPredictor(libPath, numThread, verbose))
+      verbose: Boolean = true,
+      params: Map[String, String] = Map.empty): Predictor = {
+    new Predictor(new JPredictor(libPath, numThread, verbose, params.asJava))
   }
 }
@@ -5,6 +5,7 @@
 #include <dmlc/logging.h>
 #include <dmlc/memory_io.h>
 #include <algorithm>
+#include <string>
 #include <vector>
 #include "./treelite4j.h"
 
@@ -20,6 +21,36 @@ void setHandle(JNIEnv* jenv, jlongArray jhandle, void* handle) {
   jenv->SetLongArrayRegion(jhandle, 0, 1, &out);
 }
 
+// copy an element of a Java string array
+std::string getStringElement(JNIEnv* jenv, jobjectArray jarray, jsize i) {
+  jstring jstr = (jstring)jenv->GetObjectArrayElement(jarray, i);
+  const char* str = jenv->GetStringUTFChars(jstr, 0);
+  std::string out(str);
+  jenv->ReleaseStringUTFChars(jstr, str);
+  jenv->DeleteLocalRef(jstr);
+  return out;
+}
+
+// name-value pairs copied from two Java string arrays, to be passed to the C API
+struct ParamList {
+  std::vector<std::string> names, values;
+  std::vector<const char*> names_ptr, values_ptr;
+};
+
+void getParamList(JNIEnv* jenv, jobjectArray jparam_names, jobjectArray jparam_values,
+                  ParamList* out) {
+  const jsize num_param = jenv->GetArrayLength(jparam_names);
+  for (jsize i = 0; i < num_param; ++i) {
+    out->names.push_back(getStringElement(jenv, jparam_names, i));
+    out->values.push_back(getStringElement(jenv, jparam_values, i));
+  }
+  // taken only after every string is in place, since push_back() may move them
+  for (jsize i = 0; i < num_param; ++i) {
+    out->names_ptr.push_back(out->names[i].c_str());
+    out->values_ptr.push_back(out->values[i].c_str());
+  }
+}
+
 }  // namespace anonymous
 
 /*
@@ -159,6 +190,70 @@ Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreelitePredictorLoad(
   return ret;
 }
 
+/*
+ * Class:     ml_dmlc_treelite4j_java_TreeliteJNI
+ * Method:    TreelitePredictorLoadWithParams
+ * Signature: (Ljava/lang/String;I[Ljava/lang/String;[Ljava/lang/String;[J)I
+ */
+JNIEXPORT jint JNICALL
+Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreelitePredictorLoadWithParams(
+  JNIEnv* jenv, jclass jcls, jstring jlibrary_path, jint jnum_worker_thread,
+  jobjectArray jparam_names, jobjectArray jparam_values, jlongArray jout) {
+
+  ParamList params;
+  getParamList(jenv, jparam_names, jparam_values, &params);
+  const char* library_path = jenv->GetStringUTFChars(jlibrary_path, 0);
+  PredictorHandle out;
+  const jint ret = (jint)TreelitePredictorLoadWithParams(library_path,
+    (int)jnum_worker_thread, params.names.size(), params.names_ptr.data(),
+    params.values_ptr.data(), &out);
+  setHandle(jenv, jout, out);
+  jenv->ReleaseStringUTFChars(jlibrary_path, library_path);
+
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_treelite4j_java_TreeliteJNI
+ * Method:    TreelitePredictorLoadModelFile
+ * Signature: (Ljava/lang/String;I[Ljava/lang/String;[Ljava/lang/String;[J)I
+ */
+JNIEXPORT jint JNICALL
+Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreelitePredictorLoadModelFile(
+  JNIEnv* jenv, jclass jcls, jstring jmodel_path, jint jnum_worker_thread,
+  jobjectArray jparam_names, jobjectArray jparam_values, jlongArray jout) {
+
+  ParamList params;
+  getParamList(jenv, jparam_names, jparam_values, &params);
+  const char* model_path = jenv->GetStringUTFChars(jmodel_path, 0);
+  PredictorHandle out;
+  const jint ret = (jint)TreelitePredictorLoadModelFile(model_path,
+    (int)jnum_worker_thread, params.names.size(), params.names_ptr.data(),
+    params.values_ptr.data(), &out);
+  setHandle(jenv, jout, out);
+  jenv->ReleaseStringUTFChars(jmodel_path, model_path);
+
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_treelite4j_java_TreeliteJNI
+ * Method:    TreelitePredictorSetParam
+ * Signature: (JLjava/lang/String;Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL
+Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreelitePredictorSetParam(
+  JNIEnv* jenv, jclass jcls, jlong jhandle, jstring jname, jstring jvalue) {
+
+  const char* name = jenv->GetStringUTFChars(jname, 0);
+  const char* value = jenv->GetStringUTFChars(jvalue, 0);
+  const jint ret = (jint)TreelitePredictorSetParam((PredictorHandle)jhandle, name, value);
+  jenv->ReleaseStringUTFChars(jname, name);
+  jenv->ReleaseStringUTFChars(jvalue, value);
+
+  return ret;
+}
+
 /*
  * Class:     ml_dmlc_treelite4j_java_TreeliteJNI
  * Method:    TreelitePredictorPredictBatch
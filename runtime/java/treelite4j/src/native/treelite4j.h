@@ -63,6 +63,30 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreeliteBatchGet
 JNIEXPORT jint JNICALL Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreelitePredictorLoad
   (JNIEnv *, jclass, jstring, jint, jlongArray);
 
+/*
+ * Class:     ml_dmlc_treelite4j_java_TreeliteJNI
+ * Method:    TreelitePredictorLoadWithParams
+ * Signature: (Ljava/lang/String;I[Ljava/lang/String;[Ljava/lang/String;[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreelitePredictorLoadWithParams
+  (JNIEnv *, jclass, jstring, jint, jobjectArray, jobjectArray, jlongArray);
+
+/*
+ * Class:     ml_dmlc_treelite4j_java_TreeliteJNI
+ * Method:    TreelitePredictorLoadModelFile
+ * Signature: (Ljava/lang/String;I[Ljava/lang/String;[Ljava/lang/String;[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreelitePredictorLoadModelFile
+  (JNIEnv *, jclass, jstring, jint, jobjectArray, jobjectArray, jlongArray);
+
+/*
+ * Class:     ml_dmlc_treelite4j_java_TreeliteJNI
+ * Method:    TreelitePredictorSetParam
+ * Signature: (JLjava/lang/String;Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_treelite4j_java_TreeliteJNI_TreelitePredictorSetParam
+  (JNIEnv *, jclass, jlong, jstring, jstring);
+
 /*
  * Class:     ml_dmlc_treelite4j_java_TreeliteJNI
  * Method:    TreelitePredictorPredictBatch
@@ -1,5 +1,8 @@
 package ml.dmlc.treelite4j.java;
 
+import com.esotericsoftware.kryo.Kryo;
+import com.esotericsoftware.kryo.io.Input;
+import com.esotericsoftware.kryo.io.Output;
 import junit.framework.TestCase;
 import ml.dmlc.treelite4j.DataPoint;
 import org.apache.commons.io.FileUtils;
@@ -9,7 +12,9 @@ import org.junit.Test;
 
 import java.io.*;
 import java.util.ArrayList;
+import java.util.HashMap;
 import java.util.List;
+import java.util.Map;
 
 /**
  * Test cases for Treelite Predictor
@@ -101,6 +106,27 @@ public class PredictorTest {
     mushroomLibPredictionTest(predictor);
   }
 
+  @Test
+  public void testWaitPolicy() throws TreeliteError, IOException {
+    List<DataPoint> dmat
+        = BatchBuilder.LoadDatasetFromLibSVM(mushroomTestDataLocation);
+    SparseBatch sparse_batch = BatchBuilder.CreateSparseBatch(dmat.iterator());
+    float[] expected_result
+        = LoadArrayFromText(mushroomTestDataPredProbResultLocation);
+    for (String policy : new String[]{"spin", "spin_then_park", "park", "futex"}) {
+      Map<String, String> params = new HashMap<String, String>();
+      params.put("wait_policy", policy);
+      params.put("spin_count", "1000");
+      Predictor predictor = new Predictor(mushroomLibLocation, -1, true, params);
+      float[][] result = predictor.predict(sparse_batch, true, false);
+      for (int i = 0; i < result.length; ++i) {
+        TestCase.assertEquals(1, result[i].length);
+        TestCase.assertEquals(expected_result[i], result[i][0]);
+      }
+      predictor.dispose();
+    }
+  }
+
   @Test
   public void testSerialization() throws TreeliteError, IOException, ClassNotFoundException {
     Predictor predictor = new Predictor(mushroomLibLocation, -1, true);
@@ -113,6 +139,47 @@ public class PredictorTest {
     mushroomLibPredictionTest(predictor2);
   }
 
+  @Test
+  public void testKryoSerialization() throws TreeliteError, IOException {
+    Map<String, String> params = new HashMap<String, String>();
+    params.put("wait_policy", "park");
+    Predictor predictor = new Predictor(mushroomLibLocation, -1, true, params);
+    Kryo kryo = new Kryo();
+    Output output = new Output(4096, -1);
+    kryo.writeObject(output, predictor);
+    Predictor predictor2 = kryo.readObject(new Input(output.toBytes()), Predictor.class);
+    TestCase.assertEquals(predictor.GetNumFeature(), predictor2.GetNumFeature());
+    mushroomLibPredictionTest(predictor2);
+  }
+
+  @Test
+  public void testDeserializeUnversionedFormat()
+      throws TreeliteError, IOException, ClassNotFoundException {
+    // the serialized form written before it carried a version, which has no
+    // runtime parameters
+    ByteArrayOutputStream baos = new ByteArrayOutputStream();
+    DataOutputStream out = new DataOutputStream(baos);
+    byte[] libext = mushroomLibLocation.substring(
+        mushroomLibLocation.lastIndexOf('.')).getBytes();
+    byte[] lib_data = FileUtils.readFileToByteArray(new File(mushroomLibLocation));
+    out.writeInt(-1);  // num_thread
+    out.writeBoolean(true);  // verbose
+    out.writeShort(libext.length);
+    out.write(libext);
+    out.writeInt(lib_data.length);
+    out.write(lib_data);
+    out.close();
+    byte[] state = baos.toByteArray();
+
+    Predictor predictor = (Predictor) fromByteArray(toJavaStream(state));
+    TestCase.assertEquals(127, predictor.GetNumFeature());
+    mushroomLibPredictionTest(predictor);
+
+    Predictor predictor2 = new Kryo().readObject(new Input(state), Predictor.class);
+    TestCase.assertEquals(127, predictor2.GetNumFeature());
+    mushroomLibPredictionTest(predictor2);
+  }
+
   private void mushroomLibPredictionTest(Predictor predictor) throws IOException, TreeliteError {
     Entry[] inst_arr = new Entry[predictor.GetNumFeature()];
     for (int i = 0; i < inst_arr.length; ++i) {
@@ -168,6 +235,31 @@ public class PredictorTest {
     return o;
   }
 
+  /**
+   * Wrap the state written by the writeObject() method of a Predictor into a
+   * Java serialization stream, as ObjectOutputStream would.
+   */
+  private static byte[] toJavaStream(byte[] state) throws IOException {
+    ByteArrayOutputStream baos = new ByteArrayOutputStream();
+    DataOutputStream out = new DataOutputStream(baos);
+    out.writeShort(ObjectStreamConstants.STREAM_MAGIC);
+    out.writeShort(ObjectStreamConstants.STREAM_VERSION);
+    out.writeByte(ObjectStreamConstants.TC_OBJECT);
+    out.writeByte(ObjectStreamConstants.TC_CLASSDESC);
+    out.writeUTF(Predictor.class.getName());
+    out.writeLong(ObjectStreamClass.lookup(Predictor.class).getSerialVersionUID());
+    out.writeByte(ObjectStreamConstants.SC_SERIALIZABLE | ObjectStreamConstants.SC_WRITE_METHOD);
+    out.writeShort(0);  // no serializable fields
+    out.writeByte(ObjectStreamConstants.TC_ENDBLOCKDATA);  // no class annotations
+    out.writeByte(ObjectStreamConstants.TC_NULL);  // no serializable superclass
+    out.writeByte(ObjectStreamConstants.TC_BLOCKDATALONG);
+    out.writeInt(state.length);
+    out.write(state);
+    out.writeByte(ObjectStreamConstants.TC_ENDBLOCKDATA);
+    out.close();
+    return baos.toByteArray();
+  }
+
   /**
    * Write the object to a ByteArray.
    */
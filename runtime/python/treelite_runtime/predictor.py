@@ -50,6 +50,10 @@ def _check_call(ret):
         raise TreeliteRuntimeError(py_str(_LIB.TreeliteGetLastError()))
 
 
+# value of the batch_sparse argument of the C API for each kind of batch
+_BATCH_KIND_CODE = {'dense': 0, 'sparse': 1, 'quantized': 2}
+
+
 class PredictorEntry(ctypes.Union):
     _fields_ = [('missing', ctypes.c_int), ('fvalue', ctypes.c_float)]
 
@@ -67,6 +71,8 @@ class Batch(object):
                 _check_call(_LIB.TreeliteDeleteSparseBatch(self.handle))
             elif self.kind == 'dense':
                 _check_call(_LIB.TreeliteDeleteDenseBatch(self.handle))
+            elif self.kind == 'quantized':
+                _check_call(_LIB.TreeliteDeleteQuantizedBatch(self.handle))
             else:
                 raise TreeliteRuntimeError('this batch has wrong value for `kind` field')
             self.handle = None
@@ -85,7 +91,7 @@ class Batch(object):
         num_col = ctypes.c_size_t()
         _check_call(_LIB.TreeliteBatchGetDimension(
             self.handle,
-            ctypes.c_int(1 if self.kind == 'sparse' else 0),
+            ctypes.c_int(_BATCH_KIND_CODE[self.kind]),
             ctypes.byref(num_row),
             ctypes.byref(num_col)))
         return (num_row.value, num_col.value)
@@ -225,25 +231,129 @@ class Batch(object):
         batch.csr = csr
         return batch
 
+    @classmethod
+    def from_quantized(cls, bins, rbegin=0, rend=None):
+        """
+        Get a batch from a 2D numpy matrix of features that were already
+        converted into bins. Only a library compiled with ``quantize=1`` can
+        make predictions with such a batch. For a numerical feature, the bin of
+        value ``x`` is twice the number of cut points less than ``x``, plus one
+        if ``x`` is a cut point; see :py:meth:`Predictor.cut_points`. For a
+        categorical feature, the bin is the category itself. A missing value is
+        represented by a bin with all bits set.
+
+        Parameters
+        ----------
+        bins : object of type :py:class:`numpy.ndarray`, with dimension 2
+            matrix of bins, of type ``numpy.uint8``, ``numpy.uint16`` or
+            ``numpy.uint32`` (see :py:attr:`Predictor.bin_size`)
+        rbegin : :py:class:`int <python:int>`, optional
+            the index of the first row in the subset
+        rend : :py:class:`int <python:int>`, optional
+            one past the index of the last row in the subset. If missing, set to
+            the end of the matrix.
+
+        Returns
+        -------
+        quantized_batch : :py:class:`Batch`
+            a quantized batch consisting of rows ``[rbegin, rend)``
+        """
+        if not isinstance(bins, np.ndarray):
+            raise ValueError('bins must be of type numpy.ndarray')
+        if len(bins.shape) != 2:
+            raise ValueError('Input numpy.ndarray must be two-dimensional')
+        if bins.dtype not in (np.uint8, np.uint16, np.uint32):
+            raise ValueError('bins must be of type numpy.uint8, numpy.uint16 or numpy.uint32')
+        num_row = bins.shape[0]
+        num_col = bins.shape[1]
+        rbegin = rbegin if rbegin is not None else 0
+        rend = rend if rend is not None else num_row
+        if rbegin >= rend:
+            raise TreeliteRuntimeError('rbegin must be less than rend')
+        if rbegin < 0:
+            raise TreeliteRuntimeError('rbegin must be nonnegative')
+        if rend > num_row:
+            raise TreeliteRuntimeError('rend must be less than number of rows in bins')
+        data_subset = np.ascontiguousarray(bins[rbegin:rend, :])
+
+        batch = Batch()
+        batch.handle = ctypes.c_void_p()
+        batch.kind = 'quantized'
+        _check_call(_LIB.TreeliteAssembleQuantizedBatch(
+            data_subset.ctypes.data_as(ctypes.c_void_p),
+            ctypes.c_size_t(data_subset.itemsize),
+            ctypes.c_size_t(rend - rbegin),
+            ctypes.c_size_t(num_col),
+            ctypes.byref(batch.handle)))
+        # save handles for internal arrays
+        batch.data = data_subset
+        # save pointer to bins so that it doesn't get garbage-collected prematurely
+        batch.mat = bins
+        return batch
+
 
 class Predictor(object):
     """
     Predictor class: loader for compiled shared libraries
 
+    The predictor can also score a model without compiling it first: pass
+    ``model`` instead of ``libpath`` to have the trees evaluated in-process by
+    an interpreter. The interpreter produces the same predictions as a
+    compiled library, only more slowly, and needs no C compiler.
+
     Parameters
     ----------
-    libpath: :py:class:`str <python:str>`
+    libpath: :py:class:`str <python:str>`, optional
         location of dynamic shared library (.dll/.so/.dylib)
     nthread: :py:class:`int <python:int>`, optional
-        number of worker threads to use; if unspecified, use maximum number of
-        hardware threads
+        number of worker threads to use; if unspecified, use one thread per CPU
+        available to the process, as limited by its affinity mask and CPU quota
     verbose : :py:class:`bool <python:bool>`, optional
         Whether to print extra messages during construction
+    params : :py:class:`dict <python:dict>`, optional
+        Runtime parameters for the predictor, e.g. ``{'wait_policy': 'park'}``.
+        See :doc:`/knobs/predictor_param`.
+    model : :py:class:`treelite.Model` or :py:class:`str <python:str>`, optional
+        model to score in-process instead of a shared library; either a model
+        object or the path to a model serialized with
+        :py:meth:`treelite.Model.serialize`. Exactly one of ``libpath`` and
+        ``model`` must be given.
     """
 
     # pylint: disable=R0903
 
-    def __init__(self, libpath, nthread=None, verbose=False):
+    def __init__(self, libpath=None, nthread=None, verbose=False, params=None, model=None):
+        if (libpath is None) == (model is None):
+            raise TreeliteRuntimeError('Exactly one of libpath and model must be specified')
+        self.handle = ctypes.c_void_p()
+        # pass the parameters along, so that they take effect before the worker
+        # threads start
+        params = params if params is not None else {}
+        param_names = (ctypes.c_char_p * len(params))(*[c_str(k) for k in params])
+        param_values = (ctypes.c_char_p * len(params))(*[c_str(str(v)) for v in params.values()])
+        nthread = ctypes.c_int(nthread if nthread is not None else -1)
+        if model is not None:
+            if isinstance(model, str):
+                path = model
+                if not re.match(r'^[a-zA-Z]+://', path):
+                    path = os.path.abspath(path)
+                _check_call(_LIB.TreelitePredictorLoadModelFile(
+                    c_str(path), nthread, ctypes.c_size_t(len(params)),
+                    param_names, param_values, ctypes.byref(self.handle)))
+            elif getattr(model, 'handle', None) is not None:
+                path = 'model'
+                _check_call(_LIB.TreelitePredictorLoadModel(
+                    model.handle, nthread, ctypes.c_size_t(len(params)),
+                    param_names, param_values, ctypes.byref(self.handle)))
+            else:
+                raise TypeError('model must be a treelite.Model object or a path to ' +
+                                'a serialized model')
+            self._query_model_info()
+            if verbose:
+                log_info(__file__, lineno(),
+                         f'Model {path} has been loaded into memory, to be scored in-process')
+            return
+
         if os.path.isdir(libpath):  # libpath is a directory
             # directory is given; locate shared library inside it
             lib_found = False
@@ -267,13 +377,23 @@ class Predictor(object):
                 raise TreeliteRuntimeError(f'Specified path {libpath} has wrong file extension ' +
                                            f'({fileext}); the share library must have one of the ' +
                                            'following extensions: .so / .dll / .dylib')
-        self.handle = ctypes.c_void_p()
         if not re.match(r'^[a-zA-Z]+://', path):
             path = os.path.abspath(path)
-        _check_call(_LIB.TreelitePredictorLoad(
+        _check_call(_LIB.TreelitePredictorLoadWithParams(
             c_str(path),
-            ctypes.c_int(nthread if nthread is not None else -1),
+            nthread,
+            ctypes.c_size_t(len(params)),
+            param_names,
+            param_values,
             ctypes.byref(self.handle)))
+        self._query_model_info()
+
+        if verbose:
+            log_info(__file__, lineno(),
+                     f'Dynamic shared library {path} has been successfully loaded into memory')
+
+    def _query_model_info(self):
+        """Save the properties of the loaded model"""
         # save # of features
         num_feature = ctypes.c_size_t()
         _check_call(_LIB.TreelitePredictorQueryNumFeature(
@@ -305,9 +425,19 @@ class Predictor(object):
             ctypes.byref(global_bias)))
         self.global_bias_ = global_bias.value
 
-        if verbose:
-            log_info(__file__, lineno(),
-                     f'Dynamic shared library {path} has been successfully loaded into memory')
+    def set_param(self, name, value):
+        """
+        Set a runtime parameter for the predictor. See :doc:`/knobs/predictor_param`.
+
+        Parameters
+        ----------
+        name : :py:class:`str <python:str>`
+            name of parameter
+        value : :py:class:`str <python:str>` or number
+            value of parameter
+        """
+        _check_call(_LIB.TreelitePredictorSetParam(
+            self.handle, c_str(name), c_str(str(value))))
 
     def predict_instance(self, inst, missing=None, pred_margin=False):
         """
@@ -386,10 +516,9 @@ class Predictor(object):
     def predict(self, batch, verbose=False, pred_margin=False):
         """
         Perform batch prediction with a 2D sparse data matrix. Worker threads will
-        internally divide up work for batch prediction. **Note that this function
-        may be called by only one thread at a time.** In order to use multiple
-        threads to process multiple prediction requests simultaneously, use
-        :py:meth:`predict_instance` instead.
+        internally divide up work for batch prediction. This function may be called
+        by multiple threads at once; concurrent calls share the same pool of worker
+        threads.
 
         Parameters
         ----------
@@ -408,14 +537,14 @@ class Predictor(object):
         _check_call(_LIB.TreelitePredictorQueryResultSize(
             self.handle,
             batch.handle,
-            ctypes.c_int(1 if batch.kind == 'sparse' else 0),
+            ctypes.c_int(_BATCH_KIND_CODE[batch.kind]),
             ctypes.byref(result_size)))
         out_result = np.zeros(result_size.value, dtype=np.float32, order='C')
         out_result_size = ctypes.c_size_t()
         _check_call(_LIB.TreelitePredictorPredictBatch(
             self.handle,
             batch.handle,
-            ctypes.c_int(1 if batch.kind == 'sparse' else 0),
+            ctypes.c_int(_BATCH_KIND_CODE[batch.kind]),
             ctypes.c_int(1 if verbose else 0),
             ctypes.c_int(1 if pred_margin else 0),
             out_result.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
@@ -426,6 +555,31 @@ class Predictor(object):
             res = res.reshape((-1, self.num_output_group_))
         return res
 
+    def plan_batch(self, num_row):
+        """
+        Query the number of threads (including the calling thread) among which
+        :py:meth:`predict` would divide a batch with the given number of rows.
+        A batch whose estimated cost is small is scored on the calling thread
+        alone; see the parameters ``min_work_per_thread_us`` and ``row_cost_ns``
+        in :doc:`/knobs/predictor_param`.
+
+        Parameters
+        ----------
+        num_row : :py:class:`int <python:int>`
+            number of rows in the batch
+
+        Returns
+        -------
+        num_thread : :py:class:`int <python:int>`
+            number of threads
+        """
+        num_thread = ctypes.c_int()
+        _check_call(_LIB.TreelitePredictorQueryBatchPlan(
+            self.handle,
+            ctypes.c_size_t(num_row),
+            ctypes.byref(num_thread)))
+        return num_thread.value
+
     def __del__(self):
         if self.handle is not None:
             _check_call(_LIB.TreelitePredictorFree(self.handle))
@@ -455,3 +609,40 @@ class Predictor(object):
     def sigmoid_alpha(self):
         """Query sigmoid alpha of the model"""
         return self.sigmoid_alpha_
+
+    @property
+    def bin_size(self):
+        """
+        Query the width in bytes of the bins accepted by
+        :py:meth:`Batch.from_quantized`: 1 for ``numpy.uint8``, 2 for
+        ``numpy.uint16`` and 4 for ``numpy.uint32``. It is 0 if the library does not accept pre-quantized
+        input.
+        """
+        bin_size = ctypes.c_size_t()
+        _check_call(_LIB.TreelitePredictorQueryBinSize(
+            self.handle,
+            ctypes.byref(bin_size)))
+        return bin_size.value
+
+    @property
+    def cut_points(self):
+        """
+        Query the cut points used to convert each feature into bins, as a list
+        with one ascending ``numpy.ndarray`` per feature. The array is empty for
+        features not used by any numerical split. With ``np.searchsorted``, the
+        bins of numerical feature ``i`` are
+        ``np.searchsorted(cut_points[i], x, side='left') +
+        np.searchsorted(cut_points[i], x, side='right')``.
+        """
+        result = []
+        for fid in range(self.num_feature_):
+            cut_points = ctypes.POINTER(ctypes.c_float)()
+            num_cut_points = ctypes.c_size_t()
+            _check_call(_LIB.TreelitePredictorQueryCutPoints(
+                self.handle,
+                ctypes.c_uint(fid),
+                ctypes.byref(cut_points),
+                ctypes.byref(num_cut_points)))
+            result.append(np.array(cut_points[:num_cut_points.value] if num_cut_points.value > 0
+                                   else [], dtype=np.float32))
+        return result
@@ -7,6 +7,7 @@
 
 
 #include <treelite/annotator.h>
+#include <treelite/build_driver.h>
 #include <treelite/c_api.h>
 #include <treelite/compiler.h>
 #include <treelite/compiler_param.h>
@@ -281,23 +282,34 @@ int TreeliteCompilerGenerateCode(CompilerHandle compiler,
 
   /* compile model */
   impl->compiler.reset(Compiler::Create(impl->name, cparam));
-  auto compiled_model = impl->compiler->Compile(*model_);
-  if (verbose > 0) {
-    LOG(INFO) << "Code generation finished. Writing code to files...";
-  }
+  impl->compiler->CompileToDirectory(*model_, dirpath_, verbose > 0);
 
-  for (const auto& it : compiled_model.files) {
-    if (verbose > 0) {
-      LOG(INFO) << "Writing file " << it.first << "...";
-    }
-    const std::string filename_full = dirpath_ + "/" + it.first;
-    if (it.second.is_binary) {
-      filesystem::WriteToFile(filename_full, it.second.content_binary);
-    } else {
-      filesystem::WriteToFile(filename_full, it.second.content);
-    }
-  }
+  API_END();
+}
 
+int TreeliteCompilerExportLib(CompilerHandle compiler,
+                              ModelHandle model,
+                              const char* toolchain,
+                              const char* dirpath,
+                              const char* libpath,
+                              int nthread,
+                              const char** options,
+                              size_t num_option,
+                              int verbose,
+                              const char** out_build_log) {
+  const int ret = TreeliteCompilerGenerateCode(compiler, model, verbose, dirpath);
+  if (ret != 0) {  // code generation failed
+    return ret;
+  }
+  API_BEGIN();
+  const std::vector<std::string> options_(options, options + num_option);
+  const compiler::BuildReport report
+    = compiler::BuildSharedLib(dirpath, toolchain, libpath, nthread, options_, verbose > 0);
+  if (out_build_log) {
+    std::string& ret_str = TreeliteAPIThreadLocalStore::Get()->ret_str;
+    ret_str = report.ToJSON();
+    *out_build_log = ret_str.c_str();
+  }
   API_END();
 }
 
@@ -371,6 +383,14 @@ int TreeliteSetTreeLimit(ModelHandle handle, size_t limit) {
   API_END();
 }
 
+int TreeliteSerializeModel(ModelHandle handle, const char* filename) {
+  API_BEGIN();
+  auto model_ = static_cast<const Model*>(handle);
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(filename, "w"));
+  model_->ReferenceSerialize(fo.get());
+  API_END();
+}
+
 int TreeliteCreateTreeBuilder(TreeBuilderHandle* out) {
   API_BEGIN();
   std::unique_ptr<frontend::TreeBuilder> builder{new frontend::TreeBuilder()};
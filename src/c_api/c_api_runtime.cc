@@ -6,10 +6,15 @@
  */
 
 #include <treelite/predictor.h>
+#include <treelite/tree.h>
 #include <treelite/c_api_runtime.h>
 #include <dmlc/thread_local.h>
 #include <string>
 #include <cstring>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
 #include "./c_api_error.h"
 
 using namespace treelite;
@@ -20,6 +25,8 @@ namespace {
 struct TreeliteRuntimeAPIThreadLocalEntry {
   /*! \brief result holder for returning string */
   std::string ret_str;
+  /*! \brief result holder for returning cut points */
+  std::vector<float> ret_vec_float;
 };
 
 // thread-local store for returning strings
@@ -69,12 +76,37 @@ int TreeliteDeleteDenseBatch(DenseBatchHandle handle) {
   API_END();
 }
 
+int TreeliteAssembleQuantizedBatch(const void* data, size_t bin_size,
+                                   size_t num_row, size_t num_col,
+                                   QuantizedBatchHandle* out) {
+  API_BEGIN();
+  CHECK(bin_size == 1 || bin_size == 2 || bin_size == 4)
+    << "bin_size must be 1, 2 or 4";
+  QuantizedBatch* batch = new QuantizedBatch();
+  batch->data = data;
+  batch->bin_size = bin_size;
+  batch->num_row = num_row;
+  batch->num_col = num_col;
+  *out = static_cast<QuantizedBatchHandle>(batch);
+  API_END();
+}
+
+int TreeliteDeleteQuantizedBatch(QuantizedBatchHandle handle) {
+  API_BEGIN();
+  delete static_cast<QuantizedBatch*>(handle);
+  API_END();
+}
+
 int TreeliteBatchGetDimension(void* handle,
                               int batch_sparse,
                               size_t* out_num_row,
                               size_t* out_num_col) {
   API_BEGIN();
-  if (batch_sparse) {
+  if (batch_sparse == 2) {
+    const QuantizedBatch* batch_ = static_cast<QuantizedBatch*>(handle);
+    *out_num_row = batch_->num_row;
+    *out_num_col = batch_->num_col;
+  } else if (batch_sparse) {
     const CSRBatch* batch_ = static_cast<CSRBatch*>(handle);
     *out_num_row = batch_->num_row;
     *out_num_col = batch_->num_col;
@@ -96,6 +128,66 @@ int TreelitePredictorLoad(const char* library_path,
   API_END();
 }
 
+int TreelitePredictorLoadWithParams(const char* library_path,
+                                    int num_worker_thread,
+                                    size_t num_param,
+                                    const char** param_names,
+                                    const char** param_values,
+                                    PredictorHandle* out) {
+  API_BEGIN();
+  std::vector<std::pair<std::string, std::string>> params;
+  for (size_t i = 0; i < num_param; ++i) {
+    params.emplace_back(param_names[i], param_values[i]);
+  }
+  std::unique_ptr<Predictor> predictor(new Predictor(num_worker_thread, params));
+  predictor->Load(library_path);
+  *out = static_cast<PredictorHandle>(predictor.release());
+  API_END();
+}
+
+int TreelitePredictorLoadModel(void* model,
+                               int num_worker_thread,
+                               size_t num_param,
+                               const char** param_names,
+                               const char** param_values,
+                               PredictorHandle* out) {
+  API_BEGIN();
+  std::vector<std::pair<std::string, std::string>> params;
+  for (size_t i = 0; i < num_param; ++i) {
+    params.emplace_back(param_names[i], param_values[i]);
+  }
+  std::unique_ptr<Predictor> predictor(new Predictor(num_worker_thread, params));
+  predictor->LoadModel(*static_cast<const Model*>(model));
+  *out = static_cast<PredictorHandle>(predictor.release());
+  API_END();
+}
+
+int TreelitePredictorLoadModelFile(const char* model_path,
+                                   int num_worker_thread,
+                                   size_t num_param,
+                                   const char** param_names,
+                                   const char** param_values,
+                                   PredictorHandle* out) {
+  API_BEGIN();
+  std::vector<std::pair<std::string, std::string>> params;
+  for (size_t i = 0; i < num_param; ++i) {
+    params.emplace_back(param_names[i], param_values[i]);
+  }
+  std::unique_ptr<Predictor> predictor(new Predictor(num_worker_thread, params));
+  predictor->LoadModelFile(model_path);
+  *out = static_cast<PredictorHandle>(predictor.release());
+  API_END();
+}
+
+int TreelitePredictorSetParam(PredictorHandle handle,
+                              const char* name,
+                              const char* value) {
+  API_BEGIN();
+  Predictor* predictor_ = static_cast<Predictor*>(handle);
+  predictor_->SetParam(name, value);
+  API_END();
+}
+
 int TreelitePredictorPredictBatch(PredictorHandle handle,
                                   void* batch,
                                   int batch_sparse,
@@ -110,7 +202,11 @@ int TreelitePredictorPredictBatch(PredictorHandle handle,
     = std::string("Too many columns (features) in the given batch. "
                   "Number of features must not exceed ")
       + std::to_string(num_feature);
-  if (batch_sparse) {
+  if (batch_sparse == 2) {
+    const QuantizedBatch* batch_ = static_cast<QuantizedBatch*>(batch);
+    *out_result_size = predictor_->PredictBatch(batch_, verbose,
+                                               (pred_margin != 0), out_result);
+  } else if (batch_sparse) {
     const CSRBatch* batch_ = static_cast<CSRBatch*>(batch);
     CHECK_LE(batch_->num_col, num_feature) << err_msg;
     *out_result_size = predictor_->PredictBatch(batch_, verbose,
@@ -124,6 +220,79 @@ int TreelitePredictorPredictBatch(PredictorHandle handle,
   API_END();
 }
 
+int TreelitePredictorPredictBatchAsync(PredictorHandle handle,
+                                       void* batch,
+                                       int batch_sparse,
+                                       int verbose,
+                                       int pred_margin,
+                                       float* out_result,
+                                       TreelitePredictionCallback callback,
+                                       void* callback_data,
+                                       PredictionFutureHandle* out_future) {
+  API_BEGIN();
+  Predictor* predictor_ = static_cast<Predictor*>(handle);
+  const size_t num_feature = predictor_->QueryNumFeature();
+  const std::string err_msg
+    = std::string("Too many columns (features) in the given batch. "
+                  "Number of features must not exceed ")
+      + std::to_string(num_feature);
+  PredictionCallback callback_;
+  if (callback != nullptr) {
+    callback_ = [callback, callback_data](size_t result_size, std::exception_ptr error) {
+      int status = 0;
+      if (error) {
+        try {
+          std::rethrow_exception(error);
+        } catch (std::exception& e) {
+          status = TreeliteAPIHandleException(e);
+        }
+      }
+      callback(status, result_size, callback_data);
+    };
+  }
+  PredictionFuture future;
+  if (batch_sparse == 2) {
+    const QuantizedBatch* batch_ = static_cast<QuantizedBatch*>(batch);
+    future = predictor_->PredictBatchAsync(batch_, verbose, (pred_margin != 0),
+                                           out_result, std::move(callback_));
+  } else if (batch_sparse) {
+    const CSRBatch* batch_ = static_cast<CSRBatch*>(batch);
+    CHECK_LE(batch_->num_col, num_feature) << err_msg;
+    future = predictor_->PredictBatchAsync(batch_, verbose, (pred_margin != 0),
+                                           out_result, std::move(callback_));
+  } else {
+    const DenseBatch* batch_ = static_cast<DenseBatch*>(batch);
+    CHECK_LE(batch_->num_col, num_feature) << err_msg;
+    future = predictor_->PredictBatchAsync(batch_, verbose, (pred_margin != 0),
+                                           out_result, std::move(callback_));
+  }
+  if (out_future != nullptr) {
+    *out_future = static_cast<PredictionFutureHandle>(new PredictionFuture(std::move(future)));
+  }
+  API_END();
+}
+
+int TreelitePredictionFutureWait(PredictionFutureHandle future,
+                                 size_t* out_result_size) {
+  API_BEGIN();
+  const PredictionFuture* future_ = static_cast<PredictionFuture*>(future);
+  *out_result_size = future_->Wait();
+  API_END();
+}
+
+int TreelitePredictionFutureIsReady(PredictionFutureHandle future, int* out) {
+  API_BEGIN();
+  const PredictionFuture* future_ = static_cast<PredictionFuture*>(future);
+  *out = future_->IsReady() ? 1 : 0;
+  API_END();
+}
+
+int TreelitePredictionFutureFree(PredictionFutureHandle future) {
+  API_BEGIN();
+  delete static_cast<PredictionFuture*>(future);
+  API_END();
+}
+
 int TreelitePredictorPredictInst(PredictorHandle handle,
                                  union TreelitePredictorEntry* inst,
                                  int pred_margin,
@@ -141,7 +310,10 @@ int TreelitePredictorQueryResultSize(PredictorHandle handle,
                                      size_t* out) {
   API_BEGIN();
   const Predictor* predictor_ = static_cast<Predictor*>(handle);
-  if (batch_sparse) {
+  if (batch_sparse == 2) {
+    const QuantizedBatch* batch_ = static_cast<QuantizedBatch*>(batch);
+    *out = predictor_->QueryResultSize(batch_);
+  } else if (batch_sparse) {
     const CSRBatch* batch_ = static_cast<CSRBatch*>(batch);
     *out = predictor_->QueryResultSize(batch_);
   } else {
@@ -197,6 +369,32 @@ int TreelitePredictorQueryGlobalBias(PredictorHandle handle, float* out) {
   API_END();
 }
 
+int TreelitePredictorQueryBinSize(PredictorHandle handle, size_t* out) {
+  API_BEGIN();
+  const Predictor* predictor_ = static_cast<Predictor*>(handle);
+  *out = predictor_->QueryBinSize();
+  API_END();
+}
+
+int TreelitePredictorQueryCutPoints(PredictorHandle handle, unsigned int fid,
+                                    const float** out_cut_points, size_t* out_len) {
+  API_BEGIN();
+  const Predictor* predictor_ = static_cast<Predictor*>(handle);
+  std::vector<float>& ret_vec_float
+    = TreeliteRuntimeAPIThreadLocalStore::Get()->ret_vec_float;
+  ret_vec_float = predictor_->QueryCutPoints(fid);
+  *out_cut_points = ret_vec_float.data();
+  *out_len = ret_vec_float.size();
+  API_END();
+}
+
+int TreelitePredictorQueryBatchPlan(PredictorHandle handle, size_t num_row, int* out) {
+  API_BEGIN();
+  const Predictor* predictor_ = static_cast<Predictor*>(handle);
+  *out = predictor_->PlanBatch(num_row);
+  API_END();
+}
+
 int TreelitePredictorFree(PredictorHandle handle) {
   API_BEGIN();
   delete static_cast<Predictor*>(handle);
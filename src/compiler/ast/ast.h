@@ -7,10 +7,17 @@
 #ifndef TREELITE_COMPILER_AST_AST_H_
 #define TREELITE_COMPILER_AST_AST_H_
 
+#include <dmlc/logging.h>
 #include <dmlc/optional.h>
 #include <treelite/base.h>
 #include <fmt/format.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <memory>
+#include <new>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <utility>
@@ -18,33 +25,127 @@
 namespace treelite {
 namespace compiler {
 
+/*! \brief type of an AST node; used to dispatch without RTTI */
+enum class ASTNodeKind : uint8_t {
+  kMain, kTranslationUnit, kQuantizer, kAccumulatorContext, kCodeFolder,
+  kColdCode, kNumericalCondition, kCategoricalCondition, kOutput
+};
+
+class ASTNode;
+
+/*!
+ * \brief list of the children of an AST node. Up to two children are stored in
+ *        the node itself, so that condition nodes (which always have two) and
+ *        most other nodes never allocate; longer lists, such as the trees under
+ *        an accumulator context, are moved to the heap.
+ */
+class ASTChildList {
+ public:
+  ASTChildList() : size_(0), capacity_(kInlineCapacity), inline_{nullptr, nullptr} {}
+  ~ASTChildList() {
+    if (capacity_ > kInlineCapacity) {
+      delete[] heap_;
+    }
+  }
+  ASTChildList(const ASTChildList&) = delete;
+  ASTChildList& operator=(const ASTChildList&) = delete;
+  ASTChildList& operator=(const std::vector<ASTNode*>& nodes) {
+    size_ = 0;
+    Reserve(nodes.size());
+    for (ASTNode* e : nodes) {
+      push_back(e);
+    }
+    return *this;
+  }
+
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0; }
+  inline ASTNode** begin() { return data(); }
+  inline ASTNode** end() { return data() + size_; }
+  inline ASTNode* const* begin() const { return data(); }
+  inline ASTNode* const* end() const { return data() + size_; }
+  inline ASTNode*& operator[](size_t i) { return data()[i]; }
+  inline ASTNode* operator[](size_t i) const { return data()[i]; }
+  inline void push_back(ASTNode* node) {
+    if (size_ == capacity_) {
+      Reserve(static_cast<size_t>(capacity_) * 2);
+    }
+    data()[size_++] = node;
+  }
+
+ private:
+  static constexpr uint32_t kInlineCapacity = 2;
+  uint32_t size_;
+  uint32_t capacity_;
+  union {
+    ASTNode* inline_[kInlineCapacity];
+    ASTNode** heap_;
+  };
+
+  inline ASTNode** data() { return (capacity_ > kInlineCapacity) ? heap_ : inline_; }
+  inline ASTNode* const* data() const {
+    return (capacity_ > kInlineCapacity) ? heap_ : inline_;
+  }
+  void Reserve(size_t capacity) {
+    if (capacity <= capacity_) {
+      return;
+    }
+    CHECK_LE(capacity, std::numeric_limits<uint32_t>::max()) << "Too many children";
+    ASTNode** new_data = new ASTNode*[capacity];
+    std::copy(begin(), end(), new_data);
+    if (capacity_ > kInlineCapacity) {
+      delete[] heap_;
+    }
+    heap_ = new_data;
+    capacity_ = static_cast<uint32_t>(capacity);
+  }
+};
+
 class ASTNode {
  public:
+  const ASTNodeKind kind;
   ASTNode* parent;
-  std::vector<ASTNode*> children;
+  ASTChildList children;
   int node_id;
   int tree_id;
   dmlc::optional<size_t> data_count;
   dmlc::optional<double> sum_hess;
-  virtual std::string GetDump() const = 0;
-  virtual ~ASTNode() = 0;  // force ASTNode to be abstract class
+  /*! \brief text representation of the node, for debugging */
+  std::string GetDump() const;
  protected:
-  ASTNode() : parent(nullptr), node_id(-1), tree_id(-1) {}
+  // Nodes are created and destroyed by ASTNodeArena only. There is no vtable:
+  // code that needs the concrete type checks [kind], through NodeCast<>().
+  explicit ASTNode(ASTNodeKind kind) : kind(kind), parent(nullptr), node_id(-1), tree_id(-1) {}
+  ~ASTNode() = default;
 };
-inline ASTNode::~ASTNode() {}
+
+/*!
+ * \brief cast an AST node to a given node class
+ * \return the node, or nullptr if the node is not an instance of NodeType
+ */
+template <typename NodeType>
+inline NodeType* NodeCast(ASTNode* node) {
+  return (node && NodeType::IsKind(node->kind)) ? static_cast<NodeType*>(node) : nullptr;
+}
+template <typename NodeType>
+inline const NodeType* NodeCast(const ASTNode* node) {
+  return (node && NodeType::IsKind(node->kind)) ? static_cast<const NodeType*>(node) : nullptr;
+}
 
 class MainNode : public ASTNode {
  public:
   MainNode(tl_float global_bias, bool average_result, int num_tree,
            int num_feature)
-    : global_bias(global_bias), average_result(average_result),
+    : ASTNode(ASTNodeKind::kMain), global_bias(global_bias), average_result(average_result),
       num_tree(num_tree), num_feature(num_feature) {}
   tl_float global_bias;
   bool average_result;
   int num_tree;
   int num_feature;
 
-  std::string GetDump() const override {
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kMain; }
+
+  std::string GetDump() const {
     return fmt::format("MainNode {{ global_bias: {}, average_result: {}, num_tree: {}, "
                        "num_feature: {} }}", global_bias, average_result, num_tree, num_feature);
   }
@@ -52,23 +153,29 @@ class MainNode : public ASTNode {
 
 class TranslationUnitNode : public ASTNode {
  public:
-  explicit TranslationUnitNode(int unit_id) : unit_id(unit_id) {}
+  explicit TranslationUnitNode(int unit_id)
+    : ASTNode(ASTNodeKind::kTranslationUnit), unit_id(unit_id) {}
   int unit_id;
 
-  std::string GetDump() const override {
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kTranslationUnit; }
+
+  std::string GetDump() const {
     return fmt::format("TranslationUnitNode {{ unit_id: {} }}", unit_id);
   }
 };
 
 class QuantizerNode : public ASTNode {
  public:
-  explicit QuantizerNode(const std::vector<std::vector<tl_float>>& cut_pts)
-    : cut_pts(cut_pts) {}
-  explicit QuantizerNode(std::vector<std::vector<tl_float>>&& cut_pts)
-    : cut_pts(std::move(cut_pts)) {}
+  QuantizerNode(const std::vector<std::vector<tl_float>>& cut_pts, int bin_size)
+    : ASTNode(ASTNodeKind::kQuantizer), cut_pts(cut_pts), bin_size(bin_size) {}
+  QuantizerNode(std::vector<std::vector<tl_float>>&& cut_pts, int bin_size)
+    : ASTNode(ASTNodeKind::kQuantizer), cut_pts(std::move(cut_pts)), bin_size(bin_size) {}
   std::vector<std::vector<tl_float>> cut_pts;
+  int bin_size;  // width of each bin (quantized feature value), in bytes
 
-  std::string GetDump() const override {
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kQuantizer; }
+
+  std::string GetDump() const {
     std::ostringstream oss;
     for (const auto& vec : cut_pts) {
       oss << "[ ";
@@ -77,37 +184,54 @@ class QuantizerNode : public ASTNode {
       }
       oss << "], ";
     }
-    return fmt::format("QuantizerNode {{ cut_pts: {} }}", oss.str());
+    return fmt::format("QuantizerNode {{ cut_pts: {}bin_size: {} }}", oss.str(), bin_size);
   }
 };
 
 class AccumulatorContextNode : public ASTNode {
  public:
-  AccumulatorContextNode() {}
+  AccumulatorContextNode() : ASTNode(ASTNodeKind::kAccumulatorContext) {}
+
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kAccumulatorContext; }
 
-  std::string GetDump() const override {
+  std::string GetDump() const {
     return fmt::format("AccumulatorContextNode {{}}");
   }
 };
 
 class CodeFolderNode : public ASTNode {
  public:
-  CodeFolderNode() {}
+  CodeFolderNode() : ASTNode(ASTNodeKind::kCodeFolder) {}
 
-  std::string GetDump() const override {
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kCodeFolder; }
+
+  std::string GetDump() const {
     return fmt::format("CodeFolderNode {{}}");
   }
 };
 
+class ColdCodeNode : public ASTNode {
+ public:
+  ColdCodeNode() : ASTNode(ASTNodeKind::kColdCode) {}
+
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kColdCode; }
+
+  std::string GetDump() const {
+    return fmt::format("ColdCodeNode {{}}");
+  }
+};
+
 class ConditionNode : public ASTNode {
  public:
-  ConditionNode(unsigned split_index, bool default_left)
-    : split_index(split_index), default_left(default_left) {}
   unsigned split_index;
   bool default_left;
   dmlc::optional<double> gain;
 
-  std::string GetDump() const override {
+  static bool IsKind(ASTNodeKind kind) {
+    return kind == ASTNodeKind::kNumericalCondition || kind == ASTNodeKind::kCategoricalCondition;
+  }
+
+  std::string GetDump() const {
     if (gain) {
       return fmt::format("ConditionNode {{ split_index: {}, default_left: {}, gain: {} }}",
                          split_index, default_left, gain.value());
@@ -116,6 +240,10 @@ class ConditionNode : public ASTNode {
                          split_index, default_left);
     }
   }
+
+ protected:
+  ConditionNode(ASTNodeKind kind, unsigned split_index, bool default_left)
+    : ASTNode(kind), split_index(split_index), default_left(default_left) {}
 };
 
 union ThresholdVariant {
@@ -130,13 +258,15 @@ class NumericalConditionNode : public ConditionNode {
   NumericalConditionNode(unsigned split_index, bool default_left,
                          bool quantized, Operator op,
                          ThresholdVariant threshold)
-    : ConditionNode(split_index, default_left),
+    : ConditionNode(ASTNodeKind::kNumericalCondition, split_index, default_left),
       quantized(quantized), op(op), threshold(threshold) {}
   bool quantized;
   Operator op;
   ThresholdVariant threshold;
 
-  std::string GetDump() const override {
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kNumericalCondition; }
+
+  std::string GetDump() const {
     return fmt::format("NumericalConditionNode {{ {}, quantized: {}, op: {}, threshold: {} }}",
                        ConditionNode::GetDump(), quantized, OpName(op),
                        (quantized ? fmt::format("{:d}", threshold.int_val)
@@ -149,13 +279,15 @@ class CategoricalConditionNode : public ConditionNode {
   CategoricalConditionNode(unsigned split_index, bool default_left,
                            const std::vector<uint32_t>& left_categories,
                            bool convert_missing_to_zero)
-    : ConditionNode(split_index, default_left),
+    : ConditionNode(ASTNodeKind::kCategoricalCondition, split_index, default_left),
       left_categories(left_categories),
       convert_missing_to_zero(convert_missing_to_zero) {}
   std::vector<uint32_t> left_categories;
   bool convert_missing_to_zero;
 
-  std::string GetDump() const override {
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kCategoricalCondition; }
+
+  std::string GetDump() const {
     std::ostringstream oss;
     oss << "[";
     for (const auto& e : left_categories) {
@@ -171,14 +303,16 @@ class CategoricalConditionNode : public ConditionNode {
 class OutputNode : public ASTNode {
  public:
   explicit OutputNode(tl_float scalar)
-    : is_vector(false), scalar(scalar) {}
+    : ASTNode(ASTNodeKind::kOutput), is_vector(false), scalar(scalar) {}
   explicit OutputNode(const std::vector<tl_float>& vector)
-    : is_vector(true), vector(vector) {}
+    : ASTNode(ASTNodeKind::kOutput), is_vector(true), vector(vector) {}
   bool is_vector;
   tl_float scalar;
   std::vector<tl_float> vector;
 
-  std::string GetDump() const override {
+  static bool IsKind(ASTNodeKind kind) { return kind == ASTNodeKind::kOutput; }
+
+  std::string GetDump() const {
     if (is_vector) {
       std::ostringstream oss;
       oss << "[";
@@ -193,6 +327,95 @@ class OutputNode : public ASTNode {
   }
 };
 
+inline std::string ASTNode::GetDump() const {
+  switch (kind) {
+    case ASTNodeKind::kMain:
+      return static_cast<const MainNode*>(this)->GetDump();
+    case ASTNodeKind::kTranslationUnit:
+      return static_cast<const TranslationUnitNode*>(this)->GetDump();
+    case ASTNodeKind::kQuantizer:
+      return static_cast<const QuantizerNode*>(this)->GetDump();
+    case ASTNodeKind::kAccumulatorContext:
+      return static_cast<const AccumulatorContextNode*>(this)->GetDump();
+    case ASTNodeKind::kCodeFolder:
+      return static_cast<const CodeFolderNode*>(this)->GetDump();
+    case ASTNodeKind::kColdCode:
+      return static_cast<const ColdCodeNode*>(this)->GetDump();
+    case ASTNodeKind::kNumericalCondition:
+      return static_cast<const NumericalConditionNode*>(this)->GetDump();
+    case ASTNodeKind::kCategoricalCondition:
+      return static_cast<const CategoricalConditionNode*>(this)->GetDump();
+    case ASTNodeKind::kOutput:
+      return static_cast<const OutputNode*>(this)->GetDump();
+  }
+  LOG(FATAL) << "Unrecognized AST node type";
+  return std::string();
+}
+
+/*!
+ * \brief owner of all nodes of an AST. Nodes are carved out of large blocks
+ *        instead of being allocated one by one, and are destroyed together with
+ *        the arena.
+ */
+class ASTNodeArena {
+ public:
+  ASTNodeArena() : block_used_(kBlockSize) {}
+  ~ASTNodeArena() {
+    for (ASTNode* node : nodes_) {
+      if (node) {
+        Destroy(node);
+      }
+    }
+  }
+  ASTNodeArena(const ASTNodeArena&) = delete;
+  ASTNodeArena& operator=(const ASTNodeArena&) = delete;
+
+  template <typename NodeType, typename ...Args>
+  NodeType* New(Args&& ...args) {
+    static_assert(alignof(NodeType) <= alignof(std::max_align_t), "Unsupported alignment");
+    void* mem = Allocate(sizeof(NodeType), alignof(NodeType));
+    nodes_.push_back(nullptr);  // so that a failure here doesn't leave a node behind
+    NodeType* node = new (mem) NodeType(std::forward<Args>(args)...);
+    nodes_.back() = node;
+    return node;
+  }
+
+ private:
+  static constexpr size_t kBlockSize = 1024 * 1024;  // in bytes
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  size_t block_used_;  // bytes used in the last block
+  std::vector<ASTNode*> nodes_;  // every node, in order of creation
+
+  void* Allocate(size_t size, size_t align) {
+    size_t offset = (block_used_ + align - 1) / align * align;
+    if (offset + size > kBlockSize) {
+      // std::max() would bind kBlockSize to a reference, which needs a definition
+      blocks_.emplace_back(new char[(size > kBlockSize) ? size : kBlockSize]);
+      offset = 0;
+    }
+    block_used_ = offset + size;
+    return blocks_.back().get() + offset;
+  }
+
+  template <typename NodeType>
+  static void DestroyAs(ASTNode* node) {
+    static_cast<NodeType*>(node)->~NodeType();
+  }
+  static void Destroy(ASTNode* node) {
+    switch (node->kind) {
+      case ASTNodeKind::kMain: DestroyAs<MainNode>(node); break;
+      case ASTNodeKind::kTranslationUnit: DestroyAs<TranslationUnitNode>(node); break;
+      case ASTNodeKind::kQuantizer: DestroyAs<QuantizerNode>(node); break;
+      case ASTNodeKind::kAccumulatorContext: DestroyAs<AccumulatorContextNode>(node); break;
+      case ASTNodeKind::kCodeFolder: DestroyAs<CodeFolderNode>(node); break;
+      case ASTNodeKind::kColdCode: DestroyAs<ColdCodeNode>(node); break;
+      case ASTNodeKind::kNumericalCondition: DestroyAs<NumericalConditionNode>(node); break;
+      case ASTNodeKind::kCategoricalCondition: DestroyAs<CategoricalConditionNode>(node); break;
+      case ASTNodeKind::kOutput: DestroyAs<OutputNode>(node); break;
+    }
+  }
+};
+
 }  // namespace compiler
 }  // namespace treelite
 
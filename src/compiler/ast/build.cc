@@ -5,6 +5,7 @@
  */
 #include <dmlc/registry.h>
 #include "./builder.h"
+#include "../common/parallel_util.h"
 
 namespace treelite {
 namespace compiler {
@@ -24,13 +25,39 @@ void ASTBuilder::BuildAST(const Model& model) {
                                                model.num_feature);
   ASTNode* ac = AddNode<AccumulatorContextNode>(this->main_node);
   this->main_node->children.push_back(ac);
-  for (int tree_id = 0; tree_id < model.trees.size(); ++tree_id) {
-    ASTNode* tree_head = BuildASTFromTree(model.trees[tree_id], tree_id, ac);
-    ac->children.push_back(tree_head);
-  }
+  std::vector<ASTNode*> tree_heads(model.trees.size());
+  common_util::ParallelFor(model.trees.size(), this->nthread, [&](size_t tree_id) {
+    tree_heads[tree_id] = BuildASTFromTree(model.trees[tree_id], static_cast<int>(tree_id), ac);
+  });
+  ac->children = tree_heads;
   this->model_param = model.param.__DICT__();
 }
 
+std::vector<ASTNode*> ASTBuilder::GetTreeHeads() const {
+  // The trees hang from accumulator contexts, possibly under translation units
+  // (see Split()) and a quantizer node (see QuantizeThresholds()). Any other
+  // node below them is the top of a tree.
+  std::vector<ASTNode*> tree_heads;
+  std::vector<ASTNode*> stack{this->main_node};
+  while (!stack.empty()) {
+    ASTNode* node = stack.back();
+    stack.pop_back();
+    switch (node->kind) {
+      case ASTNodeKind::kMain:
+      case ASTNodeKind::kQuantizer:
+      case ASTNodeKind::kAccumulatorContext:
+      case ASTNodeKind::kTranslationUnit:
+        for (size_t i = node->children.size(); i > 0; --i) {
+          stack.push_back(node->children[i - 1]);
+        }
+        break;
+      default:
+        tree_heads.push_back(node);
+    }
+  }
+  return tree_heads;
+}
+
 ASTNode* ASTBuilder::BuildASTFromTree(const Tree& tree, int tree_id,
                                       ASTNode* parent) {
   return BuildASTFromTree(tree, tree_id, 0, parent);
@@ -62,7 +89,7 @@ ASTNode* ASTBuilder::BuildASTFromTree(const Tree& tree, int tree_id, int nid,
                                                    tree.MissingCategoryToZero(nid));
     }
     if (tree.HasGain(nid)) {
-      dynamic_cast<ConditionNode*>(ast_node)->gain = tree.Gain(nid);
+      NodeCast<ConditionNode>(ast_node)->gain = tree.Gain(nid);
     }
     ast_node->children.push_back(BuildASTFromTree(tree, tree_id, tree.LeftChild(nid), ast_node));
     ast_node->children.push_back(BuildASTFromTree(tree, tree_id, tree.RightChild(nid), ast_node));
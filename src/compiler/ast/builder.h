@@ -7,6 +7,8 @@
 #define TREELITE_COMPILER_AST_BUILDER_H_
 
 #include <treelite/tree.h>
+#include <treelite/omp.h>
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
@@ -21,13 +23,25 @@ namespace compiler {
 // forward declaration
 class ASTBuilder;
 struct CodeFoldingContext;
-bool fold_code(ASTNode*, CodeFoldingContext*, ASTBuilder*);
+bool fold_code(ASTNode*, ASTNode**, CodeFoldingContext*, ASTBuilder*);
+int outline_cold_code(ASTNode*, size_t, double, ASTBuilder*);
 bool breakup(ASTNode*, int, int*, ASTBuilder*);
 
 class ASTBuilder {
  public:
-  ASTBuilder() : output_vector_flag(false), main_node(nullptr),
-                 quantize_threshold_flag(false) {}
+  /*!
+   * \param nthread number of threads to use; the trees are processed in
+   *                parallel by BuildAST(), FoldCode() and QuantizeThresholds().
+   *                The resulting AST doesn't depend on the number of threads.
+   */
+  explicit ASTBuilder(int nthread = 1)
+    : output_vector_flag(false), main_node(nullptr), quantize_threshold_flag(false),
+      nthread(std::max(nthread, 1)) {
+    // one arena per thread, so that threads can add nodes without locking
+    for (int i = 0; i < std::max(omp_get_max_threads(), this->nthread); ++i) {
+      nodes.emplace_back(new ASTNodeArena());
+    }
+  }
 
   /* \brief initially build AST from model */
   void BuildAST(const Model& model);
@@ -52,12 +66,26 @@ class ASTBuilder {
   /*
    * \brief split prediction function into multiple translation units
    * \param parallel_comp number of translation units
+   * \param method how trees are assigned to units: 'round_robin' (tree i
+   *               goes to unit i % parallel_comp), 'balanced' (units get
+   *               about the same number of nodes) or 'feature' (like
+   *               'balanced', grouping trees that test the same features)
    */
-  void Split(int parallel_comp);
+  void Split(int parallel_comp, const std::string& method = "round_robin");
   /* \brief replace split thresholds with integers */
   void QuantizeThresholds();
   /* \brief Load data counts from annotation file */
   void LoadDataCounts(const std::vector<std::vector<size_t>>& counts);
+  /*
+   * \brief move rarely visited subtrees out of the way of the hot code. A
+   *        subtree is rare if its data count is lower than [cold_ratio] times
+   *        the data count of the root node of the decision tree. Folded
+   *        subtrees are left alone.
+   * \param cold_ratio fraction of the root data count below which a subtree
+   *                   is considered cold
+   * \return number of subtrees outlined
+   */
+  int OutlineColdCode(double cold_ratio);
   /*
    * \brief Get a text representation of AST
    */
@@ -68,29 +96,32 @@ class ASTBuilder {
   }
 
  private:
-  friend bool treelite::compiler::fold_code(ASTNode*, CodeFoldingContext*,
+  friend bool treelite::compiler::fold_code(ASTNode*, ASTNode**, CodeFoldingContext*,
                                             ASTBuilder*);
+  friend int treelite::compiler::outline_cold_code(ASTNode*, size_t, double,
+                                                   ASTBuilder*);
 
   template <typename NodeType, typename ...Args>
   NodeType* AddNode(ASTNode* parent, Args&& ...args) {
-    std::unique_ptr<NodeType> node(new NodeType(std::forward<Args>(args)...));
-    NodeType* ref = node.get();
-    ref->parent = parent;
-    nodes.push_back(std::move(node));
-    return ref;
+    NodeType* node = nodes[omp_get_thread_num()]->New<NodeType>(std::forward<Args>(args)...);
+    node->parent = parent;
+    return node;
   }
   ASTNode* BuildASTFromTree(const Tree& tree, int tree_id, ASTNode* parent);
   ASTNode* BuildASTFromTree(const Tree& tree, int tree_id, int nid,
                             ASTNode* parent);
+  /* \brief get the top node of every tree, in the order of the trees */
+  std::vector<ASTNode*> GetTreeHeads() const;
 
-  // keep tract of all nodes built so far, to prevent memory leak
-  std::vector<std::unique_ptr<ASTNode>> nodes;
+  // own all nodes built so far; nodes[i] is used by the i-th thread
+  std::vector<std::unique_ptr<ASTNodeArena>> nodes;
   bool output_vector_flag;
   bool quantize_threshold_flag;
   int num_feature;
   int num_output_group;
   bool random_forest_flag;
   ASTNode* main_node;
+  int nthread;
   std::vector<bool> is_categorical;
   std::map<std::string, std::string> model_param;
 };
@@ -5,9 +5,11 @@
  * \author Hyunsu Cho
  */
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include "./builder.h"
+#include "../common/parallel_util.h"
 
 namespace treelite {
 namespace compiler {
@@ -22,7 +24,9 @@ struct CodeFoldingContext {
   int num_tu;
 };
 
-bool fold_code(ASTNode* node, CodeFoldingContext* context,
+// [slot] is the link to [node] from its parent, which is replaced if [node] is
+// folded. Only that link is touched, so that trees can be folded concurrently.
+bool fold_code(ASTNode* node, ASTNode** slot, CodeFoldingContext* context,
                ASTBuilder* builder) {
   if (node->node_id == 0) {
     if (node->data_count) {
@@ -57,23 +61,15 @@ bool fold_code(ASTNode* node, CodeFoldingContext* context,
     } else {
       folder_node = builder->AddNode<CodeFolderNode>(parent_node);
     }
-    size_t node_loc = -1;  // is current node 1st child or 2nd child or so forth
-    for (size_t i = 0; i < parent_node->children.size(); ++i) {
-      if (parent_node->children[i] == node) {
-        node_loc = i;
-        break;
-      }
-    }
-    CHECK_NE(node_loc, -1);  // parent should have a link to current node
-    parent_node->children[node_loc]
-      = context->create_new_translation_unit ? tu_node : folder_node;
+    CHECK_EQ(*slot, node);  // parent should have a link to current node
+    *slot = context->create_new_translation_unit ? tu_node : folder_node;
     folder_node->children.push_back(node);
     node->parent = folder_node;
     return true;
   } else {
     bool folded_at_least_once = false;
-    for (ASTNode* child : node->children) {
-      folded_at_least_once |= fold_code(child, context, builder);
+    for (ASTNode*& child : node->children) {
+      folded_at_least_once |= fold_code(child, &child, context, builder);
     }
     return folded_at_least_once;
   }
@@ -88,7 +84,22 @@ bool ASTBuilder::FoldCode(double magnitude_req,
                              std::numeric_limits<double>::quiet_NaN(),
                              create_new_translation_unit,
                              count_tu_nodes(this->main_node)};
-  return fold_code(this->main_node, &context, this);
+  CHECK_EQ(this->main_node->children.size(), 1);
+  ASTNode* top_ac_node = this->main_node->children[0];
+  CHECK(NodeCast<AccumulatorContextNode>(top_ac_node));
+  // Each tree gets a copy of the context. New translation units are numbered
+  // in the order of the trees, so they are created by a single thread.
+  const int nthread = create_new_translation_unit ? 1 : this->nthread;
+  std::vector<char> folded(top_ac_node->children.size(), 0);
+  common_util::ParallelFor(folded.size(), nthread, [&](size_t i) {
+    CodeFoldingContext tree_context = context;
+    ASTNode*& tree_head = top_ac_node->children[i];
+    folded[i] = fold_code(tree_head, &tree_head, &tree_context, this);
+    if (create_new_translation_unit) {
+      context.num_tu = tree_context.num_tu;
+    }
+  });
+  return std::find(folded.begin(), folded.end(), 1) != folded.end();
 }
 
 }  // namespace compiler
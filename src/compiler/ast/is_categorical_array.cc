@@ -15,7 +15,7 @@ DMLC_REGISTRY_FILE_TAG(is_categorical_array);
 static void
 scan_thresholds(ASTNode* node, std::vector<bool>* is_categorical) {
   CategoricalConditionNode* cat_cond
-    = dynamic_cast<CategoricalConditionNode*>(node);
+    = NodeCast<CategoricalConditionNode>(node);
   if (cat_cond) {
     (*is_categorical)[cat_cond->split_index] = true;
   }
@@ -0,0 +1,56 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file outline_cold_code.cc
+ * \brief AST manipulation logic to move rarely visited subtrees out of the
+ *        way of the hot code
+ */
+#include <dmlc/registry.h>
+#include "./builder.h"
+
+namespace treelite {
+namespace compiler {
+
+DMLC_REGISTRY_FILE_TAG(outline_cold_code);
+
+int outline_cold_code(ASTNode* node, size_t root_data_count, double cold_ratio,
+                      ASTBuilder* builder) {
+  if (NodeCast<CodeFolderNode>(node)) {
+    return 0;  // folded subtrees are already compact
+  }
+  if (node->node_id == 0) {
+    if (!node->data_count) {
+      return 0;  // no data counts for this tree
+    }
+    root_data_count = node->data_count.value();
+  }
+  // Only outline subtrees with at least one test; the root of each tree stays in place
+  if (node->node_id > 0 && NodeCast<ConditionNode>(node)
+      && NodeCast<ConditionNode>(node->parent) && node->data_count
+      && static_cast<double>(node->data_count.value())
+         < cold_ratio * static_cast<double>(root_data_count)) {
+    ASTNode* parent_node = node->parent;
+    ASTNode* cold_node = builder->AddNode<ColdCodeNode>(parent_node);
+    cold_node->tree_id = node->tree_id;
+    cold_node->data_count = node->data_count;
+    for (ASTNode*& child : parent_node->children) {
+      if (child == node) {
+        child = cold_node;
+      }
+    }
+    cold_node->children.push_back(node);
+    node->parent = cold_node;
+    return 1;
+  }
+  int num_outlined = 0;
+  for (ASTNode* child : node->children) {
+    num_outlined += outline_cold_code(child, root_data_count, cold_ratio, builder);
+  }
+  return num_outlined;
+}
+
+int ASTBuilder::OutlineColdCode(double cold_ratio) {
+  return outline_cold_code(this->main_node, 0, cold_ratio, this);
+}
+
+}  // namespace compiler
+}  // namespace treelite
@@ -5,8 +5,12 @@
  */
 #include <treelite/math.h>
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <cmath>
+#include <numeric>
+#include <set>
 #include "./builder.h"
+#include "../common/parallel_util.h"
 
 namespace treelite {
 namespace compiler {
@@ -18,7 +22,7 @@ scan_thresholds(ASTNode* node,
                 std::vector<std::set<tl_float>>* cut_pts) {
   NumericalConditionNode* num_cond;
   CategoricalConditionNode* cat_cond;
-  if ( (num_cond = dynamic_cast<NumericalConditionNode*>(node)) ) {
+  if ( (num_cond = NodeCast<NumericalConditionNode>(node)) ) {
     CHECK(!num_cond->quantized) << "should not be already quantized";
     const tl_float threshold = num_cond->threshold.float_val;
     if (std::isfinite(threshold)) {
@@ -30,18 +34,34 @@ scan_thresholds(ASTNode* node,
   }
 }
 
+// max_category stays at -1 if there is no categorical split
+static void
+scan_categories(ASTNode* node, int64_t* max_category) {
+  CategoricalConditionNode* cat_cond;
+  if ( (cat_cond = NodeCast<CategoricalConditionNode>(node)) ) {
+    *max_category = std::max<int64_t>(*max_category, 0);
+    for (uint32_t e : cat_cond->left_categories) {
+      *max_category = std::max(*max_category, static_cast<int64_t>(e));
+    }
+  }
+  for (ASTNode* child : node->children) {
+    scan_categories(child, max_category);
+  }
+}
+
 static void
 rewrite_thresholds(ASTNode* node,
                    const std::vector<std::vector<tl_float>>& cut_pts) {
   NumericalConditionNode* num_cond;
-  if ( (num_cond = dynamic_cast<NumericalConditionNode*>(node)) ) {
+  if ( (num_cond = NodeCast<NumericalConditionNode>(node)) ) {
     CHECK(!num_cond->quantized) << "should not be already quantized";
     const tl_float threshold = num_cond->threshold.float_val;
     if (std::isfinite(threshold)) {
       const auto& v = cut_pts[num_cond->split_index];
       auto loc = math::binary_search(v.begin(), v.end(), threshold);
       CHECK(loc != v.end());
-      num_cond->threshold.int_val = static_cast<int>(loc - v.begin()) * 2;
+      // bin 2k+1 holds the values equal to the k-th threshold; see choose_bin_size()
+      num_cond->threshold.int_val = static_cast<int>(loc - v.begin()) * 2 + 1;
       num_cond->quantized = true;
     }  // splits with infinite thresholds will not be quantized
   }
@@ -50,30 +70,71 @@ rewrite_thresholds(ASTNode* node,
   }
 }
 
+/*
+ * \brief choose the narrowest unsigned integer type that holds the bins of every
+ *        feature. Numerical features with n thresholds have 2n+1 bins: bin 2k+1
+ *        for values equal to the k-th threshold and bin 2k for values between
+ *        the (k-1)-th and k-th thresholds. Categorical features use the
+ *        category as the bin. The largest value of the type is reserved for
+ *        missing values, and the one below it for categories not used by any
+ *        split.
+ * \return width of bins in bytes: 1, 2 or 4
+ */
+static int
+choose_bin_size(const std::vector<std::vector<tl_float>>& cut_pts, int64_t max_category) {
+  size_t max_num_cut_pts = 0;
+  for (const auto& e : cut_pts) {
+    max_num_cut_pts = std::max(max_num_cut_pts, e.size());
+  }
+  for (int bin_size : {1, 2}) {
+    const int64_t max_bin = (int64_t(1) << (bin_size * 8)) - 2;
+    if (static_cast<int64_t>(max_num_cut_pts) * 2 <= max_bin && max_category < max_bin) {
+      return bin_size;
+    }
+  }
+  return 4;
+}
+
 void ASTBuilder::QuantizeThresholds() {
   this->quantize_threshold_flag = true;
-  std::vector<std::set<tl_float>> cut_pts;
-  std::vector<std::vector<tl_float>> cut_pts_vec;
-  cut_pts.resize(this->num_feature);
-  cut_pts_vec.resize(this->num_feature);
-  scan_thresholds(this->main_node, &cut_pts);
-  // convert cut_pts into std::vector
+  const std::vector<ASTNode*> tree_heads = GetTreeHeads();
+  // each thread collects the thresholds of the trees it visits; the sets are
+  // merged afterwards, so the result doesn't depend on the order of the trees
+  std::vector<std::vector<std::set<tl_float>>> cut_pts_tloc(
+    this->nodes.size(), std::vector<std::set<tl_float>>(this->num_feature));
+  std::vector<int64_t> max_category_per_tree(tree_heads.size(), -1);
+  common_util::ParallelFor(tree_heads.size(), this->nthread, [&](size_t i) {
+    scan_thresholds(tree_heads[i], &cut_pts_tloc[omp_get_thread_num()]);
+    scan_categories(tree_heads[i], &max_category_per_tree[i]);
+  });
+  std::vector<std::vector<tl_float>> cut_pts_vec(this->num_feature);
   for (int i = 0; i < this->num_feature; ++i) {
-    std::copy(cut_pts[i].begin(), cut_pts[i].end(),
-              std::back_inserter(cut_pts_vec[i]));
+    std::set<tl_float> cut_pts;
+    for (auto& e : cut_pts_tloc) {
+      cut_pts.insert(e[i].begin(), e[i].end());
+      e[i].clear();
+    }
+    // convert cut_pts into std::vector
+    std::copy(cut_pts.begin(), cut_pts.end(), std::back_inserter(cut_pts_vec[i]));
   }
+  const int64_t max_category
+    = std::accumulate(max_category_per_tree.begin(), max_category_per_tree.end(), int64_t(-1),
+                      [](int64_t a, int64_t b) { return std::max(a, b); });
 
   /* revise all numerical splits by quantizing thresholds */
-  rewrite_thresholds(this->main_node, cut_pts_vec);
+  common_util::ParallelFor(tree_heads.size(), this->nthread, [&](size_t i) {
+    rewrite_thresholds(tree_heads[i], cut_pts_vec);
+  });
+  const int bin_size = choose_bin_size(cut_pts_vec, max_category);
 
   CHECK_EQ(this->main_node->children.size(), 1);
   ASTNode* top_ac_node = this->main_node->children[0];
-  CHECK(dynamic_cast<AccumulatorContextNode*>(top_ac_node));
-  /* dynamic_cast<> is used here to check node types. This is to ensure
+  CHECK(NodeCast<AccumulatorContextNode>(top_ac_node));
+  /* NodeCast<> is used here to check node types. This is to ensure
      that we don't accidentally call QuantizeThresholds() twice. */
 
   ASTNode* quantizer_node = AddNode<QuantizerNode>(this->main_node,
-                                                   std::move(cut_pts_vec));
+                                                   std::move(cut_pts_vec), bin_size);
   quantizer_node->children.push_back(top_ac_node);
   top_ac_node->parent = quantizer_node;
   this->main_node->children[0] = quantizer_node;
@@ -4,7 +4,14 @@
  * \brief Split prediction subroutine into multiple translation units (files)
  */
 #include <dmlc/registry.h>
+#include <algorithm>
+#include <bitset>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <utility>
 #include "./builder.h"
+#include "../common/parallel_util.h"
 
 namespace treelite {
 namespace compiler {
@@ -12,56 +19,201 @@ namespace compiler {
 DMLC_REGISTRY_FILE_TAG(split);
 
 int count_tu_nodes(ASTNode* node) {
-  int accum = (dynamic_cast<TranslationUnitNode*>(node)) ? 1 : 0;
+  int accum = (NodeCast<TranslationUnitNode>(node)) ? 1 : 0;
   for (ASTNode* child : node->children) {
     accum += count_tu_nodes(child);
   }
   return accum;
 }
 
-void ASTBuilder::Split(int parallel_comp) {
+namespace {
+
+/* estimated cost of a tree, both to compile and to evaluate: the number of
+   nodes, each of which is emitted as one test or one entry of an array */
+size_t count_nodes(const ASTNode* node) {
+  size_t accum = 1;
+  for (const ASTNode* child : node->children) {
+    accum += count_nodes(child);
+  }
+  return accum;
+}
+
+/* set the bits of the features tested by a tree */
+void collect_features(const ASTNode* node, std::vector<uint64_t>* features) {
+  const ConditionNode* cond = NodeCast<ConditionNode>(node);
+  if (cond) {
+    (*features)[cond->split_index / 64] |= (uint64_t(1) << (cond->split_index % 64));
+  }
+  for (const ASTNode* child : node->children) {
+    collect_features(child, features);
+  }
+}
+
+/* trees in decreasing order of cost; ties are broken by tree ID */
+std::vector<size_t> order_by_cost(const std::vector<size_t>& cost) {
+  std::vector<size_t> order(cost.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&cost](size_t a, size_t b) {
+    return cost[a] > cost[b];
+  });
+  return order;
+}
+
+/* Tree i goes to unit (i % nunit). The assignment of a tree does not depend
+   on the total number of trees, so appending trees to the model, or
+   retraining a few of them, leaves most units unchanged. The unchanged
+   units need not be compiled again (see the compile cache of export_lib).
+   This does not hold with quantize=1: every unit tests thresholds by their
+   bin index, so a new cut point renumbers the bins of its feature in all
+   units that test that feature, and most units change. */
+std::vector<int> assign_round_robin(size_t ntree, int nunit) {
+  std::vector<int> unit_of(ntree);
+  for (size_t i = 0; i < ntree; ++i) {
+    unit_of[i] = static_cast<int>(i % nunit);
+  }
+  return unit_of;
+}
+
+/* Greedy bin packing (longest processing time first): each tree, from the
+   costliest to the cheapest, goes to the unit with the lowest total cost so
+   far. No unit ends up costing more than 4/3 of the optimum, so that a unit
+   with the deepest trees doesn't hold up the parallel build. */
+std::vector<int> assign_balanced(const std::vector<size_t>& cost, int nunit) {
+  std::vector<int> unit_of(cost.size());
+  // (load, unit ID); the least loaded unit is on top, with ties broken by ID
+  using Entry = std::pair<size_t, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> units;
+  for (int unit_id = 0; unit_id < nunit; ++unit_id) {
+    units.emplace(0, unit_id);
+  }
+  for (size_t tree_id : order_by_cost(cost)) {
+    Entry e = units.top();
+    units.pop();
+    unit_of[tree_id] = e.second;
+    e.first += cost[tree_id];
+    units.push(e);
+  }
+  return unit_of;
+}
+
+/* Like assign_balanced(), but each tree goes to the unit whose trees test the
+   most similar set of features (by Jaccard index), among the units that stay
+   within 10% of the average cost. The trees of a unit then read fewer
+   distinct features, which keeps the row being scored in fewer cache lines.
+   The costliest trees seed the units, one per unit. */
+std::vector<int> assign_by_feature(const std::vector<size_t>& cost,
+                                   const std::vector<std::vector<uint64_t>>& features,
+                                   int nunit) {
+  std::vector<int> unit_of(cost.size());
+  const double total_cost
+    = static_cast<double>(std::accumulate(cost.begin(), cost.end(), size_t(0)));
+  const double capacity = total_cost / nunit * 1.1;
+  std::vector<size_t> load(nunit, 0);
+  std::vector<std::vector<uint64_t>> unit_features(
+    nunit, std::vector<uint64_t>(features.empty() ? 0 : features[0].size(), 0));
+  const std::vector<size_t> order = order_by_cost(cost);
+  for (size_t k = 0; k < order.size(); ++k) {
+    const size_t tree_id = order[k];
+    int best = -1;
+    if (k < static_cast<size_t>(nunit)) {
+      best = static_cast<int>(k);
+    } else {
+      double best_score = -1.0;
+      for (int unit_id = 0; unit_id < nunit; ++unit_id) {
+        if (static_cast<double>(load[unit_id] + cost[tree_id]) > capacity) {
+          continue;
+        }
+        size_t num_common = 0, num_union = 0;
+        for (size_t w = 0; w < features[tree_id].size(); ++w) {
+          num_common += std::bitset<64>(features[tree_id][w] & unit_features[unit_id][w]).count();
+          num_union += std::bitset<64>(features[tree_id][w] | unit_features[unit_id][w]).count();
+        }
+        const double score = (num_union > 0) ? static_cast<double>(num_common) / num_union : 0.0;
+        if (score > best_score || (score == best_score && load[unit_id] < load[best])) {
+          best = unit_id;
+          best_score = score;
+        }
+      }
+      if (best < 0) {  // no unit has room left; fall back to the least loaded
+        best = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+      }
+    }
+    unit_of[tree_id] = best;
+    load[best] += cost[tree_id];
+    for (size_t w = 0; w < features[tree_id].size(); ++w) {
+      unit_features[best][w] |= features[tree_id][w];
+    }
+  }
+  return unit_of;
+}
+
+}  // anonymous namespace
+
+void ASTBuilder::Split(int parallel_comp, const std::string& method) {
   if (parallel_comp <= 0) {
     LOG(INFO) << "Parallel compilation disabled; all member trees will be "
               << "dumped to a single source file. This may increase "
               << "compilation time and memory usage.";
     return;
   }
+  CHECK(method == "round_robin" || method == "balanced" || method == "feature")
+    << "Unknown method '" << method << "' for dividing trees into translation units; "
+    << "must be one of 'round_robin', 'balanced' and 'feature'";
   LOG(INFO) << "Parallel compilation enabled; member trees will be "
-            << "divided into " << parallel_comp << " translation units.";
+            << "divided into " << parallel_comp << " translation units ("
+            << method << ").";
   CHECK_EQ(this->main_node->children.size(), 1);
   ASTNode* top_ac_node = this->main_node->children[0];
-  CHECK(dynamic_cast<AccumulatorContextNode*>(top_ac_node));
+  CHECK(NodeCast<AccumulatorContextNode>(top_ac_node));
 
   /* tree_head[i] stores reference to head of tree i */
   std::vector<ASTNode*> tree_head;
   for (ASTNode* node : top_ac_node->children) {
-    CHECK(dynamic_cast<ConditionNode*>(node) || dynamic_cast<OutputNode*>(node)
-          || dynamic_cast<CodeFolderNode*>(node));
+    CHECK(NodeCast<ConditionNode>(node) || NodeCast<OutputNode>(node)
+          || NodeCast<CodeFolderNode>(node));
     tree_head.push_back(node);
   }
-  /* dynamic_cast<> is used here to check node types. This is to ensure
+  /* NodeCast<> is used here to check node types. This is to ensure
      that we don't accidentally call Split() twice. */
 
-  const int ntree = static_cast<int>(tree_head.size());
-  const int nunit = parallel_comp;
-  const int unit_size = (ntree + nunit - 1) / nunit;
+  const size_t ntree = tree_head.size();
+  const int nunit = static_cast<int>(std::min(static_cast<size_t>(parallel_comp), ntree));
+  std::vector<int> unit_of;  // unit_of[i] : unit to which tree i is assigned
+  if (method == "round_robin") {
+    unit_of = assign_round_robin(ntree, nunit);
+  } else {
+    std::vector<size_t> cost(ntree);
+    common_util::ParallelFor(ntree, this->nthread, [&](size_t i) {
+      cost[i] = count_nodes(tree_head[i]);
+    });
+    if (method == "balanced") {
+      unit_of = assign_balanced(cost, nunit);
+    } else {
+      const size_t num_word = (static_cast<size_t>(this->num_feature) + 63) / 64;
+      std::vector<std::vector<uint64_t>> features(ntree, std::vector<uint64_t>(num_word, 0));
+      common_util::ParallelFor(ntree, this->nthread, [&](size_t i) {
+        collect_features(tree_head[i], &features[i]);
+      });
+      unit_of = assign_by_feature(cost, features, nunit);
+    }
+  }
+
   std::vector<ASTNode*> tu_list;  // list of translation units
+  std::vector<AccumulatorContextNode*> ac_list;
   const int current_num_tu = count_tu_nodes(this->main_node);
   for (int unit_id = 0; unit_id < nunit; ++unit_id) {
-    const int tree_begin = unit_id * unit_size;
-    const int tree_end = std::min((unit_id + 1) * unit_size, ntree);
-    if (tree_begin < tree_end) {
-      TranslationUnitNode* tu
-        = AddNode<TranslationUnitNode>(top_ac_node, current_num_tu + unit_id);
-      tu_list.push_back(tu);
-      AccumulatorContextNode* ac = AddNode<AccumulatorContextNode>(tu);
-      tu->children.push_back(ac);
-      for (int tree_id = tree_begin; tree_id < tree_end; ++tree_id) {
-        ASTNode* tree_head_node = tree_head[tree_id];
-        tree_head_node->parent = ac;
-        ac->children.push_back(tree_head_node);
-      }
-    }
+    TranslationUnitNode* tu
+      = AddNode<TranslationUnitNode>(top_ac_node, current_num_tu + unit_id);
+    tu_list.push_back(tu);
+    AccumulatorContextNode* ac = AddNode<AccumulatorContextNode>(tu);
+    tu->children.push_back(ac);
+    ac_list.push_back(ac);
+  }
+  // within each unit, the trees stay in the order of the model
+  for (size_t tree_id = 0; tree_id < ntree; ++tree_id) {
+    AccumulatorContextNode* ac = ac_list[unit_of[tree_id]];
+    tree_head[tree_id]->parent = ac;
+    ac->children.push_back(tree_head[tree_id]);
   }
   top_ac_node->children = tu_list;
 }
@@ -7,12 +7,15 @@
 #include <treelite/compiler.h>
 #include <treelite/compiler_param.h>
 #include <treelite/annotator.h>
+#include <treelite/filesystem.h>
 #include <fmt/format.h>
 #include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <unordered_map>
 #include <queue>
 #include <cmath>
+#include <utility>
 #include "./pred_transform.h"
 #include "./ast/builder.h"
 #include "./native/main_template.h"
@@ -22,6 +25,7 @@
 #include "./common/format_util.h"
 #include "./common/code_folding_util.h"
 #include "./common/categorical_bitmap.h"
+#include "./common/parallel_util.h"
 
 #if defined(_MSC_VER) || defined(_WIN32)
 #define DLLEXPORT_KEYWORD "__declspec(dllexport) "
@@ -39,7 +43,7 @@ DMLC_REGISTRY_FILE_TAG(ast_native);
 class ASTNativeCompiler : public Compiler {
  public:
   explicit ASTNativeCompiler(const CompilerParam& param)
-    : param(param) {
+    : param(param), num_thread_(1), unit_worker_(false) {
     if (param.verbose > 0) {
       LOG(INFO) << "Using ASTNativeCompiler";
     }
@@ -47,6 +51,10 @@ class ASTNativeCompiler : public Compiler {
       LOG(INFO) << "Warning: 'dump_array_as_elf' parameter is not applicable "
                    "for ASTNativeCompiler";
     }
+    if (param.dense_input > 0 && param.quantize > 0) {
+      LOG(INFO) << "Warning: 'dense_input' parameter is not applicable "
+                   "when 'quantize' is set";
+    }
   }
 
   CompiledModel Compile(const Model& model) override {
@@ -60,8 +68,16 @@ class ASTNativeCompiler : public Compiler {
     global_bias_ = model.param.global_bias;
     pred_tranform_func_ = PredTransformFunction("native", model);
     files_.clear();
+    emit_dense_ = false;
+    preprocess_code_.clear();
+    unit_function_names_.clear();
+    file_declarations_.clear();
+    unit_bodies_.clear();
+    flushed_line_count_.clear();
+    bin_size_ = 0;
+    num_thread_ = common_util::NumCodegenThread(param.nthread);
 
-    ASTBuilder builder;
+    ASTBuilder builder(num_thread_);
     builder.BuildAST(model);
     if (builder.FoldCode(param.code_folding_req)
         || param.quantize > 0) {
@@ -79,7 +95,11 @@ class ASTNativeCompiler : public Compiler {
       LOG(INFO) << "Loading node frequencies from `"
                 << param.annotate_in << "'";
     }
-    builder.Split(param.parallel_comp);
+    if (param.profile_layout > 0) {
+      const int num_outlined = builder.OutlineColdCode(0.01);
+      LOG(INFO) << num_outlined << " cold subtrees will be placed in cold.c";
+    }
+    builder.Split(param.parallel_comp, param.unit_partition);
     if (param.quantize > 0) {
       builder.QuantizeThresholds();
     }
@@ -93,8 +113,18 @@ class ASTNativeCompiler : public Compiler {
     }
 
     WalkAST(builder.GetRootNode(), "main.c", 0);
-    if (files_.count("arrays.c") > 0) {
-      PrependToBuffer("arrays.c", "#include \"header.h\"\n", 0);
+    for (auto& kv : file_declarations_) {
+      InsertDeclarations(&files_[kv.first].content, kv.second);
+    }
+    file_declarations_.clear();
+    if (!output_dir_.empty()) {
+      std::vector<std::string> remaining;
+      for (const auto& kv : files_) {
+        remaining.push_back(kv.first);
+      }
+      for (const std::string& name : remaining) {
+        FlushBuffer(name);
+      }
     }
 
     {
@@ -109,6 +139,13 @@ class ASTNativeCompiler : public Compiler {
                                   {"length", std::to_string(line_count)} });
         }
       }
+      for (const auto& kv : flushed_line_count_) {
+        if (kv.first.compare(kv.first.length() - 2, 2, ".c") == 0) {
+          source_list.push_back({ {"name",
+                                   kv.first.substr(0, kv.first.length() - 2)},
+                                  {"length", std::to_string(kv.second)} });
+        }
+      }
       std::ostringstream oss;
       std::unique_ptr<dmlc::JSONWriter> writer(new dmlc::JSONWriter(&oss));
       writer->BeginObject();
@@ -117,10 +154,35 @@ class ASTNativeCompiler : public Compiler {
       writer->EndObject();
       files_["recipe.json"] = CompiledModel::FileEntry(oss.str());
     }
+    if (!output_dir_.empty()) {
+      FlushBuffer("recipe.json");
+      FinishFlushedFiles();
+    }
     cm.files = std::move(files_);
     return cm;
   }
 
+  void CompileToDirectory(const Model& model, const std::string& dirpath,
+                          bool verbose) override {
+    // Each translation unit is written to disk as soon as it is generated, so
+    // that only one unit is held in memory at a time (besides main.c and
+    // header.h). With parallel_comp=0, the whole model is in main.c.
+    output_dir_ = dirpath;
+    try {
+      Compile(model);
+    } catch (...) {
+      // leave neither temporary files nor the streaming mode behind, so that
+      // the compiler can be used again
+      DiscardFlushedFiles();
+      output_dir_.clear();
+      throw;
+    }
+    output_dir_.clear();
+    if (verbose) {
+      LOG(INFO) << "Code generation finished; files were written to " << dirpath;
+    }
+  }
+
  private:
   CompilerParam param;
   int num_feature_;
@@ -131,33 +193,126 @@ class ASTNativeCompiler : public Compiler {
   std::string pred_tranform_func_;
   std::string array_is_categorical_;
   std::unordered_map<std::string, CompiledModel::FileEntry> files_;
+  bool emit_dense_;
+    // whether the code being emitted reads rows of a dense matrix (const float*)
+    // instead of arrays of union Entry
+  std::string preprocess_code_;
+    // body of preprocess_batch(), which converts feature values into bin indices
+  int bin_size_;
+    // width of bins (quantized feature values) in bytes; 0 if thresholds are
+    // not quantized
+  std::vector<std::string> unit_function_names_;
+    // names of the functions for translation units, indexed by unit ID
+  std::unordered_map<std::string, std::string> file_declarations_;
+    // declarations of the arrays and functions that each source file uses but
+    // doesn't define; see DeclareInFile()
+  std::string output_dir_;
+    // if not empty, files are written to this directory as they are generated;
+    // see FlushBuffer()
+  std::unordered_map<std::string, size_t> flushed_line_count_;
+    // number of lines written so far to each file in output_dir_
+  int num_thread_;
+    // number of threads used to generate translation units
+  bool unit_worker_;
+    // whether this instance generates the body of a single translation unit,
+    // for another instance; see GenerateUnitBodies()
+
+  // code generated for the body of a translation unit by a worker
+  struct UnitBody {
+    std::unordered_map<std::string, std::string> files;
+      // the unit and the parts of arrays.c and cold.c it uses, without #include
+    std::unordered_map<std::string, std::string> declarations;
+      // see DeclareInFile()
+  };
+  std::unordered_map<int, UnitBody> unit_bodies_;
+    // bodies generated ahead of time, indexed by unit ID
+
+  // instance of the compiler that generates a unit body with the same settings
+  ASTNativeCompiler(const ASTNativeCompiler& parent, bool unit_worker)
+    : param(parent.param), num_feature_(parent.num_feature_),
+      num_output_group_(parent.num_output_group_), emit_dense_(parent.emit_dense_),
+      bin_size_(parent.bin_size_), num_thread_(1), unit_worker_(unit_worker) {}
+
+  // Generate the bodies of up to [num_thread_] translation units at once: the
+  // units among the children of [node], starting from the [begin]-th child.
+  // Each unit is generated by a worker into buffers of its own, which
+  // HandleTUNode() then appends to the files in the order of the units, so
+  // that the output doesn't depend on the number of threads. When the output is
+  // streamed to disk, no more than [num_thread_] units are held in memory.
+  void GenerateUnitBodies(const ASTNode* node, size_t begin) {
+    std::vector<const TranslationUnitNode*> units;
+    for (size_t i = begin; i < node->children.size()
+                           && units.size() < static_cast<size_t>(num_thread_); ++i) {
+      const TranslationUnitNode* unit = NodeCast<TranslationUnitNode>(node->children[i]);
+      if (unit) {
+        units.push_back(unit);
+      }
+    }
+    std::vector<UnitBody> bodies(units.size());
+    common_util::ParallelFor(units.size(), num_thread_, [&](size_t i) {
+      ASTNativeCompiler worker(*this, true);
+      CHECK_EQ(units[i]->children.size(), 1);
+      worker.WalkAST(units[i]->children[0], fmt::format("tu{}.c", units[i]->unit_id), 2);
+      for (auto& kv : worker.files_) {
+        bodies[i].files[kv.first] = std::move(kv.second.content);
+      }
+      bodies[i].declarations = std::move(worker.file_declarations_);
+    });
+    for (size_t i = 0; i < units.size(); ++i) {
+      unit_bodies_[units[i]->unit_id] = std::move(bodies[i]);
+    }
+  }
+
+  void AppendUnitBody(const UnitBody& body) {
+    for (const auto& kv : body.files) {
+      // a worker leaves the #include of shared files out; see StartSharedFile()
+      StartSharedFile(kv.first);
+      files_[kv.first].content += kv.second;
+    }
+    for (const auto& kv : body.declarations) {
+      file_declarations_[kv.first] += kv.second;
+    }
+  }
+
+  // begin arrays.c or cold.c, which hold the code of several units, with an
+  // #include, unless the file was already started
+  inline void StartSharedFile(const std::string& name) {
+    if ((name == "arrays.c" || name == "cold.c") && !unit_worker_ && !FileStarted(name)) {
+      AppendToBuffer(name, "#include \"header.h\"\n", 0);
+    }
+  }
 
   void WalkAST(const ASTNode* node,
                const std::string& dest,
                size_t indent) {
-    const MainNode* t1;
-    const AccumulatorContextNode* t2;
-    const ConditionNode* t3;
-    const OutputNode* t4;
-    const TranslationUnitNode* t5;
-    const QuantizerNode* t6;
-    const CodeFolderNode* t7;
-    if ( (t1 = dynamic_cast<const MainNode*>(node)) ) {
-      HandleMainNode(t1, dest, indent);
-    } else if ( (t2 = dynamic_cast<const AccumulatorContextNode*>(node)) ) {
-      HandleACNode(t2, dest, indent);
-    } else if ( (t3 = dynamic_cast<const ConditionNode*>(node)) ) {
-      HandleCondNode(t3, dest, indent);
-    } else if ( (t4 = dynamic_cast<const OutputNode*>(node)) ) {
-      HandleOutputNode(t4, dest, indent);
-    } else if ( (t5 = dynamic_cast<const TranslationUnitNode*>(node)) ) {
-      HandleTUNode(t5, dest, indent);
-    } else if ( (t6 = dynamic_cast<const QuantizerNode*>(node)) ) {
-      HandleQNode(t6, dest, indent);
-    } else if ( (t7 = dynamic_cast<const CodeFolderNode*>(node)) ) {
-      HandleCodeFolderNode(t7, dest, indent);
-    } else {
-      LOG(FATAL) << "Unrecognized AST node type";
+    switch (node->kind) {
+      case ASTNodeKind::kMain:
+        HandleMainNode(static_cast<const MainNode*>(node), dest, indent);
+        break;
+      case ASTNodeKind::kAccumulatorContext:
+        HandleACNode(static_cast<const AccumulatorContextNode*>(node), dest, indent);
+        break;
+      case ASTNodeKind::kNumericalCondition:
+      case ASTNodeKind::kCategoricalCondition:
+        HandleCondNode(static_cast<const ConditionNode*>(node), dest, indent);
+        break;
+      case ASTNodeKind::kOutput:
+        HandleOutputNode(static_cast<const OutputNode*>(node), dest, indent);
+        break;
+      case ASTNodeKind::kTranslationUnit:
+        HandleTUNode(static_cast<const TranslationUnitNode*>(node), dest, indent);
+        break;
+      case ASTNodeKind::kQuantizer:
+        HandleQNode(static_cast<const QuantizerNode*>(node), dest, indent);
+        break;
+      case ASTNodeKind::kCodeFolder:
+        HandleCodeFolderNode(static_cast<const CodeFolderNode*>(node), dest, indent);
+        break;
+      case ASTNodeKind::kColdCode:
+        HandleColdCodeNode(static_cast<const ColdCodeNode*>(node), dest, indent);
+        break;
+      default:
+        LOG(FATAL) << "Unrecognized AST node type";
     }
   }
 
@@ -168,6 +323,80 @@ class ASTNativeCompiler : public Compiler {
     files_[dest].content += common_util::IndentMultiLineString(content, indent);
   }
 
+  // declare an array or a function defined in another source file, in the file
+  // that uses it. The declarations are inserted below #include "header.h" once
+  // the code is generated. They are kept out of header.h, so that adding or
+  // changing a tree leaves the header, and thus the other units, unchanged.
+  inline void DeclareInFile(const std::string& dest,
+                            const std::string& declaration) {
+    file_declarations_[dest] += declaration;
+  }
+
+  // place declarations below #include "header.h", or at the start of content
+  // that doesn't include the header (a later part of a file being flushed)
+  static void InsertDeclarations(std::string* content, const std::string& declarations) {
+    const std::string include_header = "#include \"header.h\"\n";
+    const size_t pos = content->find(include_header);
+    if (pos == std::string::npos) {
+      content->insert(0, declarations);
+    } else {
+      content->insert(pos + include_header.length(), declarations);
+    }
+  }
+
+  // whether anything was written to a given file, in memory or on disk
+  inline bool FileStarted(const std::string& name) const {
+    return files_.count(name) > 0 || flushed_line_count_.count(name) > 0;
+  }
+
+  // write the content of a buffer generated so far to a temporary file in
+  // output_dir_ and clear the buffer. This must be called between two
+  // top-level definitions, since the declarations pending for the file are
+  // written first.
+  void FlushBuffer(const std::string& name) {
+    auto it = files_.find(name);
+    if (it == files_.end()) {
+      return;
+    }
+    std::string& content = it->second.content;
+    auto decl = file_declarations_.find(name);
+    if (decl != file_declarations_.end()) {
+      InsertDeclarations(&content, decl->second);
+      file_declarations_.erase(decl);
+    }
+    const bool first = (flushed_line_count_.count(name) == 0);
+    std::ofstream of(output_dir_ + "/" + name + ".tmp",
+                     first ? std::ios::out | std::ios::trunc : std::ios::out | std::ios::app);
+    CHECK(of) << "Failed to write to " << output_dir_ << "/" << name << ".tmp";
+    of << content;
+    flushed_line_count_[name] += std::count(content.begin(), content.end(), '\n');
+    files_.erase(it);
+  }
+
+  // move the temporary files into place. A file identical to the one already
+  // in output_dir_ is discarded, so that its modification time doesn't change.
+  void FinishFlushedFiles() {
+    for (const auto& kv : flushed_line_count_) {
+      const std::string path = output_dir_ + "/" + kv.first;
+      if (filesystem::FilesHaveSameContent(path + ".tmp", path)) {
+        std::remove((path + ".tmp").c_str());
+      } else {
+        filesystem::ReplaceFile(path + ".tmp", path);
+      }
+    }
+    flushed_line_count_.clear();
+  }
+
+  // remove the temporary files, after code generation failed
+  void DiscardFlushedFiles() {
+    for (const auto& kv : flushed_line_count_) {
+      std::remove((output_dir_ + "/" + kv.first + ".tmp").c_str());
+    }
+    flushed_line_count_.clear();
+    files_.clear();
+    file_declarations_.clear();
+  }
+
   // prepend content to a given buffer, with given level of indentation
   inline void PrependToBuffer(const std::string& dest,
                               const std::string& content,
@@ -194,6 +423,27 @@ class ASTNativeCompiler : public Compiler {
           "size_t predict_multiclass(union Entry* data, int pred_margin, "
                                     "float* result)"
         : "float predict(union Entry* data, int pred_margin)";
+    const char* predict_batch_function_signature
+      = "size_t predict_batch(union Entry* rows, size_t nrow, size_t stride, "
+                             "int pred_margin, float* out)";
+    const char* predict_batch_dense_function_signature
+      = "size_t predict_batch_dense(const float* rows, size_t nrow, size_t stride, "
+                                   "float missing_value, int pred_margin, float* out)";
+    const char* preprocess_batch_function_signature
+      = "void preprocess_batch(union Entry* rows, size_t nrow, size_t stride)";
+    const char* postprocess_batch_function_signature
+      = "size_t postprocess_batch(size_t nrow, int pred_margin, float* out)";
+    const char* predict_batch_quantized_function_signature
+      = "size_t predict_batch_quantized(const bin_t* rows, size_t nrow, size_t stride, "
+                                       "int pred_margin, float* out)";
+    const QuantizerNode* qnode = NodeCast<QuantizerNode>(node->children[0]);
+    bin_size_ = (qnode ? qnode->bin_size : 0);
+    // predict() is a thin wrapper around predict_batch(), so that the code for
+    // the trees is emitted only once
+    const std::string predict_function_body
+      = fmt::format((num_output_group_ > 1) ? native::predict_body_multiclass_template
+                                            : native::predict_body_template,
+                    "num_feature"_a = num_feature_);
 
     if (!array_is_categorical_.empty()) {
       array_is_categorical_
@@ -216,6 +466,7 @@ class ASTNativeCompiler : public Compiler {
           = get_global_bias_function_signature,
         "pred_transform_function"_a = pred_tranform_func_,
         "predict_function_signature"_a = predict_function_signature,
+        "predict_function_body"_a = predict_function_body,
         "num_output_group"_a = num_output_group_,
         "num_feature"_a = num_feature_,
         "pred_transform"_a = pred_transform_,
@@ -236,48 +487,184 @@ class ASTNativeCompiler : public Compiler {
         "get_global_bias_function_signature"_a
           = get_global_bias_function_signature,
         "predict_function_signature"_a = predict_function_signature,
-        "threshold_type"_a = (param.quantize > 0 ? "int" : "float")),
+        "predict_batch_function_signature"_a = predict_batch_function_signature,
+        "preprocess_batch_function_signature"_a = preprocess_batch_function_signature,
+        "postprocess_batch_function_signature"_a = postprocess_batch_function_signature,
+        "bin_type"_a = (bin_size_ > 0 ? fmt::format(native::bin_type_template,
+                                                      "bin_type"_a = BinTypeName())
+                                       : std::string()),
+        "node_struct"_a = fmt::format(param.compact_nodes > 0
+                                      ? native::compact_node_struct_template
+                                      : native::node_struct_template,
+          "threshold_type"_a = (bin_size_ > 0 ? "bin_t" : "float"))),
       indent);
 
-    CHECK_EQ(node->children.size(), 1);
-    WalkAST(node->children[0], dest, indent + 2);
+    if (bin_size_ > 0) {
+      // the trees are emitted once, as predict_batch_quantized(), which reads
+      // rows of bins; predict_batch() converts blocks of rows into bins and
+      // calls it
+      AppendToBuffer("header.h",
+        fmt::format("{dllexport}{predict_batch_quantized_function_signature};\n",
+          "dllexport"_a = DLLEXPORT_KEYWORD,
+          "predict_batch_quantized_function_signature"_a
+            = predict_batch_quantized_function_signature),
+        0);
+      EmitBatchFunction(node, dest, indent, predict_batch_quantized_function_signature);
+      EmitQuantizeFunctions(dest, indent, predict_batch_function_signature);
+    } else {
+      EmitBatchFunction(node, dest, indent, predict_batch_function_signature);
+    }
+    if (param.dense_input > 0 && param.quantize == 0) {
+      AppendToBuffer("header.h",
+        fmt::format(native::header_dense_input_template,
+          "dllexport"_a = DLLEXPORT_KEYWORD,
+          "predict_batch_dense_function_signature"_a
+            = predict_batch_dense_function_signature),
+        indent);
+      // walk the trees a second time, to emit the variant for dense input
+      emit_dense_ = true;
+      EmitBatchFunction(node, dest, indent, predict_batch_dense_function_signature);
+      emit_dense_ = false;
+    }
 
+    // predict_batch() consists of three steps: preprocess_batch(), which
+    // quantizes the input; the translation units (if any), which accumulate
+    // margin scores; and postprocess_batch(). The steps are exported
+    // separately, so that the runtime may run the units of a single row in
+    // parallel.
+    AppendToBuffer(dest,
+      fmt::format(native::preprocess_batch_template,
+        "preprocess_batch_function_signature"_a = preprocess_batch_function_signature,
+        "preprocess_code"_a = preprocess_code_),
+      indent);
     const std::string optional_average_field
       = (node->average_result) ? fmt::format(" / {}", node->num_tree)
                                : std::string("");
-    if (num_output_group_ > 1) {
-      AppendToBuffer(dest,
-        fmt::format(native::main_end_multiclass_template,
-          "num_output_group"_a = num_output_group_,
-          "optional_average_field"_a = optional_average_field,
-          "global_bias"_a = common_util::ToStringHighPrecision(node->global_bias)),
-        indent);
-    } else {
+    AppendToBuffer(dest,
+      fmt::format((num_output_group_ > 1) ? native::postprocess_batch_multiclass_template
+                                          : native::postprocess_batch_template,
+        "postprocess_batch_function_signature"_a = postprocess_batch_function_signature,
+        "num_output_group"_a = num_output_group_,
+        "optional_average_field"_a = optional_average_field,
+        "global_bias"_a = common_util::ToStringHighPrecision(node->global_bias)),
+      indent);
+    if (!unit_function_names_.empty()) {
+      const char* get_num_unit_function_signature = "size_t get_num_unit(void)";
+      const char* predict_unit_function_signature
+        = "void predict_margin_unit(size_t unit_id, union Entry* rows, size_t nrow, "
+                                   "size_t stride, float* out)";
+      std::string unit_cases;
+      for (size_t i = 0; i < unit_function_names_.size(); ++i) {
+        // after preprocess_batch(), the rows of a quantized model hold bins
+        unit_cases += fmt::format("   case {}: {}({}rows, nrow, stride, out); break;\n",
+                                  i, unit_function_names_[i],
+                                  (bin_size_ > 0 ? "(const bin_t*)" : ""));
+      }
+      unit_cases.pop_back();  // remove trailing newline
       AppendToBuffer(dest,
-        fmt::format(native::main_end_template,
-          "optional_average_field"_a = optional_average_field,
-          "global_bias"_a = common_util::ToStringHighPrecision(node->global_bias)),
+        fmt::format(native::unit_dispatch_template,
+          "get_num_unit_function_signature"_a = get_num_unit_function_signature,
+          "predict_unit_function_signature"_a = predict_unit_function_signature,
+          "num_unit"_a = unit_function_names_.size(),
+          "unit_cases"_a = unit_cases),
         indent);
+      AppendToBuffer("header.h",
+        fmt::format("{dllexport}{get_num_unit_function_signature};\n"
+                    "{dllexport}{predict_unit_function_signature};\n",
+          "dllexport"_a = DLLEXPORT_KEYWORD,
+          "get_num_unit_function_signature"_a = get_num_unit_function_signature,
+          "predict_unit_function_signature"_a = predict_unit_function_signature),
+        0);
     }
   }
 
+  void EmitBatchFunction(const MainNode* node,
+                         const std::string& dest,
+                         size_t indent,
+                         const char* function_signature) {
+    AppendToBuffer(dest,
+      fmt::format(native::main_batch_start_template,
+        "predict_batch_function_signature"_a = function_signature,
+        "num_output_group"_a = num_output_group_),
+      indent);
+    CHECK_EQ(node->children.size(), 1);
+    WalkAST(node->children[0], dest, indent + 2);
+    AppendToBuffer(dest, fmt::format(native::main_batch_end_template), indent);
+  }
+
+  void EmitQuantizeFunctions(const std::string& dest, size_t indent,
+                             const char* predict_batch_function_signature) {
+    const char* get_bin_size_function_signature = "size_t get_bin_size(void)";
+    const char* get_cut_points_function_signature
+      = "size_t get_cut_points(unsigned int fid, const float** out)";
+    // rows are converted in blocks of about 4K bins, kept on the stack unless a
+    // single row is larger than that
+    const int block_rows = std::max(4096 / std::max(num_feature_, 1), 1);
+    const int block_size = block_rows * std::max(num_feature_, 1);
+    const bool use_heap = (block_size > 4096);
+    AppendToBuffer(dest,
+      fmt::format(native::quantize_rows_template,
+        "predict_batch_function_signature"_a = predict_batch_function_signature,
+        "get_bin_size_function_signature"_a = get_bin_size_function_signature,
+        "get_cut_points_function_signature"_a = get_cut_points_function_signature,
+        "buffer_decl"_a
+          = use_heap ? fmt::format("  bin_t* bins = (bin_t*)malloc(sizeof(bin_t) * {});",
+                                   block_size)
+                     : fmt::format("  bin_t buf[{}];\n  bin_t* bins = buf;", block_size),
+        "buffer_free"_a = use_heap ? "  free(bins);" : "",
+        "block_rows"_a = block_rows,
+        "num_feature"_a = num_feature_,
+        "num_output_group"_a = num_output_group_),
+      indent);
+    AppendToBuffer("header.h",
+      fmt::format("{dllexport}{get_bin_size_function_signature};\n"
+                  "{dllexport}{get_cut_points_function_signature};\n",
+        "dllexport"_a = DLLEXPORT_KEYWORD,
+        "get_bin_size_function_signature"_a = get_bin_size_function_signature,
+        "get_cut_points_function_signature"_a = get_cut_points_function_signature),
+      0);
+  }
+
   void HandleACNode(const AccumulatorContextNode* node,
                     const std::string& dest,
                     size_t indent) {
-    if (num_output_group_ > 1) {
-      AppendToBuffer(dest,
-        fmt::format("float sum[{num_output_group}] = {{0.0f}};\n"
-                    "unsigned int tmp;\n"
-                    "int nid, cond, fid;  /* used for folded subtrees */\n",
-          "num_output_group"_a = num_output_group_), indent);
-    } else {
-      AppendToBuffer(dest,
-        "float sum = 0.0f;\n"
-        "unsigned int tmp;\n"
-        "int nid, cond, fid;  /* used for folded subtrees */\n", indent);
-    }
-    for (ASTNode* child : node->children) {
-      WalkAST(child, dest, indent);
+    // Trees are evaluated tree-major: each tree is applied to every row in
+    // the block before moving on to the next tree. [sum] refers to the
+    // accumulator of the current row, which is kept in out[].
+    AppendToBuffer(dest,
+      fmt::format("{sum_type} sum;\n"
+                  "{data_type} data;\n"
+                  "size_t r;\n"
+                  "unsigned int tmp;\n"
+                  "int nid, cond, fid;  /* used for folded subtrees */\n",
+        "sum_type"_a = (num_output_group_ > 1 ? "float*" : "float"),
+        "data_type"_a = RowType()), indent);
+    for (size_t i = 0; i < node->children.size(); ++i) {
+      const ASTNode* child = node->children[i];
+      if (NodeCast<TranslationUnitNode>(child)) {
+        if (num_thread_ > 1 && unit_bodies_.empty()) {
+          GenerateUnitBodies(node, i);
+        }
+        // the function for the translation unit loops over rows by itself
+        WalkAST(child, dest, indent);
+        continue;
+      }
+      if (num_output_group_ > 1) {
+        AppendToBuffer(dest,
+          fmt::format("for (r = 0; r < nrow; ++r) {{\n"
+                      "  data = &rows[r * stride];\n"
+                      "  sum = &out[r * {num_output_group}];\n",
+            "num_output_group"_a = num_output_group_), indent);
+        WalkAST(child, dest, indent + 2);
+        AppendToBuffer(dest, "}\n", indent);
+      } else {
+        AppendToBuffer(dest,
+          "for (r = 0; r < nrow; ++r) {\n"
+          "  data = &rows[r * stride];\n"
+          "  sum = out[r];\n", indent);
+        WalkAST(child, dest, indent + 2);
+        AppendToBuffer(dest, "  out[r] = sum;\n}\n", indent);
+      }
     }
   }
 
@@ -286,40 +673,84 @@ class ASTNativeCompiler : public Compiler {
                       size_t indent) {
     const NumericalConditionNode* t;
     std::string condition, condition_with_na_check;
-    if ( (t = dynamic_cast<const NumericalConditionNode*>(node)) ) {
+    if ( (t = NodeCast<NumericalConditionNode>(node)) ) {
       /* numerical split */
       condition = ExtractNumericalCondition(t);
       const char* condition_with_na_check_template
         = (node->default_left) ?
-            "!(data[{split_index}].missing != -1) || ({condition})"
-          : " (data[{split_index}].missing != -1) && ({condition})";
+            "!({present_test}) || ({condition})"
+          : " ({present_test}) && ({condition})";
       condition_with_na_check
         = fmt::format(condition_with_na_check_template,
-            "split_index"_a = node->split_index,
+            "present_test"_a = PresentTest(std::to_string(node->split_index)),
             "condition"_a = condition);
     } else {   /* categorical split */
       const CategoricalConditionNode* t2
-        = dynamic_cast<const CategoricalConditionNode*>(node);
+        = NodeCast<CategoricalConditionNode>(node);
       CHECK(t2);
       condition_with_na_check = ExtractCategoricalCondition(t2);
     }
+    CHECK_EQ(node->children.size(), 2);
+    const ASTNode* first = node->children[0];
+    const ASTNode* second = node->children[1];
     if (node->children[0]->data_count && node->children[1]->data_count) {
-      const int left_freq = node->children[0]->data_count.value();
-      const int right_freq = node->children[1]->data_count.value();
+      int first_freq = node->children[0]->data_count.value();
+      int second_freq = node->children[1]->data_count.value();
+      if (param.profile_layout > 0 && second_freq > first_freq) {
+        // emit the hot branch first, so that it directly follows the test
+        std::swap(first, second);
+        std::swap(first_freq, second_freq);
+        condition_with_na_check = fmt::format("!({})", condition_with_na_check);
+      }
       condition_with_na_check
         = fmt::format(" {keyword}( {condition} ) ",
-            "keyword"_a = ((left_freq > right_freq) ? "LIKELY" : "UNLIKELY"),
+            "keyword"_a = ((first_freq > second_freq) ? "LIKELY" : "UNLIKELY"),
             "condition"_a = condition_with_na_check);
     }
     AppendToBuffer(dest,
       fmt::format("if ({}) {{\n", condition_with_na_check), indent);
-    CHECK_EQ(node->children.size(), 2);
-    WalkAST(node->children[0], dest, indent + 2);
+    WalkAST(first, dest, indent + 2);
     AppendToBuffer(dest, "} else {\n", indent);
-    WalkAST(node->children[1], dest, indent + 2);
+    WalkAST(second, dest, indent + 2);
     AppendToBuffer(dest, "}\n", indent);
   }
 
+  void HandleColdCodeNode(const ColdCodeNode* node,
+                          const std::string& dest,
+                          size_t indent) {
+    // The subtree is moved into a function of its own, in cold.c, so that it
+    // doesn't take space in the instruction cache between the hot branches.
+    CHECK_EQ(node->children.size(), 1);
+    const std::string function_name
+      = fmt::format("cold_tree{}_node{}{}", node->children[0]->tree_id,
+                    node->children[0]->node_id, (emit_dense_ ? "_dense" : ""));
+    const std::string function_signature
+      = emit_dense_
+        ? fmt::format("void {}(const float* data, float missing_value, float* sum_out)",
+                      function_name)
+        : fmt::format("void {}({} data, float* sum_out)", function_name, RowType());
+    const char* sum_ref = (num_output_group_ > 1) ? "sum" : "&sum";
+    AppendToBuffer(dest,
+      emit_dense_ ? fmt::format("{}(data, missing_value, {});\n", function_name, sum_ref)
+                  : fmt::format("{}(data, {});\n", function_name, sum_ref), indent);
+
+    StartSharedFile("cold.c");
+    DeclareInFile(dest, fmt::format("COLD {};\n", function_signature));
+    AppendToBuffer("cold.c",
+      fmt::format("COLD {function_signature} {{\n"
+                  "  {sum_decl}\n"
+                  "  unsigned int tmp;\n"
+                  "  int nid, cond, fid;  /* used for folded subtrees */\n",
+        "function_signature"_a = function_signature,
+        "sum_decl"_a = (num_output_group_ > 1) ? "float* sum = sum_out;"
+                                               : "float sum = *sum_out;"), 0);
+    WalkAST(node->children[0], "cold.c", 2);
+    if (num_output_group_ == 1) {
+      AppendToBuffer("cold.c", "*sum_out = sum;\n", 2);
+    }
+    AppendToBuffer("cold.c", "}\n", 0);
+  }
+
   void HandleOutputNode(const OutputNode* node,
                         const std::string& dest,
                         size_t indent) {
@@ -333,41 +764,45 @@ class ASTNativeCompiler : public Compiler {
     const int unit_id = node->unit_id;
     const std::string new_file = fmt::format("tu{}.c", unit_id);
 
-    std::string unit_function_name, unit_function_signature,
-                unit_function_call_signature;
-    if (num_output_group_ > 1) {
-      unit_function_name
-        = fmt::format("predict_margin_multiclass_unit{}", unit_id);
-      unit_function_signature
-        = fmt::format("void {}(union Entry* data, float* result)",
-            unit_function_name);
-      unit_function_call_signature
-        = fmt::format("{}(data, sum);\n", unit_function_name);
-    } else {
-      unit_function_name
-        = fmt::format("predict_margin_unit{}", unit_id);
-      unit_function_signature
-        = fmt::format("float {}(union Entry* data)", unit_function_name);
-      unit_function_call_signature
-        = fmt::format("sum += {}(data);\n", unit_function_name);
-    }
+    // Each unit adds the margin scores of its trees to out[], for a block of
+    // [nrow] rows
+    const std::string unit_function_name
+      = fmt::format((num_output_group_ > 1) ? "predict_margin_multiclass_unit{}{}"
+                                            : "predict_margin_unit{}{}",
+          unit_id, (emit_dense_ ? "_dense" : ""));
+    const std::string unit_function_signature
+      = emit_dense_
+        ? fmt::format("void {}(const float* rows, size_t nrow, size_t stride, "
+                      "float missing_value, float* out)", unit_function_name)
+        : fmt::format("void {}({} rows, size_t nrow, size_t stride, float* out)",
+            unit_function_name, RowType());
+    const std::string unit_function_call_signature
+      = emit_dense_
+        ? fmt::format("{}(rows, nrow, stride, missing_value, out);\n", unit_function_name)
+        : fmt::format("{}(rows, nrow, stride, out);\n", unit_function_name);
     AppendToBuffer(dest, unit_function_call_signature, indent);
-    AppendToBuffer(new_file,
-                   fmt::format("#include \"header.h\"\n"
-                               "{} {{\n", unit_function_signature), 0);
+    if (!emit_dense_) {
+      CHECK_EQ(unit_id, static_cast<int>(unit_function_names_.size()));
+      unit_function_names_.push_back(unit_function_name);
+      AppendToBuffer(new_file, "#include \"header.h\"\n", 0);
+    }
+    AppendToBuffer(new_file, fmt::format("{} {{\n", unit_function_signature), 0);
     CHECK_EQ(node->children.size(), 1);
-    WalkAST(node->children[0], new_file, 2);
-    if (num_output_group_ > 1) {
-      AppendToBuffer(new_file,
-        fmt::format("  for (int i = 0; i < {num_output_group}; ++i) {{\n"
-                    "    result[i] += sum[i];\n"
-                    "  }}\n"
-                    "}}\n",
-          "num_output_group"_a = num_output_group_), 0);
+    auto body = unit_bodies_.find(unit_id);
+    if (body != unit_bodies_.end()) {
+      AppendUnitBody(body->second);
+      unit_bodies_.erase(body);
     } else {
-      AppendToBuffer(new_file, "  return sum;\n}\n", 0);
+      WalkAST(node->children[0], new_file, 2);
     }
+    AppendToBuffer(new_file, "}\n", 0);
     AppendToBuffer("header.h", fmt::format("{};\n", unit_function_signature), 0);
+    if (!output_dir_.empty()) {
+      // the unit is complete, along with the arrays and cold functions it uses
+      FlushBuffer(new_file);
+      FlushBuffer("arrays.c");
+      FlushBuffer("cold.c");
+    }
   }
 
   void HandleQNode(const QuantizerNode* node,
@@ -379,8 +814,6 @@ class ASTNativeCompiler : public Compiler {
     //   ensemble model. For each feature, an ascending list of unique
     //   thresholds is generated. The range th_begin[i]:(th_begin[i]+th_len[i])
     //   of the threshold[] array stores the threshold list for feature i.
-    size_t total_num_threshold;
-      // to hold total number of (distinct) thresholds
     {
       common_util::ArrayFormatter formatter(80, 2);
       for (const auto& e : node->cut_pts) {
@@ -399,7 +832,6 @@ class ASTNativeCompiler : public Compiler {
         formatter << accum;
         accum += e.size();  // e.size() = number of thresholds for each feature
       }
-      total_num_threshold = accum;
       array_th_begin = formatter.str();
     }
     {
@@ -409,20 +841,16 @@ class ASTNativeCompiler : public Compiler {
       }
       array_th_len = formatter.str();
     }
-    if (!array_threshold.empty() && !array_th_begin.empty() && !array_th_len.empty()) {
-      PrependToBuffer(dest,
-        fmt::format(native::qnode_template,
-          "total_num_threshold"_a = total_num_threshold), 0);
-      AppendToBuffer(dest,
-        fmt::format(native::quantize_loop_template,
-          "num_feature"_a = num_feature_), indent);
-    }
-    if (!array_threshold.empty()) {
-      PrependToBuffer(dest,
-        fmt::format("static const float threshold[] = {{\n"
-                    "{array_threshold}\n"
-                    "}};\n", "array_threshold"_a = array_threshold), 0);
+    if (array_threshold.empty()) {
+      array_threshold = "  0.0f  /* no threshold; th_len[] is all zeros */";
     }
+    PrependToBuffer(dest, fmt::format(native::qnode_template), 0);
+    preprocess_code_ = common_util::IndentMultiLineString(
+      fmt::format(native::quantize_in_place_template, "num_feature"_a = num_feature_), 2);
+    PrependToBuffer(dest,
+      fmt::format("static const float threshold[] = {{\n"
+                  "{array_threshold}\n"
+                  "}};\n", "array_threshold"_a = array_threshold), 0);
     if (!array_th_begin.empty()) {
       PrependToBuffer(dest,
         fmt::format("static const int th_begin[] = {{\n"
@@ -464,27 +892,34 @@ class ASTNativeCompiler : public Compiler {
 
     std::string output_switch_statement;
     Operator common_comp_op;
-    common_util::RenderCodeFolderArrays(node, param.quantize, false,
-      "{{ {default_left}, {split_index}, {threshold}, {left_child}, {right_child} }}",
+    const bool compact = (param.compact_nodes > 0);
+    const bool hot_first = (param.profile_layout > 0);
+    common_util::RenderCodeFolderArrays(node, param.quantize, false, compact, hot_first,
+      compact ? "{{ 0x{sindex:X}U, {threshold}, {right_child} }}"
+              : "{{ {default_left}, {split_index}, {threshold}, {left_child}, {right_child} }}",
       [this](const OutputNode* node) { return RenderOutputStatement(node); },
       &array_nodes, &array_cat_bitmap, &array_cat_begin,
       &output_switch_statement, &common_comp_op);
-    if (!array_nodes.empty()) {
-      AppendToBuffer("header.h",
-                     fmt::format("extern const struct Node {node_array_name}[];\n",
-                       "node_array_name"_a = node_array_name), 0);
+    // the arrays are shared by the variants for dense and non-dense input
+    if (!emit_dense_
+        && !(array_nodes.empty() && array_cat_bitmap.empty() && array_cat_begin.empty())) {
+      StartSharedFile("arrays.c");
+    }
+    if (!array_nodes.empty() && !emit_dense_) {
+      DeclareInFile(dest, fmt::format("extern const struct Node {node_array_name}[];\n",
+                                      "node_array_name"_a = node_array_name));
       AppendToBuffer("arrays.c",
-                     fmt::format("const struct Node {node_array_name}[] = {{\n"
+                     fmt::format("{align}const struct Node {node_array_name}[] = {{\n"
                                  "{array_nodes}\n"
                                  "}};\n",
+                       "align"_a = (compact ? "NODE_ARRAY_ALIGN " : ""),
                        "node_array_name"_a = node_array_name,
                        "array_nodes"_a = array_nodes), 0);
     }
 
-    if (!array_cat_bitmap.empty()) {
-      AppendToBuffer("header.h",
-                     fmt::format("extern const uint64_t {cat_bitmap_name}[];\n",
-                       "cat_bitmap_name"_a = cat_bitmap_name), 0);
+    if (!array_cat_bitmap.empty() && !emit_dense_) {
+      DeclareInFile(dest, fmt::format("extern const uint64_t {cat_bitmap_name}[];\n",
+                                      "cat_bitmap_name"_a = cat_bitmap_name));
       AppendToBuffer("arrays.c",
                      fmt::format("const uint64_t {cat_bitmap_name}[] = {{\n"
                                  "{array_cat_bitmap}\n"
@@ -493,10 +928,9 @@ class ASTNativeCompiler : public Compiler {
                        "array_cat_bitmap"_a = array_cat_bitmap), 0);
     }
 
-    if (!array_cat_begin.empty()) {
-      AppendToBuffer("header.h",
-                     fmt::format("extern const size_t {cat_begin_name}[];\n",
-                       "cat_begin_name"_a = cat_begin_name), 0);
+    if (!array_cat_begin.empty() && !emit_dense_) {
+      DeclareInFile(dest, fmt::format("extern const size_t {cat_begin_name}[];\n",
+                                      "cat_begin_name"_a = cat_begin_name));
       AppendToBuffer("arrays.c",
                      fmt::format("const size_t {cat_begin_name}[] = {{\n"
                                  "{array_cat_begin}\n"
@@ -505,6 +939,29 @@ class ASTNativeCompiler : public Compiler {
                        "array_cat_begin"_a = array_cat_begin), 0);
     }
 
+    // expressions to read a node, which depend on the layout of the node array
+    const std::string split_index
+      = compact ? fmt::format("(int)({}[nid].sindex & 0x1FFFFFFFU)", node_array_name)
+                : fmt::format("{}[nid].split_index", node_array_name);
+    const std::string default_left
+      = compact ? fmt::format("(int)({}[nid].sindex >> 31)", node_array_name)
+                : fmt::format("{}[nid].default_left", node_array_name);
+    // with the compact layout, the first child is the next node, and [hot_first]
+    // may put the right child first (bit 29)
+    std::string select_child;
+    if (!compact) {
+      select_child = fmt::format("cond ? {0}[nid].left_child : {0}[nid].right_child",
+                                 node_array_name);
+    } else {
+      select_child
+        = fmt::format("{cond} ? (({arr}[nid].sindex & 0x40000000U) ? -(nid + 1) : nid + 1) "
+                      ": {arr}[nid].right_child",
+            "cond"_a = (hot_first ? fmt::format("(cond ^ (int)(({}[nid].sindex >> 29) & 1U))",
+                                                node_array_name)
+                                  : std::string("cond")),
+            "arr"_a = node_array_name);
+    }
+
     if (array_nodes.empty()) {
       /* folded code consists of a single leaf node */
       AppendToBuffer(dest,
@@ -518,7 +975,12 @@ class ASTNativeCompiler : public Compiler {
                        "node_array_name"_a = node_array_name,
                        "cat_bitmap_name"_a = cat_bitmap_name,
                        "cat_begin_name"_a = cat_begin_name,
-                       "data_field"_a = (param.quantize > 0 ? "qvalue" : "fvalue"),
+                       "split_index"_a = split_index,
+                       "default_left"_a = default_left,
+                       "select_child"_a = select_child,
+                       "missing_test"_a = MissingTest("fid"),
+                       "fvalue"_a = FeatureValue("fid"),
+                       "data_value"_a = FeatureValue("fid"),
                        "comp_op"_a = OpName(common_comp_op),
                        "output_switch_statement"_a
                          = output_switch_statement), indent);
@@ -526,7 +988,11 @@ class ASTNativeCompiler : public Compiler {
       AppendToBuffer(dest,
                      fmt::format(native::eval_loop_template_without_categorical_feature,
                        "node_array_name"_a = node_array_name,
-                       "data_field"_a = (param.quantize > 0 ? "qvalue" : "fvalue"),
+                       "split_index"_a = split_index,
+                       "default_left"_a = default_left,
+                       "select_child"_a = select_child,
+                       "missing_test"_a = MissingTest("fid"),
+                       "data_value"_a = FeatureValue("fid"),
                        "comp_op"_a = OpName(common_comp_op),
                        "output_switch_statement"_a
                          = output_switch_statement), indent);
@@ -537,7 +1003,7 @@ class ASTNativeCompiler : public Compiler {
   ExtractNumericalCondition(const NumericalConditionNode* node) {
     std::string result;
     if (node->quantized) {  // quantized threshold
-      result = fmt::format("data[{split_index}].qvalue {opname} {threshold}",
+      result = fmt::format("data[{split_index}] {opname} {threshold}",
                  "split_index"_a = node->split_index,
                  "opname"_a = OpName(node->op),
                  "threshold"_a = node->threshold.int_val);
@@ -546,8 +1012,8 @@ class ASTNativeCompiler : public Compiler {
       // must be identical for all finite [lhs]. Same goes for operator >.
       result = (CompareWithOp(0.0, node->op, node->threshold.float_val) ? "1" : "0");
     } else {  // finite threshold
-      result = fmt::format("data[{split_index}].fvalue {opname} (float){threshold}",
-                 "split_index"_a = node->split_index,
+      result = fmt::format("{fvalue} {opname} (float){threshold}",
+                 "fvalue"_a = FeatureValue(std::to_string(node->split_index)),
                  "opname"_a = OpName(node->op),
                  "threshold"_a = common_util::ToStringHighPrecision(node->threshold.float_val));
     }
@@ -568,20 +1034,21 @@ class ASTNativeCompiler : public Compiler {
       result = "0";
     } else {
       std::ostringstream oss;
+      const std::string split_index = std::to_string(node->split_index);
       if (node->convert_missing_to_zero) {
         // All missing values are converted into zeros
         oss << fmt::format(
-          "((tmp = (data[{0}].missing == -1 ? 0U "
-          ": (unsigned int)(data[{0}].fvalue) )), ", node->split_index);
+          "((tmp = ({0} ? 0U "
+          ": (unsigned int)({1}) )), ", MissingTest(split_index), FeatureValue(split_index));
       } else {
         if (node->default_left) {
           oss << fmt::format(
-            "data[{0}].missing == -1 || ("
-            "(tmp = (unsigned int)(data[{0}].fvalue) ), ", node->split_index);
+            "{0} || ("
+            "(tmp = (unsigned int)({1}) ), ", MissingTest(split_index), FeatureValue(split_index));
         } else {
           oss << fmt::format(
-            "data[{0}].missing != -1 && ("
-            "(tmp = (unsigned int)(data[{0}].fvalue) ), ", node->split_index);
+            "{0} && ("
+            "(tmp = (unsigned int)({1}) ), ", PresentTest(split_index), FeatureValue(split_index));
         }
       }
       oss << "(tmp >= 0 && tmp < 64 && (( (uint64_t)"
@@ -598,6 +1065,30 @@ class ASTNativeCompiler : public Compiler {
     return result;
   }
 
+  // expressions to test and read feature [fid] of the current row. With
+  // quantized thresholds, the rows hold bins instead of feature values.
+  inline std::string MissingTest(const std::string& fid) const {
+    return emit_dense_ ? fmt::format("is_missing(data[{}], missing_value)", fid)
+         : bin_size_ > 0 ? fmt::format("data[{}] == BIN_MISSING", fid)
+         : fmt::format("data[{}].missing == -1", fid);
+  }
+  inline std::string PresentTest(const std::string& fid) const {
+    return emit_dense_ ? fmt::format("!is_missing(data[{}], missing_value)", fid)
+         : bin_size_ > 0 ? fmt::format("data[{}] != BIN_MISSING", fid)
+         : fmt::format("data[{}].missing != -1", fid);
+  }
+  inline std::string FeatureValue(const std::string& fid) const {
+    return (emit_dense_ || bin_size_ > 0) ? fmt::format("data[{}]", fid)
+                                          : fmt::format("data[{}].fvalue", fid);
+  }
+  // type of a pointer to a row
+  inline const char* RowType() const {
+    return emit_dense_ ? "const float*" : bin_size_ > 0 ? "const bin_t*" : "union Entry*";
+  }
+  inline const char* BinTypeName() const {
+    return bin_size_ == 1 ? "uint8_t" : bin_size_ == 2 ? "uint16_t" : "uint32_t";
+  }
+
   inline std::string
   RenderIsCategoricalArray(const std::vector<bool>& is_categorical) {
     common_util::ArrayFormatter formatter(80, 2);
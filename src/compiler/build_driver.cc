@@ -0,0 +1,242 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file build_driver.cc
+ * \author Hyunsu Cho
+ * \brief In-process driver that builds generated code into a shared library
+ */
+
+#include <treelite/build_driver.h>
+#include <dmlc/json.h>
+#include <dmlc/logging.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+/*! \brief contents of recipe.json, as written by the compilers */
+struct Recipe {
+  std::string target;
+  std::vector<std::string> sources;  // file names, without extension
+  std::vector<size_t> lengths;  // number of lines in each source
+  std::vector<std::string> extra;  // objects to link as they are
+};
+
+Recipe ReadRecipe(const std::string& dirpath) {
+  const std::string path = dirpath + "/recipe.json";
+  std::ifstream fi(path);
+  CHECK(fi) << "Failed to open " << path;
+  Recipe recipe;
+  std::vector<std::map<std::string, std::string>> sources;
+  dmlc::JSONReader reader(&fi);
+  reader.BeginObject();
+  std::string key;
+  while (reader.NextObjectItem(&key)) {
+    if (key == "target") {
+      reader.Read(&recipe.target);
+    } else if (key == "sources") {
+      reader.Read(&sources);
+    } else if (key == "extra") {
+      reader.Read(&recipe.extra);
+    } else {
+      LOG(FATAL) << "Unrecognized key '" << key << "' in " << path;
+    }
+  }
+  CHECK(!recipe.target.empty()) << "Malformed " << path << ": missing target";
+  for (const auto& source : sources) {
+    CHECK(source.count("name") > 0) << "Malformed " << path << ": source without name";
+    recipe.sources.push_back(source.at("name"));
+    recipe.lengths.push_back(source.count("length") > 0
+                             ? static_cast<size_t>(std::stoull(source.at("length"))) : 0);
+  }
+  return recipe;
+}
+
+inline std::string Quote(const std::string& path) {
+  return "\"" + path + "\"";
+}
+
+/*! \brief command lines for a toolchain, mirroring python/treelite/contrib */
+class Toolchain {
+ public:
+  Toolchain(const std::string& name, const std::vector<std::string>& options)
+    : msvc_(name == "msvc"), name_(name), options_() {
+    for (const std::string& e : options) {
+      options_ += " " + e;
+    }
+  }
+  const char* ObjectExt() const {
+    return msvc_ ? ".obj" : ".o";
+  }
+  std::string CompileCommand(const std::string& source, const std::string& object) const {
+    return msvc_ ? fmt::format("cl.exe /c /openmp /Ox /Fo{} {}{}",
+                               Quote(object), Quote(source), options_)
+                 : fmt::format("{} -c -O3 -o {} {} -fPIC -std=c99{}",
+                               name_, Quote(object), Quote(source), options_);
+  }
+  std::string LinkCommand(const std::vector<std::string>& objects,
+                          const std::string& libpath) const {
+    std::string object_list;
+    for (const std::string& e : objects) {
+      object_list += " " + Quote(e);
+    }
+    return msvc_ ? fmt::format("cl.exe /LD /Fe{} /openmp{}{}",
+                               Quote(libpath), object_list, options_)
+                 : fmt::format("{} -shared -O3 -o {}{} -std=c99{} -lm",
+                               name_, Quote(libpath), object_list, options_);
+  }
+
+ private:
+  bool msvc_;
+  std::string name_;
+  std::string options_;
+};
+
+/*!
+ * \brief run a command, with its output redirected to [logfile]. On failure,
+ *        the output is returned through [log]; otherwise the log file is
+ *        removed.
+ * \return whether the command succeeded
+ */
+bool RunCommand(const std::string& command, const std::string& logfile, std::string* log) {
+  std::string redirected = fmt::format("{} > {} 2>&1", command, Quote(logfile));
+#ifdef _WIN32
+  // cmd.exe strips the outermost pair of quotes
+  redirected = Quote(redirected);
+#endif
+  const int retcode = std::system(redirected.c_str());
+  if (retcode == 0) {
+    std::remove(logfile.c_str());
+    return true;
+  }
+  std::ifstream fi(logfile);
+  std::ostringstream oss;
+  oss << fi.rdbuf();
+  *log = oss.str();
+  return false;
+}
+
+inline double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // anonymous namespace
+
+namespace treelite {
+namespace compiler {
+
+std::string BuildReport::ToJSON() const {
+  std::ostringstream oss;
+  std::unique_ptr<dmlc::JSONWriter> writer(new dmlc::JSONWriter(&oss));
+  std::map<std::string, double> unit_seconds;
+  for (const BuildStep& e : units) {
+    unit_seconds[e.name] = e.seconds;
+  }
+  writer->BeginObject();
+  writer->WriteObjectKeyValue("units", unit_seconds);
+  writer->WriteObjectKeyValue("link", link.name);
+  writer->WriteObjectKeyValue("link_seconds", link.seconds);
+  writer->WriteObjectKeyValue("total_seconds", total_seconds);
+  writer->EndObject();
+  return oss.str();
+}
+
+BuildReport BuildSharedLib(const std::string& dirpath, const std::string& toolchain,
+                           const std::string& libpath, int nthread,
+                           const std::vector<std::string>& options, bool verbose) {
+  const auto build_start = std::chrono::steady_clock::now();
+  const Recipe recipe = ReadRecipe(dirpath);
+  const Toolchain tc(toolchain, options);
+  const size_t num_unit = recipe.sources.size();
+
+  // longest sources first: with a greedy scheduler, this keeps a long unit from
+  // being started last and delaying the link step
+  std::vector<size_t> order(num_unit);
+  for (size_t i = 0; i < num_unit; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&recipe](size_t a, size_t b) {
+    return recipe.lengths[a] > recipe.lengths[b];
+  });
+
+  if (nthread <= 0) {
+    nthread = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+  }
+  const size_t num_worker = std::min(static_cast<size_t>(nthread), std::max(num_unit, size_t(1)));
+  if (verbose) {
+    LOG(INFO) << "Compiling " << num_unit << " source files in " << dirpath
+              << " with " << num_worker << " concurrent jobs...";
+  }
+
+  BuildReport report;
+  report.units.resize(num_unit);
+  std::atomic<size_t> next_job(0);
+  std::atomic<bool> failed(false);
+  std::mutex mutex;  // guards [error] and logging
+  std::string error;
+  auto worker = [&]() {
+    for (size_t job = next_job++; job < num_unit && !failed; job = next_job++) {
+      const size_t unit = order[job];
+      const std::string& name = recipe.sources[unit];
+      const std::string base = dirpath + "/" + name;
+      const auto start = std::chrono::steady_clock::now();
+      std::string log;
+      const bool ok = RunCommand(tc.CompileCommand(base + ".c", base + tc.ObjectExt()),
+                                 base + ".log", &log);
+      report.units[unit] = BuildStep{name + ".c", SecondsSince(start)};
+      std::lock_guard<std::mutex> guard(mutex);
+      if (!ok) {
+        if (!failed) {
+          error = fmt::format("Failed to compile {}.c:\n{}", base, log);
+        }
+        failed = true;
+      } else if (verbose) {
+        LOG(INFO) << "Compiled " << name << ".c in "
+                  << fmt::format("{:.2f}", report.units[unit].seconds) << " seconds";
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_worker; ++i) {
+    workers.emplace_back(worker);
+  }
+  for (std::thread& e : workers) {
+    e.join();
+  }
+  CHECK(!failed) << error;
+
+  std::vector<std::string> objects;
+  for (const std::string& name : recipe.sources) {
+    objects.push_back(dirpath + "/" + name + tc.ObjectExt());
+  }
+  for (const std::string& name : recipe.extra) {
+    objects.push_back(dirpath + "/" + name);
+  }
+  if (verbose) {
+    LOG(INFO) << "Generating dynamic shared library " << libpath << "...";
+  }
+  const auto link_start = std::chrono::steady_clock::now();
+  std::string log;
+  CHECK(RunCommand(tc.LinkCommand(objects, libpath), dirpath + "/" + recipe.target + ".log",
+                   &log))
+    << "Failed to create dynamic library " << libpath << ":\n" << log;
+  report.link = BuildStep{libpath, SecondsSince(link_start)};
+  report.total_seconds = SecondsSince(build_start);
+  if (verbose) {
+    LOG(INFO) << "Generated shared library in "
+              << fmt::format("{:.2f}", report.total_seconds) << " seconds";
+  }
+  return report;
+}
+
+}  // namespace compiler
+}  // namespace treelite
@@ -10,6 +10,7 @@
 #include <dmlc/logging.h>
 #include <fmt/format.h>
 #include <unordered_map>
+#include <utility>
 #include <queue>
 #include <set>
 #include <string>
@@ -29,6 +30,8 @@ inline void
 RenderCodeFolderArrays(const CodeFolderNode* node,
                        bool quantize,
                        bool use_boolean_literal,
+                       bool compact,
+                       bool hot_first,
                        const char* node_entry_template,
                        OutputFormatFunc RenderOutputStatement,
                        std::string* array_nodes,
@@ -40,39 +43,100 @@ RenderCodeFolderArrays(const CodeFolderNode* node,
   const int tree_id = node->children[0]->tree_id;
   // list of descendants, with newly assigned ID's
   std::unordered_map<ASTNode*, int> descendants;
+  // test nodes among the descendants, in the order they are rendered
+  std::vector<ASTNode*> test_nodes;
   // list of all OutputNode's among the descendants
   std::vector<OutputNode*> output_nodes;
   // two arrays used to store categorical split info
   std::vector<uint64_t> cat_bitmap;
   std::vector<size_t> cat_begin{0};
 
-  // 1. Assign new continuous node ID's (0, 1, 2, ...) by traversing the
-  // subtree breadth-first
+  // Children of a test node in the order they are laid out. If [hot_first] is
+  // set, the child with the higher data count comes first.
+  auto ordered_children = [hot_first](ASTNode* e) -> std::pair<ASTNode*, ASTNode*> {
+    CHECK_EQ(e->children.size(), 2U);
+    ASTNode* left = e->children[0];
+    ASTNode* right = e->children[1];
+    if (hot_first && left->data_count && right->data_count
+        && right->data_count.value() > left->data_count.value()) {
+      return {right, left};
+    }
+    return {left, right};
+  };
+
+  // 1. Assign new continuous node ID's (0, 1, 2, ...) to the test nodes and
+  // negative ID's (-1, -2, ...) to the leaves. By default, the subtree is
+  // traversed breadth-first, or depth-first with the hot child first if
+  // [hot_first] is set. With the compact layout, the test nodes are numbered
+  // depth-first, so that the first child of node i is node (i + 1) whenever
+  // it is a test node. A leaf that is the first child of node i then gets
+  // ID -(i + 1), and the other leaves are numbered after all such ID's.
   {
-    std::queue<ASTNode*> Q;
     std::set<treelite::Operator> ops;
-    int new_node_id = 0;
-    int new_leaf_id = -1;
-    Q.push(node->children[0]);
-    while (!Q.empty()) {
-      ASTNode* e = Q.front(); Q.pop();
+    std::vector<ASTNode*> leaves;
+    auto visit = [&](ASTNode* e) {
       // sanity check: all descendants must have same tree_id
       CHECK_EQ(e->tree_id, tree_id);
       // sanity check: all descendants must be ConditionNode or OutputNode
-      ConditionNode* t1 = dynamic_cast<ConditionNode*>(e);
-      OutputNode* t2 = dynamic_cast<OutputNode*>(e);
+      ConditionNode* t1 = NodeCast<ConditionNode>(e);
+      OutputNode* t2 = NodeCast<OutputNode>(e);
       NumericalConditionNode* t3;
       CHECK(t1 || t2);
       if (t2) {  // e is OutputNode
-        descendants[e] = new_leaf_id--;
+        leaves.push_back(e);
+        output_nodes.push_back(t2);
       } else {
-        if ( (t3 = dynamic_cast<NumericalConditionNode*>(t1)) ) {
+        if ( (t3 = NodeCast<NumericalConditionNode>(t1)) ) {
           ops.insert(t3->op);
         }
-        descendants[e] = new_node_id++;
+        descendants[e] = static_cast<int>(test_nodes.size());
+        test_nodes.push_back(e);
+      }
+    };
+    if (compact || hot_first) {
+      std::vector<ASTNode*> stack{node->children[0]};
+      while (!stack.empty()) {
+        ASTNode* e = stack.back(); stack.pop_back();
+        visit(e);
+        if (!e->children.empty()) {
+          const auto children = ordered_children(e);
+          stack.push_back(children.second);
+          stack.push_back(children.first);
+        }
+      }
+    }
+    if (compact) {
+      int new_leaf_id = -static_cast<int>(test_nodes.size()) - 1;
+      for (ASTNode* e : test_nodes) {
+        const auto children = ordered_children(e);
+        if (NodeCast<OutputNode>(children.first)) {
+          descendants[children.first] = -descendants[e] - 1;
+        }
+        if (NodeCast<OutputNode>(children.second)) {
+          descendants[children.second] = new_leaf_id--;
+        }
+      }
+      if (test_nodes.empty()) {
+        descendants[node->children[0]] = -1;
+      }
+    } else if (hot_first) {
+      int new_leaf_id = -1;
+      for (ASTNode* e : leaves) {
+        descendants[e] = new_leaf_id--;
+      }
+    } else {
+      std::queue<ASTNode*> Q;
+      Q.push(node->children[0]);
+      while (!Q.empty()) {
+        ASTNode* e = Q.front(); Q.pop();
+        visit(e);
+        for (ASTNode* child : e->children) {
+          Q.push(child);
+        }
       }
-      for (ASTNode* child : e->children) {
-        Q.push(child);
+      int new_leaf_id = -1;
+      for (ASTNode* e : leaves) {
+        descendants[e] = new_leaf_id--;
       }
     }
     // sanity check: all numerical splits must have identical comparison operators
@@ -80,8 +144,7 @@ RenderCodeFolderArrays(const CodeFolderNode* node,
     *common_comp_op = ops.empty() ? Operator::kLT : *ops.begin();
   }
 
-  // 2. Render node_treeXX_nodeXX[] by traversing the subtree once again.
-  // Now we can use the re-assigned node ID's.
+  // 2. Render node_treeXX_nodeXX[], using the re-assigned node ID's.
   {
     ArrayFormatter formatter(80, 2);
 
@@ -89,57 +152,61 @@ RenderCodeFolderArrays(const CodeFolderNode* node,
     std::string threshold;
     int left_child_id, right_child_id;
     unsigned int split_index;
-    OutputNode* t1;
     NumericalConditionNode* t2;
     CategoricalConditionNode* t3;
 
-    std::queue<ASTNode*> Q;
-    Q.push(node->children[0]);
-    while (!Q.empty()) {
-      ASTNode* e = Q.front(); Q.pop();
-      if ( (t1 = dynamic_cast<OutputNode*>(e)) ) {
-        output_nodes.push_back(t1);
-        // don't render OutputNode but save it for later
+    for (ASTNode* e : test_nodes) {
+      CHECK_EQ(e->children.size(), 2U);
+      left_child_id = descendants[ e->children[0] ];
+      right_child_id = descendants[ e->children[1] ];
+      if ( (t2 = NodeCast<NumericalConditionNode>(e)) ) {
+        default_left = t2->default_left;
+        split_index = t2->split_index;
+        threshold
+         = quantize ? std::to_string(t2->threshold.int_val)
+                    : ToStringHighPrecision(t2->threshold.float_val);
       } else {
-        CHECK_EQ(e->children.size(), 2U);
-        left_child_id = descendants[ e->children[0] ];
-        right_child_id = descendants[ e->children[1] ];
-        if ( (t2 = dynamic_cast<NumericalConditionNode*>(e)) ) {
-          default_left = t2->default_left;
-          split_index = t2->split_index;
-          threshold
-           = quantize ? std::to_string(t2->threshold.int_val)
-                      : ToStringHighPrecision(t2->threshold.float_val);
-        } else {
-          CHECK((t3 = dynamic_cast<CategoricalConditionNode*>(e)));
-          default_left = t3->default_left;
-          split_index = t3->split_index;
-          threshold = "-1";  // dummy value
-          CHECK(!t3->convert_missing_to_zero)
-            << "Code folding not supported, because a categorical split "
-            << "is supposed to convert missing values into zeros, and this "
-            << "is not possible with current code folding implementation.";
-          std::vector<uint64_t> bitmap
-            = GetCategoricalBitmap(t3->left_categories);
-          cat_bitmap.insert(cat_bitmap.end(), bitmap.begin(), bitmap.end());
-          cat_begin.push_back(cat_bitmap.size());
-        }
-        const char* (*BoolWrapper)(bool);
-        if (use_boolean_literal) {
-          BoolWrapper = [](bool x) { return x ? "true" : "false"; };
-        } else {
-          BoolWrapper = [](bool x) { return x ? "1" : "0"; };
-        }
-        formatter << fmt::format(node_entry_template,
-                                  "default_left"_a = BoolWrapper(default_left),
-                                  "split_index"_a = split_index,
-                                  "threshold"_a = threshold,
-                                  "left_child"_a = left_child_id,
-                                  "right_child"_a = right_child_id);
+        CHECK((t3 = NodeCast<CategoricalConditionNode>(e)));
+        default_left = t3->default_left;
+        split_index = t3->split_index;
+        threshold = "-1";  // dummy value
+        CHECK(!t3->convert_missing_to_zero)
+          << "Code folding not supported, because a categorical split "
+          << "is supposed to convert missing values into zeros, and this "
+          << "is not possible with current code folding implementation.";
+        std::vector<uint64_t> bitmap
+          = GetCategoricalBitmap(t3->left_categories);
+        cat_bitmap.insert(cat_bitmap.end(), bitmap.begin(), bitmap.end());
       }
-      for (ASTNode* child : e->children) {
-        Q.push(child);
+      // cat_begin[] is indexed by node ID, so numerical splits get an empty range
+      cat_begin.push_back(cat_bitmap.size());
+      const char* (*BoolWrapper)(bool);
+      if (use_boolean_literal) {
+        BoolWrapper = [](bool x) { return x ? "true" : "false"; };
+      } else {
+        BoolWrapper = [](bool x) { return x ? "1" : "0"; };
+      }
+      uint32_t sindex = 0;
+      if (compact) {
+        // the first child is implicit; the other one is stored in [right_child]
+        const auto children = ordered_children(e);
+        const bool swapped = (children.first != e->children[0]);
+        CHECK_LT(split_index, (1U << 29))
+          << "Feature index is too large for the compact node layout";
+        sindex = split_index | (default_left ? (1U << 31) : 0U)
+                 | (descendants[children.first] < 0 ? (1U << 30) : 0U)
+                 | (swapped ? (1U << 29) : 0U);
+        if (swapped) {
+          std::swap(left_child_id, right_child_id);
+        }
       }
+      formatter << fmt::format(node_entry_template,
+                                "default_left"_a = BoolWrapper(default_left),
+                                "split_index"_a = split_index,
+                                "sindex"_a = sindex,
+                                "threshold"_a = threshold,
+                                "left_child"_a = left_child_id,
+                                "right_child"_a = right_child_id);
     }
     *array_nodes = formatter.str();
   }
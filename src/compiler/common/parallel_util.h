@@ -0,0 +1,60 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file parallel_util.h
+ * \author Hyunsu Cho
+ * \brief Utilities for running parts of code generation in parallel
+ */
+#ifndef TREELITE_COMPILER_COMMON_PARALLEL_UTIL_H_
+#define TREELITE_COMPILER_COMMON_PARALLEL_UTIL_H_
+
+#include <treelite/omp.h>
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+
+namespace treelite {
+namespace compiler {
+namespace common_util {
+
+/*!
+ * \brief number of threads to use for code generation
+ * \param nthread number of threads requested; 0 to use all cores
+ */
+inline int NumCodegenThread(int nthread) {
+  const int max_thread = omp_get_max_threads();
+  return (nthread <= 0) ? max_thread : std::min(nthread, max_thread);
+}
+
+/*!
+ * \brief call func(i) for every i in [0, n), using up to [nthread] threads.
+ *        Iterations are handed out one at a time, since their cost varies
+ *        widely (e.g. one iteration per tree). If func throws, the first
+ *        exception is rethrown once all iterations are done.
+ */
+template <typename Func>
+inline void ParallelFor(size_t n, int nthread, Func func) {
+  std::exception_ptr error;
+  const int64_t n_i = static_cast<int64_t>(n);
+  #pragma omp parallel for schedule(dynamic) num_threads(nthread)
+  for (int64_t i = 0; i < n_i; ++i) {
+    try {
+      func(static_cast<size_t>(i));
+    } catch (...) {
+      #pragma omp critical
+      {
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+}  // namespace common_util
+}  // namespace compiler
+}  // namespace treelite
+
+#endif  // TREELITE_COMPILER_COMMON_PARALLEL_UTIL_H_
@@ -5,6 +5,7 @@
  */
 #include <treelite/compiler.h>
 #include <treelite/compiler_param.h>
+#include <treelite/filesystem.h>
 #include <dmlc/registry.h>
 
 namespace dmlc {
@@ -20,6 +21,39 @@ Compiler* Compiler::Create(const std::string& name,
   }
   return (e->body)(param);
 }
+
+void Compiler::CompileToDirectory(const Model& model, const std::string& dirpath,
+                                  bool verbose) {
+  const compiler::CompiledModel compiled_model = Compile(model);
+  if (verbose) {
+    LOG(INFO) << "Code generation finished. Writing code to files...";
+  }
+  for (const auto& it : compiled_model.files) {
+    const std::string filename_full = dirpath + "/" + it.first;
+    // Files that are identical to those already in dirpath are left untouched,
+    // so that their modification time doesn't change and build tools (e.g. make)
+    // only recompile the units that changed since the last code generation.
+    const bool unchanged = it.second.is_binary
+      ? filesystem::FileHasContent(filename_full, it.second.content_binary.data(),
+                                   it.second.content_binary.size())
+      : filesystem::FileHasContent(filename_full, it.second.content.data(),
+                                   it.second.content.size());
+    if (unchanged) {
+      if (verbose) {
+        LOG(INFO) << "File " << it.first << " is unchanged";
+      }
+      continue;
+    }
+    if (verbose) {
+      LOG(INFO) << "Writing file " << it.first << "...";
+    }
+    if (it.second.is_binary) {
+      filesystem::WriteToFile(filename_full, it.second.content_binary);
+    } else {
+      filesystem::WriteToFile(filename_full, it.second.content);
+    }
+  }
+}
 }  // namespace treelite
 
 namespace treelite {
@@ -30,5 +64,6 @@ DMLC_REGISTER_PARAMETER(CompilerParam);
 // List of files that will be force linked in static links.
 DMLC_REGISTRY_LINK_TAG(ast_native);
 DMLC_REGISTRY_LINK_TAG(failsafe);
+DMLC_REGISTRY_LINK_TAG(quickscorer);
 }  // namespace compiler
 }  // namespace treelite
@@ -138,7 +138,7 @@ void FormatArrayAsELF(std::vector<char>* elf_buffer) {
     {27, SHT_PROGBITS,    SHF_ALLOC | SHF_EXECINSTR, 0x0, 0x0,                0, 0, 0,  1,  0},
     {33, SHT_PROGBITS,        SHF_WRITE | SHF_ALLOC, 0x0, 0x0,                0, 0, 0,  1,  0},
     {39,   SHT_NOBITS,        SHF_WRITE | SHF_ALLOC, 0x0, 0x0,                0, 0, 0,  1,  0},
-    {44, SHT_PROGBITS, SHF_ALLOC | SHF_X86_64_LARGE, 0x0, 0x0,       array_size, 0, 0, 32,  0},
+    {44, SHT_PROGBITS, SHF_ALLOC | SHF_X86_64_LARGE, 0x0, 0x0,       array_size, 0, 0, 64,  0},
     {53, SHT_PROGBITS,      SHF_MERGE | SHF_STRINGS, 0x0, 0x0,  sizeof(comment), 0, 0,  1,  1},
     {62, SHT_PROGBITS,                          0x0, 0x0, 0x0,                0, 0, 0,  1,  0},
     { 1,   SHT_SYMTAB,                          0x0, 0x0, 0x0,   sizeof(symtab), 8, 8,  8, 24},
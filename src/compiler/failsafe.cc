@@ -36,6 +36,12 @@ struct NodeStructValue {
   int cright;
 };
 
+struct CompactNodeStructValue {
+  unsigned int sindex;
+  float info;
+  unsigned int cright;
+};
+
 const char* header_template = R"TREELITETEMPLATE(
 #include <stdlib.h>
 #include <string.h>
@@ -52,12 +58,7 @@ union NodeInfo {{
   float threshold;
 }};
 
-struct Node {{
-  unsigned int sindex;
-  union NodeInfo info;
-  int cleft;
-  int cright;
-}};
+{node_struct}
 
 extern const struct Node nodes[];
 extern const int nodes_row_ptr[];
@@ -65,8 +66,35 @@ extern const int nodes_row_ptr[];
 {dllexport}size_t get_num_output_group(void);
 {dllexport}size_t get_num_feature(void);
 {dllexport}{predict_function_signature};
+{dllexport}size_t predict_batch(union Entry* rows, size_t nrow, size_t stride, int pred_margin,
+                                float* out);
+{dllexport}size_t predict_batch_dense(const float* rows, size_t nrow, size_t stride,
+                                      float missing_value, int pred_margin, float* out);
 )TREELITETEMPLATE";
 
+const char* node_struct_template = R"TREELITETEMPLATE(
+struct Node {
+  unsigned int sindex;
+  union NodeInfo info;
+  int cleft;
+  int cright;
+};)TREELITETEMPLATE";
+
+// Compact layout: the nodes of each tree are stored in depth-first order, so that the left child
+// of a test node is the node right after it. [cright] is relative to the start of the tree and is
+// zero for leaves.
+const char* compact_node_struct_template = R"TREELITETEMPLATE(
+struct Node {
+  unsigned int sindex;
+  union NodeInfo info;
+  unsigned int cright;
+};
+#if defined(_MSC_VER)
+#define NODE_ARRAY_ALIGN __declspec(align(64))
+#else
+#define NODE_ARRAY_ALIGN __attribute__((aligned(64)))
+#endif)TREELITETEMPLATE";
+
 const char* main_template = R"TREELITETEMPLATE(
 #include "header.h"
 
@@ -83,47 +111,95 @@ size_t get_num_feature(void) {{
 {pred_transform_function}
 
 {predict_function_signature} {{
-  {accumulator_definition};
+{predict_function_body}
+}}
+
+size_t predict_batch(union Entry* rows, size_t nrow, size_t stride, int pred_margin,
+                     float* out) {{
+  memset(out, 0, sizeof(float) * nrow * {num_output_group});
+
+  /* evaluate tree-major: apply each tree to every row before moving on to the next tree */
+  for (int tree_id = 0; tree_id < {num_tree}; ++tree_id) {{
+    const struct Node* tree = &nodes[nodes_row_ptr[tree_id]];
+    for (size_t r = 0; r < nrow; ++r) {{
+      const union Entry* data = &rows[r * stride];
+      int nid = 0;
+      while ({is_test_node}) {{
+        const unsigned feature_id = tree[nid].sindex & ((1U << 31) - 1U);
+        const unsigned char default_left = (tree[nid].sindex >> 31) != 0;
+        if (data[feature_id].missing == -1) {{
+          nid = (default_left ? {left_child} : {right_child});
+        }} else {{
+          nid = (data[feature_id].fvalue {compare_op} tree[nid].info.threshold
+                 ? {left_child} : {right_child});
+        }}
+      }}
+      {output_statement}
+    }}
+  }}
+  {return_statement}
+}}
+
+size_t predict_batch_dense(const float* rows, size_t nrow, size_t stride,
+                           float missing_value, int pred_margin, float* out) {{
+  memset(out, 0, sizeof(float) * nrow * {num_output_group});
 
   for (int tree_id = 0; tree_id < {num_tree}; ++tree_id) {{
-    int nid = 0;
     const struct Node* tree = &nodes[nodes_row_ptr[tree_id]];
-    while (tree[nid].cleft != -1) {{
-      const unsigned feature_id = tree[nid].sindex & ((1U << 31) - 1U);
-      const unsigned char default_left = (tree[nid].sindex >> 31) != 0;
-      if (data[feature_id].missing == -1) {{
-        nid = (default_left ? tree[nid].cleft : tree[nid].cright);
-      }} else {{
-        nid = (data[feature_id].fvalue {compare_op} tree[nid].info.threshold
-               ? tree[nid].cleft : tree[nid].cright);
+    for (size_t r = 0; r < nrow; ++r) {{
+      const float* data = &rows[r * stride];
+      int nid = 0;
+      while ({is_test_node}) {{
+        const unsigned feature_id = tree[nid].sindex & ((1U << 31) - 1U);
+        const unsigned char default_left = (tree[nid].sindex >> 31) != 0;
+        const float fvalue = data[feature_id];
+        if (isnan(fvalue) || fvalue == missing_value) {{
+          nid = (default_left ? {left_child} : {right_child});
+        }} else {{
+          nid = (fvalue {compare_op} tree[nid].info.threshold
+                 ? {left_child} : {right_child});
+        }}
       }}
+      {output_statement}
     }}
-    {output_statement}
   }}
   {return_statement}
 }}
 )TREELITETEMPLATE";
 
+const char* predict_body_multiclass_template =
+R"TREELITETEMPLATE(  return predict_batch(data, 1, {num_feature}, pred_margin, result);)TREELITETEMPLATE";
+  // only for multiclass classification
+
+const char* predict_body_template =
+R"TREELITETEMPLATE(  float result;
+  predict_batch(data, 1, {num_feature}, pred_margin, &result);
+  return result;)TREELITETEMPLATE";
+
 const char* return_multiclass_template =
 R"TREELITETEMPLATE(
-  for (int i = 0; i < {num_output_group}; ++i) {{
-    result[i] = sum[i] + (float)({global_bias});
-  }}
-  if (!pred_margin) {{
-    return pred_transform(result);
-  }} else {{
-    return {num_output_group};
+  size_t result_size = {num_output_group};
+  for (size_t i = 0; i < nrow; ++i) {{
+    float* result = &out[i * {num_output_group}];
+    for (int k = 0; k < {num_output_group}; ++k) {{
+      result[k] += (float)({global_bias});
+    }}
+    if (!pred_margin) {{
+      result_size = pred_transform(result);
+    }}
   }}
+  return result_size;
 )TREELITETEMPLATE";  // only for multiclass classification
 
 const char* return_template =
 R"TREELITETEMPLATE(
-  sum += (float)({global_bias});
-  if (!pred_margin) {{
-    return pred_transform(sum);
-  }} else {{
-    return sum;
+  for (size_t i = 0; i < nrow; ++i) {{
+    out[i] += (float)({global_bias});
+    if (!pred_margin) {{
+      out[i] = pred_transform(out[i]);
+    }}
   }}
+  return 1;
 )TREELITETEMPLATE";
 
 const char* arrays_template = R"TREELITETEMPLATE(
@@ -132,74 +208,118 @@ const char* arrays_template = R"TREELITETEMPLATE(
 {nodes}
 )TREELITETEMPLATE";
 
+// Lists the nodes of a tree in the order they are stored in nodes[]. With the compact layout, the
+// nodes are listed depth-first, so that the left child of each test node comes right after it.
+inline std::vector<int> NodeOrder(const treelite::Tree& tree, bool compact) {
+  std::vector<int> order;
+  if (!compact) {
+    for (int nid = 0; nid < tree.num_nodes; ++nid) {
+      order.push_back(nid);
+    }
+    return order;
+  }
+  std::vector<int> stack{0};
+  while (!stack.empty()) {
+    const int nid = stack.back();
+    stack.pop_back();
+    order.push_back(nid);
+    if (!tree.IsLeaf(nid)) {
+      stack.push_back(tree.RightChild(nid));
+      stack.push_back(tree.LeftChild(nid));
+    }
+  }
+  return order;
+}
+
+// Returns the fields of a node: packed feature index, threshold or leaf value, and the positions
+// of the children among the nodes of the tree. [position] maps node IDs to positions.
+inline NodeStructValue GetNodeStructValue(const treelite::Tree& tree, int nid,
+                                          const std::vector<int>& position) {
+  if (tree.IsLeaf(nid)) {
+    CHECK(!tree.HasLeafVector(nid))
+      << "multi-class random forest classifier is not supported in FailSafeCompiler";
+    return {0, static_cast<float>(tree.LeafValue(nid)), -1, -1};
+  }
+  CHECK(tree.SplitType(nid) == treelite::SplitFeatureType::kNumerical
+        && tree.LeftCategories(nid).empty())
+    << "categorical splits are not supported in FailSafeCompiler";
+  return {(tree.SplitIndex(nid) | (static_cast<uint32_t>(tree.DefaultLeft(nid)) << 31U)),
+          static_cast<float>(tree.Threshold(nid)),
+          position[tree.LeftChild(nid)], position[tree.RightChild(nid)]};
+}
+
+// Calls f(tree, nid, val) for every node of the model, in the order they are stored in nodes[], and fills
+// nodes_row_ptr[]
+template <typename Func>
+inline void ForEachNode(const treelite::Model& model, bool compact,
+                        treelite::compiler::common_util::ArrayFormatter* nodes_row_ptr, Func f) {
+  int node_count = 0;
+  *nodes_row_ptr << "0";
+  for (const auto& tree : model.trees) {
+    const std::vector<int> order = NodeOrder(tree, compact);
+    std::vector<int> position(tree.num_nodes);
+    for (size_t i = 0; i < order.size(); ++i) {
+      position[order[i]] = static_cast<int>(i);
+    }
+    for (int nid : order) {
+      f(tree, nid, GetNodeStructValue(tree, nid, position));
+    }
+    node_count += tree.num_nodes;
+    *nodes_row_ptr << std::to_string(node_count);
+  }
+}
+
 // Returns formatted nodes[] and nodes_row_ptr[] arrays
 // nodes[]: stores nodes from all decision trees
 // nodes_row_ptr[]: marks bounaries between decision trees. The nodes belonging to Tree [i] are
 //                  found in nodes[nodes_row_ptr[i]:nodes_row_ptr[i+1]]
-inline std::pair<std::string, std::string> FormatNodesArray(const treelite::Model& model) {
+inline std::pair<std::string, std::string> FormatNodesArray(const treelite::Model& model,
+                                                            bool compact) {
   treelite::compiler::common_util::ArrayFormatter nodes(100, 2);
   treelite::compiler::common_util::ArrayFormatter nodes_row_ptr(100, 2);
-  int node_count = 0;
-  nodes_row_ptr << "0";
-  for (const auto& tree : model.trees) {
-    for (int nid = 0; nid < tree.num_nodes; ++nid) {
-      if (tree.IsLeaf(nid)) {
-        CHECK(!tree.HasLeafVector(nid))
-          << "multi-class random forest classifier is not supported in FailSafeCompiler";
-        nodes << fmt::format("{{ 0x{sindex:X}, {info}, {cleft}, {cright} }}",
-          "sindex"_a = 0,
-          "info"_a = treelite::compiler::common_util::ToStringHighPrecision(tree.LeafValue(nid)),
-          "cleft"_a = -1,
-          "cright"_a = -1);
-      } else {
-        CHECK(tree.SplitType(nid) == treelite::SplitFeatureType::kNumerical
-              && tree.LeftCategories(nid).empty())
-          << "categorical splits are not supported in FailSafeCompiler";
-        nodes << fmt::format("{{ 0x{sindex:X}, {info}, {cleft}, {cright} }}",
-            "sindex"_a
-              = (tree.SplitIndex(nid) |(static_cast<uint32_t>(tree.DefaultLeft(nid)) << 31U)),
-            "info"_a = treelite::compiler::common_util::ToStringHighPrecision(tree.Threshold(nid)),
-            "cleft"_a = tree.LeftChild(nid),
-            "cright"_a = tree.RightChild(nid));
-      }
+  ForEachNode(model, compact, &nodes_row_ptr,
+              [&nodes, compact](const treelite::Tree& tree, int nid, const NodeStructValue& val) {
+    const std::string info = treelite::compiler::common_util::ToStringHighPrecision(
+        tree.IsLeaf(nid) ? tree.LeafValue(nid) : tree.Threshold(nid));
+    if (compact) {
+      nodes << fmt::format("{{ 0x{sindex:X}, {info}, {cright} }}",
+        "sindex"_a = val.sindex,
+        "info"_a = info,
+        "cright"_a = (val.cleft == -1 ? 0 : val.cright));
+    } else {
+      nodes << fmt::format("{{ 0x{sindex:X}, {info}, {cleft}, {cright} }}",
+        "sindex"_a = val.sindex,
+        "info"_a = info,
+        "cleft"_a = val.cleft,
+        "cright"_a = val.cright);
     }
-    node_count += tree.num_nodes;
-    nodes_row_ptr << std::to_string(node_count);
-  }
-  return std::make_pair(fmt::format("const struct Node nodes[] = {{\n{}\n}};", nodes.str()),
+  });
+  return std::make_pair(fmt::format("{}const struct Node nodes[] = {{\n{}\n}};",
+                                    (compact ? "NODE_ARRAY_ALIGN " : ""), nodes.str()),
                         fmt::format("const int nodes_row_ptr[] = {{\n{}\n}};",
                                     nodes_row_ptr.str()));
 }
 
 // Variant of FormatNodesArray(), where nodes[] array is dumped as an ELF binary
-inline std::pair<std::vector<char>, std::string> FormatNodesArrayELF(const treelite::Model& model) {
+inline std::pair<std::vector<char>, std::string> FormatNodesArrayELF(const treelite::Model& model,
+                                                                     bool compact) {
   std::vector<char> nodes_elf;
   treelite::compiler::AllocateELFHeader(&nodes_elf);
 
   treelite::compiler::common_util::ArrayFormatter nodes_row_ptr(100, 2);
-  NodeStructValue val;
-  int node_count = 0;
-  nodes_row_ptr << "0";
-  for (const auto& tree : model.trees) {
-    for (int nid = 0; nid < tree.num_nodes; ++nid) {
-      if (tree.IsLeaf(nid)) {
-        CHECK(!tree.HasLeafVector(nid))
-          << "multi-class random forest classifier is not supported in FailSafeCompiler";
-        val = {0, static_cast<float>(tree.LeafValue(nid)), -1, -1};
-      } else {
-        CHECK(tree.SplitType(nid) == treelite::SplitFeatureType::kNumerical
-              && tree.LeftCategories(nid).empty())
-          << "categorical splits are not supported in FailSafeCompiler";
-        val = {(tree.SplitIndex(nid) | (static_cast<uint32_t>(tree.DefaultLeft(nid)) << 31)),
-               static_cast<float>(tree.Threshold(nid)), tree.LeftChild(nid), tree.RightChild(nid)};
-      }
-      const size_t beg = nodes_elf.size();
+  ForEachNode(model, compact, &nodes_row_ptr,
+              [&nodes_elf, compact](const treelite::Tree&, int, const NodeStructValue& val) {
+    const size_t beg = nodes_elf.size();
+    if (compact) {
+      const CompactNodeStructValue compact_val
+        = {val.sindex, val.info, (val.cleft == -1 ? 0U : static_cast<unsigned int>(val.cright))};
+      nodes_elf.resize(beg + sizeof(CompactNodeStructValue));
+      std::memcpy(&nodes_elf[beg], &compact_val, sizeof(CompactNodeStructValue));
+    } else {
       nodes_elf.resize(beg + sizeof(NodeStructValue));
       std::memcpy(&nodes_elf[beg], &val, sizeof(NodeStructValue));
     }
-    node_count += tree.num_nodes;
-    nodes_row_ptr << std::to_string(node_count);
-  }
+  });
   treelite::compiler::FormatArrayAsELF(&nodes_elf);
 
   return std::make_pair(nodes_elf, fmt::format("const int nodes_row_ptr[] = {{\n{}\n}};",
@@ -280,17 +400,17 @@ class FailSafeCompiler : public Compiler {
         : "float predict(union Entry* data, int pred_margin)";
 
     std::ostringstream main_program;
-    std::string accumulator_definition
-      = (num_output_group_ > 1
-         ? fmt::format("float sum[{num_output_group}] = {{0.0f}}",
-             "num_output_group"_a = num_output_group_)
-         : std::string("float sum = 0.0f"));
+    const std::string predict_function_body
+      = fmt::format((num_output_group_ > 1) ? predict_body_multiclass_template
+                                            : predict_body_template,
+                    "num_feature"_a = num_feature_);
 
     std::string output_statement
       = (num_output_group_ > 1
-         ? fmt::format("sum[tree_id % {num_output_group}] += tree[nid].info.leaf_value;",
+         ? fmt::format("out[r * {num_output_group} + tree_id % {num_output_group}] "
+                       "+= tree[nid].info.leaf_value;",
              "num_output_group"_a = num_output_group_)
-         : std::string("sum += tree[nid].info.leaf_value;"));
+         : std::string("out[r] += tree[nid].info.leaf_value;"));
 
     std::string return_statement
       = (num_output_group_ > 1
@@ -302,15 +422,16 @@ class FailSafeCompiler : public Compiler {
              "global_bias"_a
                 = compiler::common_util::ToStringHighPrecision(model.param.global_bias)));
 
+    const bool compact = (param.compact_nodes > 0);
     std::string nodes, nodes_row_ptr;
     std::vector<char> nodes_elf;
     if (param.dump_array_as_elf > 0) {
       if (param.verbose > 0) {
         LOG(INFO) << "Dumping arrays as an ELF relocatable object...";
       }
-      std::tie(nodes_elf, nodes_row_ptr) = FormatNodesArrayELF(model);
+      std::tie(nodes_elf, nodes_row_ptr) = FormatNodesArrayELF(model, compact);
     } else {
-      std::tie(nodes, nodes_row_ptr) = FormatNodesArray(model);
+      std::tie(nodes, nodes_row_ptr) = FormatNodesArray(model, compact);
     }
 
     main_program << fmt::format(main_template,
@@ -321,7 +442,10 @@ class FailSafeCompiler : public Compiler {
       "num_feature"_a = num_feature_,
       "num_tree"_a = model.trees.size(),
       "compare_op"_a = GetCommonOp(model),
-      "accumulator_definition"_a = accumulator_definition,
+      "is_test_node"_a = (compact ? "tree[nid].cright != 0" : "tree[nid].cleft != -1"),
+      "left_child"_a = (compact ? "nid + 1" : "tree[nid].cleft"),
+      "right_child"_a = (compact ? "(int)tree[nid].cright" : "tree[nid].cright"),
+      "predict_function_body"_a = predict_function_body,
       "output_statement"_a = output_statement,
       "return_statement"_a = return_statement);
 
@@ -336,6 +460,7 @@ class FailSafeCompiler : public Compiler {
 
     files_["header.h"] = CompiledModel::FileEntry(fmt::format(header_template,
       "dllexport"_a = DLLEXPORT_KEYWORD,
+      "node_struct"_a = (compact ? compact_node_struct_template : node_struct_template),
       "predict_function_signature"_a = predict_function_signature));
 
     {
@@ -16,16 +16,16 @@ const char* eval_loop_template =
 R"TREELITETEMPLATE(
 nid = 0;
 while (nid >= 0) {{  /* negative nid implies leaf */
-  fid = {node_array_name}[nid].split_index;
-  if (data[fid].missing == -1) {{
-    cond = {node_array_name}[nid].default_left;
+  fid = {split_index};
+  if ({missing_test}) {{
+    cond = {default_left};
   }} else if (is_categorical[fid]) {{
-    tmp = (unsigned int)data[fid].fvalue;
+    tmp = (unsigned int){fvalue};
     cond = ({cat_bitmap_name}[{cat_begin_name}[nid] + tmp / 64] >> (tmp % 64)) & 1;
   }} else {{
-    cond = (data[fid].{data_field} {comp_op} {node_array_name}[nid].threshold);
+    cond = ({data_value} {comp_op} {node_array_name}[nid].threshold);
   }}
-  nid = cond ? {node_array_name}[nid].left_child : {node_array_name}[nid].right_child;
+  nid = {select_child};
 }}
 
 {output_switch_statement}
@@ -35,13 +35,13 @@ const char* eval_loop_template_without_categorical_feature =
 R"TREELITETEMPLATE(
 nid = 0;
 while (nid >= 0) {{  /* negative nid implies leaf */
-  fid = {node_array_name}[nid].split_index;
-  if (data[fid].missing == -1) {{
-    cond = {node_array_name}[nid].default_left;
+  fid = {split_index};
+  if ({missing_test}) {{
+    cond = {default_left};
   }} else {{
-    cond = (data[fid].{data_field} {comp_op} {node_array_name}[nid].threshold);
+    cond = ({data_value} {comp_op} {node_array_name}[nid].threshold);
   }}
-  nid = cond ? {node_array_name}[nid].left_child : {node_array_name}[nid].right_child;
+  nid = {select_child};
 }}
 
 {output_switch_statement}
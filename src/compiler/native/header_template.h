@@ -22,9 +22,11 @@ R"TREELITETEMPLATE(
 #if defined(__clang__) || defined(__GNUC__)
 #define LIKELY(x)   __builtin_expect(!!(x), 1)
 #define UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define COLD        __attribute__((cold, noinline))
 #else
 #define LIKELY(x)   (x)
 #define UNLIKELY(x) (x)
+#define COLD
 #endif
 
 union Entry {{
@@ -33,13 +35,7 @@ union Entry {{
   int qvalue;
 }};
 
-struct Node {{
-  uint8_t default_left;
-  unsigned int split_index;
-  {threshold_type} threshold;
-  int left_child;
-  int right_child;
-}};
+{bin_type}{node_struct}
 
 extern const unsigned char is_categorical[];
 
@@ -49,6 +45,53 @@ extern const unsigned char is_categorical[];
 {dllexport}{get_sigmoid_alpha_function_signature};
 {dllexport}{get_global_bias_function_signature};
 {dllexport}{predict_function_signature};
+{dllexport}{predict_batch_function_signature};
+{dllexport}{preprocess_batch_function_signature};
+{dllexport}{postprocess_batch_function_signature};
+)TREELITETEMPLATE";
+
+// Bins (quantized feature values) are unsigned integers of the narrowest
+// width that fits every feature; see get_cut_points()
+const char* bin_type_template =
+R"TREELITETEMPLATE(
+typedef {bin_type} bin_t;
+#define BIN_MISSING ((bin_t)-1)
+)TREELITETEMPLATE";
+
+const char* node_struct_template =
+R"TREELITETEMPLATE(
+struct Node {{
+  uint8_t default_left;
+  unsigned int split_index;
+  {threshold_type} threshold;
+  int left_child;
+  int right_child;
+}};)TREELITETEMPLATE";
+
+// Compact layout: the left child of node i is node (i + 1), or leaf -(i + 1) if bit 30 of
+// [sindex] is set. Bit 31 of [sindex] holds the default direction for missing values. If bit 29
+// is set, the children are swapped: node (i + 1) is the right child and [right_child] stores
+// the left child.
+const char* compact_node_struct_template =
+R"TREELITETEMPLATE(
+struct Node {{
+  uint32_t sindex;
+  {threshold_type} threshold;
+  int right_child;
+}};
+#if defined(_MSC_VER)
+#define NODE_ARRAY_ALIGN __declspec(align(64))
+#else
+#define NODE_ARRAY_ALIGN __attribute__((aligned(64)))
+#endif)TREELITETEMPLATE";
+
+const char* header_dense_input_template =
+R"TREELITETEMPLATE(
+static inline int is_missing(float fvalue, float missing_value) {{
+  return isnan(fvalue) || fvalue == missing_value;
+}}
+
+{dllexport}{predict_batch_dense_function_signature};
 )TREELITETEMPLATE";
 
 }  // namespace native
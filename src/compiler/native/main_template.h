@@ -40,28 +40,75 @@ R"TREELITETEMPLATE(
 
 {pred_transform_function}
 {predict_function_signature} {{
+{predict_function_body}
+}}
 )TREELITETEMPLATE";
 
-const char* main_end_multiclass_template =
+const char* main_batch_start_template =
 R"TREELITETEMPLATE(
-  for (int i = 0; i < {num_output_group}; ++i) {{
-    result[i] = sum[i]{optional_average_field} + (float)({global_bias});
-  }}
-  if (!pred_margin) {{
-    return pred_transform(result);
-  }} else {{
-    return {num_output_group};
+{predict_batch_function_signature} {{
+  memset(out, 0, sizeof(float) * nrow * {num_output_group});
+)TREELITETEMPLATE";
+
+const char* predict_body_multiclass_template =
+R"TREELITETEMPLATE(  return predict_batch(data, 1, {num_feature}, pred_margin, result);)TREELITETEMPLATE";
+  // only for multiclass classification
+
+const char* predict_body_template =
+R"TREELITETEMPLATE(  float result;
+  predict_batch(data, 1, {num_feature}, pred_margin, &result);
+  return result;)TREELITETEMPLATE";
+
+const char* main_batch_end_template =
+R"TREELITETEMPLATE(
+  return postprocess_batch(nrow, pred_margin, out);
+}}
+)TREELITETEMPLATE";
+
+const char* preprocess_batch_template =
+R"TREELITETEMPLATE(
+{preprocess_batch_function_signature} {{{preprocess_code}}}
+)TREELITETEMPLATE";
+
+const char* postprocess_batch_multiclass_template =
+R"TREELITETEMPLATE(
+{postprocess_batch_function_signature} {{
+  size_t result_size = {num_output_group};
+  for (size_t i = 0; i < nrow; ++i) {{
+    float* result = &out[i * {num_output_group}];
+    for (int k = 0; k < {num_output_group}; ++k) {{
+      result[k] = result[k]{optional_average_field} + (float)({global_bias});
+    }}
+    if (!pred_margin) {{
+      result_size = pred_transform(result);
+    }}
   }}
+  return result_size;
 }}
 )TREELITETEMPLATE";  // only for multiclass classification
 
-const char* main_end_template =
+const char* postprocess_batch_template =
+R"TREELITETEMPLATE(
+{postprocess_batch_function_signature} {{
+  for (size_t i = 0; i < nrow; ++i) {{
+    out[i] = out[i]{optional_average_field} + (float)({global_bias});
+    if (!pred_margin) {{
+      out[i] = pred_transform(out[i]);
+    }}
+  }}
+  return 1;
+}}
+)TREELITETEMPLATE";
+
+const char* unit_dispatch_template =
 R"TREELITETEMPLATE(
-  sum = sum{optional_average_field} + (float)({global_bias});
-  if (!pred_margin) {{
-    return pred_transform(sum);
-  }} else {{
-    return sum;
+{get_num_unit_function_signature} {{
+  return {num_unit};
+}}
+
+{predict_unit_function_signature} {{
+  switch (unit_id) {{
+{unit_cases}
   }}
 }}
 )TREELITETEMPLATE";
@@ -19,49 +19,113 @@ R"TREELITETEMPLATE(
 /*
  * \brief function to convert a feature value into bin index.
  * \param val feature value, in floating-point
- * \param fid feature identifier
- * \return bin index corresponding to given feature value
+ * \param array ascending list of thresholds for the feature
+ * \param len number of thresholds
+ * \return bin index corresponding to given feature value: 2k+1 if val equals
+ *         the k-th threshold, 2k if val lies between the (k-1)-th and k-th
+ *         thresholds (0 if val is less than every threshold), and 2*len if val
+ *         is greater than every threshold (or NaN)
  */
-static inline int quantize(float val, unsigned fid) {{
-  const size_t offset = th_begin[fid];
-  const float* array = &threshold[offset];
-  int len = th_len[fid];
-  int low = 0;
-  int high = len;
-  int mid;
-  float mval;
-  // It is possible th_begin[i] == [total_num_threshold]. This means that
-  // all features i, (i+1), ... are not used for any of the splits in the model.
-  // So in this case, just return something
-  if (offset == {total_num_threshold} || val < array[0]) {{
-    return -10;
+static inline int quantize(float val, const float* array, int len) {{
+  int lb = 0;  // number of thresholds below val
+  if (len <= 8) {{
+    // short lists: count the thresholds below val; the loop has no branches
+    // and is unrolled or vectorized by the C compiler
+    for (int k = 0; k < len; ++k) {{
+      lb += !(val <= array[k]);
+    }}
+  }} else {{
+    // branchless binary search: the comparison selects the next base pointer
+    const float* base = array;
+    int n = len;
+    while (n > 1) {{
+      const int half = n / 2;
+      base = !(val <= base[half - 1]) ? base + half : base;
+      n -= half;
+    }}
+    lb = (int)(base - array) + !(val <= base[0]);
   }}
-  while (low + 1 < high) {{
-    mid = (low + high) / 2;
-    mval = array[mid];
-    if (val == mval) {{
-      return mid * 2;
-    }} else if (val < mval) {{
-      high = mid;
+  return lb * 2 + (lb < len && array[lb] == val);
+}}
+)TREELITETEMPLATE";
+
+// Bins of categorical features hold the category. Categories that are not
+// representable (negative, or too large) are mapped to BIN_MISSING - 1, which
+// is not used by any split.
+const char* quantize_rows_template =
+R"TREELITETEMPLATE(
+static inline bin_t category_bin(float fvalue) {{
+  return (fvalue >= 0.0f && fvalue < (float)(BIN_MISSING - 1)) ? (bin_t)fvalue
+                                                               : (bin_t)(BIN_MISSING - 1);
+}}
+
+/*
+ * \brief convert a block of rows into bins, stored in the packed row buffer
+ *        [bins] with {num_feature} bins per row. The thresholds of each
+ *        feature are loaded once for the whole block.
+ */
+static void quantize_rows(const union Entry* rows, size_t nrow, size_t stride, bin_t* bins) {{
+  for (int i = 0; i < {num_feature}; ++i) {{
+    const float* array = &threshold[th_begin[i]];
+    const int len = th_len[i];
+    if (is_categorical[i]) {{
+      for (size_t r = 0; r < nrow; ++r) {{
+        const union Entry* e = &rows[r * stride + i];
+        bins[r * {num_feature} + i] = (e->missing == -1) ? BIN_MISSING : category_bin(e->fvalue);
+      }}
     }} else {{
-      low = mid;
+      for (size_t r = 0; r < nrow; ++r) {{
+        const union Entry* e = &rows[r * stride + i];
+        bins[r * {num_feature} + i]
+          = (e->missing == -1) ? BIN_MISSING : (bin_t)quantize(e->fvalue, array, len);
+      }}
     }}
   }}
-  if (array[low] == val) {{
-    return low * 2;
-  }} else if (high == len) {{
-    return len * 2;
-  }} else {{
-    return low * 2 + 1;
+}}
+
+{predict_batch_function_signature} {{
+{buffer_decl}
+  size_t result_size = 0;
+  if (!bins) {{
+    return 0;
+  }}
+  for (size_t begin = 0; begin < nrow; begin += {block_rows}) {{
+    const size_t n = (nrow - begin > {block_rows}) ? {block_rows} : nrow - begin;
+    quantize_rows(&rows[begin * stride], n, stride, bins);
+    result_size = predict_batch_quantized(bins, n, {num_feature}, pred_margin,
+                                          &out[begin * {num_output_group}]);
+  }}
+{buffer_free}
+  return result_size;
+}}
+
+{get_bin_size_function_signature} {{
+  return sizeof(bin_t);
+}}
+
+{get_cut_points_function_signature} {{
+  if (fid >= {num_feature} || th_len[fid] == 0) {{
+    *out = NULL;
+    return 0;
   }}
+  *out = &threshold[th_begin[fid]];
+  return (size_t)th_len[fid];
 }}
 )TREELITETEMPLATE";
 
-const char* quantize_loop_template =
+// Used by preprocess_batch(): the rows are converted in place, one row after
+// another, so that the bins never overwrite an entry that is yet to be read.
+// Afterwards, the bins of row r start at ((bin_t*)rows)[r * stride].
+const char* quantize_in_place_template =
 R"TREELITETEMPLATE(
-for (int i = 0; i < {num_feature}; ++i) {{
-  if (data[i].missing != -1 && !is_categorical[i]) {{
-    data[i].qvalue = quantize(data[i].fvalue, i);
+bin_t* bins = (bin_t*)rows;
+for (size_t r = 0; r < nrow; ++r) {{
+  for (int i = 0; i < {num_feature}; ++i) {{
+    const union Entry e = rows[r * stride + i];
+    bins[r * stride + i]
+      = (e.missing == -1) ? BIN_MISSING
+      : is_categorical[i] ? category_bin(e.fvalue)
+      : (bin_t)quantize(e.fvalue, &threshold[th_begin[i]], th_len[i]);
   }}
 }}
 )TREELITETEMPLATE";
@@ -0,0 +1,630 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file quickscorer.cc
+ * \author Hyunsu Cho
+ * \brief C code generator (QuickScorer). The generated code evaluates the trees feature by
+ *        feature, keeping one bitvector of candidate exit leaves per tree, instead of walking
+ *        each tree node by node. See Lucchese et al., "QuickScorer: a Fast Algorithm to Rank
+ *        Documents with Additive Ensembles of Regression Trees" (SIGIR 2015).
+ */
+
+#include <treelite/tree.h>
+#include <treelite/compiler.h>
+#include <treelite/compiler_param.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <unordered_map>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include "./pred_transform.h"
+#include "./common/format_util.h"
+
+#if defined(_MSC_VER) || defined(_WIN32)
+#define DLLEXPORT_KEYWORD "__declspec(dllexport) "
+#else
+#define DLLEXPORT_KEYWORD ""
+#endif
+
+using namespace fmt::literals;
+
+namespace {
+
+/*! \brief largest number of leaves per tree, so that a tree fits in one 64-bit bitvector */
+constexpr int kMaxLeaf = 64;
+
+const char* header_template = R"TREELITETEMPLATE(
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+union Entry {{
+  int missing;
+  float fvalue;
+}};
+
+extern const uint32_t qs_used_feature[];
+extern const uint32_t qs_feature_ptr[];
+extern const float qs_threshold[];
+extern const uint32_t qs_tree[];
+extern const uint64_t qs_mask[];
+extern const uint32_t qs_missing_ptr[];
+extern const uint32_t qs_missing_tree[];
+extern const uint64_t qs_missing_mask[];
+extern const uint32_t qs_nan_ptr[];
+extern const uint32_t qs_nan_tree[];
+extern const uint64_t qs_nan_mask[];
+extern const uint32_t qs_leaf_ptr[];
+extern const float qs_leaf_value[];
+
+{dllexport}size_t get_num_output_group(void);
+{dllexport}size_t get_num_feature(void);
+{dllexport}const char* get_pred_transform(void);
+{dllexport}float get_sigmoid_alpha(void);
+{dllexport}float get_global_bias(void);
+{dllexport}{predict_function_signature};
+{dllexport}size_t predict_batch(union Entry* rows, size_t nrow, size_t stride, int pred_margin,
+                                float* out);
+{dllexport}size_t predict_batch_dense(const float* rows, size_t nrow, size_t stride,
+                                      float missing_value, int pred_margin, float* out);
+)TREELITETEMPLATE";
+
+const char* main_template = R"TREELITETEMPLATE(
+#include "header.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static __inline int qs_ctz(uint64_t x) {{
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return (int)index;
+}}
+#else
+#define qs_ctz(x) __builtin_ctzll(x)
+#endif
+
+size_t get_num_output_group(void) {{
+  return {num_output_group};
+}}
+
+size_t get_num_feature(void) {{
+  return {num_feature};
+}}
+
+const char* get_pred_transform(void) {{
+  return "{pred_transform}";
+}}
+
+float get_sigmoid_alpha(void) {{
+  return {sigmoid_alpha};
+}}
+
+float get_global_bias(void) {{
+  return {global_bias};
+}}
+
+{pred_transform_function}
+
+{predict_function_signature} {{
+{predict_function_body}
+}}
+
+/*
+ * The leaves of each tree are numbered from left to right, and bit i of the
+ * bitvector of a tree stands for leaf i. A test node is "false" for a row if
+ * the row goes to its right child. Each false node clears the leaves of its
+ * left subtree; the exit leaf of the tree is then the leftmost leaf still set.
+ * For each feature, the thresholds of the tests are sorted in ascending order,
+ * so that the false nodes of a row form a prefix of the list.
+ */
+static inline void qs_apply_present(uint64_t* leafidx, uint32_t fid, float fvalue) {{
+  const uint32_t end = qs_feature_ptr[fid + 1];
+  for (uint32_t i = qs_feature_ptr[fid]; i < end && fvalue >= qs_threshold[i]; ++i) {{
+    leafidx[qs_tree[i]] &= qs_mask[i];
+  }}
+}}
+
+/* A missing value is sent to the right child by the test nodes listed here */
+static inline void qs_apply_missing(uint64_t* leafidx, uint32_t fid) {{
+  const uint32_t end = qs_missing_ptr[fid + 1];
+  for (uint32_t i = qs_missing_ptr[fid]; i < end; ++i) {{
+    leafidx[qs_missing_tree[i]] &= qs_missing_mask[i];
+  }}
+}}
+
+/*
+ * A NaN that is present (not marked missing) fails every comparison, so it is
+ * sent to the right child of the original test by the test nodes listed here
+ */
+static inline void qs_apply_nan(uint64_t* leafidx, uint32_t fid) {{
+  const uint32_t end = qs_nan_ptr[fid + 1];
+  for (uint32_t i = qs_nan_ptr[fid]; i < end; ++i) {{
+    leafidx[qs_nan_tree[i]] &= qs_nan_mask[i];
+  }}
+}}
+
+static inline void qs_accumulate(const uint64_t* leafidx, float* out) {{
+  for (int tree_id = 0; tree_id < {num_tree}; ++tree_id) {{
+    out[{output_group_expr}] += qs_leaf_value[qs_leaf_ptr[tree_id] + qs_ctz(leafidx[tree_id])];
+  }}
+}}
+
+size_t predict_batch(union Entry* rows, size_t nrow, size_t stride, int pred_margin,
+                     float* out) {{
+  uint64_t leafidx[{num_tree}];
+  memset(out, 0, sizeof(float) * nrow * {num_output_group});
+
+  for (size_t r = 0; r < nrow; ++r) {{
+    const union Entry* data = &rows[r * stride];
+    memset(leafidx, 0xFF, sizeof(leafidx));
+    for (int i = 0; i < {num_used_feature}; ++i) {{
+      const uint32_t fid = qs_used_feature[i];
+      if (data[fid].missing == -1) {{
+        qs_apply_missing(leafidx, fid);
+      }} else if (isnan(data[fid].fvalue)) {{
+        qs_apply_nan(leafidx, fid);
+      }} else {{
+        qs_apply_present(leafidx, fid, data[fid].fvalue);
+      }}
+    }}
+    qs_accumulate(leafidx, &out[r * {num_output_group}]);
+  }}
+  {return_statement}
+}}
+
+size_t predict_batch_dense(const float* rows, size_t nrow, size_t stride,
+                           float missing_value, int pred_margin, float* out) {{
+  uint64_t leafidx[{num_tree}];
+  memset(out, 0, sizeof(float) * nrow * {num_output_group});
+
+  for (size_t r = 0; r < nrow; ++r) {{
+    const float* data = &rows[r * stride];
+    memset(leafidx, 0xFF, sizeof(leafidx));
+    for (int i = 0; i < {num_used_feature}; ++i) {{
+      const uint32_t fid = qs_used_feature[i];
+      const float fvalue = data[fid];
+      if (isnan(fvalue) || fvalue == missing_value) {{
+        qs_apply_missing(leafidx, fid);
+      }} else {{
+        qs_apply_present(leafidx, fid, fvalue);
+      }}
+    }}
+    qs_accumulate(leafidx, &out[r * {num_output_group}]);
+  }}
+  {return_statement}
+}}
+)TREELITETEMPLATE";
+
+const char* predict_body_multiclass_template =
+R"TREELITETEMPLATE(  return predict_batch(data, 1, {num_feature}, pred_margin, result);)TREELITETEMPLATE";
+  // only for multiclass classification
+
+const char* predict_body_template =
+R"TREELITETEMPLATE(  float result;
+  predict_batch(data, 1, {num_feature}, pred_margin, &result);
+  return result;)TREELITETEMPLATE";
+
+const char* return_multiclass_template =
+R"TREELITETEMPLATE(
+  size_t result_size = {num_output_group};
+  for (size_t i = 0; i < nrow; ++i) {{
+    float* result = &out[i * {num_output_group}];
+    for (int k = 0; k < {num_output_group}; ++k) {{
+      result[k] = result[k]{optional_average_field} + (float)({global_bias});
+    }}
+    if (!pred_margin) {{
+      result_size = pred_transform(result);
+    }}
+  }}
+  return result_size;
+)TREELITETEMPLATE";  // only for multiclass classification
+
+const char* return_template =
+R"TREELITETEMPLATE(
+  for (size_t i = 0; i < nrow; ++i) {{
+    out[i] = out[i]{optional_average_field} + (float)({global_bias});
+    if (!pred_margin) {{
+      out[i] = pred_transform(out[i]);
+    }}
+  }}
+  return 1;
+)TREELITETEMPLATE";
+
+const char* arrays_template = R"TREELITETEMPLATE(
+#include "header.h"
+
+/* features used in at least one test */
+const uint32_t qs_used_feature[] = {{
+{used_feature}
+}};
+
+/* tests on feature f are found in [qs_feature_ptr[f], qs_feature_ptr[f+1]) */
+const uint32_t qs_feature_ptr[] = {{
+{feature_ptr}
+}};
+
+const float qs_threshold[] = {{
+{threshold}
+}};
+
+const uint32_t qs_tree[] = {{
+{tree}
+}};
+
+const uint64_t qs_mask[] = {{
+{mask}
+}};
+
+const uint32_t qs_missing_ptr[] = {{
+{missing_ptr}
+}};
+
+const uint32_t qs_missing_tree[] = {{
+{missing_tree}
+}};
+
+const uint64_t qs_missing_mask[] = {{
+{missing_mask}
+}};
+
+const uint32_t qs_nan_ptr[] = {{
+{nan_ptr}
+}};
+
+const uint32_t qs_nan_tree[] = {{
+{nan_tree}
+}};
+
+const uint64_t qs_nan_mask[] = {{
+{nan_mask}
+}};
+
+/* leaves of tree i are found in [qs_leaf_ptr[i], qs_leaf_ptr[i+1]) */
+const uint32_t qs_leaf_ptr[] = {{
+{leaf_ptr}
+}};
+
+const float qs_leaf_value[] = {{
+{leaf_value}
+}};
+)TREELITETEMPLATE";
+
+/*!
+ * \brief test node, rewritten so that a present feature value x goes to the
+ *        left child iff x < threshold
+ */
+struct QSTest {
+  float threshold;  // -inf if every present value goes to the right
+  uint32_t tree_id;
+  uint64_t mask;    // clears the leaves of the left subtree
+};
+
+/*! \brief test node that sends missing values (or NaN) to the right child */
+struct QSMissingTest {
+  uint32_t tree_id;
+  uint64_t mask;
+};
+
+struct QSModel {
+  std::vector<std::vector<QSTest>> tests;  // by feature
+  std::vector<std::vector<QSMissingTest>> missing_tests;  // by feature
+  std::vector<std::vector<QSMissingTest>> nan_tests;  // by feature
+  std::vector<std::vector<float>> leaf_values;  // by tree, from left to right
+};
+
+class QSTreeFlattener {
+ public:
+  QSTreeFlattener(const treelite::Tree& tree, uint32_t tree_id, QSModel* out)
+    : tree_(tree), tree_id_(tree_id), out_(out) {}
+
+  /*! \brief number the leaves of the subtree rooted at nid and collect its tests */
+  void Visit(int nid) {
+    if (tree_.IsLeaf(nid)) {
+      CHECK(!tree_.HasLeafVector(nid))
+        << "multi-class random forest classifier is not supported in QuickScorerCompiler";
+      CHECK_LT(out_->leaf_values[tree_id_].size(), static_cast<size_t>(kMaxLeaf))
+        << "QuickScorerCompiler supports trees with at most " << kMaxLeaf << " leaves; "
+        << "tree " << tree_id_ << " has more. Use the ast_native compiler instead.";
+      out_->leaf_values[tree_id_].push_back(static_cast<float>(tree_.LeafValue(nid)));
+      return;
+    }
+    CHECK(tree_.SplitType(nid) == treelite::SplitFeatureType::kNumerical
+          && tree_.LeftCategories(nid).empty())
+      << "categorical splits are not supported in QuickScorerCompiler";
+    const treelite::Operator op = tree_.ComparisonOp(nid);
+    const float threshold = static_cast<float>(tree_.Threshold(nid));
+    const unsigned split_index = tree_.SplitIndex(nid);
+    // Rewrite x > t and x >= t as x <= t and x < t, by swapping the children
+    bool swap = false;
+    switch (op) {
+     case treelite::Operator::kLT: case treelite::Operator::kLE:
+      break;
+     case treelite::Operator::kGT: case treelite::Operator::kGE:
+      swap = true;
+      break;
+     default:
+      LOG(FATAL) << "QuickScorerCompiler does not support operator "
+                 << treelite::OpName(op);
+    }
+    const int left = swap ? tree_.RightChild(nid) : tree_.LeftChild(nid);
+    const int right = swap ? tree_.LeftChild(nid) : tree_.RightChild(nid);
+    const bool default_left = (tree_.DefaultLeft(nid) != swap);
+
+    const size_t leaf_begin = out_->leaf_values[tree_id_].size();
+    Visit(left);
+    const size_t leaf_end = out_->leaf_values[tree_id_].size();
+    Visit(right);
+
+    uint64_t left_leaves = 0;
+    for (size_t i = leaf_begin; i < leaf_end; ++i) {
+      left_leaves |= (static_cast<uint64_t>(1) << i);
+    }
+    const uint64_t mask = ~left_leaves;
+    if (!default_left) {
+      out_->missing_tests[split_index].push_back({tree_id_, mask});
+    }
+    float qs_threshold;
+    if (std::isinf(threshold)) {
+      // The generated code of other compilers resolves the test in advance, as
+      // the outcome is identical for all finite feature values
+      const bool goes_original_left = treelite::CompareWithOp(0.0f, op, threshold);
+      if (goes_original_left != swap) {
+        return;  // every present value goes to the (new) left child
+      }
+      qs_threshold = -std::numeric_limits<float>::infinity();
+      out_->nan_tests[split_index].push_back({tree_id_, mask});  // so does NaN
+    } else {
+      if (op == treelite::Operator::kLE || op == treelite::Operator::kGT) {
+        // x > t iff x >= (the next float after t)
+        qs_threshold = std::nextafter(threshold, std::numeric_limits<float>::infinity());
+      } else {
+        qs_threshold = threshold;
+      }
+      // As in the code generated by other compilers, a present NaN fails the
+      // original test and goes to the original right child
+      if (!swap) {
+        out_->nan_tests[split_index].push_back({tree_id_, mask});
+      }
+    }
+    out_->tests[split_index].push_back({qs_threshold, tree_id_, mask});
+  }
+
+ private:
+  const treelite::Tree& tree_;
+  uint32_t tree_id_;
+  QSModel* out_;
+};
+
+inline QSModel FlattenModel(const treelite::Model& model) {
+  QSModel out;
+  out.tests.resize(model.num_feature);
+  out.missing_tests.resize(model.num_feature);
+  out.nan_tests.resize(model.num_feature);
+  out.leaf_values.resize(model.trees.size());
+  for (size_t tree_id = 0; tree_id < model.trees.size(); ++tree_id) {
+    QSTreeFlattener(model.trees[tree_id], static_cast<uint32_t>(tree_id), &out).Visit(0);
+  }
+  for (auto& tests : out.tests) {
+    std::stable_sort(tests.begin(), tests.end(), [](const QSTest& a, const QSTest& b) {
+      return a.threshold < b.threshold;
+    });
+  }
+  return out;
+}
+
+inline std::string FormatThreshold(float threshold) {
+  if (std::isinf(threshold)) {
+    return (threshold < 0) ? "-INFINITY" : "INFINITY";
+  }
+  return treelite::compiler::common_util::ToStringHighPrecision(threshold);
+}
+
+inline std::string FormatMask(uint64_t mask) {
+  return fmt::format("0x{:016X}ULL", mask);
+}
+
+/*! \brief C does not allow empty arrays; emit a single unused element instead */
+inline std::string NonEmpty(std::string array) {
+  return array.empty() ? std::string("  0") : array;
+}
+
+// Test whether a string ends with a given suffix
+inline bool EndsWith(const std::string& str, const std::string& suffix) {
+  return (str.size() >= suffix.size()
+          && str.compare(str.length() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+}   // anonymous namespace
+
+namespace treelite {
+namespace compiler {
+
+DMLC_REGISTRY_FILE_TAG(quickscorer);
+
+class QuickScorerCompiler : public Compiler {
+ public:
+  explicit QuickScorerCompiler(const CompilerParam& param)
+    : param(param) {
+    if (param.verbose > 0) {
+      LOG(INFO) << "Using QuickScorerCompiler";
+    }
+    if (param.annotate_in != "NULL") {
+      LOG(INFO) << "Warning: 'annotate_in' parameter is not applicable for "
+                   "QuickScorerCompiler";
+    }
+    if (param.quantize > 0) {
+      LOG(INFO) << "Warning: 'quantize' parameter is not applicable for "
+                   "QuickScorerCompiler";
+    }
+    if (param.parallel_comp > 0) {
+      LOG(INFO) << "Warning: 'parallel_comp' parameter is not applicable for "
+                   "QuickScorerCompiler";
+    }
+    if (std::isfinite(param.code_folding_req)) {
+      LOG(INFO) << "Warning: 'code_folding_req' parameter is not applicable "
+                   "for QuickScorerCompiler";
+    }
+    if (param.dump_array_as_elf > 0) {
+      LOG(INFO) << "Warning: 'dump_array_as_elf' parameter is not applicable "
+                   "for QuickScorerCompiler";
+    }
+  }
+
+  CompiledModel Compile(const Model& model) override {
+    CompiledModel cm;
+    cm.backend = "native";
+
+    num_feature_ = model.num_feature;
+    num_output_group_ = model.num_output_group;
+    CHECK(!model.trees.empty()) << "Model must contain at least one tree";
+    pred_tranform_func_ = PredTransformFunction("native", model);
+    files_.clear();
+
+    const QSModel qs_model = FlattenModel(model);
+    common_util::ArrayFormatter used_feature(100, 2), feature_ptr(100, 2), threshold(100, 2),
+                                tree(100, 2), mask(100, 2), missing_ptr(100, 2),
+                                missing_tree(100, 2), missing_mask(100, 2), nan_ptr(100, 2),
+                                nan_tree(100, 2), nan_mask(100, 2), leaf_ptr(100, 2),
+                                leaf_value(100, 2);
+    int num_used_feature = 0;
+    size_t num_test = 0, num_missing_test = 0, num_nan_test = 0, num_leaf = 0;
+    feature_ptr << num_test;
+    missing_ptr << num_missing_test;
+    nan_ptr << num_nan_test;
+    for (int fid = 0; fid < num_feature_; ++fid) {
+      if (!qs_model.tests[fid].empty() || !qs_model.missing_tests[fid].empty()) {
+        used_feature << fid;
+        ++num_used_feature;
+      }
+      for (const QSTest& test : qs_model.tests[fid]) {
+        threshold << FormatThreshold(test.threshold);
+        tree << test.tree_id;
+        mask << FormatMask(test.mask);
+      }
+      for (const QSMissingTest& test : qs_model.missing_tests[fid]) {
+        missing_tree << test.tree_id;
+        missing_mask << FormatMask(test.mask);
+      }
+      for (const QSMissingTest& test : qs_model.nan_tests[fid]) {
+        nan_tree << test.tree_id;
+        nan_mask << FormatMask(test.mask);
+      }
+      num_test += qs_model.tests[fid].size();
+      num_missing_test += qs_model.missing_tests[fid].size();
+      num_nan_test += qs_model.nan_tests[fid].size();
+      feature_ptr << num_test;
+      missing_ptr << num_missing_test;
+      nan_ptr << num_nan_test;
+    }
+    leaf_ptr << num_leaf;
+    for (const auto& leaves : qs_model.leaf_values) {
+      for (float v : leaves) {
+        leaf_value << common_util::ToStringHighPrecision(v);
+      }
+      num_leaf += leaves.size();
+      leaf_ptr << num_leaf;
+    }
+    CHECK_LE(std::max(num_test, num_leaf),
+             static_cast<size_t>(std::numeric_limits<uint32_t>::max()))
+      << "Model is too large for QuickScorerCompiler";
+
+    const char* predict_function_signature
+      = (num_output_group_ > 1) ?
+          "size_t predict_multiclass(union Entry* data, int pred_margin, "
+                                    "float* result)"
+        : "float predict(union Entry* data, int pred_margin)";
+
+    const std::string predict_function_body
+      = fmt::format((num_output_group_ > 1) ? predict_body_multiclass_template
+                                            : predict_body_template,
+                    "num_feature"_a = num_feature_);
+
+    const std::string optional_average_field
+      = model.random_forest_flag ? fmt::format(" / {}", model.trees.size())
+                                 : std::string("");
+    const std::string global_bias
+      = common_util::ToStringHighPrecision(model.param.global_bias);
+    const std::string return_statement
+      = fmt::format((num_output_group_ > 1) ? return_multiclass_template : return_template,
+                    "num_output_group"_a = num_output_group_,
+                    "optional_average_field"_a = optional_average_field,
+                    "global_bias"_a = global_bias);
+
+    files_["main.c"] = CompiledModel::FileEntry(fmt::format(main_template,
+      "num_output_group"_a = num_output_group_,
+      "num_feature"_a = num_feature_,
+      "pred_transform"_a = model.param.pred_transform,
+      "sigmoid_alpha"_a = common_util::ToStringHighPrecision(model.param.sigmoid_alpha),
+      "global_bias"_a = global_bias,
+      "pred_transform_function"_a = pred_tranform_func_,
+      "predict_function_signature"_a = predict_function_signature,
+      "predict_function_body"_a = predict_function_body,
+      "num_tree"_a = model.trees.size(),
+      "num_used_feature"_a = num_used_feature,
+      "output_group_expr"_a = (num_output_group_ > 1
+                               ? fmt::format("tree_id % {}", num_output_group_)
+                               : std::string("0")),
+      "return_statement"_a = return_statement));
+
+    files_["arrays.c"] = CompiledModel::FileEntry(fmt::format(arrays_template,
+      "used_feature"_a = NonEmpty(used_feature.str()),
+      "feature_ptr"_a = feature_ptr.str(),
+      "threshold"_a = NonEmpty(threshold.str()),
+      "tree"_a = NonEmpty(tree.str()),
+      "mask"_a = NonEmpty(mask.str()),
+      "missing_ptr"_a = missing_ptr.str(),
+      "missing_tree"_a = NonEmpty(missing_tree.str()),
+      "missing_mask"_a = NonEmpty(missing_mask.str()),
+      "nan_ptr"_a = nan_ptr.str(),
+      "nan_tree"_a = NonEmpty(nan_tree.str()),
+      "nan_mask"_a = NonEmpty(nan_mask.str()),
+      "leaf_ptr"_a = leaf_ptr.str(),
+      "leaf_value"_a = leaf_value.str()));
+
+    files_["header.h"] = CompiledModel::FileEntry(fmt::format(header_template,
+      "dllexport"_a = DLLEXPORT_KEYWORD,
+      "predict_function_signature"_a = predict_function_signature));
+
+    {
+      /* write recipe.json */
+      std::vector<std::unordered_map<std::string, std::string>> source_list;
+      for (const auto& kv : files_) {
+        if (EndsWith(kv.first, ".c")) {
+          const size_t line_count
+            = std::count(kv.second.content.begin(), kv.second.content.end(), '\n');
+          source_list.push_back({ {"name",
+                                   kv.first.substr(0, kv.first.length() - 2)},
+                                  {"length", std::to_string(line_count)} });
+        }
+      }
+      std::ostringstream oss;
+      std::unique_ptr<dmlc::JSONWriter> writer(new dmlc::JSONWriter(&oss));
+      writer->BeginObject();
+      writer->WriteObjectKeyValue("target", param.native_lib_name);
+      writer->WriteObjectKeyValue("sources", source_list);
+      writer->EndObject();
+      files_["recipe.json"] = CompiledModel::FileEntry(oss.str());
+    }
+    cm.files = std::move(files_);
+    return cm;
+  }
+
+ private:
+  CompilerParam param;
+  int num_feature_;
+  int num_output_group_;
+  std::string pred_tranform_func_;
+  std::unordered_map<std::string, CompiledModel::FileEntry> files_;
+};
+
+TREELITE_REGISTER_COMPILER(QuickScorerCompiler, "quickscorer")
+.describe("Compiler that evaluates trees feature by feature with leaf bitvectors "
+          "(trees with at most 64 leaves)")
+.set_body([](const CompilerParam& param) -> Compiler* {
+    return new QuickScorerCompiler(param);
+  });
+}  // namespace compiler
+}  // namespace treelite
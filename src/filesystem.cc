@@ -7,6 +7,8 @@
 
 #include <treelite/filesystem.h>
 #include <dmlc/logging.h>
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 
 #ifdef _WIN32
@@ -95,5 +97,48 @@ void WriteToFile(const std::string& filename, const std::vector<char>& content)
   of.write(content.data(), content.size());
 }
 
+bool FileHasContent(const std::string& filename, const char* content, size_t size) {
+  std::ifstream fi(filename, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!fi || static_cast<size_t>(fi.tellg()) != size) {
+    return false;
+  }
+  fi.seekg(0);
+  std::vector<char> buf(size);
+  fi.read(buf.data(), size);
+  return fi && std::equal(buf.begin(), buf.end(), content);
+}
+
+bool FilesHaveSameContent(const std::string& filename1, const std::string& filename2) {
+  std::ifstream f1(filename1, std::ios::in | std::ios::binary);
+  std::ifstream f2(filename2, std::ios::in | std::ios::binary);
+  if (!f1 || !f2) {
+    return false;
+  }
+  std::vector<char> buf1(1 << 16), buf2(1 << 16);
+  while (true) {
+    f1.read(buf1.data(), buf1.size());
+    f2.read(buf2.data(), buf2.size());
+    if (f1.gcount() != f2.gcount()
+        || !std::equal(buf1.begin(), buf1.begin() + f1.gcount(), buf2.begin())) {
+      return false;
+    }
+    if (!f1 || !f2) {
+      return !f1 && !f2;
+    }
+  }
+}
+
+void ReplaceFile(const std::string& src, const std::string& dst) {
+#ifdef _WIN32
+  if (!MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+    HandleSystemError(std::string("Failed to rename ") + src + " to " + dst);
+  }
+#else
+  if (std::rename(src.c_str(), dst.c_str()) != 0) {
+    HandleSystemError(std::string("Failed to rename ") + src + " to " + dst);
+  }
+#endif
+}
+
 }  // namespace filesystem
 }  // namespace treelite
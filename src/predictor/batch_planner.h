@@ -0,0 +1,95 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file batch_planner.h
+ * \author Hyunsu Cho
+ * \brief Decide how many threads to use for a batch prediction, from an
+ *        estimate of the cost of scoring the batch
+ */
+#ifndef TREELITE_PREDICTOR_BATCH_PLANNER_H_
+#define TREELITE_PREDICTOR_BATCH_PLANNER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+
+namespace treelite {
+
+/*!
+ * \brief Choose the number of threads among which the rows of a batch are
+ *        divided. Handing rows to a worker thread costs a wakeup, so a batch
+ *        whose rows take only a few microseconds to score is better scored on
+ *        the calling thread alone.
+ *
+ * The cost of a batch is estimated as the number of rows times the cost of
+ * scoring a single row, which is proportional to the number of trees times
+ * their average depth. The cost per row is either configured, or measured:
+ * every batch prediction reports the time its threads spent scoring rows, and
+ * the estimate follows an exponential moving average of the reported costs.
+ * One thread is used for every [min_work_per_thread_ns] of estimated work.
+ */
+class BatchPlanner {
+ public:
+  /*! \brief weight of the latest measurement in the moving average */
+  static constexpr double kSmoothing = 0.2;
+
+  BatchPlanner() : measured_row_cost_ns_(0.0) {}
+
+  /*!
+   * \brief choose the number of threads for a batch
+   * \param num_row number of rows in the batch
+   * \param max_thread number of threads available (including the caller)
+   * \param row_cost_ns cost of scoring a row (in nanoseconds); set to 0 to
+   *                    use the measured cost
+   * \param min_work_per_thread_ns minimum amount of work (in nanoseconds)
+   *                               worth handing to a thread; set to 0 to
+   *                               always use all threads
+   * \return number of threads, between 1 and max_thread. All threads are
+   *         used if the cost of a row is neither configured nor measured yet.
+   */
+  inline int Plan(size_t num_row, int max_thread, double row_cost_ns,
+                  double min_work_per_thread_ns) const {
+    if (row_cost_ns <= 0.0) {
+      row_cost_ns = measured_row_cost_ns_.load(std::memory_order_relaxed);
+    }
+    if (max_thread <= 1 || min_work_per_thread_ns <= 0.0 || row_cost_ns <= 0.0) {
+      return std::max(max_thread, 1);
+    }
+    const double num_thread
+      = std::ceil(static_cast<double>(num_row) * row_cost_ns / min_work_per_thread_ns);
+    return static_cast<int>(std::max(std::min(num_thread, static_cast<double>(max_thread)),
+                                     1.0));
+  }
+  /*!
+   * \brief report the time spent scoring a batch, summed over all threads
+   * \param num_row number of rows in the batch
+   * \param work_ns time spent scoring the rows (in nanoseconds)
+   */
+  inline void Record(size_t num_row, double work_ns) {
+    if (num_row == 0 || work_ns <= 0.0) {
+      return;
+    }
+    const double row_cost_ns = work_ns / static_cast<double>(num_row);
+    // concurrent updates may overwrite one another; losing a measurement
+    // now and then is harmless
+    const double prev = measured_row_cost_ns_.load(std::memory_order_relaxed);
+    measured_row_cost_ns_.store(
+      (prev > 0.0) ? (1.0 - kSmoothing) * prev + kSmoothing * row_cost_ns : row_cost_ns,
+      std::memory_order_relaxed);
+  }
+  /*! \brief measured cost of scoring a row (in nanoseconds); 0 if unknown */
+  inline double MeasuredRowCost() const {
+    return measured_row_cost_ns_.load(std::memory_order_relaxed);
+  }
+  /*! \brief forget the measured cost, e.g. when a different model is loaded */
+  inline void Reset() {
+    measured_row_cost_ns_.store(0.0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<double> measured_row_cost_ns_;
+};
+
+}  // namespace treelite
+
+#endif  // TREELITE_PREDICTOR_BATCH_PLANNER_H_
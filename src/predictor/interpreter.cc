@@ -0,0 +1,437 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file interpreter.cc
+ * \author Hyunsu Cho
+ * \brief Engine that scores a tree ensemble model in-process, without
+ *        compiling it into a shared library first
+ */
+
+#include <treelite/math.h>
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "./interpreter.h"
+
+namespace {
+
+/*
+ * Prediction transform functions. They compute exactly what the functions
+ * emitted by the compiler (src/compiler/native/pred_transform.h) compute, so
+ * that the interpreter and a compiled library agree bit for bit.
+ */
+
+size_t identity(float* pred, size_t num_output_group, float alpha) {
+  return 1;
+}
+
+size_t sigmoid(float* pred, size_t num_output_group, float alpha) {
+  pred[0] = 1.0f / (1 + std::exp(-alpha * pred[0]));
+  return 1;
+}
+
+size_t exponential(float* pred, size_t num_output_group, float alpha) {
+  pred[0] = std::exp(pred[0]);
+  return 1;
+}
+
+size_t logarithm_one_plus_exp(float* pred, size_t num_output_group, float alpha) {
+  pred[0] = std::log1p(std::exp(pred[0]));
+  return 1;
+}
+
+size_t identity_multiclass(float* pred, size_t num_output_group, float alpha) {
+  return num_output_group;
+}
+
+size_t max_index(float* pred, size_t num_output_group, float alpha) {
+  size_t max_index = 0;
+  float max_margin = pred[0];
+  for (size_t k = 1; k < num_output_group; ++k) {
+    if (pred[k] > max_margin) {
+      max_margin = pred[k];
+      max_index = k;
+    }
+  }
+  pred[0] = static_cast<float>(max_index);
+  return 1;
+}
+
+size_t softmax(float* pred, size_t num_output_group, float alpha) {
+  float max_margin = pred[0];
+  double norm_const = 0.0;
+  float t;
+  for (size_t k = 1; k < num_output_group; ++k) {
+    if (pred[k] > max_margin) {
+      max_margin = pred[k];
+    }
+  }
+  for (size_t k = 0; k < num_output_group; ++k) {
+    t = std::exp(pred[k] - max_margin);
+    norm_const += t;
+    pred[k] = t;
+  }
+  for (size_t k = 0; k < num_output_group; ++k) {
+    pred[k] /= static_cast<float>(norm_const);
+  }
+  return num_output_group;
+}
+
+size_t multiclass_ova(float* pred, size_t num_output_group, float alpha) {
+  for (size_t k = 0; k < num_output_group; ++k) {
+    pred[k] = 1.0f / (1.0f + std::exp(-alpha * pred[k]));
+  }
+  return num_output_group;
+}
+
+#define PRED_TRANSFORM_FUNC(name) {#name, &(name)}
+
+using PredTransformFunc = size_t (*)(float*, size_t, float);
+
+const std::unordered_map<std::string, PredTransformFunc> pred_transform_db = {
+  PRED_TRANSFORM_FUNC(identity),
+  PRED_TRANSFORM_FUNC(sigmoid),
+  PRED_TRANSFORM_FUNC(exponential),
+  PRED_TRANSFORM_FUNC(logarithm_one_plus_exp)
+};
+
+// prediction transform function for *multi-class classifiers* only
+const std::unordered_map<std::string, PredTransformFunc> pred_transform_multiclass_db = {
+  PRED_TRANSFORM_FUNC(identity_multiclass),
+  PRED_TRANSFORM_FUNC(max_index),
+  PRED_TRANSFORM_FUNC(softmax),
+  PRED_TRANSFORM_FUNC(multiclass_ova)
+};
+
+/*! \brief a row given as an array of entries */
+struct SparseRow {
+  const TreelitePredictorEntry* data;
+  inline bool IsMissing(uint32_t fid) const {
+    return data[fid].missing == -1;
+  }
+  inline float Value(uint32_t fid) const {
+    return data[fid].fvalue;
+  }
+};
+
+/*! \brief a row of a dense matrix */
+struct DenseRow {
+  const float* data;
+  float missing_value;
+  inline bool IsMissing(uint32_t fid) const {
+    return treelite::math::CheckNAN(data[fid]) || data[fid] == missing_value;
+  }
+  inline float Value(uint32_t fid) const {
+    return data[fid];
+  }
+};
+
+struct SparseBlock {
+  const TreelitePredictorEntry* rows;
+  size_t stride;
+  inline SparseRow Row(size_t rid) const {
+    return SparseRow{&rows[rid * stride]};
+  }
+  inline treelite::simd::RowBlock SIMDBlock() const {
+    static_assert(sizeof(TreelitePredictorEntry) == sizeof(float),
+                  "TreelitePredictorEntry must be 4 bytes");
+    return treelite::simd::RowBlock{rows, stride, false, 0.0f};
+  }
+};
+
+struct DenseBlock {
+  const float* rows;
+  size_t stride;
+  float missing_value;
+  inline DenseRow Row(size_t rid) const {
+    return DenseRow{&rows[rid * stride], missing_value};
+  }
+  inline treelite::simd::RowBlock SIMDBlock() const {
+    return treelite::simd::RowBlock{rows, stride, true, missing_value};
+  }
+};
+
+constexpr uint32_t kDefaultLeftBit = (1U << 31);
+
+}  // anonymous namespace
+
+namespace treelite {
+
+Interpreter::Interpreter(const Model& model)
+  : num_tree_(model.trees.size()),
+    num_output_group_(static_cast<size_t>(model.num_output_group)),
+    num_feature_(static_cast<size_t>(model.num_feature)),
+    average_result_(model.random_forest_flag),
+    output_vector_(model.num_output_group > 1 && model.random_forest_flag),
+    pred_transform_(model.param.pred_transform),
+    sigmoid_alpha_(model.param.sigmoid_alpha),
+    global_bias_(model.param.global_bias),
+    simd_level_(simd::DetectLevel()) {
+  // the SIMD kernels read the nodes as words (see simd::node_layout)
+  static_assert(offsetof(Node, sindex) == 0 && offsetof(Node, right_child) == 4
+                && offsetof(Node, info) == 8 && offsetof(Node, kind) == 12
+                && offsetof(Node, op) == 13, "Node layout must match simd::node_layout");
+  static_assert(static_cast<uint32_t>(NodeKind::kLeaf) == simd::node_layout::kKindLeaf
+                && static_cast<uint32_t>(NodeKind::kNumerical)
+                   == simd::node_layout::kKindNumerical
+                && static_cast<uint32_t>(TestOp::kLT) == simd::node_layout::kOpLT
+                && static_cast<uint32_t>(TestOp::kLE) == simd::node_layout::kOpLE
+                && static_cast<uint32_t>(TestOp::kGT) == simd::node_layout::kOpGT
+                && static_cast<uint32_t>(TestOp::kGE) == simd::node_layout::kOpGE
+                && static_cast<uint32_t>(TestOp::kEQ) == simd::node_layout::kOpEQ
+                && static_cast<uint32_t>(TestOp::kTrue) == simd::node_layout::kOpTrue
+                && static_cast<uint32_t>(TestOp::kFalse) == simd::node_layout::kOpFalse,
+                "Node kinds and operators must match simd::node_layout");
+  CHECK_GT(num_output_group_, 0) << "num_output_group cannot be zero";
+  CHECK_GT(num_feature_, 0) << "num_feature cannot be zero";
+  const auto& db = (num_output_group_ > 1) ? pred_transform_multiclass_db : pred_transform_db;
+  auto it = db.find(pred_transform_);
+  if (it == db.end()) {
+    std::ostringstream oss;
+    for (const auto& e : db) {
+      oss << "'" << e.first << "', ";
+    }
+    LOG(FATAL) << "Invalid argument given for `pred_transform` parameter. "
+               << "For " << (num_output_group_ > 1 ? "" : "any task that is NOT ")
+               << "multi-class classification, you should set "
+               << "`pred_transform` to one of the following: "
+               << "{ " << oss.str() << " }";
+  }
+  if (pred_transform_ == "sigmoid" || pred_transform_ == "multiclass_ova") {
+    CHECK_GT(sigmoid_alpha_, 0.0f) << pred_transform_ << ": alpha must be strictly positive";
+  }
+  pred_transform_func_ = it->second;
+
+  size_t num_node = 0;
+  for (const Tree& tree : model.trees) {
+    num_node += static_cast<size_t>(tree.num_nodes);
+  }
+  nodes_.reserve(num_node);
+  tree_begin_.reserve(num_tree_);
+  tree_vectorizable_.reserve(num_tree_);
+  cat_begin_.push_back(0);
+  for (const Tree& tree : model.trees) {
+    const size_t tree_begin = nodes_.size();
+    tree_begin_.push_back(tree_begin);
+    Flatten_(tree, 0, tree_begin);
+    const size_t tree_size = nodes_.size() - tree_begin;
+    CHECK_LE(tree_size, static_cast<size_t>(std::numeric_limits<uint32_t>::max()))
+      << "Tree is too large";
+    // the SIMD kernels address the words of a node with 32-bit signed offsets
+    bool vectorizable
+      = (tree_size <= static_cast<size_t>(std::numeric_limits<int32_t>::max() / 4));
+    for (size_t i = tree_begin; i < nodes_.size(); ++i) {
+      vectorizable = vectorizable && (nodes_[i].kind != NodeKind::kCategorical);
+    }
+    tree_vectorizable_.push_back(vectorizable ? 1 : 0);
+  }
+}
+
+void
+Interpreter::SetSIMDLevel(simd::Level level) {
+  CHECK_LE(static_cast<int>(level), static_cast<int>(simd::DetectLevel()))
+    << "Instruction set " << simd::LevelName(level) << " is not supported on this machine";
+  simd_level_ = level;
+}
+
+void
+Interpreter::Flatten_(const Tree& tree, int nid, size_t tree_begin) {
+  Node node;
+  std::memset(&node, 0, sizeof(node));
+  const size_t pos = nodes_.size();
+  if (tree.IsLeaf(nid)) {
+    node.kind = NodeKind::kLeaf;
+    if (output_vector_) {
+      // multi-class classification with random forest
+      const std::vector<tl_float> leaf_vector = tree.LeafVector(nid);
+      CHECK_EQ(leaf_vector.size(), num_output_group_)
+        << "Ill-formed model: leaf vector must be of length [num_output_group]";
+      node.info.offset = static_cast<uint32_t>(leaf_vector_.size());
+      leaf_vector_.insert(leaf_vector_.end(), leaf_vector.begin(), leaf_vector.end());
+    } else {
+      node.info.leaf_value = tree.LeafValue(nid);
+    }
+    nodes_.push_back(node);
+    return;
+  }
+
+  const uint32_t split_index = tree.SplitIndex(nid);
+  CHECK_LT(split_index, num_feature_)
+    << "Ill-formed model: split on feature " << split_index << ", but the model has only "
+    << num_feature_ << " features";
+  node.sindex = split_index | (tree.DefaultLeft(nid) ? kDefaultLeftBit : 0U);
+  if (tree.SplitType(nid) == SplitFeatureType::kNumerical) {
+    node.kind = NodeKind::kNumerical;
+    const tl_float threshold = tree.Threshold(nid);
+    const Operator op = tree.ComparisonOp(nid);
+    node.info.threshold = threshold;
+    if (std::isinf(threshold)) {
+      // According to IEEE 754, the result of comparison [lhs] < infinity
+      // must be identical for all finite [lhs]. Same goes for operator >.
+      node.op = CompareWithOp(0.0f, op, threshold) ? TestOp::kTrue : TestOp::kFalse;
+    } else {
+      switch (op) {
+       case Operator::kLT: node.op = TestOp::kLT; break;
+       case Operator::kLE: node.op = TestOp::kLE; break;
+       case Operator::kGT: node.op = TestOp::kGT; break;
+       case Operator::kGE: node.op = TestOp::kGE; break;
+       case Operator::kEQ: node.op = TestOp::kEQ; break;
+       default: LOG(FATAL) << "Ill-formed model: operator undefined";
+      }
+    }
+  } else {
+    const std::vector<uint32_t> left_categories = tree.LeftCategories(nid);
+    if (left_categories.empty()) {
+      // every row goes to the right child, whether the feature is missing or not
+      node.kind = NodeKind::kNumerical;
+      node.sindex = split_index;
+      node.op = TestOp::kFalse;
+    } else {
+      node.kind = NodeKind::kCategorical;
+      node.missing_category_to_zero = tree.MissingCategoryToZero(nid) ? 1 : 0;
+      node.info.offset = static_cast<uint32_t>(cat_begin_.size() - 1);
+      const uint32_t max_category
+        = *std::max_element(left_categories.begin(), left_categories.end());
+      const size_t bitmap_begin = cat_bitmap_.size();
+      cat_bitmap_.resize(bitmap_begin + (max_category + 1 + 63) / 64, 0);
+      for (uint32_t cat : left_categories) {
+        cat_bitmap_[bitmap_begin + cat / 64] |= (static_cast<uint64_t>(1) << (cat % 64));
+      }
+      cat_begin_.push_back(cat_bitmap_.size());
+    }
+  }
+  nodes_.push_back(node);
+  // the left child follows its parent; the right child follows the subtree
+  // rooted at the left child
+  Flatten_(tree, tree.LeftChild(nid), tree_begin);
+  nodes_[pos].right_child = static_cast<uint32_t>(nodes_.size() - tree_begin);
+  Flatten_(tree, tree.RightChild(nid), tree_begin);
+}
+
+template <typename RowType>
+inline bool
+Interpreter::GoLeft_(const Node& node, const RowType& row) const {
+  const uint32_t fid = node.sindex & ~kDefaultLeftBit;
+  const bool default_left = (node.sindex & kDefaultLeftBit) != 0;
+  if (node.kind == NodeKind::kNumerical) {
+    if (row.IsMissing(fid)) {
+      return default_left;
+    }
+    const float fvalue = row.Value(fid);
+    switch (node.op) {
+     case TestOp::kLT: return fvalue < node.info.threshold;
+     case TestOp::kLE: return fvalue <= node.info.threshold;
+     case TestOp::kGT: return fvalue > node.info.threshold;
+     case TestOp::kGE: return fvalue >= node.info.threshold;
+     case TestOp::kEQ: return fvalue == node.info.threshold;
+     case TestOp::kTrue: return true;
+     default: return false;
+    }
+  }
+  uint32_t category;
+  if (row.IsMissing(fid)) {
+    if (!node.missing_category_to_zero) {
+      return default_left;
+    }
+    category = 0;
+  } else {
+    const float fvalue = row.Value(fid);
+    // negative (or NaN) values and values too large for a category never
+    // belong to the left child
+    if (!(fvalue >= 0.0f) || fvalue >= 4294967296.0f) {
+      return false;
+    }
+    category = static_cast<uint32_t>(fvalue);
+  }
+  const size_t bitmap_begin = cat_begin_[node.info.offset];
+  const size_t bitmap_len = cat_begin_[node.info.offset + 1] - bitmap_begin;
+  const size_t word = category / 64;
+  return word < bitmap_len && ((cat_bitmap_[bitmap_begin + word] >> (category % 64)) & 1);
+}
+
+template <typename RowType>
+inline uint32_t
+Interpreter::Traverse_(const Node* tree, const RowType& row) const {
+  uint32_t nid = 0;
+  while (tree[nid].kind != NodeKind::kLeaf) {
+    nid = GoLeft_(tree[nid], row) ? nid + 1 : tree[nid].right_child;
+  }
+  return nid;
+}
+
+template <typename BlockType>
+size_t
+Interpreter::PredictBlock_(const BlockType& block, size_t num_row, bool pred_margin,
+                           float* out) const {
+  const size_t num_output_group = num_output_group_;
+  std::fill(out, out + num_row * num_output_group, 0.0f);
+  std::vector<uint32_t> leaf(num_row);
+  // evaluate tree-major: apply each tree to every row in the block before
+  // moving on to the next tree, so that the nodes of the tree stay in cache
+  for (size_t tree_id = 0; tree_id < num_tree_; ++tree_id) {
+    const Node* tree = &nodes_[tree_begin_[tree_id]];
+    size_t rid = 0;
+    if (simd_level_ != simd::Level::kScalar && tree_vectorizable_[tree_id]) {
+      rid = simd::TraverseBlock(simd_level_, reinterpret_cast<const uint32_t*>(tree),
+                                block.SIMDBlock(), num_row, leaf.data());
+    }
+    for (; rid < num_row; ++rid) {
+      leaf[rid] = Traverse_(tree, block.Row(rid));
+    }
+    if (output_vector_) {
+      for (rid = 0; rid < num_row; ++rid) {
+        const float* leaf_vector = &leaf_vector_[tree[leaf[rid]].info.offset];
+        float* sum = &out[rid * num_output_group];
+        for (size_t k = 0; k < num_output_group; ++k) {
+          sum[k] += leaf_vector[k];
+        }
+      }
+    } else {
+      // for multi-class gradient boosted trees, tree i belongs to output
+      // group (i % num_output_group)
+      float* sum = &out[tree_id % num_output_group];
+      for (rid = 0; rid < num_row; ++rid) {
+        sum[rid * num_output_group] += tree[leaf[rid]].info.leaf_value;
+      }
+    }
+  }
+  return Postprocess_(num_row, pred_margin, out);
+}
+
+size_t
+Interpreter::Postprocess_(size_t num_row, bool pred_margin, float* out) const {
+  const size_t num_output_group = num_output_group_;
+  const float num_tree = static_cast<float>(num_tree_);
+  size_t result_size = (num_output_group > 1) ? num_output_group : 1;
+  for (size_t rid = 0; rid < num_row; ++rid) {
+    float* result = &out[rid * num_output_group];
+    for (size_t k = 0; k < num_output_group; ++k) {
+      result[k] = (average_result_ ? result[k] / num_tree : result[k]) + global_bias_;
+    }
+    if (!pred_margin) {
+      result_size = pred_transform_func_(result, num_output_group, sigmoid_alpha_);
+    }
+  }
+  return result_size;
+}
+
+size_t
+Interpreter::PredictBatch(const TreelitePredictorEntry* rows, size_t num_row, size_t stride,
+                          bool pred_margin, float* out) const {
+  CHECK_GE(stride, num_feature_);
+  return PredictBlock_(SparseBlock{rows, stride}, num_row, pred_margin, out);
+}
+
+size_t
+Interpreter::PredictBatchDense(const float* rows, size_t num_row, size_t stride,
+                               float missing_value, bool pred_margin, float* out) const {
+  CHECK_GE(stride, num_feature_);
+  return PredictBlock_(DenseBlock{rows, stride, missing_value}, num_row, pred_margin, out);
+}
+
+}  // namespace treelite
@@ -0,0 +1,166 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file interpreter.h
+ * \author Hyunsu Cho
+ * \brief Engine that scores a tree ensemble model in-process, without
+ *        compiling it into a shared library first
+ */
+#ifndef TREELITE_PREDICTOR_INTERPRETER_H_
+#define TREELITE_PREDICTOR_INTERPRETER_H_
+
+#include <treelite/tree.h>
+#include <treelite/entry.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "./simd_traversal.h"
+
+namespace treelite {
+
+/*!
+ * \brief Scores a tree ensemble model directly from its trees. When the
+ *        interpreter is created, the trees are flattened into one array of
+ *        16-byte nodes. Each tree is laid out in depth-first order, so that the
+ *        left child of a test node is the node right after it and only the
+ *        right child needs to be stored.
+ *
+ *        PredictBatch() and PredictBatchDense() follow the same contract as
+ *        predict_batch() and predict_batch_dense() in a compiled library, and
+ *        produce the same results.
+ *
+ *        On CPUs with AVX2 or AVX-512, trees that contain only numerical splits
+ *        are traversed for 8 or 16 rows at a time (see simd_traversal.h).
+ */
+class Interpreter {
+ public:
+  explicit Interpreter(const Model& model);
+  Interpreter(const Interpreter&) = delete;
+  Interpreter& operator=(const Interpreter&) = delete;
+
+  /*!
+   * \brief score a block of rows, tree by tree
+   * \param rows rows to score, each [stride] entries wide
+   * \param num_row number of rows
+   * \param stride width of each row; must be at least the number of features
+   * \param pred_margin whether to produce raw margin scores instead of
+   *                    transformed probabilities
+   * \param out output buffer, with room for [num_row] * [num_output_group]
+   *            values
+   * \return length of the output for each row
+   */
+  size_t PredictBatch(const TreelitePredictorEntry* rows, size_t num_row, size_t stride,
+                      bool pred_margin, float* out) const;
+  /*!
+   * \brief score a block of rows of a dense matrix, reading them in place.
+   *        Feature values that are NaN or equal to [missing_value] are
+   *        treated as missing.
+   * \param rows rows to score, each [stride] values wide
+   * \param num_row number of rows
+   * \param stride width of each row; must be at least the number of features
+   * \param missing_value value representing the missing value
+   * \param pred_margin whether to produce raw margin scores instead of
+   *                    transformed probabilities
+   * \param out output buffer, with room for [num_row] * [num_output_group]
+   *            values
+   * \return length of the output for each row
+   */
+  size_t PredictBatchDense(const float* rows, size_t num_row, size_t stride,
+                           float missing_value, bool pred_margin, float* out) const;
+
+  inline size_t NumOutputGroup() const {
+    return num_output_group_;
+  }
+  inline size_t NumFeature() const {
+    return num_feature_;
+  }
+  inline size_t NumNode() const {
+    return nodes_.size();
+  }
+  inline const std::string& PredTransform() const {
+    return pred_transform_;
+  }
+  inline float SigmoidAlpha() const {
+    return sigmoid_alpha_;
+  }
+  inline float GlobalBias() const {
+    return global_bias_;
+  }
+  inline simd::Level SIMDLevel() const {
+    return simd_level_;
+  }
+  /*!
+   * \brief choose the instruction set used to traverse trees. By default, the
+   *        widest one supported by the CPU is used.
+   * \param level instruction set; must not exceed simd::DetectLevel()
+   */
+  void SetSIMDLevel(simd::Level level);
+
+ private:
+  enum class NodeKind : uint8_t {
+    kLeaf = 0, kNumerical = 1, kCategorical = 2
+  };
+  /*! \brief test applied to a (non-missing) feature value at a numerical split */
+  enum class TestOp : uint8_t {
+    kLT = 0, kLE = 1, kGT = 2, kGE = 3, kEQ = 4,
+    kTrue = 5, kFalse = 6  // outcome known in advance, e.g. infinite threshold
+  };
+  struct Node {
+    uint32_t sindex;
+      // feature index; the highest bit indicates the default direction for
+      // missing values
+    uint32_t right_child;
+      // index of the right child, relative to the start of the tree. The left
+      // child always follows its parent.
+    union Info {
+      float threshold;     // numerical split
+      float leaf_value;    // leaf, when leaf vectors are not in use
+      uint32_t offset;     // leaf: position in leaf_vector_;
+                           // categorical split: position in cat_begin_
+    } info;
+    NodeKind kind;
+    TestOp op;
+    uint8_t missing_category_to_zero;
+    uint8_t pad_;
+  };
+  static_assert(sizeof(Node) == 16, "Node must be 16 bytes");
+
+  /*! \brief function to transform the margin scores of a single row */
+  typedef size_t (*PredTransformFunc)(float* pred, size_t num_output_group, float alpha);
+
+  void Flatten_(const Tree& tree, int nid, size_t tree_begin);
+  template <typename RowType>
+  inline uint32_t Traverse_(const Node* tree, const RowType& row) const;
+  template <typename RowType>
+  inline bool GoLeft_(const Node& node, const RowType& row) const;
+  template <typename BlockType>
+  size_t PredictBlock_(const BlockType& block, size_t num_row, bool pred_margin,
+                       float* out) const;
+  size_t Postprocess_(size_t num_row, bool pred_margin, float* out) const;
+
+  std::vector<Node> nodes_;
+  std::vector<size_t> tree_begin_;
+    // nodes of tree i start at nodes_[tree_begin_[i]]
+  std::vector<uint8_t> tree_vectorizable_;
+    // whether tree i can be traversed with the SIMD kernels, i.e. has no
+    // categorical splits
+  std::vector<float> leaf_vector_;
+    // leaf vectors of all leaves, [num_output_group] values each
+  std::vector<uint64_t> cat_bitmap_;
+  std::vector<size_t> cat_begin_;
+    // the i-th categorical split sends a category c to the left child if bit c
+    // is set in cat_bitmap_[cat_begin_[i]:cat_begin_[i+1]]
+  size_t num_tree_;
+  size_t num_output_group_;
+  size_t num_feature_;
+  bool average_result_;  // whether to average the leaf outputs over all trees
+  bool output_vector_;   // whether each leaf produces a vector of outputs
+  std::string pred_transform_;
+  PredTransformFunc pred_transform_func_;
+  float sigmoid_alpha_;
+  float global_bias_;
+  simd::Level simd_level_;
+};
+
+}  // namespace treelite
+
+#endif  // TREELITE_PREDICTOR_INTERPRETER_H_
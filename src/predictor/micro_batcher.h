@@ -0,0 +1,142 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file micro_batcher.h
+ * \author Hyunsu Cho
+ * \brief Collect concurrent single-instance prediction requests into small
+ *        batches
+ */
+#ifndef TREELITE_PREDICTOR_MICRO_BATCHER_H_
+#define TREELITE_PREDICTOR_MICRO_BATCHER_H_
+
+#include <treelite/entry.h>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace treelite {
+
+/*!
+ * \brief Collect single-instance prediction requests arriving concurrently
+ *        from many threads, so that they can be scored together as a batch.
+ *
+ * The first thread to submit a request becomes the leader of a new batch and
+ * waits until the batch holds [max_rows] requests, [timeout] has elapsed, or
+ * every thread inside Submit() has joined the batch. Other threads arriving in
+ * the meantime join the batch and go to sleep. The leader then scores the
+ * whole batch and wakes up each of the other threads individually. Requests
+ * with and without pred_margin are collected into separate batches.
+ *
+ * The leader only waits while other threads are still busy with earlier
+ * requests, since those are the ones likely to submit again shortly. A lone
+ * caller, therefore, is scored right away and never pays for the timeout.
+ */
+class MicroBatcher {
+ public:
+  /*! \brief a single-instance prediction request */
+  struct Request {
+    const TreelitePredictorEntry* inst;
+    float* out_result;
+    size_t result_size;
+    std::exception_ptr error;
+    bool done;
+    std::condition_variable cv;
+  };
+  /*!
+   * \brief function to score a batch of requests. It should set result_size
+   *        of every request.
+   */
+  typedef std::function<void(bool pred_margin, const std::vector<Request*>& requests)>
+    FlushFunc;
+
+  MicroBatcher(size_t max_rows, std::chrono::microseconds timeout, FlushFunc flush)
+    : max_rows_(max_rows), timeout_(timeout), flush_(std::move(flush)) {}
+
+  /*!
+   * \brief submit a request and block until it has been scored
+   * \return length of the output vector
+   */
+  size_t Submit(const TreelitePredictorEntry* inst, bool pred_margin, float* out_result) {
+    Request req;
+    req.inst = inst;
+    req.out_result = out_result;
+    req.result_size = 0;
+    req.done = false;
+    Batch*& open_batch = open_batch_[pred_margin ? 1 : 0];
+    size_t& num_submitter = num_submitter_[pred_margin ? 1 : 0];
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++num_submitter;
+    if (open_batch == nullptr) {  // become the leader of a new batch
+      std::unique_ptr<Batch> batch(new Batch());
+      open_batch = batch.get();
+      batch->requests.push_back(&req);
+      // stop waiting once no other thread is left to join the batch
+      batch->full_cv.wait_for(lock, timeout_, [this, &batch, &num_submitter] {
+        return batch->closed || batch->requests.size() >= max_rows_
+               || batch->requests.size() == num_submitter;
+      });
+      if (!batch->closed) {  // timed out, or no more requests to wait for
+        batch->closed = true;
+        open_batch = nullptr;
+      }
+      lock.unlock();
+      try {
+        flush_(pred_margin, batch->requests);
+      } catch (...) {
+        const std::exception_ptr error = std::current_exception();
+        for (Request* e : batch->requests) {
+          e->error = error;
+        }
+      }
+      lock.lock();
+      for (Request* e : batch->requests) {
+        e->done = true;
+        if (e != &req) {
+          e->cv.notify_one();
+        }
+      }
+    } else {  // join the open batch
+      Batch* batch = open_batch;
+      batch->requests.push_back(&req);
+      if (batch->requests.size() >= max_rows_) {
+        batch->closed = true;
+        open_batch = nullptr;
+        batch->full_cv.notify_one();
+      }
+      req.cv.wait(lock, [&req] { return req.done; });
+    }
+    --num_submitter;
+    if (open_batch != nullptr) {
+      // the leader of the open batch may have been waiting for this thread
+      open_batch->full_cv.notify_one();
+    }
+    lock.unlock();
+    if (req.error) {
+      std::rethrow_exception(req.error);
+    }
+    return req.result_size;
+  }
+
+ private:
+  struct Batch {
+    std::vector<Request*> requests;
+    bool closed = false;
+    std::condition_variable full_cv;
+  };
+
+  size_t max_rows_;
+  std::chrono::microseconds timeout_;
+  FlushFunc flush_;
+  std::mutex mutex_;
+  Batch* open_batch_[2] = {nullptr, nullptr};
+    // batch currently accepting requests, one for each value of pred_margin
+  size_t num_submitter_[2] = {0, 0};
+    // number of threads inside Submit(), one for each value of pred_margin
+};
+
+}  // namespace treelite
+
+#endif  // TREELITE_PREDICTOR_MICRO_BATCHER_H_
@@ -6,6 +6,7 @@
  */
 
 #include <treelite/predictor.h>
+#include <treelite/tree.h>
 #include <treelite/math.h>
 #include <dmlc/logging.h>
 #include <dmlc/io.h>
@@ -17,7 +18,18 @@
 #include <limits>
 #include <functional>
 #include <type_traits>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <thread>
+#include <chrono>
+#include "thread_pool/cpu_topology.h"
 #include "thread_pool/thread_pool.h"
+#include "thread_pool/wait_policy.h"
+#include "thread_pool/work_stealing_scheduler.h"
+#include "micro_batcher.h"
+#include "batch_planner.h"
+#include "interpreter.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -25,32 +37,201 @@
 #include <dlfcn.h>
 #endif
 
-namespace {
-
-enum class InputType : uint8_t {
-  kSparseBatch = 0, kDenseBatch = 1
-};
+namespace treelite {
 
-struct InputToken {
+/*!
+ * \brief State shared by all threads taking part in a single batch
+ *        prediction. Each call to PredictBatch() or PredictBatchAsync() has
+ *        its own context, so that multiple threads may make predictions with
+ *        the same predictor at once.
+ */
+struct BatchContext {
+  enum class InputType : uint8_t {
+    kSparseBatch = 0, kDenseBatch = 1, kQuantizedBatch = 2
+  };
   InputType input_type;
-  const void* data;  // pointer to input data
+  CSRBatch sparse_batch;
+  DenseBatch dense_batch;
+  QuantizedBatch quantized_batch;
+    // copy of the batch description, so that workers never need to access
+    // the caller's batch object
   bool pred_margin;  // whether to store raw margin or transformed scores
   size_t num_feature;
     // # features (columns) accepted by the tree ensemble model
   size_t num_output_group;
     // size of output per instance (row)
-  treelite::Predictor::PredFuncHandle pred_func_handle;
-  size_t rbegin, rend;
-    // range of instances (rows) assigned to each worker
+  Predictor::PredFuncHandle pred_func_handle;
+  Predictor::PredFuncHandle batch_pred_func_handle;
+    // used instead of pred_func_handle when not null
+  Predictor::PredFuncHandle dense_batch_pred_func_handle;
+    // used for dense batches when not null
+  Predictor::PredFuncHandle quantized_batch_pred_func_handle;
+    // used for quantized batches
+  const Interpreter* interpreter;
+    // used instead of all prediction functions when not null
   float* out_pred;
-    // buffer to store output from each worker
+    // buffer to store output from all workers
+  int verbose;
+  double tstart;
+  PredictionCallback callback;
+    // to be invoked once the prediction completes (may be empty)
+  size_t num_row;
+  WorkStealingScheduler scheduler;
+    // hands out ranges of instances (rows) to workers
+  std::atomic<size_t> num_row_done;
+  std::atomic<size_t> query_result_size;
+  size_t result_size;  // length of the final output vector
+  std::atomic<bool> failed;
+  std::exception_ptr error;  // first error raised by any worker
+  std::mutex mutex;  // guards error
+  CompletionEvent done;
+  WaitConfig wait;  // how the caller waits for the prediction to complete
+  std::atomic<int64_t> work_ns;
+    // time spent scoring rows (in nanoseconds), summed over all threads
+  std::shared_ptr<BatchPlanner> planner;
+    // receives work_ns once the prediction completes, to refine its estimate
+    // of the cost of a row
+
+  BatchContext(size_t num_row, int num_worker, size_t chunk_size)
+    : num_row(num_row), scheduler(num_row, num_worker, chunk_size),
+      num_row_done(0), query_result_size(0), result_size(0), failed(false),
+      work_ns(0) {}
+
+  /*! \brief record that a range of rows has been processed (or abandoned) */
+  inline void Complete(size_t num_row_processed, size_t query_result_size_) {
+    query_result_size.fetch_add(query_result_size_);
+    if (num_row_done.fetch_add(num_row_processed) + num_row_processed == num_row) {
+      Finish();
+    }
+  }
+  inline void Fail(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!failed.load()) {
+      error = e;
+      failed.store(true);
+    }
+  }
+  /*!
+   * \brief block until the prediction completes
+   * \return length of the output vector
+   */
+  inline size_t Wait() {
+    done.Wait(wait);
+    if (failed.load()) {
+      std::rethrow_exception(error);
+    }
+    return result_size;
+  }
+
+ private:
+  /*! \brief run by the thread that processes the last row */
+  inline void Finish() {
+    if (!failed.load()) {
+      try {
+        result_size = ReshapeOutput();
+      } catch (...) {
+        Fail(std::current_exception());
+      }
+    }
+    if (planner && !failed.load()) {
+      planner->Record(num_row, static_cast<double>(work_ns.load()));
+    }
+    if (verbose > 0) {
+      LOG(INFO) << "Treelite: Finished prediction in "
+                << dmlc::GetTime() - tstart << " sec";
+    }
+    // release the waiting threads before invoking the callback, so that the
+    // callback may itself check or wait for the prediction. The context stays
+    // alive while the callback runs, since the task holds a reference to it.
+    const std::exception_ptr e = failed.load() ? error : nullptr;
+    done.Set();
+    if (callback) {
+      callback(result_size, e);
+    }
+  }
+  /*! \brief re-shape output if total_size < dimension of out_pred */
+  inline size_t ReshapeOutput() {
+    const size_t total_size = query_result_size.load();
+    if (total_size < num_row * num_output_group) {
+      CHECK_GT(num_output_group, 1);
+      CHECK_EQ(total_size % num_row, 0);
+      const size_t query_size_per_instance = total_size / num_row;
+      CHECK_GT(query_size_per_instance, 0);
+      CHECK_LT(query_size_per_instance, num_output_group);
+      for (size_t rid = 0; rid < num_row; ++rid) {
+        for (size_t k = 0; k < query_size_per_instance; ++k) {
+          out_pred[rid * query_size_per_instance + k]
+            = out_pred[rid * num_output_group + k];
+        }
+      }
+    }
+    return total_size;
+  }
 };
 
-struct OutputToken {
-  size_t query_result_size;
+}  // namespace treelite
+
+namespace {
+
+using treelite::BatchContext;
+using InputType = treelite::BatchContext::InputType;
+
+/*!
+ * \brief State shared by all threads taking part in a single-instance
+ *        prediction, whose translation units are scored in parallel
+ */
+struct InstContext {
+  using UnitPredFunc = void (*)(size_t, TreelitePredictorEntry*, size_t, size_t, float*);
+  std::vector<TreelitePredictorEntry> inst;
+    // copy of the row, since preprocess_batch() overwrites it with bins
+  size_t stride;  // width of inst
+  size_t num_output_group;
+  UnitPredFunc unit_pred_func;
+  size_t num_unit;
+  std::vector<float> unit_out;
+    // margin scores from each translation unit, to be added up by the caller
+  std::atomic<size_t> next_unit;
+  std::atomic<size_t> num_unit_done;
+  treelite::CompletionEvent done;
+  treelite::WaitConfig wait;  // how the caller waits for the other threads
+
+  InstContext(const TreelitePredictorEntry* inst, size_t stride, size_t num_output_group,
+              UnitPredFunc unit_pred_func, size_t num_unit, treelite::WaitConfig wait)
+    : inst(inst, inst + stride), stride(stride), num_output_group(num_output_group),
+      unit_pred_func(unit_pred_func), num_unit(num_unit),
+      unit_out(num_unit * num_output_group, 0.0f), next_unit(0), num_unit_done(0),
+      wait(wait) {}
+
+  /*! \brief keep claiming translation units and scoring them, until every
+   *         unit has been claimed */
+  inline void Run() {
+    size_t num_unit_processed = 0;
+    for (size_t unit_id = next_unit.fetch_add(1); unit_id < num_unit;
+         unit_id = next_unit.fetch_add(1)) {
+      unit_pred_func(unit_id, inst.data(), 1, stride, &unit_out[unit_id * num_output_group]);
+      ++num_unit_processed;
+    }
+    if (num_unit_processed > 0
+        && num_unit_done.fetch_add(num_unit_processed) + num_unit_processed == num_unit) {
+      done.Set();
+    }
+  }
+  /*! \brief block until every translation unit has been scored */
+  inline void Wait() {
+    done.Wait(wait);
+  }
+};
+
+struct InputToken {
+  std::shared_ptr<BatchContext> context;
+    // shared with the caller, since a task may be picked up by a worker only
+    // after all rows have been processed and the caller has returned
+  int worker_id;
+  std::shared_ptr<InstContext> inst_context;
+    // set instead of context, for single-instance prediction
 };
 
-using PredThreadPool = treelite::ThreadPool<InputToken, OutputToken, treelite::Predictor>;
+using PredThreadPool = treelite::ThreadPool<InputToken, treelite::Predictor>;
 
 inline treelite::Predictor::LibraryHandle OpenLibrary(const char* name) {
 #ifdef _WIN32
@@ -80,71 +261,100 @@ inline HandleType LoadFunction(treelite::Predictor::LibraryHandle lib_handle,
   return static_cast<HandleType>(func_handle);
 }
 
-template <typename PredFunc>
-inline size_t PredLoop(const treelite::CSRBatch* batch, size_t num_feature,
-                       size_t rbegin, size_t rend,
-                       float* out_pred, PredFunc func) {
-  CHECK_LE(batch->num_col, num_feature);
-  std::vector<TreelitePredictorEntry> inst(
-    std::max(batch->num_col, num_feature), {-1});
-  CHECK(rbegin < rend && rend <= batch->num_row);
-  CHECK(sizeof(size_t) < sizeof(int64_t)
-     || (rbegin <= static_cast<size_t>(std::numeric_limits<int64_t>::max())
-        && rend <= static_cast<size_t>(std::numeric_limits<int64_t>::max())));
-  const int64_t rbegin_ = static_cast<int64_t>(rbegin);
-  const int64_t rend_ = static_cast<int64_t>(rend);
+/*!
+ * \brief maximum number of rows to pass to predict_batch() at a time. Each
+ *        tree is applied to all rows in the block before moving on to the
+ *        next tree, so the block should be small enough for the rows to stay
+ *        in cache.
+ */
+constexpr size_t kMaxBlockRows = 64;
+/*! \brief maximum number of entries in a block of rows */
+constexpr size_t kMaxBlockEntries = 64 * 1024;
+
+/*! \brief copy a row into the (all-missing) row buffer inst */
+inline void FillRow(const treelite::CSRBatch* batch, size_t rid,
+                    TreelitePredictorEntry* inst) {
+  const size_t ibegin = batch->row_ptr[rid];
+  const size_t iend = batch->row_ptr[rid + 1];
+  for (size_t i = ibegin; i < iend; ++i) {
+    inst[batch->col_ind[i]].fvalue = batch->data[i];
+  }
+}
+
+/*! \brief mark all entries of the row buffer inst as missing again */
+inline void ClearRow(const treelite::CSRBatch* batch, size_t rid,
+                     TreelitePredictorEntry* inst) {
+  const size_t ibegin = batch->row_ptr[rid];
+  const size_t iend = batch->row_ptr[rid + 1];
+  for (size_t i = ibegin; i < iend; ++i) {
+    inst[batch->col_ind[i]].missing = -1;
+  }
+}
+
+inline void FillRow(const treelite::DenseBatch* batch, size_t rid,
+                    TreelitePredictorEntry* inst) {
+  const bool nan_missing = treelite::math::CheckNAN(batch->missing_value);
   const size_t num_col = batch->num_col;
-  const float* data = batch->data;
-  const uint32_t* col_ind = batch->col_ind;
-  const size_t* row_ptr = batch->row_ptr;
-  size_t total_output_size = 0;
-  for (int64_t rid = rbegin_; rid < rend_; ++rid) {
-    const size_t ibegin = row_ptr[rid];
-    const size_t iend = row_ptr[rid + 1];
-    for (size_t i = ibegin; i < iend; ++i) {
-      inst[col_ind[i]].fvalue = data[i];
-    }
-    total_output_size += func(rid, &inst[0], out_pred);
-    for (size_t i = ibegin; i < iend; ++i) {
-      inst[col_ind[i]].missing = -1;
+  const float missing_value = batch->missing_value;
+  const float* row = &batch->data[rid * num_col];
+  for (size_t j = 0; j < num_col; ++j) {
+    if (treelite::math::CheckNAN(row[j])) {
+      CHECK(nan_missing)
+        << "The missing_value argument must be set to NaN if there is any "
+        << "NaN in the matrix.";
+    } else if (nan_missing || row[j] != missing_value) {
+      inst[j].fvalue = row[j];
     }
   }
-  return total_output_size;
 }
 
-template <typename PredFunc>
-inline size_t PredLoop(const treelite::DenseBatch* batch, size_t num_feature,
-                       size_t rbegin, size_t rend,
-                       float* out_pred, PredFunc func) {
-  const bool nan_missing = treelite::math::CheckNAN(batch->missing_value);
-  CHECK_LE(batch->num_col, num_feature);
-  std::vector<TreelitePredictorEntry> inst(
-    std::max(batch->num_col, num_feature), {-1});
-  CHECK(rbegin < rend && rend <= batch->num_row);
-  CHECK(sizeof(size_t) < sizeof(int64_t)
-     || (rbegin <= static_cast<size_t>(std::numeric_limits<int64_t>::max())
-        && rend <= static_cast<size_t>(std::numeric_limits<int64_t>::max())));
+inline void ClearRow(const treelite::DenseBatch* batch, size_t rid,
+                     TreelitePredictorEntry* inst) {
+  const size_t num_col = batch->num_col;
+  for (size_t j = 0; j < num_col; ++j) {
+    inst[j].missing = -1;
+  }
+}
+
+template <typename BatchType, typename PredFunc>
+inline size_t PredLoop(const BatchType* batch, size_t rbegin, size_t rend,
+                       TreelitePredictorEntry* inst, float* out_pred, PredFunc func) {
   const int64_t rbegin_ = static_cast<int64_t>(rbegin);
   const int64_t rend_ = static_cast<int64_t>(rend);
-  const size_t num_col = batch->num_col;
-  const float missing_value = batch->missing_value;
-  const float* data = batch->data;
-  const float* row;
   size_t total_output_size = 0;
   for (int64_t rid = rbegin_; rid < rend_; ++rid) {
-    row = &data[rid * num_col];
-    for (size_t j = 0; j < num_col; ++j) {
-      if (treelite::math::CheckNAN(row[j])) {
-        CHECK(nan_missing)
-          << "The missing_value argument must be set to NaN if there is any "
-          << "NaN in the matrix.";
-      } else if (nan_missing || row[j] != missing_value) {
-        inst[j].fvalue = row[j];
-      }
+    FillRow(batch, rid, inst);
+    total_output_size += func(rid, inst, out_pred);
+    ClearRow(batch, rid, inst);
+  }
+  return total_output_size;
+}
+
+/*!
+ * \brief Make predictions for the rows [rbegin, rend) in blocks of up to
+ *        [block_rows] rows, with either predict_batch() or the interpreter
+ * \param rows buffer to hold a block of rows, each [stride] entries wide;
+ *             all entries must be marked as missing
+ * \param pred_block function to score a block of rows; takes the rows, the
+ *                   number of rows, the stride and the output buffer, and
+ *                   returns the length of the output for each row
+ */
+template <typename BatchType, typename BlockPredFunc>
+inline size_t PredictBlocks_(const BatchType* batch, size_t num_output_group,
+                             size_t rbegin, size_t rend, size_t block_rows, size_t stride,
+                             TreelitePredictorEntry* rows, float* out_pred,
+                             BlockPredFunc pred_block) {
+  size_t total_output_size = 0;
+  for (size_t bbegin = rbegin; bbegin < rend; bbegin += block_rows) {
+    const size_t bend = std::min(bbegin + block_rows, rend);
+    for (size_t rid = bbegin; rid < bend; ++rid) {
+      FillRow(batch, rid, &rows[(rid - bbegin) * stride]);
     }
-    total_output_size += func(rid, &inst[0], out_pred);
-    for (size_t j = 0; j < num_col; ++j) {
-      inst[j].missing = -1;
+    const size_t query_result_size_per_row
+      = pred_block(rows, bend - bbegin, stride, &out_pred[bbegin * num_output_group]);
+    total_output_size += query_result_size_per_row * (bend - bbegin);
+    for (size_t rid = bbegin; rid < bend; ++rid) {
+      ClearRow(batch, rid, &rows[(rid - bbegin) * stride]);
     }
   }
   return total_output_size;
@@ -152,10 +362,10 @@ inline size_t PredLoop(const treelite::DenseBatch* batch, size_t num_feature,
 
 template <typename BatchType>
 inline size_t PredictBatch_(const BatchType* batch, bool pred_margin,
-                            size_t num_feature, size_t num_output_group,
+                            size_t num_output_group,
                             treelite::Predictor::PredFuncHandle pred_func_handle,
                             size_t rbegin, size_t rend,
-                            size_t expected_query_result_size, float* out_pred) {
+                            TreelitePredictorEntry* inst, float* out_pred) {
   CHECK(pred_func_handle != nullptr)
     << "A shared library needs to be loaded first using Load()";
   /* Pass the correct prediction function to PredLoop.
@@ -169,7 +379,7 @@ inline size_t PredictBatch_(const BatchType* batch, bool pred_margin,
     using PredFunc = size_t (*)(TreelitePredictorEntry*, int, float*);
     PredFunc pred_func = reinterpret_cast<PredFunc>(pred_func_handle);
     query_result_size =
-     PredLoop(batch, num_feature, rbegin, rend, out_pred,
+     PredLoop(batch, rbegin, rend, inst, out_pred,
       [pred_func, num_output_group, pred_margin]
       (int64_t rid, TreelitePredictorEntry* inst, float* out_pred) -> size_t {
         return pred_func(inst, static_cast<int>(pred_margin),
@@ -179,7 +389,7 @@ inline size_t PredictBatch_(const BatchType* batch, bool pred_margin,
     using PredFunc = float (*)(TreelitePredictorEntry*, int);
     PredFunc pred_func = reinterpret_cast<PredFunc>(pred_func_handle);
     query_result_size =
-     PredLoop(batch, num_feature, rbegin, rend, out_pred,
+     PredLoop(batch, rbegin, rend, inst, out_pred,
       [pred_func, pred_margin]
       (int64_t rid, TreelitePredictorEntry* inst, float* out_pred) -> size_t {
         out_pred[rid] = pred_func(inst, static_cast<int>(pred_margin));
@@ -189,6 +399,208 @@ inline size_t PredictBatch_(const BatchType* batch, bool pred_margin,
   return query_result_size;
 }
 
+/*! \brief number of rows to pass to predict_batch() at a time */
+inline size_t BlockRows(BatchContext* ctx, size_t stride) {
+  return std::max(std::min({kMaxBlockRows, ctx->scheduler.ChunkSize(),
+                            kMaxBlockEntries / stride}),
+                  static_cast<size_t>(1));
+}
+
+/*!
+ * \brief Make predictions for the range of rows [rbegin, rend) already claimed
+ *        with predict_chunk, then keep claiming chunks of rows from the
+ *        scheduler and making predictions for them, until every row has been
+ *        claimed.
+ */
+template <typename PredictChunkFunc>
+inline void ForEachChunk_(BatchContext* ctx, int worker_id, size_t rbegin, size_t rend,
+                          PredictChunkFunc predict_chunk) {
+  do {
+    size_t query_result_size = 0;
+    if (!ctx->failed.load(std::memory_order_relaxed)) {
+      const auto chunk_start = std::chrono::steady_clock::now();
+      try {
+        query_result_size = predict_chunk(rbegin, rend);
+      } catch (...) {
+        ctx->Fail(std::current_exception());
+      }
+      // recorded before Complete(), so that the thread finishing the batch
+      // sees the work of every thread
+      ctx->work_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - chunk_start).count());
+    }
+    ctx->Complete(rend - rbegin, query_result_size);
+  } while (ctx->scheduler.Next(worker_id, &rbegin, &rend));
+}
+
+template <typename BatchType>
+inline void PredictBatchChunks_(BatchContext* ctx, const BatchType* batch, int worker_id) {
+  size_t rbegin, rend;
+  if (!ctx->scheduler.Next(worker_id, &rbegin, &rend)) {
+    return;
+  }
+  const size_t stride = std::max(batch->num_col, ctx->num_feature);
+  const treelite::Interpreter* interpreter = ctx->interpreter;
+  const bool use_blocks = (interpreter != nullptr || ctx->batch_pred_func_handle != nullptr);
+  // with predict_batch() or the interpreter, the buffer holds a block of rows
+  // instead of one
+  const size_t block_rows = use_blocks ? BlockRows(ctx, stride) : 1;
+  // allocated and first touched by the thread that uses it, so that the
+  // buffer of a bound worker thread resides on the NUMA node of its CPU
+  std::vector<TreelitePredictorEntry> inst(block_rows * stride, {-1});
+  ForEachChunk_(ctx, worker_id, rbegin, rend,
+    [ctx, batch, interpreter, use_blocks, block_rows, stride, &inst]
+    (size_t rbegin, size_t rend) {
+      const bool pred_margin = ctx->pred_margin;
+      if (interpreter != nullptr) {
+        return PredictBlocks_(batch, ctx->num_output_group, rbegin, rend, block_rows,
+                              stride, &inst[0], ctx->out_pred,
+          [interpreter, pred_margin]
+          (TreelitePredictorEntry* rows, size_t num_row, size_t row_stride, float* out) {
+            return interpreter->PredictBatch(rows, num_row, row_stride, pred_margin, out);
+          });
+      } else if (use_blocks) {
+        using BatchPredFunc = size_t (*)(TreelitePredictorEntry*, size_t, size_t, int, float*);
+        BatchPredFunc pred_func = reinterpret_cast<BatchPredFunc>(ctx->batch_pred_func_handle);
+        return PredictBlocks_(batch, ctx->num_output_group, rbegin, rend, block_rows,
+                              stride, &inst[0], ctx->out_pred,
+          [pred_func, pred_margin]
+          (TreelitePredictorEntry* rows, size_t num_row, size_t row_stride, float* out) {
+            return pred_func(rows, num_row, row_stride, static_cast<int>(pred_margin), out);
+          });
+      } else {
+        return PredictBatch_(batch, ctx->pred_margin, ctx->num_output_group,
+                             ctx->pred_func_handle, rbegin, rend, &inst[0], ctx->out_pred);
+      }
+    });
+}
+
+/*!
+ * \brief Variant of PredictBatchChunks_() for dense batches, which passes the
+ *        rows of the matrix to predict_batch_dense() (or the interpreter)
+ *        without copying them.
+ * \param pred_block function to score a block of rows; takes the rows, the
+ *                   number of rows, the stride, the missing value and the
+ *                   output buffer, and returns the length of the output for
+ *                   each row
+ */
+template <typename DensePredFunc>
+inline void PredictDenseChunks_(BatchContext* ctx, const treelite::DenseBatch* batch,
+                                int worker_id, DensePredFunc pred_block) {
+  size_t rbegin, rend;
+  if (!ctx->scheduler.Next(worker_id, &rbegin, &rend)) {
+    return;
+  }
+  const size_t num_col = batch->num_col;
+  const size_t block_rows = BlockRows(ctx, num_col);
+  const bool nan_missing = treelite::math::CheckNAN(batch->missing_value);
+  ForEachChunk_(ctx, worker_id, rbegin, rend,
+    [ctx, batch, &pred_block, num_col, block_rows, nan_missing](size_t rbegin, size_t rend) {
+      size_t total_output_size = 0;
+      for (size_t bbegin = rbegin; bbegin < rend; bbegin += block_rows) {
+        const size_t bend = std::min(bbegin + block_rows, rend);
+        const float* rows = &batch->data[bbegin * num_col];
+        if (!nan_missing) {
+          for (size_t i = 0; i < (bend - bbegin) * num_col; ++i) {
+            CHECK(!treelite::math::CheckNAN(rows[i]))
+              << "The missing_value argument must be set to NaN if there is any "
+              << "NaN in the matrix.";
+          }
+        }
+        const size_t query_result_size_per_row
+          = pred_block(rows, bend - bbegin, num_col, batch->missing_value,
+                       &ctx->out_pred[bbegin * ctx->num_output_group]);
+        total_output_size += query_result_size_per_row * (bend - bbegin);
+      }
+      return total_output_size;
+    });
+}
+
+/*!
+ * \brief Variant of PredictBatchChunks_() for quantized batches. Each chunk is
+ *        passed to predict_batch_quantized() in one call, since the function
+ *        widens the bins block by block by itself.
+ */
+inline void PredictQuantizedChunks_(BatchContext* ctx, const treelite::QuantizedBatch* batch,
+                                    int worker_id) {
+  size_t rbegin, rend;
+  if (!ctx->scheduler.Next(worker_id, &rbegin, &rend)) {
+    return;
+  }
+  using QuantizedPredFunc = size_t (*)(const void*, size_t, size_t, int, float*);
+  QuantizedPredFunc pred_func
+    = reinterpret_cast<QuantizedPredFunc>(ctx->quantized_batch_pred_func_handle);
+  const uint8_t* data = static_cast<const uint8_t*>(batch->data);
+  ForEachChunk_(ctx, worker_id, rbegin, rend,
+    [ctx, batch, pred_func, data](size_t rbegin, size_t rend) {
+      const size_t query_result_size_per_row
+        = pred_func(&data[rbegin * batch->num_col * batch->bin_size], rend - rbegin,
+                    batch->num_col, static_cast<int>(ctx->pred_margin),
+                    &ctx->out_pred[rbegin * ctx->num_output_group]);
+      return query_result_size_per_row * (rend - rbegin);
+    });
+}
+
+inline void SetBatch(BatchContext* ctx, const treelite::CSRBatch* batch) {
+  ctx->input_type = InputType::kSparseBatch;
+  ctx->sparse_batch = *batch;
+}
+
+inline void SetBatch(BatchContext* ctx, const treelite::DenseBatch* batch) {
+  ctx->input_type = InputType::kDenseBatch;
+  ctx->dense_batch = *batch;
+}
+
+inline void SetBatch(BatchContext* ctx, const treelite::QuantizedBatch* batch) {
+  ctx->input_type = InputType::kQuantizedBatch;
+  ctx->quantized_batch = *batch;
+}
+
+inline void RunTask(const InputToken& input) {
+  if (input.inst_context) {
+    input.inst_context->Run();
+    return;
+  }
+  BatchContext* ctx = input.context.get();
+  switch (ctx->input_type) {
+   case InputType::kSparseBatch:
+    PredictBatchChunks_(ctx, &ctx->sparse_batch, input.worker_id);
+    break;
+   case InputType::kDenseBatch:
+    // predict_batch_dense() and the interpreter expect rows with as many
+    // columns as the model has features
+    if (ctx->dense_batch.num_col != ctx->num_feature) {
+      PredictBatchChunks_(ctx, &ctx->dense_batch, input.worker_id);
+    } else if (ctx->interpreter != nullptr) {
+      const treelite::Interpreter* interpreter = ctx->interpreter;
+      const bool pred_margin = ctx->pred_margin;
+      PredictDenseChunks_(ctx, &ctx->dense_batch, input.worker_id,
+        [interpreter, pred_margin]
+        (const float* rows, size_t num_row, size_t stride, float missing_value, float* out) {
+          return interpreter->PredictBatchDense(rows, num_row, stride, missing_value,
+                                                pred_margin, out);
+        });
+    } else if (ctx->dense_batch_pred_func_handle != nullptr) {
+      using DensePredFunc = size_t (*)(const float*, size_t, size_t, float, int, float*);
+      DensePredFunc pred_func
+        = reinterpret_cast<DensePredFunc>(ctx->dense_batch_pred_func_handle);
+      const bool pred_margin = ctx->pred_margin;
+      PredictDenseChunks_(ctx, &ctx->dense_batch, input.worker_id,
+        [pred_func, pred_margin]
+        (const float* rows, size_t num_row, size_t stride, float missing_value, float* out) {
+          return pred_func(rows, num_row, stride, missing_value,
+                           static_cast<int>(pred_margin), out);
+        });
+    } else {
+      PredictBatchChunks_(ctx, &ctx->dense_batch, input.worker_id);
+    }
+    break;
+   case InputType::kQuantizedBatch:
+    PredictQuantizedChunks_(ctx, &ctx->quantized_batch, input.worker_id);
+    break;
+  }
+}
+
 inline size_t PredictInst_(TreelitePredictorEntry* inst,
                            bool pred_margin, size_t num_output_group,
                            treelite::Predictor::PredFuncHandle pred_func_handle,
@@ -209,27 +621,91 @@ inline size_t PredictInst_(TreelitePredictorEntry* inst,
   return query_result_size;
 }
 
+/*!
+ * \brief choose the CPUs on which the worker threads run
+ * \return list of CPUs; the first CPU is meant for the calling thread
+ */
+inline std::vector<int> ChooseCPUs(const treelite::PredictorParam& param) {
+  namespace topology = treelite::cpu_topology;
+  std::vector<int> cpus
+    = param.cpu_list.empty() ? topology::GroupByNUMANode(topology::GetAllowedCPUs())
+                             : topology::ParseCPUList(param.cpu_list);
+  CHECK(!cpus.empty()) << "cpu_list must contain at least one CPU";
+  if (param.numa_node >= 0) {
+    const std::vector<int> node_cpus = topology::GetNUMANodeCPUs(param.numa_node);
+    cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&node_cpus](int cpu) {
+                 return std::find(node_cpus.begin(), node_cpus.end(), cpu) == node_cpus.end();
+               }), cpus.end());
+    CHECK(!cpus.empty()) << "None of the CPUs available belong to NUMA node "
+                         << param.numa_node;
+  }
+  return cpus;
+}
+
+/*!
+ * \brief choose the number of threads (including the calling thread) among
+ *        which batch predictions are divided
+ * \param num_worker_thread number of threads requested, or -1 to choose it
+ *                          from the CPUs available
+ * \param cpus CPUs on which the threads run; see ChooseCPUs()
+ */
+inline int ChooseNumWorkerThread(int num_worker_thread, const std::vector<int>& cpus) {
+  // no more threads than can run at once, so that they do not get throttled
+  // in a container
+  const int max_num_thread = treelite::cpu_topology::GetMaxConcurrency(cpus);
+  if (num_worker_thread == -1) {
+    return max_num_thread;
+  }
+  CHECK(num_worker_thread >= 1 && num_worker_thread <= max_num_thread)
+    << "Number of worker threads must be between 1 and " << max_num_thread
+    << ", the number of CPUs available to the process";
+  return num_worker_thread;
+}
+
 }  // anonymous namespace
 
 namespace treelite {
 
-Predictor::Predictor(int num_worker_thread)
+// register predictor parameter
+DMLC_REGISTER_PARAMETER(PredictorParam);
+
+Predictor::Predictor(int num_worker_thread,
+                     const std::vector<std::pair<std::string, std::string>>& params)
                        : lib_handle_(nullptr),
                          num_output_group_query_func_handle_(nullptr),
                          num_feature_query_func_handle_(nullptr),
                          pred_func_handle_(nullptr),
+                         batch_pred_func_handle_(nullptr),
+                         dense_batch_pred_func_handle_(nullptr),
+                         quantized_batch_pred_func_handle_(nullptr),
+                         bin_size_query_func_handle_(nullptr),
+                         cut_points_query_func_handle_(nullptr),
+                         unit_pred_func_handle_(nullptr),
+                         preprocess_func_handle_(nullptr),
+                         postprocess_func_handle_(nullptr),
+                         num_unit_(0),
                          thread_pool_handle_(nullptr),
-                         num_worker_thread_(num_worker_thread) {}
+                         num_worker_thread_(num_worker_thread),
+                         auto_num_worker_thread_(num_worker_thread == -1),
+                         batch_planner_(std::make_shared<BatchPlanner>()) {
+  param_.Init(cfg_, dmlc::parameter::kAllMatch);
+  ConfigureMicroBatcher_();
+  for (const auto& kv : params) {
+    SetParam(kv.first, kv.second);
+  }
+}
 Predictor::~Predictor() {
   Free();
 }
 
 void
 Predictor::Load(const char* name) {
+  Free();
   lib_handle_ = OpenLibrary(name);
   if (lib_handle_ == nullptr) {
     LOG(FATAL) << "Failed to load dynamic shared library `" << name << "'";
   }
+  batch_planner_->Reset();  // the cost of a row differs from model to model
 
   /* 1. query # of output groups */
   num_output_group_query_func_handle_
@@ -310,154 +786,329 @@ Predictor::Load(const char* name) {
       << "Dynamic shared library `" << name
       << "' does not contain valid predict() function";
   }
-
-  if (num_worker_thread_ == -1) {
-    num_worker_thread_ = std::thread::hardware_concurrency();
+  /* 7. load the function for scoring a block of rows at once, if available */
+  batch_pred_func_handle_ = LoadFunction<PredFuncHandle>(lib_handle_, "predict_batch");
+  /* 8. load the function for reading dense rows directly, if available */
+  dense_batch_pred_func_handle_
+    = LoadFunction<PredFuncHandle>(lib_handle_, "predict_batch_dense");
+  /* 9. load the functions for pre-quantized input, if available */
+  quantized_batch_pred_func_handle_
+    = LoadFunction<PredFuncHandle>(lib_handle_, "predict_batch_quantized");
+  bin_size_query_func_handle_ = LoadFunction<QueryFuncHandle>(lib_handle_, "get_bin_size");
+  cut_points_query_func_handle_ = LoadFunction<QueryFuncHandle>(lib_handle_, "get_cut_points");
+  /* 10. load the functions for scoring translation units separately, if available */
+  auto num_unit_query_func = reinterpret_cast<UnsignedQueryFunc>(
+    LoadFunction<QueryFuncHandle>(lib_handle_, "get_num_unit"));
+  unit_pred_func_handle_ = LoadFunction<PredFuncHandle>(lib_handle_, "predict_margin_unit");
+  preprocess_func_handle_ = LoadFunction<PredFuncHandle>(lib_handle_, "preprocess_batch");
+  postprocess_func_handle_ = LoadFunction<PredFuncHandle>(lib_handle_, "postprocess_batch");
+  if (num_unit_query_func != nullptr && unit_pred_func_handle_ != nullptr
+      && preprocess_func_handle_ != nullptr && postprocess_func_handle_ != nullptr) {
+    num_unit_ = num_unit_query_func();
+  } else {
+    num_unit_ = 0;
   }
+
+  StartThreadPool_(ChooseCPUs(param_));
+}
+
+void
+Predictor::LoadModel(const Model& model) {
+  Free();
+  interpreter_.reset(new Interpreter(model));
+  batch_planner_->Reset();  // the cost of a row differs from model to model
+  num_output_group_ = interpreter_->NumOutputGroup();
+  num_feature_ = interpreter_->NumFeature();
+  pred_transform_ = interpreter_->PredTransform();
+  sigmoid_alpha_ = interpreter_->SigmoidAlpha();
+  global_bias_ = interpreter_->GlobalBias();
+  StartThreadPool_(ChooseCPUs(param_));
+}
+
+void
+Predictor::LoadModelFile(const char* path) {
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(path, "r"));
+  Model model;
+  model.ReferenceDeserialize(fi.get());
+  LoadModel(model);
+}
+
+void
+Predictor::StartThreadPool_(const std::vector<int>& cpus) {
+  const int num_worker_thread
+    = ChooseNumWorkerThread(auto_num_worker_thread_ ? -1 : num_worker_thread_, cpus);
+  // bind the threads only when asked to place them on particular CPUs;
+  // otherwise, the OS is free to move them around
+  const bool bind = !param_.cpu_list.empty() || param_.numa_node >= 0;
+  delete static_cast<PredThreadPool*>(thread_pool_handle_);
+  thread_pool_handle_ = nullptr;
+  num_worker_thread_ = num_worker_thread;
   thread_pool_handle_ = static_cast<ThreadPoolHandle>(
       new PredThreadPool(num_worker_thread_ - 1, this,
-                         [](SpscQueue<InputToken>* incoming_queue,
-                            SpscQueue<OutputToken>* outgoing_queue,
-                            const Predictor* predictor) {
-      InputToken input;
-      while (incoming_queue->Pop(&input)) {
-        size_t query_result_size;
-        const size_t rbegin = input.rbegin;
-        const size_t rend = input.rend;
-        switch (input.input_type) {
-         case InputType::kSparseBatch:
-          {
-            const CSRBatch* batch = static_cast<const CSRBatch*>(input.data);
-            query_result_size
-              = PredictBatch_(batch, input.pred_margin, input.num_feature,
-                              input.num_output_group, input.pred_func_handle,
-                              rbegin, rend,
-                              predictor->QueryResultSize(batch, rbegin, rend),
-                              input.out_pred);
-          }
-          break;
-         case InputType::kDenseBatch:
-          {
-            const DenseBatch* batch = static_cast<const DenseBatch*>(input.data);
-            query_result_size
-              = PredictBatch_(batch, input.pred_margin, input.num_feature,
-                              input.num_output_group, input.pred_func_handle,
-                              rbegin, rend,
-                              predictor->QueryResultSize(batch, rbegin, rend),
-                              input.out_pred);
-          }
-          break;
-        }
-        outgoing_queue->Push(OutputToken{query_result_size});
-      }
-    }));
+                         [](const InputToken& input, const Predictor* predictor) {
+                           RunTask(input);
+                         }, bind ? cpus : std::vector<int>(), WaitConfig(param_)));
 }
 
 void
 Predictor::Free() {
-  CloseLibrary(lib_handle_);
+  // stop the workers before unloading the prediction function they may call
   delete static_cast<PredThreadPool*>(thread_pool_handle_);
+  thread_pool_handle_ = nullptr;
+  if (lib_handle_ != nullptr) {
+    CloseLibrary(lib_handle_);
+    lib_handle_ = nullptr;
+  }
+  pred_func_handle_ = nullptr;
+  batch_pred_func_handle_ = nullptr;
+  dense_batch_pred_func_handle_ = nullptr;
+  quantized_batch_pred_func_handle_ = nullptr;
+  bin_size_query_func_handle_ = nullptr;
+  cut_points_query_func_handle_ = nullptr;
+  unit_pred_func_handle_ = nullptr;
+  preprocess_func_handle_ = nullptr;
+  postprocess_func_handle_ = nullptr;
+  num_unit_ = 0;
+  interpreter_.reset();
 }
 
-template <typename BatchType>
-static inline
-std::vector<size_t> SplitBatch(const BatchType* batch, size_t split_factor) {
-  const size_t num_row = batch->num_row;
-  CHECK_LE(split_factor, num_row);
-  const size_t portion = num_row / split_factor;
-  const size_t remainder = num_row % split_factor;
-  std::vector<size_t> workload(split_factor, portion);
-  std::vector<size_t> row_ptr(split_factor + 1, 0);
-  for (size_t i = 0; i < remainder; ++i) {
-    ++workload[i];
+void
+Predictor::SetParam(const std::string& name, const std::string& value) {
+  std::vector<std::pair<std::string, std::string>> cfg = cfg_;
+  auto it = std::find_if(cfg.begin(), cfg.end(),
+                         [&name](const std::pair<std::string, std::string>& e) {
+                           return e.first == name;
+                         });
+  if (it != cfg.end()) {
+    it->second = value;
+  } else {
+    cfg.emplace_back(name, value);
+  }
+  // validate the new configuration before committing to it
+  PredictorParam param;
+  param.Init(cfg, dmlc::parameter::kAllMatch);
+  // the placement of the worker threads and the way they wait for tasks are
+  // fixed when they start, so restart them if either changes
+  const bool restart_pool
+    = thread_pool_handle_ != nullptr
+      && (param.cpu_list != param_.cpu_list || param.numa_node != param_.numa_node
+          || param.wait_policy != param_.wait_policy || param.spin_count != param_.spin_count);
+  std::vector<int> cpus;
+  if (restart_pool) {
+    cpus = ChooseCPUs(param);
+    // fewer CPUs may be left than there are worker threads
+    ChooseNumWorkerThread(auto_num_worker_thread_ ? -1 : num_worker_thread_, cpus);
+  }
+  param_ = param;
+  cfg_ = std::move(cfg);
+  ConfigureMicroBatcher_();
+  if (restart_pool) {
+    StartThreadPool_(cpus);
   }
-  size_t accum = 0;
-  for (size_t i = 0; i < split_factor; ++i) {
-    accum += workload[i];
-    row_ptr[i + 1] = accum;
+}
+
+void
+Predictor::ConfigureMicroBatcher_() {
+  if (param_.microbatch_max_rows <= 1) {
+    micro_batcher_.reset();
+    return;
   }
-  return row_ptr;
+  micro_batcher_.reset(new MicroBatcher(
+    static_cast<size_t>(param_.microbatch_max_rows),
+    std::chrono::microseconds(param_.microbatch_timeout_us),
+    [this](bool pred_margin, const std::vector<MicroBatcher::Request*>& requests) {
+      // Assemble the rows into a sparse batch, so that the batch path sees
+      // exactly the same set of missing values as PredictInst_() would
+      const size_t num_row = requests.size();
+      std::vector<float> data;
+      std::vector<uint32_t> col_ind;
+      std::vector<size_t> row_ptr{0};
+      for (const MicroBatcher::Request* req : requests) {
+        for (size_t j = 0; j < num_feature_; ++j) {
+          if (req->inst[j].missing != -1) {
+            data.push_back(req->inst[j].fvalue);
+            col_ind.push_back(static_cast<uint32_t>(j));
+          }
+        }
+        row_ptr.push_back(data.size());
+      }
+      const CSRBatch batch{data.data(), col_ind.data(), row_ptr.data(),
+                           num_row, num_feature_};
+      std::vector<float> out_result(num_row * num_output_group_);
+      const size_t total_size = PredictBatch(&batch, 0, pred_margin, out_result.data());
+      const size_t result_size_per_row = total_size / num_row;
+      for (size_t i = 0; i < num_row; ++i) {
+        std::copy(&out_result[i * result_size_per_row],
+                  &out_result[(i + 1) * result_size_per_row],
+                  requests[i]->out_result);
+        requests[i]->result_size = result_size_per_row;
+      }
+    }));
+}
+
+int
+Predictor::PlanBatch(size_t num_row) const {
+  const int max_thread = static_cast<int>(
+    std::min(static_cast<size_t>(std::max(num_worker_thread_, 1)), num_row));
+  return batch_planner_->Plan(num_row, max_thread, param_.row_cost_ns,
+                              param_.min_work_per_thread_us * 1000.0);
 }
 
 template <typename BatchType>
-inline size_t
+inline std::shared_ptr<BatchContext>
 Predictor::PredictBatchBase_(const BatchType* batch, int verbose,
-                             bool pred_margin, float* out_result) {
+                             bool pred_margin, float* out_result,
+                             PredictionCallback callback, bool async) {
   static_assert(std::is_same<BatchType, DenseBatch>::value
-                || std::is_same<BatchType, CSRBatch>::value,
+                || std::is_same<BatchType, CSRBatch>::value
+                || std::is_same<BatchType, QuantizedBatch>::value,
                 "PredictBatchBase_: unrecognized batch type");
   const double tstart = dmlc::GetTime();
   PredThreadPool* pool = static_cast<PredThreadPool*>(thread_pool_handle_);
-  const InputType input_type
-    = std::is_same<BatchType, CSRBatch>::value
-      ? InputType::kSparseBatch : InputType::kDenseBatch;
-  InputToken request{input_type, static_cast<const void*>(batch), pred_margin,
-                     num_feature_, num_output_group_, pred_func_handle_,
-                     0, batch->num_row, out_result};
-  OutputToken response;
+  CHECK(pool != nullptr)
+    << "A model needs to be loaded first using Load() or LoadModel()";
   CHECK_GT(batch->num_row, 0);
-  const int nthread = std::min(num_worker_thread_,
-                               static_cast<int>(batch->num_row));
-  const std::vector<size_t> row_ptr = SplitBatch(batch, nthread);
-  for (int tid = 0; tid < nthread - 1; ++tid) {
-    request.rbegin = row_ptr[tid];
-    request.rend = row_ptr[tid + 1];
-    pool->SubmitTask(tid, request);
-  }
-  size_t total_size = 0;
-  {
-    // assign work to master
-    const size_t rbegin = row_ptr[nthread - 1];
-    const size_t rend = row_ptr[nthread];
-    const size_t query_result_size
-      = PredictBatch_(batch, pred_margin, num_feature_, num_output_group_,
-                      pred_func_handle_,
-                      rbegin, rend, QueryResultSize(batch, rbegin, rend),
-                      out_result);
-    total_size += query_result_size;
-  }
-  for (int tid = 0; tid < nthread - 1; ++tid) {
-    if (pool->WaitForTask(tid, &response)) {
-      total_size += response.query_result_size;
-    }
+  CHECK_LE(batch->num_col, num_feature_);
+  CHECK(sizeof(size_t) < sizeof(int64_t)
+     || batch->num_row <= static_cast<size_t>(std::numeric_limits<int64_t>::max()));
+  // In synchronous mode, the calling thread participates as the last worker.
+  // In asynchronous mode, the calling thread returns right away, unless there
+  // is no worker thread to hand off the work to. A batch too small to be worth
+  // waking up worker threads for is scored on the calling thread alone.
+  const int num_thread = PlanBatch(batch->num_row);
+  const bool caller_participates = !async || num_worker_thread_ == 1;
+  const int num_task = caller_participates ? num_thread
+                                           : std::min(num_thread, num_worker_thread_ - 1);
+  if (verbose > 0) {
+    LOG(INFO) << "Treelite: Scoring " << batch->num_row << " rows with " << num_task
+              << (caller_participates ? " thread(s), including the calling thread"
+                                      : " worker thread(s)");
   }
-  // re-shape output if total_size < dimension of out_result
-  if (total_size < QueryResultSize(batch, 0, batch->num_row)) {
-    CHECK_GT(num_output_group_, 1);
-    CHECK_EQ(total_size % batch->num_row, 0);
-    const size_t query_size_per_instance = total_size / batch->num_row;
-    CHECK_GT(query_size_per_instance, 0);
-    CHECK_LT(query_size_per_instance, num_output_group_);
-    for (size_t rid = 0; rid < batch->num_row; ++rid) {
-      for (size_t k = 0; k < query_size_per_instance; ++k) {
-        out_result[rid * query_size_per_instance + k]
-          = out_result[rid * num_output_group_ + k];
-      }
-    }
+  std::shared_ptr<BatchContext> ctx = std::make_shared<BatchContext>(
+    batch->num_row, num_task, static_cast<size_t>(param_.chunk_size));
+  SetBatch(ctx.get(), batch);
+  ctx->pred_margin = pred_margin;
+  ctx->num_feature = num_feature_;
+  ctx->num_output_group = num_output_group_;
+  ctx->pred_func_handle = pred_func_handle_;
+  ctx->batch_pred_func_handle = batch_pred_func_handle_;
+  ctx->dense_batch_pred_func_handle = dense_batch_pred_func_handle_;
+  ctx->quantized_batch_pred_func_handle = quantized_batch_pred_func_handle_;
+  ctx->interpreter = interpreter_.get();
+  ctx->out_pred = out_result;
+  ctx->verbose = verbose;
+  ctx->tstart = tstart;
+  ctx->callback = std::move(callback);
+  ctx->wait = WaitConfig(param_);
+  ctx->planner = batch_planner_;
+  const int num_pool_task = caller_participates ? num_task - 1 : num_task;
+  for (int tid = 0; tid < num_pool_task; ++tid) {
+    pool->SubmitTask(InputToken{ctx, tid});
   }
-  const double tend = dmlc::GetTime();
-  if (verbose > 0) {
-    LOG(INFO) << "Treelite: Finished prediction in "
-              << tend - tstart << " sec";
+  if (caller_participates) {
+    RunTask(InputToken{ctx, num_task - 1});
   }
-  return total_size;
+  return ctx;
 }
 
 size_t
 Predictor::PredictBatch(const CSRBatch* batch, int verbose,
                         bool pred_margin, float* out_result) {
-  return PredictBatchBase_(batch, verbose, pred_margin, out_result);
+  return PredictBatchBase_(batch, verbose, pred_margin, out_result,
+                           nullptr, false)->Wait();
 }
 
 size_t
 Predictor::PredictBatch(const DenseBatch* batch, int verbose,
                         bool pred_margin, float* out_result) {
-  return PredictBatchBase_(batch, verbose, pred_margin, out_result);
+  return PredictBatchBase_(batch, verbose, pred_margin, out_result,
+                           nullptr, false)->Wait();
+}
+
+size_t
+Predictor::PredictBatch(const QuantizedBatch* batch, int verbose,
+                        bool pred_margin, float* out_result) {
+  CheckQuantizedBatch_(batch);
+  return PredictBatchBase_(batch, verbose, pred_margin, out_result,
+                           nullptr, false)->Wait();
+}
+
+PredictionFuture
+Predictor::PredictBatchAsync(const CSRBatch* batch, int verbose,
+                             bool pred_margin, float* out_result,
+                             PredictionCallback callback) {
+  return PredictionFuture(PredictBatchBase_(batch, verbose, pred_margin, out_result,
+                                            std::move(callback), true));
+}
+
+PredictionFuture
+Predictor::PredictBatchAsync(const DenseBatch* batch, int verbose,
+                             bool pred_margin, float* out_result,
+                             PredictionCallback callback) {
+  return PredictionFuture(PredictBatchBase_(batch, verbose, pred_margin, out_result,
+                                            std::move(callback), true));
+}
+
+PredictionFuture
+Predictor::PredictBatchAsync(const QuantizedBatch* batch, int verbose,
+                             bool pred_margin, float* out_result,
+                             PredictionCallback callback) {
+  CheckQuantizedBatch_(batch);
+  return PredictionFuture(PredictBatchBase_(batch, verbose, pred_margin, out_result,
+                                            std::move(callback), true));
+}
+
+void
+Predictor::CheckQuantizedBatch_(const QuantizedBatch* batch) const {
+  CHECK(IsLoaded_())
+    << "A model needs to be loaded first using Load() or LoadModel()";
+  CHECK(quantized_batch_pred_func_handle_ != nullptr)
+    << "Pre-quantized input requires a library compiled with the parameter quantize=1";
+  CHECK_EQ(batch->bin_size, QueryBinSize())
+    << "Width of bins does not match the one expected by the library";
+  CHECK_EQ(batch->num_col, num_feature_)
+    << "A quantized batch must have as many columns as the model has features";
+}
+
+size_t
+Predictor::QueryBinSize() const {
+  if (bin_size_query_func_handle_ == nullptr) {
+    return 0;
+  }
+  using UnsignedQueryFunc = size_t (*)(void);
+  return reinterpret_cast<UnsignedQueryFunc>(bin_size_query_func_handle_)();
+}
+
+std::vector<float>
+Predictor::QueryCutPoints(unsigned fid) const {
+  if (cut_points_query_func_handle_ == nullptr) {
+    return {};
+  }
+  using CutPointsQueryFunc = size_t (*)(unsigned, const float**);
+  const float* cut_pts = nullptr;
+  const size_t len
+    = reinterpret_cast<CutPointsQueryFunc>(cut_points_query_func_handle_)(fid, &cut_pts);
+  return std::vector<float>(cut_pts, cut_pts + len);
 }
 
 size_t
 Predictor::PredictInst(TreelitePredictorEntry* inst, bool pred_margin,
                        float* out_result) {
+  if (micro_batcher_) {
+    CHECK(IsLoaded_())
+      << "A model needs to be loaded first using Load() or LoadModel()";
+    return micro_batcher_->Submit(inst, pred_margin, out_result);
+  }
+  const size_t num_thread
+    = std::min(static_cast<size_t>(param_.inst_num_thread == 0 ? num_worker_thread_
+                                                                : param_.inst_num_thread),
+               num_unit_);
+  if (num_thread > 1 && thread_pool_handle_ != nullptr) {
+    return PredictInstParallel_(inst, pred_margin, out_result, num_thread);
+  }
+  if (interpreter_) {
+    return interpreter_->PredictBatch(inst, 1, num_feature_, pred_margin, out_result);
+  }
   size_t total_size;
   total_size = PredictInst_(inst, pred_margin, num_output_group_,
                             pred_func_handle_,
@@ -465,4 +1116,46 @@ Predictor::PredictInst(TreelitePredictorEntry* inst, bool pred_margin,
   return total_size;
 }
 
+size_t
+Predictor::PredictInstParallel_(TreelitePredictorEntry* inst, bool pred_margin,
+                                float* out_result, size_t num_thread) {
+  PredThreadPool* pool = static_cast<PredThreadPool*>(thread_pool_handle_);
+  using PreprocessFunc = void (*)(TreelitePredictorEntry*, size_t, size_t);
+  using PostprocessFunc = size_t (*)(size_t, int, float*);
+  // the context scores a copy of the row, so that the row of the caller is
+  // left intact when the copy is quantized in place
+  std::shared_ptr<InstContext> ctx = std::make_shared<InstContext>(
+    inst, num_feature_, num_output_group_,
+    reinterpret_cast<InstContext::UnitPredFunc>(unit_pred_func_handle_), num_unit_,
+    WaitConfig(param_));
+  reinterpret_cast<PreprocessFunc>(preprocess_func_handle_)(ctx->inst.data(), 1, num_feature_);
+  for (size_t i = 1; i < num_thread; ++i) {
+    pool->SubmitTask(InputToken{nullptr, 0, ctx});
+  }
+  ctx->Run();
+  ctx->Wait();
+  // add up the partial scores in the order of translation units, so that the
+  // result does not depend on which thread scored which unit
+  std::fill(out_result, out_result + num_output_group_, 0.0f);
+  for (size_t unit_id = 0; unit_id < num_unit_; ++unit_id) {
+    for (size_t k = 0; k < num_output_group_; ++k) {
+      out_result[k] += ctx->unit_out[unit_id * num_output_group_ + k];
+    }
+  }
+  return reinterpret_cast<PostprocessFunc>(postprocess_func_handle_)(
+    1, static_cast<int>(pred_margin), out_result);
+}
+
+bool
+PredictionFuture::IsReady() const {
+  CHECK(context_ != nullptr) << "PredictionFuture does not refer to any prediction";
+  return context_->done.IsSet();
+}
+
+size_t
+PredictionFuture::Wait() const {
+  CHECK(context_ != nullptr) << "PredictionFuture does not refer to any prediction";
+  return context_->Wait();
+}
+
 }  // namespace treelite
@@ -0,0 +1,257 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file simd_traversal.cc
+ * \author Hyunsu Cho
+ * \brief Kernels that advance 8 (AVX2) or 16 (AVX-512) rows through a tree in
+ *        lockstep, using gathers and masked compares. The instruction set is
+ *        chosen at runtime.
+ */
+
+#include <dmlc/logging.h>
+#include <limits>
+#include "./simd_traversal.h"
+
+/*
+ * The kernels are compiled with function-level target attributes, so that the
+ * rest of the library keeps running on CPUs without AVX2.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TREELITE_SIMD_X86
+#define TREELITE_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define TREELITE_SIMD_X86
+#define TREELITE_TARGET(isa)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+using treelite::simd::Level;
+using treelite::simd::RowBlock;
+namespace layout = treelite::simd::node_layout;
+
+#ifdef TREELITE_SIMD_X86
+
+Level DetectLevelUncached() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return Level::kScalar;
+  }
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!osxsave) {
+    return Level::kScalar;
+  }
+  // the OS must save the YMM (and ZMM) registers on context switches
+  const uint64_t xcr0 = _xgetbv(0);
+  __cpuidex(info, 7, 0);
+  const bool avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+  const bool avx512f = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+#else
+  __builtin_cpu_init();
+  const bool avx2 = __builtin_cpu_supports("avx2");
+  const bool avx512f = __builtin_cpu_supports("avx512f");
+#endif
+  if (avx512f) {
+    return Level::kAVX512;
+  } else if (avx2) {
+    return Level::kAVX2;
+  }
+  return Level::kScalar;
+}
+
+TREELITE_TARGET("avx2")
+size_t TraverseAVX2(const uint32_t* tree, const RowBlock& block, size_t num_row,
+                    uint32_t* leaf) {
+  constexpr size_t kWidth = 8;
+  if (block.stride > static_cast<size_t>(std::numeric_limits<int32_t>::max()) / kWidth) {
+    return 0;
+  }
+  const int* nodes = reinterpret_cast<const int*>(tree);
+  const int stride = static_cast<int>(block.stride);
+  const __m256i lane_offset = _mm256_setr_epi32(0, stride, 2 * stride, 3 * stride,
+                                                4 * stride, 5 * stride, 6 * stride, 7 * stride);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i all_ones = _mm256_set1_epi32(-1);
+  const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+  const __m256i fid_mask = _mm256_set1_epi32(0x7FFFFFFF);
+  const __m256i op_lt = _mm256_set1_epi32(layout::kOpLT);
+  const __m256i op_le = _mm256_set1_epi32(layout::kOpLE);
+  const __m256i op_gt = _mm256_set1_epi32(layout::kOpGT);
+  const __m256i op_ge = _mm256_set1_epi32(layout::kOpGE);
+  const __m256i op_eq = _mm256_set1_epi32(layout::kOpEQ);
+  const __m256i op_true = _mm256_set1_epi32(layout::kOpTrue);
+  const __m256 missing_value = _mm256_set1_ps(block.missing_value);
+
+  size_t rid = 0;
+  for (; rid + kWidth <= num_row; rid += kWidth) {
+    const float* rows = static_cast<const float*>(block.rows) + rid * block.stride;
+    __m256i nid = zero;
+    while (true) {
+      const __m256i word = _mm256_slli_epi32(nid, 2);
+      const __m256i kind_op = _mm256_i32gather_epi32(nodes + 3, word, 4);
+      // lanes that have not reached a leaf yet
+      const __m256i active = _mm256_cmpgt_epi32(_mm256_and_si256(kind_op, byte_mask), zero);
+      if (_mm256_testz_si256(active, active)) {
+        break;
+      }
+      const __m256i sindex = _mm256_i32gather_epi32(nodes, word, 4);
+      const __m256i right_child = _mm256_i32gather_epi32(nodes + 1, word, 4);
+      const __m256 threshold = _mm256_castsi256_ps(_mm256_i32gather_epi32(nodes + 2, word, 4));
+      const __m256i op = _mm256_and_si256(_mm256_srli_epi32(kind_op, 8), byte_mask);
+      const __m256i default_left = _mm256_srai_epi32(sindex, 31);
+      // a leaf has feature index 0, so lanes at a leaf still read a valid address
+      const __m256i offset = _mm256_add_epi32(lane_offset, _mm256_and_si256(sindex, fid_mask));
+      const __m256 fvalue = _mm256_i32gather_ps(rows, offset, 4);
+
+      __m256i missing;
+      if (block.dense) {
+        missing = _mm256_castps_si256(
+            _mm256_or_ps(_mm256_cmp_ps(fvalue, fvalue, _CMP_UNORD_Q),
+                         _mm256_cmp_ps(fvalue, missing_value, _CMP_EQ_OQ)));
+      } else {
+        missing = _mm256_cmpeq_epi32(_mm256_castps_si256(fvalue), all_ones);
+      }
+      // evaluate every operator, then keep the one each lane asked for
+      __m256i result = _mm256_cmpeq_epi32(op, op_true);
+      result = _mm256_or_si256(result, _mm256_and_si256(_mm256_cmpeq_epi32(op, op_lt),
+          _mm256_castps_si256(_mm256_cmp_ps(fvalue, threshold, _CMP_LT_OQ))));
+      result = _mm256_or_si256(result, _mm256_and_si256(_mm256_cmpeq_epi32(op, op_le),
+          _mm256_castps_si256(_mm256_cmp_ps(fvalue, threshold, _CMP_LE_OQ))));
+      result = _mm256_or_si256(result, _mm256_and_si256(_mm256_cmpeq_epi32(op, op_gt),
+          _mm256_castps_si256(_mm256_cmp_ps(fvalue, threshold, _CMP_GT_OQ))));
+      result = _mm256_or_si256(result, _mm256_and_si256(_mm256_cmpeq_epi32(op, op_ge),
+          _mm256_castps_si256(_mm256_cmp_ps(fvalue, threshold, _CMP_GE_OQ))));
+      result = _mm256_or_si256(result, _mm256_and_si256(_mm256_cmpeq_epi32(op, op_eq),
+          _mm256_castps_si256(_mm256_cmp_ps(fvalue, threshold, _CMP_EQ_OQ))));
+
+      const __m256i go_left = _mm256_blendv_epi8(result, default_left, missing);
+      const __m256i next = _mm256_blendv_epi8(right_child, _mm256_add_epi32(nid, one), go_left);
+      nid = _mm256_blendv_epi8(nid, next, active);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(leaf + rid), nid);
+  }
+  return rid;
+}
+
+TREELITE_TARGET("avx512f")
+size_t TraverseAVX512(const uint32_t* tree, const RowBlock& block, size_t num_row,
+                      uint32_t* leaf) {
+  constexpr size_t kWidth = 16;
+  if (block.stride > static_cast<size_t>(std::numeric_limits<int32_t>::max()) / kWidth) {
+    return 0;
+  }
+  const int* nodes = reinterpret_cast<const int*>(tree);
+  const __m512i lane_offset = _mm512_mullo_epi32(
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm512_set1_epi32(static_cast<int>(block.stride)));
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i all_ones = _mm512_set1_epi32(-1);
+  const __m512i byte_mask = _mm512_set1_epi32(0xFF);
+  const __m512i fid_mask = _mm512_set1_epi32(0x7FFFFFFF);
+  const __m512i default_left_bit = _mm512_set1_epi32(static_cast<int>(0x80000000U));
+  const __m512i op_lt = _mm512_set1_epi32(layout::kOpLT);
+  const __m512i op_le = _mm512_set1_epi32(layout::kOpLE);
+  const __m512i op_gt = _mm512_set1_epi32(layout::kOpGT);
+  const __m512i op_ge = _mm512_set1_epi32(layout::kOpGE);
+  const __m512i op_eq = _mm512_set1_epi32(layout::kOpEQ);
+  const __m512i op_true = _mm512_set1_epi32(layout::kOpTrue);
+  const __m512 missing_value = _mm512_set1_ps(block.missing_value);
+
+  size_t rid = 0;
+  for (; rid + kWidth <= num_row; rid += kWidth) {
+    const float* rows = static_cast<const float*>(block.rows) + rid * block.stride;
+    __m512i nid = _mm512_setzero_si512();
+    while (true) {
+      const __m512i word = _mm512_slli_epi32(nid, 2);
+      const __m512i kind_op = _mm512_i32gather_epi32(word, nodes + 3, 4);
+      // lanes that have not reached a leaf yet
+      const __mmask16 active = _mm512_test_epi32_mask(kind_op, byte_mask);
+      if (active == 0) {
+        break;
+      }
+      const __m512i sindex = _mm512_i32gather_epi32(word, nodes, 4);
+      const __m512i right_child = _mm512_i32gather_epi32(word, nodes + 1, 4);
+      const __m512 threshold = _mm512_castsi512_ps(_mm512_i32gather_epi32(word, nodes + 2, 4));
+      const __m512i op = _mm512_and_si512(_mm512_srli_epi32(kind_op, 8), byte_mask);
+      const __mmask16 default_left = _mm512_test_epi32_mask(sindex, default_left_bit);
+      // a leaf has feature index 0, so lanes at a leaf still read a valid address
+      const __m512i offset = _mm512_add_epi32(lane_offset, _mm512_and_si512(sindex, fid_mask));
+      const __m512 fvalue = _mm512_i32gather_ps(offset, rows, 4);
+
+      __mmask16 missing;
+      if (block.dense) {
+        missing = _mm512_cmp_ps_mask(fvalue, fvalue, _CMP_UNORD_Q)
+                  | _mm512_cmp_ps_mask(fvalue, missing_value, _CMP_EQ_OQ);
+      } else {
+        missing = _mm512_cmpeq_epi32_mask(_mm512_castps_si512(fvalue), all_ones);
+      }
+      // evaluate every operator, then keep the one each lane asked for
+      const __mmask16 lt = _mm512_cmp_ps_mask(fvalue, threshold, _CMP_LT_OQ);
+      const __mmask16 le = _mm512_cmp_ps_mask(fvalue, threshold, _CMP_LE_OQ);
+      const __mmask16 gt = _mm512_cmp_ps_mask(fvalue, threshold, _CMP_GT_OQ);
+      const __mmask16 ge = _mm512_cmp_ps_mask(fvalue, threshold, _CMP_GE_OQ);
+      const __mmask16 eq = _mm512_cmp_ps_mask(fvalue, threshold, _CMP_EQ_OQ);
+      const __mmask16 result = _mm512_cmpeq_epi32_mask(op, op_true)
+                               | (_mm512_cmpeq_epi32_mask(op, op_lt) & lt)
+                               | (_mm512_cmpeq_epi32_mask(op, op_le) & le)
+                               | (_mm512_cmpeq_epi32_mask(op, op_gt) & gt)
+                               | (_mm512_cmpeq_epi32_mask(op, op_ge) & ge)
+                               | (_mm512_cmpeq_epi32_mask(op, op_eq) & eq);
+
+      const __mmask16 go_left = (missing & default_left) | (~missing & result);
+      const __m512i next
+        = _mm512_mask_blend_epi32(go_left, right_child, _mm512_add_epi32(nid, one));
+      nid = _mm512_mask_blend_epi32(active, nid, next);
+    }
+    _mm512_storeu_si512(leaf + rid, nid);
+  }
+  return rid;
+}
+
+#else  // TREELITE_SIMD_X86
+
+Level DetectLevelUncached() {
+  return Level::kScalar;
+}
+
+#endif  // TREELITE_SIMD_X86
+
+}  // anonymous namespace
+
+namespace treelite {
+namespace simd {
+
+Level DetectLevel() {
+  static const Level level = DetectLevelUncached();
+  return level;
+}
+
+const char* LevelName(Level level) {
+  switch (level) {
+   case Level::kAVX2: return "avx2";
+   case Level::kAVX512: return "avx512";
+   default: return "scalar";
+  }
+}
+
+size_t TraverseBlock(Level level, const uint32_t* tree, const RowBlock& block, size_t num_row,
+                     uint32_t* leaf) {
+  CHECK_LE(static_cast<int>(level), static_cast<int>(DetectLevel()))
+    << "Instruction set " << LevelName(level) << " is not supported on this machine";
+  switch (level) {
+#ifdef TREELITE_SIMD_X86
+   case Level::kAVX512: return TraverseAVX512(tree, block, num_row, leaf);
+   case Level::kAVX2: return TraverseAVX2(tree, block, num_row, leaf);
+#endif  // TREELITE_SIMD_X86
+   default: return 0;
+  }
+}
+
+}  // namespace simd
+}  // namespace treelite
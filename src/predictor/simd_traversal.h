@@ -0,0 +1,85 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file simd_traversal.h
+ * \author Hyunsu Cho
+ * \brief Kernels that advance 8 (AVX2) or 16 (AVX-512) rows through a tree in
+ *        lockstep, using gathers and masked compares. The instruction set is
+ *        chosen at runtime.
+ */
+#ifndef TREELITE_PREDICTOR_SIMD_TRAVERSAL_H_
+#define TREELITE_PREDICTOR_SIMD_TRAVERSAL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace treelite {
+namespace simd {
+
+/*! \brief vector instruction set used to traverse trees */
+enum class Level : int {
+  kScalar = 0, kAVX2 = 1, kAVX512 = 2
+};
+
+/*!
+ * \brief find the widest instruction set supported by both the CPU and the
+ *        build. The result is computed once and cached.
+ */
+Level DetectLevel();
+/*! \brief human-readable name of an instruction set, e.g. "avx2" */
+const char* LevelName(Level level);
+
+/*!
+ * \brief Layout of a tree node, as seen by the kernels. A tree is an array of
+ *        16-byte nodes, i.e. 4 words per node:
+ *          word 0: feature index; the highest bit is set if missing values go
+ *                  to the left child
+ *          word 1: index of the right child, relative to the start of the tree.
+ *                  The left child of node i is node (i + 1).
+ *          word 2: threshold (test node) or leaf value (leaf), as a float
+ *          word 3: node kind in the lowest byte, test operator in the next byte
+ *        Only leaves and numerical test nodes are supported.
+ */
+namespace node_layout {
+constexpr uint32_t kKindLeaf = 0;
+constexpr uint32_t kKindNumerical = 1;
+constexpr uint32_t kOpLT = 0;
+constexpr uint32_t kOpLE = 1;
+constexpr uint32_t kOpGT = 2;
+constexpr uint32_t kOpGE = 3;
+constexpr uint32_t kOpEQ = 4;
+constexpr uint32_t kOpTrue = 5;   // outcome known in advance
+constexpr uint32_t kOpFalse = 6;  // outcome known in advance
+}  // namespace node_layout
+
+/*!
+ * \brief a block of rows to traverse. Rows are either arrays of
+ *        TreelitePredictorEntry, where a missing feature has all bits set, or
+ *        rows of a dense float matrix, where a missing feature is NaN or equal
+ *        to [missing_value].
+ */
+struct RowBlock {
+  const void* rows;
+  size_t stride;  // width of each row, in 4-byte elements
+  bool dense;
+  float missing_value;
+};
+
+/*!
+ * \brief traverse a tree for a leading part of a block of rows
+ * \param level instruction set to use; must not exceed DetectLevel()
+ * \param tree nodes of the tree, laid out as described in node_layout
+ * \param block rows to traverse
+ * \param num_row number of rows in the block
+ * \param leaf output: for each row processed, the index of the leaf reached,
+ *             relative to the start of the tree
+ * \return number of rows processed. This is a multiple of the vector width;
+ *         the caller traverses the remaining rows itself. Zero is returned
+ *         when the block is too wide for 32-bit gather offsets.
+ */
+size_t TraverseBlock(Level level, const uint32_t* tree, const RowBlock& block, size_t num_row,
+                     uint32_t* leaf);
+
+}  // namespace simd
+}  // namespace treelite
+
+#endif  // TREELITE_PREDICTOR_SIMD_TRAVERSAL_H_
@@ -0,0 +1,294 @@
+/*!
+* Copyright (c) 2020 by Contributors
+* \file cpu_topology.h
+* \brief Discover the CPUs that the process may run on, so that the size and
+*        placement of the thread pool respect the affinity mask, the CPU quota
+*        of the enclosing control group and the NUMA layout of the machine
+* \author Hyunsu Cho
+*/
+#ifndef TREELITE_PREDICTOR_THREAD_POOL_CPU_TOPOLOGY_H_
+#define TREELITE_PREDICTOR_THREAD_POOL_CPU_TOPOLOGY_H_
+
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace treelite {
+namespace cpu_topology {
+
+namespace detail {
+
+inline bool ParseInt(const std::string& str, int64_t* out) {
+  if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  *out = std::strtoll(str.c_str(), nullptr, 10);
+  return true;
+}
+
+inline bool ReadFile(const std::string& path, std::string* out) {
+  std::ifstream fi(path);
+  if (!fi) {
+    return false;
+  }
+  out->assign(std::istreambuf_iterator<char>(fi), std::istreambuf_iterator<char>());
+  return true;
+}
+
+inline std::string Trim(const std::string& str) {
+  const size_t first = str.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) {
+    return std::string();
+  }
+  const size_t last = str.find_last_not_of(" \t\r\n");
+  return str.substr(first, last - first + 1);
+}
+
+}  // namespace detail
+
+/*!
+ * \brief parse a list of CPUs in the format used by Linux (e.g. "0-3,8,10-11")
+ * \param str list of CPUs; comma-separated CPU IDs or ranges of CPU IDs
+ * \return CPU IDs, in the order given and without duplicates
+ */
+inline std::vector<int> ParseCPUList(const std::string& str) {
+  std::vector<int> cpus;
+  std::istringstream iss(str);
+  std::string token;
+  while (std::getline(iss, token, ',')) {
+    token = detail::Trim(token);
+    if (token.empty()) {
+      continue;
+    }
+    const size_t dash = token.find('-');
+    int64_t begin, end;
+    bool valid = detail::ParseInt(detail::Trim(token.substr(0, dash)), &begin);
+    if (dash == std::string::npos) {
+      end = begin;
+    } else {
+      valid = valid && detail::ParseInt(detail::Trim(token.substr(dash + 1)), &end);
+    }
+    CHECK(valid && begin <= end && end < std::numeric_limits<int>::max())
+      << "Invalid CPU list `" << str << "': cannot parse `" << token << "'";
+    for (int64_t cpu = begin; cpu <= end; ++cpu) {
+      if (std::find(cpus.begin(), cpus.end(), static_cast<int>(cpu)) == cpus.end()) {
+        cpus.push_back(static_cast<int>(cpu));
+      }
+    }
+  }
+  return cpus;
+}
+
+/*!
+ * \brief convert a CPU bandwidth quota of a control group into a number of CPUs,
+ *        rounding up
+ * \param quota CPU time (in microseconds) the group may use in each period;
+ *              a negative value indicates no limit
+ * \param period length of the period (in microseconds)
+ * \return number of CPUs, or 0 if there is no limit
+ */
+inline int CPULimitFromQuota(int64_t quota, int64_t period) {
+  if (quota <= 0 || period <= 0) {
+    return 0;
+  }
+  return static_cast<int>(std::max((quota + period - 1) / period, static_cast<int64_t>(1)));
+}
+
+/*!
+ * \brief parse the content of cpu.max (cgroup v2), e.g. "max 100000" or
+ *        "150000 100000"
+ * \return number of CPUs, or 0 if there is no limit
+ */
+inline int ParseCgroupCPUMax(const std::string& content) {
+  std::istringstream iss(content);
+  std::string quota, period;
+  iss >> quota >> period;
+  int64_t quota_val, period_val;
+  if (quota == "max" || !detail::ParseInt(quota, &quota_val)
+      || !detail::ParseInt(period, &period_val)) {
+    return 0;
+  }
+  return CPULimitFromQuota(quota_val, period_val);
+}
+
+/*!
+ * \brief get the CPU limit imposed by the bandwidth quota of the control group
+ *        (cgroup v1 or v2) to which the process belongs, taking into account
+ *        the quotas of all ancestor groups
+ * \return number of CPUs, or 0 if there is no limit
+ */
+inline int GetCgroupCPULimit() {
+#ifdef __linux__
+  std::string content;
+  if (!detail::ReadFile("/proc/self/cgroup", &content)) {
+    return 0;
+  }
+  int limit = 0;
+  auto update_limit = [&limit](int group_limit) {
+    if (group_limit > 0 && (limit == 0 || group_limit < limit)) {
+      limit = group_limit;
+    }
+  };
+  std::istringstream lines(content);
+  std::string line;
+  while (std::getline(lines, line)) {
+    // each line has the form hierarchy-ID:controller-list:cgroup-path
+    const size_t first_colon = line.find(':');
+    const size_t second_colon = line.find(':', first_colon + 1);
+    if (first_colon == std::string::npos || second_colon == std::string::npos) {
+      continue;
+    }
+    const std::string controllers
+      = line.substr(first_colon + 1, second_colon - first_colon - 1);
+    std::string path = line.substr(second_colon + 1);
+    std::vector<std::string> mounts;
+    if (line.compare(0, first_colon, "0") == 0 && controllers.empty()) {  // cgroup v2
+      mounts.emplace_back("/sys/fs/cgroup");
+    } else if (("," + controllers + ",").find(",cpu,") != std::string::npos) {  // cgroup v1
+      mounts.emplace_back("/sys/fs/cgroup/cpu");
+      mounts.emplace_back("/sys/fs/cgroup/cpu,cpuacct");
+    } else {
+      continue;
+    }
+    // walk from the group of the process up to the root; inside a container,
+    // the path may not be visible, in which case the root holds the quota
+    while (true) {
+      for (const std::string& mount : mounts) {
+        const std::string dir = mount + (path == "/" ? "" : path);
+        std::string cpu_max, quota, period;
+        if (detail::ReadFile(dir + "/cpu.max", &cpu_max)) {
+          update_limit(ParseCgroupCPUMax(cpu_max));
+        } else if (detail::ReadFile(dir + "/cpu.cfs_quota_us", &quota)
+                   && detail::ReadFile(dir + "/cpu.cfs_period_us", &period)) {
+          update_limit(CPULimitFromQuota(std::strtoll(quota.c_str(), nullptr, 10),
+                                         std::strtoll(period.c_str(), nullptr, 10)));
+        }
+      }
+      if (path.empty() || path == "/") {
+        break;
+      }
+      const size_t slash = path.find_last_of('/');
+      path = (slash == 0 || slash == std::string::npos) ? "/" : path.substr(0, slash);
+    }
+  }
+  return limit;
+#else
+  return 0;
+#endif
+}
+
+/*!
+ * \brief get the CPUs on which the process is allowed to run, as given by its
+ *        affinity mask. On platforms without affinity masks, all CPUs are
+ *        returned.
+ */
+inline std::vector<int> GetAllowedCPUs() {
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpuset)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    const int num_cpu = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    for (int cpu = 0; cpu < num_cpu; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+/*!
+ * \brief get the CPUs that belong to a NUMA node
+ * \return CPU IDs; empty if the node does not exist or the NUMA layout is
+ *         not available
+ */
+inline std::vector<int> GetNUMANodeCPUs(int node) {
+  std::string content;
+  if (node < 0 || !detail::ReadFile("/sys/devices/system/node/node"
+                                    + std::to_string(node) + "/cpulist", &content)) {
+    return {};
+  }
+  return ParseCPUList(content);
+}
+
+/*!
+ * \brief reorder a list of CPUs so that CPUs on the same NUMA node are
+ *        adjacent, with nodes in the order of their first CPU in the list.
+ *        This way, a thread pool using only a prefix of the list spans as
+ *        few nodes as possible.
+ */
+inline std::vector<int> GroupByNUMANode(const std::vector<int>& cpus) {
+  std::string content;
+  if (!detail::ReadFile("/sys/devices/system/node/online", &content)) {
+    return cpus;
+  }
+  std::vector<std::vector<int>> node_cpus;
+  for (int node : ParseCPUList(content)) {
+    node_cpus.push_back(GetNUMANodeCPUs(node));
+  }
+  const int unknown_node = static_cast<int>(node_cpus.size());
+  std::vector<int> node_of_cpu(cpus.size(), unknown_node);
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    for (size_t node = 0; node < node_cpus.size(); ++node) {
+      if (std::find(node_cpus[node].begin(), node_cpus[node].end(), cpus[i])
+          != node_cpus[node].end()) {
+        node_of_cpu[i] = static_cast<int>(node);
+        break;
+      }
+    }
+  }
+  std::vector<int> grouped;
+  std::vector<bool> taken(cpus.size(), false);
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    if (taken[i]) {
+      continue;
+    }
+    for (size_t j = i; j < cpus.size(); ++j) {
+      if (!taken[j] && node_of_cpu[j] == node_of_cpu[i]) {
+        grouped.push_back(cpus[j]);
+        taken[j] = true;
+      }
+    }
+  }
+  return grouped;
+}
+
+/*!
+ * \brief get the number of threads that can run at the same time on a set of
+ *        CPUs, given the CPU quota of the control group of the process
+ */
+inline int GetMaxConcurrency(const std::vector<int>& cpus) {
+  int num_cpu = static_cast<int>(cpus.size());
+  const int cpu_limit = GetCgroupCPULimit();
+  if (cpu_limit > 0) {
+    num_cpu = std::min(num_cpu, cpu_limit);
+  }
+  const int num_hardware_thread = static_cast<int>(std::thread::hardware_concurrency());
+  if (num_hardware_thread > 0) {
+    num_cpu = std::min(num_cpu, num_hardware_thread);
+  }
+  return std::max(num_cpu, 1);
+}
+
+}  // namespace cpu_topology
+}  // namespace treelite
+
+#endif  // TREELITE_PREDICTOR_THREAD_POOL_CPU_TOPOLOGY_H_
@@ -0,0 +1,250 @@
+/*!
+* Copyright (c) 2020 by Contributors
+* \file mpmc_queue.h
+* \brief Bounded multi-producer-multi-consumer queue
+* \author Hyunsu Cho
+*/
+#ifndef TREELITE_PREDICTOR_THREAD_POOL_MPMC_QUEUE_H_
+#define TREELITE_PREDICTOR_THREAD_POOL_MPMC_QUEUE_H_
+
+#include <dmlc/logging.h>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "wait_policy.h"
+
+const constexpr int kL1CacheBytes = 64;
+
+/*!
+ * \brief Bounded multi-producer-multi-consumer queue, shared by all worker
+ *        threads. Any number of threads may push and pop concurrently.
+ *
+ * The ring buffer follows Dmitry Vyukov's bounded MPMC queue: each cell carries
+ * a sequence number that tells producers and consumers whether the cell is
+ * ready to be written or read, so that neither side needs a lock. Consumers
+ * that find the queue empty wait according to the given WaitConfig: they spin
+ * for a while and then go to sleep, until a producer wakes them up.
+ */
+template <typename T>
+class MpmcQueue {
+ public:
+  static constexpr const size_t kDefaultCapacity = 1024;
+
+  explicit MpmcQueue(size_t capacity = kDefaultCapacity,
+                     treelite::WaitConfig wait = treelite::WaitConfig())
+    : wait_(wait) {
+    CHECK(capacity >= 2 && (capacity & (capacity - 1)) == 0)
+      << "Capacity of MpmcQueue must be a power of 2";
+    buffer_.reset(new Cell[capacity]);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < capacity; ++i) {
+      buffer_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+  }
+
+  void Push(T input) {
+    while (!Enqueue(&input)) {
+      std::this_thread::yield();
+    }
+    if (pending_.fetch_add(1) < 0) {
+      // some consumer is asleep (or about to be); wake up one
+      if (wait_.policy == treelite::WaitPolicy::kSpin) {
+        num_wakeup_.fetch_add(1);
+#ifdef __linux__
+      } else if (wait_.policy == treelite::WaitPolicy::kFutex) {
+        num_wakeup_.fetch_add(1);
+        futex_seq_.fetch_add(1);
+        treelite::FutexWake(&futex_seq_, 1);
+#endif
+      } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_wakeup_.fetch_add(1);
+        cv_.notify_one();
+      }
+    }
+  }
+
+  bool Pop(T* output) {
+    // Busy wait a bit when the queue is empty.
+    // If a new element comes to the queue quickly, this wait avoid the worker
+    // from sleeping.
+    const uint32_t spin_count = wait_.SpinCount();
+    for (uint32_t i = 0; i < spin_count && pending_.load() <= 0
+                         && !exit_now_.load(std::memory_order_relaxed); ++i) {
+      std::this_thread::yield();
+    }
+    if (pending_.fetch_sub(1) <= 0 && !Park()) {
+      return false;  // the queue is empty, and SignalForKill() was called
+    }
+    // An element is reserved for this consumer, but the producer of the
+    // element at the head may still be writing it
+    while (!Dequeue(output)) {
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  /*!
+   * \brief Signal to terminate all consumers. Elements still in the queue are
+   *        handed out first: Pop() fails only once the queue is empty.
+   */
+  void SignalForKill() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_now_.store(true);
+      cv_.notify_all();
+    }
+#ifdef __linux__
+    futex_seq_.fetch_add(1);
+    treelite::FutexWake(&futex_seq_, std::numeric_limits<int32_t>::max());
+#endif
+  }
+
+ protected:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  /*! \brief take one wakeup, if any is available */
+  bool TakeWakeup() {
+    int32_t num_wakeup = num_wakeup_.load();
+    while (num_wakeup > 0) {
+      if (num_wakeup_.compare_exchange_weak(num_wakeup, num_wakeup - 1)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*!
+   * \brief sleep (or spin) until a producer or SignalForKill() wakes us up
+   * \return whether a producer reserved an element for this consumer. A wakeup
+   *         is always taken in preference to SignalForKill(), so that no
+   *         element is left behind.
+   */
+  bool Park() {
+    if (wait_.policy == treelite::WaitPolicy::kSpin) {
+      for (;;) {
+        if (TakeWakeup()) {
+          return true;
+        }
+        if (exit_now_.load()) {
+          return false;
+        }
+        std::this_thread::yield();
+      }
+#ifdef __linux__
+    } else if (wait_.policy == treelite::WaitPolicy::kFutex) {
+      for (;;) {
+        // read the sequence first, so that a wakeup arriving after the checks
+        // below makes FutexWait() return immediately
+        const int32_t seq = futex_seq_.load();
+        if (TakeWakeup()) {
+          return true;
+        }
+        if (exit_now_.load()) {
+          return false;
+        }
+        treelite::FutexWait(&futex_seq_, seq);
+      }
+#endif
+    } else {
+      bool reserved = false;
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this, &reserved] {
+        reserved = TakeWakeup();
+        return reserved || exit_now_.load();
+      });
+      return reserved;
+    }
+  }
+
+  bool Enqueue(T* input) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &buffer_[pos & mask_];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // queue is full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(*input);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Dequeue(T* output) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &buffer_[pos & mask_];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // queue is empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *output = std::move(cell->data);
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // the cache line paddings are used for avoid false sharing between atomic variables
+  typedef char cache_line_pad_t[kL1CacheBytes];
+  cache_line_pad_t pad0_;
+  std::unique_ptr<Cell[]> buffer_;
+  size_t mask_;
+
+  cache_line_pad_t pad1_;
+  // position of the next cell to write
+  std::atomic<size_t> enqueue_pos_;
+
+  cache_line_pad_t pad2_;
+  // position of the next cell to read
+  std::atomic<size_t> dequeue_pos_;
+
+  cache_line_pad_t pad3_;
+  // number of elements in the queue, minus the number of waiting consumers
+  std::atomic<int64_t> pending_{0};
+
+  cache_line_pad_t pad4_;
+  // signal for exit now
+  std::atomic<bool> exit_now_{false};
+
+  // number of consumers to be woken up
+  std::atomic<int32_t> num_wakeup_{0};
+  // bumped on every wakeup, for consumers sleeping on a futex
+  std::atomic<int32_t> futex_seq_{0};
+  // how consumers wait when the queue is empty
+  treelite::WaitConfig wait_;
+
+  // internal mutex
+  std::mutex mutex_;
+  // cv for consumers
+  std::condition_variable cv_;
+};
+
+#endif  // TREELITE_PREDICTOR_THREAD_POOL_MPMC_QUEUE_H_
@@ -9,115 +9,128 @@
 
 #include <memory>
 #include <vector>
+#include <thread>
+#include <utility>
 #include <cstdlib>
 #ifdef _WIN32
 #include <windows.h>
 #else
 #include <sched.h>
 #endif
-#include "spsc_queue.h"
+#include "mpmc_queue.h"
 
 namespace treelite {
 
-template <typename InputToken, typename OutputToken, typename TaskContext>
+/*!
+ * \brief Pool of worker threads that share a single task queue. Tasks may be
+ *        submitted from any number of threads at once.
+ */
+template <typename InputToken, typename TaskContext>
 class ThreadPool {
  public:
-  using TaskFunc = void(*)(SpscQueue<InputToken>*, SpscQueue<OutputToken>*,
-                           const TaskContext*);
+  using TaskFunc = void(*)(const InputToken&, const TaskContext*);
 
-  ThreadPool(int num_worker, const TaskContext* context, TaskFunc task)
-    : num_worker_(num_worker), context_(context), task_(task) {
-    CHECK(num_worker_ >= 0 && num_worker_ < std::thread::hardware_concurrency())
-    << "Number of worker threads must be between 0 and "
-    << (std::thread::hardware_concurrency() - 1);
-    for (int i = 0; i < num_worker_; ++i) {
-      incoming_queue_.emplace_back(new SpscQueue<InputToken>());
-      outgoing_queue_.emplace_back(new SpscQueue<OutputToken>());
-    }
+  /*!
+   * \brief start the worker threads
+   * \param num_worker number of worker threads
+   * \param context context passed to every invocation of the task function
+   * \param task function to run for each submitted task
+   * \param cpus CPUs to bind the threads to; see SetAffinity(). Leave empty
+   *             to leave the placement of the threads to the OS.
+   * \param wait how idle worker threads wait for tasks
+   */
+  ThreadPool(int num_worker, const TaskContext* context, TaskFunc task,
+             const std::vector<int>& cpus = std::vector<int>(),
+             WaitConfig wait = WaitConfig())
+    : num_worker_(num_worker), queue_(MpmcQueue<InputToken>::kDefaultCapacity, wait),
+      task_(task), context_(context) {
+    CHECK_GE(num_worker_, 0) << "Number of worker threads must not be negative";
     thread_.resize(num_worker_);
     for (int i = 0; i < num_worker_; ++i) {
-      thread_[i] = std::thread(task_, incoming_queue_[i].get(),
-                                      outgoing_queue_[i].get(),
-                                      context_);
-    }
-    /* bind threads to cores */
-    const char* bind_flag = getenv("TREELITE_BIND_THREADS");
-    if (bind_flag == nullptr || std::atoi(bind_flag) == 1) {
-      SetAffinity();
+      thread_[i] = std::thread([this] {
+        InputToken input;
+        while (queue_.Pop(&input)) {
+          task_(input, context_);
+        }
+      });
     }
+    SetAffinity(cpus);
   }
+  /*!
+   * \brief stop the worker threads, once they have run every task submitted
+   *        so far. A task may be the only one left to make progress on an
+   *        asynchronous prediction, so dropping it would leave the prediction
+   *        hanging forever.
+   */
   ~ThreadPool() {
+    queue_.SignalForKill();
     for (int i = 0; i < num_worker_; ++i) {
-      incoming_queue_[i]->SignalForKill();
-      outgoing_queue_[i]->SignalForKill();
       thread_[i].join();
     }
   }
 
-  void SubmitTask(int tid, InputToken request) {
-    incoming_queue_[tid]->Push(request);
+  void SubmitTask(InputToken request) {
+    queue_.Push(std::move(request));
   }
 
-  bool WaitForTask(int tid, OutputToken* response) {
-    return outgoing_queue_[tid]->Pop(response);
+  /*!
+   * \brief bind worker thread i to CPU cpus[(i + 1) % cpus.size()]. The first
+   *        CPU in the list is meant for the thread that submits tasks and
+   *        takes part in their execution; that thread belongs to the
+   *        application and is never bound. Binding happens before any task is
+   *        submitted, so that memory first touched by a worker thread (e.g.
+   *        its scratch buffers) is allocated on the NUMA node of its CPU.
+   *        Does nothing if the list is empty or if the environment variable
+   *        TREELITE_BIND_THREADS is set to 0.
+   */
+  void SetAffinity(const std::vector<int>& cpus) {
+    const char* bind_flag = getenv("TREELITE_BIND_THREADS");
+    if (cpus.empty() || (bind_flag != nullptr && std::atoi(bind_flag) != 1)) {
+      return;
+    }
+    for (int i = 0; i < num_worker_; ++i) {
+      BindThread(i, cpus[(i + 1) % cpus.size()]);
+    }
   }
 
  private:
   int num_worker_;
   std::vector<std::thread> thread_;
-  std::vector<std::unique_ptr<SpscQueue<InputToken>>> incoming_queue_;
-  std::vector<std::unique_ptr<SpscQueue<OutputToken>>> outgoing_queue_;
+  MpmcQueue<InputToken> queue_;
   TaskFunc task_;
   const TaskContext* context_;
 
-  inline void SetAffinity() {
+  inline void BindThread(int worker_id, int cpu) {
 #ifdef _WIN32
     /* Windows */
-    SetThreadAffinityMask(GetCurrentThread(), 0x1);
-    for (int i = 0; i < num_worker_; ++i) {
-      const int core_id = i + 1;
-      SetThreadAffinityMask(thread_[i].native_handle(), (1 << core_id));
+    if (cpu < 64) {
+      SetThreadAffinityMask(thread_[worker_id].native_handle(), DWORD_PTR(1) << cpu);
     }
 #elif defined(__APPLE__) && defined(__MACH__)
 #include <TargetConditionals.h>
 #if TARGET_OS_MAC == 1
-    /* Mac OSX */
-    thread_port_t mach_thread = pthread_mach_thread_np(pthread_self());
-    thread_affinity_policy_data_t policy = {0};
+    /* Mac OSX: affinity tags are hints; threads with different tags are
+       placed on different cores */
+    thread_port_t mach_thread = pthread_mach_thread_np(thread_[worker_id].native_handle());
+    thread_affinity_policy_data_t policy = {cpu + 1};
     thread_policy_set(mach_thread, THREAD_AFFINITY_POLICY,
                       (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT);
-    for (int i = 0; i < num_worker_; ++i) {
-      const int core_id = i + 1;
-      mach_thread = pthread_mach_thread_np(thread_[i].native_handle());
-      policy = {core_id};
-      thread_policy_set(mach_thread, THREAD_AFFINITY_POLICY,
-                        (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT);
-    }
 #else
     #error "iPhone not supported yet"
 #endif
 #else
     /* Linux and others */
+    if (cpu >= CPU_SETSIZE) {
+      return;
+    }
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
-    CPU_SET(0, &cpuset);
+    CPU_SET(cpu, &cpuset);
 #if defined(__ANDROID__)
-    sched_setaffinity(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    sched_setaffinity(thread_[worker_id].native_handle(), sizeof(cpu_set_t), &cpuset);
 #else
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    pthread_setaffinity_np(thread_[worker_id].native_handle(), sizeof(cpu_set_t), &cpuset);
 #endif
-    for (int i = 0; i < num_worker_; ++i) {
-      const int core_id = i + 1;
-      CPU_ZERO(&cpuset);
-      CPU_SET(core_id, &cpuset);
-#if defined(__ANDROID__)
-      sched_setaffinity(thread_[i].native_handle(),
-                        sizeof(cpu_set_t), &cpuset);
-#else
-      pthread_setaffinity_np(thread_[i].native_handle(),
-                             sizeof(cpu_set_t), &cpuset);
-#endif
-    }
 #endif
   }
 };
@@ -0,0 +1,139 @@
+/*!
+* Copyright (c) 2020 by Contributors
+* \file wait_policy.h
+* \brief Policies for threads waiting for work or for other threads to finish
+* \author Hyunsu Cho
+*/
+#ifndef TREELITE_PREDICTOR_THREAD_POOL_WAIT_POLICY_H_
+#define TREELITE_PREDICTOR_THREAD_POOL_WAIT_POLICY_H_
+
+#include <treelite/predictor_param.h>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace treelite {
+
+/*!
+ * \brief how a thread waits: the policy (see PredictorParam::wait_policy) and
+ *        the number of times to spin before going to sleep, which applies to
+ *        the policies kSpinThenPark and kFutex
+ */
+struct WaitConfig {
+  WaitPolicy policy;
+  uint32_t spin_count;
+
+  WaitConfig() : policy(WaitPolicy::kSpinThenPark), spin_count(300000) {}
+  WaitConfig(WaitPolicy policy, uint32_t spin_count)
+    : policy(ResolvePolicy(policy)), spin_count(spin_count) {}
+  explicit WaitConfig(const PredictorParam& param)
+    : WaitConfig(static_cast<WaitPolicy>(param.wait_policy),
+                 static_cast<uint32_t>(param.spin_count)) {}
+
+  /*! \brief number of times to spin before going to sleep */
+  inline uint32_t SpinCount() const {
+    switch (policy) {
+     case WaitPolicy::kSpin:
+      return std::numeric_limits<uint32_t>::max();
+     case WaitPolicy::kPark:
+      return 0;
+     default:
+      return spin_count;
+    }
+  }
+
+ private:
+  /*! \brief futexes are only available on Linux; elsewhere, fall back to
+   *         parking on a condition variable */
+  static inline WaitPolicy ResolvePolicy(WaitPolicy policy) {
+#ifdef __linux__
+    return policy;
+#else
+    return (policy == WaitPolicy::kFutex) ? WaitPolicy::kSpinThenPark : policy;
+#endif
+  }
+};
+
+#ifdef __linux__
+/*! \brief sleep as long as *addr equals expected, or until woken up */
+inline void FutexWait(std::atomic<int32_t>* addr, int32_t expected) {
+  syscall(SYS_futex, reinterpret_cast<int32_t*>(addr), FUTEX_WAIT_PRIVATE, expected,
+          nullptr, nullptr, 0);
+}
+/*! \brief wake up to [count] threads sleeping in FutexWait() on addr */
+inline void FutexWake(std::atomic<int32_t>* addr, int32_t count) {
+  syscall(SYS_futex, reinterpret_cast<int32_t*>(addr), FUTEX_WAKE_PRIVATE, count,
+          nullptr, nullptr, 0);
+}
+#endif
+
+/*!
+ * \brief One-shot event, which any number of threads may wait for. The thread
+ *        setting the event only pays for a wakeup if some thread is asleep.
+ */
+class CompletionEvent {
+ public:
+  inline bool IsSet() const {
+    return state_.load() != 0;
+  }
+  inline void Set() {
+    state_.store(1);
+    if (num_parked_.load() > 0) {
+      {
+        // waiters check the state while holding the lock, so that none of
+        // them can miss the notification
+        std::lock_guard<std::mutex> lock(mutex_);
+      }
+      cv_.notify_all();
+#ifdef __linux__
+      FutexWake(&state_, std::numeric_limits<int32_t>::max());
+#endif
+    }
+  }
+  inline void Wait(const WaitConfig& config) {
+    const uint32_t spin_count = config.SpinCount();
+    for (uint32_t i = 0; !IsSet(); ++i) {
+      if (i >= spin_count && config.policy != WaitPolicy::kSpin) {
+        Park(config);
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  std::atomic<int32_t> state_{0};
+  std::atomic<int32_t> num_parked_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  inline void Park(const WaitConfig& config) {
+    num_parked_.fetch_add(1);
+#ifdef __linux__
+    if (config.policy == WaitPolicy::kFutex) {
+      while (!IsSet()) {
+        FutexWait(&state_, 0);
+      }
+      num_parked_.fetch_sub(1);
+      return;
+    }
+#endif
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return IsSet(); });
+    }
+    num_parked_.fetch_sub(1);
+  }
+};
+
+}  // namespace treelite
+
+#endif  // TREELITE_PREDICTOR_THREAD_POOL_WAIT_POLICY_H_
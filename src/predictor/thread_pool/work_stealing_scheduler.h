@@ -0,0 +1,131 @@
+/*!
+* Copyright (c) 2020 by Contributors
+* \file work_stealing_scheduler.h
+* \brief Chunked row scheduler with work stealing, to balance batch prediction
+*        across worker threads
+* \author Hyunsu Cho
+*/
+#ifndef TREELITE_PREDICTOR_THREAD_POOL_WORK_STEALING_SCHEDULER_H_
+#define TREELITE_PREDICTOR_THREAD_POOL_WORK_STEALING_SCHEDULER_H_
+
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include "mpmc_queue.h"
+
+namespace treelite {
+
+/*!
+ * \brief Distribute the rows [0, num_row) among a fixed set of workers.
+ *
+ * Each worker starts out owning a contiguous, equal share of the rows and
+ * claims them from the front of its share, at most [chunk_size] rows at a time.
+ * A worker that runs out of rows steals the back half of the rows not yet
+ * claimed by another worker. This way, workers that get slowed down (e.g. by
+ * rows that take longer to traverse, or by the OS scheduler) hand off their
+ * remaining work instead of holding up the whole batch.
+ */
+class WorkStealingScheduler {
+ public:
+  /*!
+   * \param num_row number of rows to distribute
+   * \param num_worker number of workers; each worker must use a distinct
+   *                   worker_id in [0, num_worker)
+   * \param chunk_size maximum number of rows to claim at a time; set to 0 to
+   *                   choose automatically
+   */
+  WorkStealingScheduler(size_t num_row, int num_worker, size_t chunk_size)
+    : num_worker_(num_worker), range_(new Range[num_worker]) {
+    CHECK_GT(num_worker, 0);
+    if (chunk_size == 0) {
+      chunk_size = num_row / (static_cast<size_t>(num_worker) * kAutoChunkPerWorker);
+    }
+    chunk_size_ = std::max(chunk_size, static_cast<size_t>(1));
+    const size_t portion = num_row / num_worker;
+    const size_t remainder = num_row % num_worker;
+    size_t accum = 0;
+    for (int i = 0; i < num_worker; ++i) {
+      range_[i].begin = accum;
+      accum += portion + (static_cast<size_t>(i) < remainder ? 1 : 0);
+      range_[i].end = accum;
+    }
+  }
+
+  /*!
+   * \brief claim the next chunk of rows for a worker
+   * \param worker_id ID of the worker making the claim
+   * \param rbegin beginning of the claimed range of rows
+   * \param rend end of the claimed range of rows
+   * \return whether any rows were claimed; false means that every row has
+   *         been claimed already
+   */
+  bool Next(int worker_id, size_t* rbegin, size_t* rend) {
+    if (TakeChunk(worker_id, rbegin, rend)) {
+      return true;
+    }
+    // own share is exhausted; steal from other workers, nearest first
+    for (int i = 1; i < num_worker_; ++i) {
+      const int victim = (worker_id + i) % num_worker_;
+      size_t begin, end;
+      {
+        std::lock_guard<std::mutex> lock(range_[victim].mutex);
+        const size_t remaining = range_[victim].end - range_[victim].begin;
+        if (remaining == 0) {
+          continue;
+        }
+        begin = range_[victim].begin + remaining / 2;
+        end = range_[victim].end;
+        range_[victim].end = begin;
+      }
+      {
+        std::lock_guard<std::mutex> lock(range_[worker_id].mutex);
+        range_[worker_id].begin = begin;
+        range_[worker_id].end = end;
+      }
+      if (TakeChunk(worker_id, rbegin, rend)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*! \brief maximum number of rows claimed at a time */
+  inline size_t ChunkSize() const {
+    return chunk_size_;
+  }
+
+ private:
+  /*! \brief when chunk size is chosen automatically, aim for this many chunks
+             in each worker's initial share */
+  static constexpr size_t kAutoChunkPerWorker = 8;
+
+  struct Range {
+    std::mutex mutex;
+    size_t begin;
+    size_t end;
+    // padding to keep ranges of different workers on separate cache lines
+    char pad[kL1CacheBytes];
+  };
+
+  int num_worker_;
+  size_t chunk_size_;
+  std::unique_ptr<Range[]> range_;
+
+  inline bool TakeChunk(int worker_id, size_t* rbegin, size_t* rend) {
+    std::lock_guard<std::mutex> lock(range_[worker_id].mutex);
+    Range& range = range_[worker_id];
+    if (range.begin == range.end) {
+      return false;
+    }
+    *rbegin = range.begin;
+    *rend = std::min(range.begin + chunk_size_, range.end);
+    range.begin = *rend;
+    return true;
+  }
+};
+
+}  // namespace treelite
+
+#endif  // TREELITE_PREDICTOR_THREAD_POOL_WORK_STEALING_SCHEDULER_H_
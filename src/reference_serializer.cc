@@ -54,6 +54,29 @@ void Tree::ReferenceSerialize(dmlc::Stream* fo) const {
   CHECK_EQ(left_categories_offset_.Back(), left_categories_.Size());
 }
 
+void Tree::ReferenceDeserialize(dmlc::Stream* fi) {
+  CHECK(fi->Read(&num_nodes)) << "Ill-formed serialized tree: failed to read num_nodes";
+  CHECK(fi->Read(&leaf_vector_)) << "Ill-formed serialized tree: failed to read leaf vectors";
+  CHECK(fi->Read(&leaf_vector_offset_))
+    << "Ill-formed serialized tree: failed to read leaf vector offsets";
+  CHECK(fi->Read(&left_categories_))
+    << "Ill-formed serialized tree: failed to read left categories";
+  CHECK(fi->Read(&left_categories_offset_))
+    << "Ill-formed serialized tree: failed to read left category offsets";
+  uint64_t sz;
+  CHECK(fi->Read(&sz)) << "Ill-formed serialized tree: failed to read number of nodes";
+  nodes_.Resize(sz);
+  CHECK_EQ(fi->Read(nodes_.Data(), sz * sizeof(Tree::Node)), sz * sizeof(Tree::Node))
+    << "Ill-formed serialized tree: failed to read nodes";
+
+  // Sanity check
+  CHECK_EQ(nodes_.Size(), num_nodes);
+  CHECK_EQ(nodes_.Size() + 1, leaf_vector_offset_.Size());
+  CHECK_EQ(leaf_vector_offset_.Back(), leaf_vector_.Size());
+  CHECK_EQ(nodes_.Size() + 1, left_categories_offset_.Size());
+  CHECK_EQ(left_categories_offset_.Back(), left_categories_.Size());
+}
+
 void Model::ReferenceSerialize(dmlc::Stream* fo) const {
   fo->Write(num_feature);
   fo->Write(num_output_group);
@@ -66,4 +89,21 @@ void Model::ReferenceSerialize(dmlc::Stream* fo) const {
   }
 }
 
+void Model::ReferenceDeserialize(dmlc::Stream* fi) {
+  CHECK(fi->Read(&num_feature)) << "Ill-formed serialized model: failed to read num_feature";
+  CHECK(fi->Read(&num_output_group))
+    << "Ill-formed serialized model: failed to read num_output_group";
+  CHECK(fi->Read(&random_forest_flag))
+    << "Ill-formed serialized model: failed to read random_forest_flag";
+  CHECK_EQ(fi->Read(&param, sizeof(param)), sizeof(param))
+    << "Ill-formed serialized model: failed to read model parameters";
+  uint64_t sz;
+  CHECK(fi->Read(&sz)) << "Ill-formed serialized model: failed to read number of trees";
+  trees.clear();
+  trees.resize(sz);
+  for (Tree& tree : trees) {
+    tree.ReferenceDeserialize(fi);
+  }
+}
+
 }  // namespace treelite
@@ -0,0 +1,50 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_batch_planner.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for choosing the number of threads for a batch prediction
+ */
+#include <gtest/gtest.h>
+#include "predictor/batch_planner.h"
+
+namespace treelite {
+
+TEST(BatchPlanner, UseAllThreadsUntilCostIsKnown) {
+  BatchPlanner planner;
+  ASSERT_EQ(planner.MeasuredRowCost(), 0.0);
+  ASSERT_EQ(planner.Plan(2, 8, 0.0, 20000.0), 8);
+  ASSERT_EQ(planner.Plan(2, 1, 0.0, 20000.0), 1);
+}
+
+TEST(BatchPlanner, PlanByConfiguredCost) {
+  BatchPlanner planner;
+  // 1 us per row, 20 us of work per thread
+  ASSERT_EQ(planner.Plan(1, 8, 1000.0, 20000.0), 1);
+  ASSERT_EQ(planner.Plan(20, 8, 1000.0, 20000.0), 1);
+  ASSERT_EQ(planner.Plan(21, 8, 1000.0, 20000.0), 2);
+  ASSERT_EQ(planner.Plan(60, 8, 1000.0, 20000.0), 3);
+  ASSERT_EQ(planner.Plan(100000, 8, 1000.0, 20000.0), 8);
+  // a threshold of 0 disables planning
+  ASSERT_EQ(planner.Plan(1, 8, 1000.0, 0.0), 8);
+}
+
+TEST(BatchPlanner, PlanByMeasuredCost) {
+  BatchPlanner planner;
+  planner.Record(100, 100000.0);  // 1 us per row
+  ASSERT_DOUBLE_EQ(planner.MeasuredRowCost(), 1000.0);
+  ASSERT_EQ(planner.Plan(10, 8, 0.0, 20000.0), 1);
+  ASSERT_EQ(planner.Plan(100, 8, 0.0, 20000.0), 5);
+  // the configured cost takes precedence
+  ASSERT_EQ(planner.Plan(100, 8, 100.0, 20000.0), 1);
+  // later measurements are blended in
+  planner.Record(10, 30000.0);  // 3 us per row
+  ASSERT_DOUBLE_EQ(planner.MeasuredRowCost(), 0.8 * 1000.0 + 0.2 * 3000.0);
+  planner.Record(0, 1000.0);
+  planner.Record(10, 0.0);
+  ASSERT_DOUBLE_EQ(planner.MeasuredRowCost(), 0.8 * 1000.0 + 0.2 * 3000.0);
+  planner.Reset();
+  ASSERT_EQ(planner.MeasuredRowCost(), 0.0);
+  ASSERT_EQ(planner.Plan(10, 8, 0.0, 20000.0), 8);
+}
+
+}  // namespace treelite
@@ -0,0 +1,84 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_build_driver.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for building shared libraries without Python
+ */
+#include <gtest/gtest.h>
+#include <treelite/c_api.h>
+#include <treelite/tree.h>
+#include <treelite/predictor.h>
+#include <limits>
+#include <string>
+#include <vector>
+#include "./test_util.h"
+
+namespace treelite {
+
+#ifndef _WIN32
+TEST(BuildDriver, ExportLib) {
+  Model model;
+  BuildStumpModel({0, 1, 0, 1}, &model);
+
+  const std::string dirpath = ::testing::TempDir() + "/build_driver_test";
+  const std::string libpath = dirpath + "/mymodel.so";
+  CompilerHandle compiler;
+  ASSERT_EQ(TreeliteCompilerCreate("ast_native", &compiler), 0);
+  ASSERT_EQ(TreeliteCompilerSetParam(compiler, "parallel_comp", "3"), 0);
+  const char* options[] = {"-O1"};
+  const char* build_log = nullptr;
+  ASSERT_EQ(TreeliteCompilerExportLib(compiler, &model, "gcc", dirpath.c_str(), libpath.c_str(),
+                                      2, options, 1, 0, &build_log), 0)
+    << TreeliteGetLastError();
+  ASSERT_EQ(TreeliteCompilerFree(compiler), 0);
+  // one entry per source file: main.c and three units
+  const std::string log(build_log);
+  for (const char* name : {"\"main.c\"", "\"tu0.c\"", "\"tu1.c\"", "\"tu2.c\"", "link_seconds"}) {
+    ASSERT_NE(log.find(name), std::string::npos) << log;
+  }
+
+  Predictor predictor(1);
+  predictor.Load(libpath.c_str());
+  const float kNaN = std::numeric_limits<float>::quiet_NaN();
+  const std::vector<float> data{-1.0f, -1.0f,  1.0f, -1.0f,  1.0f, 1.0f};
+  const DenseBatch batch{data.data(), kNaN, 3, 2};
+  std::vector<float> out(predictor.QueryResultSize(&batch));
+  ASSERT_EQ(predictor.PredictBatch(&batch, 0, true, out.data()), 3U);
+  ASSERT_EQ(out, std::vector<float>({-4.0f, 0.0f, 4.0f}));
+}
+
+TEST(BuildDriver, ParallelPredictInstKeepsRow) {
+  Model model;
+  BuildStumpModel({0, 1, 0, 1}, &model);
+
+  const std::string dirpath = ::testing::TempDir() + "/parallel_predict_inst_test";
+  const std::string libpath = dirpath + "/mymodel.so";
+  CompilerHandle compiler;
+  ASSERT_EQ(TreeliteCompilerCreate("ast_native", &compiler), 0);
+  ASSERT_EQ(TreeliteCompilerSetParam(compiler, "parallel_comp", "3"), 0);
+  ASSERT_EQ(TreeliteCompilerSetParam(compiler, "quantize", "1"), 0);
+  const char* build_log = nullptr;
+  ASSERT_EQ(TreeliteCompilerExportLib(compiler, &model, "gcc", dirpath.c_str(), libpath.c_str(),
+                                      2, nullptr, 0, 0, &build_log), 0)
+    << TreeliteGetLastError();
+  ASSERT_EQ(TreeliteCompilerFree(compiler), 0);
+
+  // the translation units are scored by the calling thread and the worker
+  // threads, after the row is converted into bins
+  Predictor predictor(1, {{"inst_num_thread", "3"}});
+  predictor.Load(libpath.c_str());
+  std::vector<TreelitePredictorEntry> inst(2);
+  inst[0].fvalue = -1.0f;
+  inst[1].fvalue = 1.0f;
+  float out;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(predictor.PredictInst(inst.data(), true, &out), 1U);
+    ASSERT_EQ(out, 0.0f);
+    // the row of the caller still holds the feature values
+    ASSERT_EQ(inst[0].fvalue, -1.0f);
+    ASSERT_EQ(inst[1].fvalue, 1.0f);
+  }
+}
+#endif  // _WIN32
+
+}  // namespace treelite
@@ -0,0 +1,50 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_compiler.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for code generation
+ */
+#include <gtest/gtest.h>
+#include <treelite/compiler.h>
+#include <treelite/compiler_param.h>
+#include <treelite/filesystem.h>
+#include <treelite/tree.h>
+#include <dmlc/logging.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./test_util.h"
+
+namespace treelite {
+
+#ifndef _WIN32
+TEST(Compiler, StreamingFailureLeavesCompilerUsable) {
+  Model model;
+  BuildStumpModel({0, 1, 0, 1}, &model);
+
+  compiler::CompilerParam param;
+  param.Init(std::vector<std::pair<std::string, std::string>>{{"parallel_comp", "3"}},
+             dmlc::parameter::kAllMatch);
+  std::unique_ptr<Compiler> compiler{Compiler::Create("ast_native", param)};
+
+  // A directory in place of the temporary file of tu1.c makes the streaming
+  // fail after tu0.c was written
+  const std::string dirpath = ::testing::TempDir() + "/streaming_failure_test";
+  filesystem::CreateDirectoryIfNotExist(dirpath.c_str());
+  filesystem::CreateDirectoryIfNotExist((dirpath + "/tu1.c.tmp").c_str());
+  ASSERT_THROW(compiler->CompileToDirectory(model, dirpath, false), dmlc::Error);
+  ASSERT_FALSE(std::ifstream(dirpath + "/tu0.c.tmp").good());
+  ASSERT_FALSE(std::ifstream(dirpath + "/tu0.c").good());
+
+  // the same compiler then generates the code in memory, as usual
+  const compiler::CompiledModel cm = compiler->Compile(model);
+  for (const char* name : {"main.c", "header.h", "tu0.c", "tu1.c", "tu2.c", "recipe.json"}) {
+    ASSERT_EQ(cm.files.count(name), 1U) << name;
+  }
+  ASSERT_FALSE(std::ifstream(dirpath + "/tu0.c").good());
+}
+#endif  // _WIN32
+
+}  // namespace treelite
@@ -0,0 +1,44 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_cpu_topology.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for discovery of the CPUs available to the thread pool
+ */
+#include <gtest/gtest.h>
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <vector>
+#include "predictor/thread_pool/cpu_topology.h"
+
+namespace treelite {
+
+TEST(CPUTopology, ParseCPUList) {
+  ASSERT_EQ(cpu_topology::ParseCPUList("0-3,8,10-11"),
+            std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_EQ(cpu_topology::ParseCPUList(" 5, 2-3 ,2\n"), std::vector<int>({5, 2, 3}));
+  ASSERT_TRUE(cpu_topology::ParseCPUList("").empty());
+  ASSERT_THROW(cpu_topology::ParseCPUList("0-"), dmlc::Error);
+  ASSERT_THROW(cpu_topology::ParseCPUList("3-1"), dmlc::Error);
+  ASSERT_THROW(cpu_topology::ParseCPUList("a"), dmlc::Error);
+}
+
+TEST(CPUTopology, CgroupCPULimit) {
+  ASSERT_EQ(cpu_topology::ParseCgroupCPUMax("max 100000\n"), 0);
+  ASSERT_EQ(cpu_topology::ParseCgroupCPUMax("200000 100000\n"), 2);
+  ASSERT_EQ(cpu_topology::ParseCgroupCPUMax("150000 100000\n"), 2);
+  ASSERT_EQ(cpu_topology::ParseCgroupCPUMax("50000 100000\n"), 1);
+  ASSERT_EQ(cpu_topology::CPULimitFromQuota(-1, 100000), 0);
+  ASSERT_EQ(cpu_topology::CPULimitFromQuota(400000, 100000), 4);
+  ASSERT_GE(cpu_topology::GetCgroupCPULimit(), 0);
+}
+
+TEST(CPUTopology, AllowedCPUs) {
+  const std::vector<int> cpus = cpu_topology::GetAllowedCPUs();
+  ASSERT_FALSE(cpus.empty());
+  std::vector<int> grouped = cpu_topology::GroupByNUMANode(cpus);
+  ASSERT_EQ(grouped.size(), cpus.size());
+  std::sort(grouped.begin(), grouped.end());
+  ASSERT_EQ(grouped, cpus);
+}
+
+}  // namespace treelite
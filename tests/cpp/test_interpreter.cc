@@ -0,0 +1,306 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_interpreter.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for scoring models in-process with the interpreter
+ */
+#include <gtest/gtest.h>
+#include <treelite/tree.h>
+#include <treelite/frontend.h>
+#include <treelite/predictor.h>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include "predictor/interpreter.h"
+#include "./test_util.h"
+
+namespace {
+
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+/*! \brief make a row of entries from dense feature values, with NaN meaning missing */
+inline std::vector<TreelitePredictorEntry> MakeRow(const std::vector<float>& values) {
+  std::vector<TreelitePredictorEntry> row(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (std::isnan(values[i])) {
+      row[i].missing = -1;
+    } else {
+      row[i].fvalue = values[i];
+    }
+  }
+  return row;
+}
+
+/*! \brief score a single row with both the sparse and the dense entry point */
+inline std::vector<float> Score(const treelite::Interpreter& interpreter,
+                                const std::vector<float>& values, bool pred_margin) {
+  std::vector<float> out(interpreter.NumOutputGroup());
+  std::vector<float> out_dense(interpreter.NumOutputGroup());
+  const std::vector<TreelitePredictorEntry> row = MakeRow(values);
+  const size_t size = interpreter.PredictBatch(row.data(), 1, values.size(), pred_margin,
+                                               out.data());
+  const size_t size_dense = interpreter.PredictBatchDense(values.data(), 1, values.size(), kNaN,
+                                                          pred_margin, out_dense.data());
+  EXPECT_EQ(size, size_dense);
+  out.resize(size);
+  out_dense.resize(size_dense);
+  EXPECT_EQ(out, out_dense);
+  return out;
+}
+
+}  // anonymous namespace
+
+namespace treelite {
+
+TEST(Interpreter, NumericalSplit) {
+  std::unique_ptr<frontend::ModelBuilder> builder{
+    new frontend::ModelBuilder(2, 1, false)
+  };
+  std::unique_ptr<frontend::TreeBuilder> tree{new frontend::TreeBuilder()};
+  for (int i = 0; i < 5; ++i) {
+    tree->CreateNode(i);
+  }
+  tree->SetNumericalTestNode(0, 0, "<", 0.0f, true, 1, 2);
+  tree->SetNumericalTestNode(2, 1, ">=", 1.5f, false, 3, 4);
+  tree->SetRootNode(0);
+  tree->SetLeafNode(1, -1.0f);
+  tree->SetLeafNode(3, 2.0f);
+  tree->SetLeafNode(4, 0.5f);
+  builder->InsertTree(tree.get());
+
+  Model model;
+  builder->CommitModel(&model);
+  Interpreter interpreter(model);
+  ASSERT_EQ(interpreter.NumNode(), 5U);
+  ASSERT_EQ(Score(interpreter, {-1.0f, 0.0f}, true), std::vector<float>{-1.0f});
+  ASSERT_EQ(Score(interpreter, {kNaN, 2.0f}, true), std::vector<float>{-1.0f});
+  ASSERT_EQ(Score(interpreter, {1.0f, 1.5f}, true), std::vector<float>{2.0f});
+  ASSERT_EQ(Score(interpreter, {1.0f, 1.0f}, true), std::vector<float>{0.5f});
+  ASSERT_EQ(Score(interpreter, {1.0f, kNaN}, true), std::vector<float>{0.5f});
+}
+
+TEST(Interpreter, InfiniteThreshold) {
+  std::unique_ptr<frontend::ModelBuilder> builder{
+    new frontend::ModelBuilder(1, 1, false)
+  };
+  std::unique_ptr<frontend::TreeBuilder> tree{new frontend::TreeBuilder()};
+  for (int i = 0; i < 3; ++i) {
+    tree->CreateNode(i);
+  }
+  tree->SetNumericalTestNode(0, 0, "<", std::numeric_limits<float>::infinity(), false, 1, 2);
+  tree->SetRootNode(0);
+  tree->SetLeafNode(1, 1.0f);
+  tree->SetLeafNode(2, 2.0f);
+  builder->InsertTree(tree.get());
+
+  Model model;
+  builder->CommitModel(&model);
+  Interpreter interpreter(model);
+  ASSERT_EQ(Score(interpreter, {1e30f}, true), std::vector<float>{1.0f});
+  // missing values still follow the default direction
+  ASSERT_EQ(Score(interpreter, {kNaN}, true), std::vector<float>{2.0f});
+}
+
+TEST(Interpreter, CategoricalSplit) {
+  std::unique_ptr<frontend::ModelBuilder> builder{
+    new frontend::ModelBuilder(1, 1, false)
+  };
+  std::unique_ptr<frontend::TreeBuilder> tree{new frontend::TreeBuilder()};
+  for (int i = 0; i < 3; ++i) {
+    tree->CreateNode(i);
+  }
+  tree->SetCategoricalTestNode(0, 0, {0, 2, 70}, false, 1, 2);
+  tree->SetRootNode(0);
+  tree->SetLeafNode(1, -1.0f);
+  tree->SetLeafNode(2, 1.0f);
+  builder->InsertTree(tree.get());
+
+  Model model;
+  builder->CommitModel(&model);
+  Interpreter interpreter(model);
+  ASSERT_EQ(Score(interpreter, {0.0f}, true), std::vector<float>{-1.0f});
+  ASSERT_EQ(Score(interpreter, {2.0f}, true), std::vector<float>{-1.0f});
+  ASSERT_EQ(Score(interpreter, {70.0f}, true), std::vector<float>{-1.0f});
+  ASSERT_EQ(Score(interpreter, {1.0f}, true), std::vector<float>{1.0f});
+  ASSERT_EQ(Score(interpreter, {1000.0f}, true), std::vector<float>{1.0f});
+  ASSERT_EQ(Score(interpreter, {-2.0f}, true), std::vector<float>{1.0f});
+  ASSERT_EQ(Score(interpreter, {kNaN}, true), std::vector<float>{1.0f});
+}
+
+TEST(Interpreter, MulticlassGradientBoosting) {
+  std::unique_ptr<frontend::ModelBuilder> builder{
+    new frontend::ModelBuilder(1, 3, false)
+  };
+  builder->SetModelParam("pred_transform", "max_index");
+  // tree i contributes to class (i % 3)
+  for (int tree_id = 0; tree_id < 6; ++tree_id) {
+    std::unique_ptr<frontend::TreeBuilder> tree{new frontend::TreeBuilder()};
+    for (int i = 0; i < 3; ++i) {
+      tree->CreateNode(i);
+    }
+    tree->SetNumericalTestNode(0, 0, "<", static_cast<float>(tree_id % 3), true, 1, 2);
+    tree->SetRootNode(0);
+    tree->SetLeafNode(1, 0.0f);
+    tree->SetLeafNode(2, 1.0f);
+    builder->InsertTree(tree.get());
+  }
+
+  Model model;
+  builder->CommitModel(&model);
+  Interpreter interpreter(model);
+  ASSERT_EQ(Score(interpreter, {1.5f}, true), std::vector<float>({2.0f, 2.0f, 0.0f}));
+  ASSERT_EQ(Score(interpreter, {1.5f}, false), std::vector<float>{0.0f});
+  ASSERT_EQ(Score(interpreter, {0.5f}, true), std::vector<float>({2.0f, 0.0f, 0.0f}));
+}
+
+TEST(Interpreter, RandomForestLeafVector) {
+  std::unique_ptr<frontend::ModelBuilder> builder{
+    new frontend::ModelBuilder(1, 2, true)
+  };
+  builder->SetModelParam("pred_transform", "identity_multiclass");
+  for (int tree_id = 0; tree_id < 2; ++tree_id) {
+    std::unique_ptr<frontend::TreeBuilder> tree{new frontend::TreeBuilder()};
+    for (int i = 0; i < 3; ++i) {
+      tree->CreateNode(i);
+    }
+    tree->SetNumericalTestNode(0, 0, "<", static_cast<float>(tree_id), true, 1, 2);
+    tree->SetRootNode(0);
+    tree->SetLeafVectorNode(1, {1.0f, 0.0f});
+    tree->SetLeafVectorNode(2, {0.0f, 1.0f});
+    builder->InsertTree(tree.get());
+  }
+
+  Model model;
+  builder->CommitModel(&model);
+  Interpreter interpreter(model);
+  // the outputs of the trees are averaged
+  ASSERT_EQ(Score(interpreter, {-1.0f}, false), std::vector<float>({1.0f, 0.0f}));
+  ASSERT_EQ(Score(interpreter, {0.5f}, false), std::vector<float>({0.5f, 0.5f}));
+  ASSERT_EQ(Score(interpreter, {2.0f}, false), std::vector<float>({0.0f, 1.0f}));
+}
+
+TEST(Interpreter, SigmoidWithGlobalBias) {
+  std::unique_ptr<frontend::ModelBuilder> builder{
+    new frontend::ModelBuilder(1, 1, false)
+  };
+  builder->SetModelParam("pred_transform", "sigmoid");
+  builder->SetModelParam("global_bias", "0.5");
+  std::unique_ptr<frontend::TreeBuilder> tree{new frontend::TreeBuilder()};
+  for (int i = 0; i < 3; ++i) {
+    tree->CreateNode(i);
+  }
+  tree->SetNumericalTestNode(0, 0, "<", 0.0f, true, 1, 2);
+  tree->SetRootNode(0);
+  tree->SetLeafNode(1, -0.5f);
+  tree->SetLeafNode(2, 1.5f);
+  builder->InsertTree(tree.get());
+
+  Model model;
+  builder->CommitModel(&model);
+  Interpreter interpreter(model);
+  ASSERT_EQ(Score(interpreter, {1.0f}, true), std::vector<float>{2.0f});
+  ASSERT_EQ(Score(interpreter, {-1.0f}, false), std::vector<float>{0.5f});
+  ASSERT_EQ(Score(interpreter, {1.0f}, false),
+            std::vector<float>{1.0f / (1 + std::exp(-2.0f))});
+}
+
+TEST(Interpreter, SIMDMatchesScalar) {
+  const int num_feature = 4;
+  std::unique_ptr<frontend::ModelBuilder> builder{
+    new frontend::ModelBuilder(num_feature, 1, false)
+  };
+  const char* ops[] = {"<", "<=", ">", ">=", "=="};
+  // complete trees of depth 3 with mixed operators; every fourth tree also has
+  // a categorical split, so that it takes the scalar path
+  for (int tree_id = 0; tree_id < 16; ++tree_id) {
+    std::unique_ptr<frontend::TreeBuilder> tree{new frontend::TreeBuilder()};
+    for (int i = 0; i < 15; ++i) {
+      tree->CreateNode(i);
+    }
+    for (int i = 0; i < 7; ++i) {
+      const int fid = (tree_id + i) % num_feature;
+      if (tree_id % 4 == 0 && i == 2) {
+        tree->SetCategoricalTestNode(i, fid, {1, 3}, true, 2 * i + 1, 2 * i + 2);
+      } else {
+        const float threshold = (i == 5) ? std::numeric_limits<float>::infinity()
+                                         : static_cast<float>((tree_id + 3 * i) % 5);
+        tree->SetNumericalTestNode(i, fid, ops[(tree_id + i) % 5], threshold, (i % 2 == 0),
+                                   2 * i + 1, 2 * i + 2);
+      }
+    }
+    for (int i = 7; i < 15; ++i) {
+      tree->SetLeafNode(i, static_cast<float>(tree_id * 15 + i) / 8.0f);
+    }
+    tree->SetRootNode(0);
+    builder->InsertTree(tree.get());
+  }
+
+  Model model;
+  builder->CommitModel(&model);
+  Interpreter interpreter(model);
+
+  // 37 rows, so that there are leftover rows for the scalar path
+  const size_t num_row = 37;
+  std::mt19937 rng(0);
+  std::vector<float> data(num_row * num_feature);
+  for (float& v : data) {
+    const int r = static_cast<int>(rng() % 7);
+    v = (r == 6) ? kNaN : static_cast<float>(r) - 0.5f * static_cast<float>(rng() % 2);
+  }
+  std::vector<TreelitePredictorEntry> rows;
+  for (size_t rid = 0; rid < num_row; ++rid) {
+    const std::vector<TreelitePredictorEntry> row
+      = MakeRow({&data[rid * num_feature], &data[(rid + 1) * num_feature]});
+    rows.insert(rows.end(), row.begin(), row.end());
+  }
+
+  std::vector<float> expected(num_row), expected_dense(num_row);
+  interpreter.SetSIMDLevel(simd::Level::kScalar);
+  interpreter.PredictBatch(rows.data(), num_row, num_feature, true, expected.data());
+  interpreter.PredictBatchDense(data.data(), num_row, num_feature, kNaN, true,
+                                expected_dense.data());
+  ASSERT_EQ(expected, expected_dense);
+  for (simd::Level level : {simd::Level::kAVX2, simd::Level::kAVX512}) {
+    if (static_cast<int>(level) > static_cast<int>(simd::DetectLevel())) {
+      continue;
+    }
+    interpreter.SetSIMDLevel(level);
+    std::vector<float> out(num_row);
+    interpreter.PredictBatch(rows.data(), num_row, num_feature, true, out.data());
+    ASSERT_EQ(out, expected) << simd::LevelName(level);
+    interpreter.PredictBatchDense(data.data(), num_row, num_feature, kNaN, true, out.data());
+    ASSERT_EQ(out, expected) << simd::LevelName(level);
+  }
+}
+
+TEST(Interpreter, PredictorLoadModel) {
+  Model model;
+  BuildStumpModel({1}, &model);
+  Predictor predictor(1);
+  predictor.LoadModel(model);
+  ASSERT_EQ(predictor.QueryNumFeature(), 2U);
+  ASSERT_EQ(predictor.QueryNumOutputGroup(), 1U);
+  ASSERT_EQ(predictor.QueryPredTransform(), "identity");
+
+  const std::vector<float> data{0.0f, -1.0f,  0.0f, 1.0f,  0.0f, kNaN};
+  const DenseBatch dense_batch{data.data(), kNaN, 3, 2};
+  std::vector<float> out(predictor.QueryResultSize(&dense_batch));
+  ASSERT_EQ(predictor.PredictBatch(&dense_batch, 0, false, out.data()), 3U);
+  ASSERT_EQ(out, std::vector<float>({-1.0f, 1.0f, -1.0f}));
+
+  const std::vector<float> values{-1.0f, 1.0f};
+  const std::vector<uint32_t> col_ind{1, 1};
+  const std::vector<size_t> row_ptr{0, 1, 2, 2};
+  const CSRBatch sparse_batch{values.data(), col_ind.data(), row_ptr.data(), 3, 2};
+  ASSERT_EQ(predictor.PredictBatch(&sparse_batch, 0, false, out.data()), 3U);
+  ASSERT_EQ(out, std::vector<float>({-1.0f, 1.0f, -1.0f}));
+
+  std::vector<TreelitePredictorEntry> inst = MakeRow({0.0f, 1.0f});
+  float result;
+  ASSERT_EQ(predictor.PredictInst(inst.data(), false, &result), 1U);
+  ASSERT_EQ(result, 1.0f);
+}
+
+}  // namespace treelite
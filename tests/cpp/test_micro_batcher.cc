@@ -0,0 +1,86 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_micro_batcher.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for micro-batching of single-instance predictions
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "predictor/micro_batcher.h"
+
+namespace treelite {
+
+TEST(MicroBatcher, CompleteEachRequest) {
+  const size_t max_rows = 4;
+  const int num_thread = 16;
+  const int num_request_per_thread = 50;
+  std::atomic<size_t> max_batch_size{0};
+  MicroBatcher batcher(max_rows, std::chrono::microseconds(1000),
+    [&](bool pred_margin, const std::vector<MicroBatcher::Request*>& requests) {
+      size_t cur = max_batch_size.load();
+      while (requests.size() > cur && !max_batch_size.compare_exchange_weak(cur, requests.size())) {}
+      for (MicroBatcher::Request* req : requests) {
+        req->out_result[0] = req->inst[0].fvalue * (pred_margin ? 1.0f : 2.0f);
+        req->result_size = 1;
+      }
+    });
+  std::vector<std::thread> threads;
+  std::atomic<int> num_mismatch{0};
+  for (int tid = 0; tid < num_thread; ++tid) {
+    threads.emplace_back([&, tid]() {
+      for (int i = 0; i < num_request_per_thread; ++i) {
+        TreelitePredictorEntry inst;
+        inst.fvalue = static_cast<float>(tid * 1000 + i);
+        const bool pred_margin = (i % 2 == 0);
+        float out;
+        const size_t result_size = batcher.Submit(&inst, pred_margin, &out);
+        if (result_size != 1 || out != inst.fvalue * (pred_margin ? 1.0f : 2.0f)) {
+          ++num_mismatch;
+        }
+      }
+    });
+  }
+  for (auto& e : threads) {
+    e.join();
+  }
+  ASSERT_EQ(num_mismatch.load(), 0);
+  ASSERT_LE(max_batch_size.load(), max_rows);
+}
+
+TEST(MicroBatcher, PropagateError) {
+  MicroBatcher batcher(2, std::chrono::microseconds(10),
+    [](bool, const std::vector<MicroBatcher::Request*>&) {
+      throw std::runtime_error("flush failed");
+    });
+  TreelitePredictorEntry inst;
+  inst.fvalue = 0.0f;
+  float out;
+  ASSERT_THROW(batcher.Submit(&inst, false, &out), std::runtime_error);
+}
+
+TEST(MicroBatcher, SingleCallerDoesNotWait) {
+  const auto timeout = std::chrono::seconds(1);
+  MicroBatcher batcher(4, timeout,
+    [](bool, const std::vector<MicroBatcher::Request*>& requests) {
+      for (MicroBatcher::Request* req : requests) {
+        req->out_result[0] = req->inst[0].fvalue;
+        req->result_size = 1;
+      }
+    });
+  // with nobody else to batch with, each request is scored right away
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; ++i) {
+    TreelitePredictorEntry inst;
+    inst.fvalue = static_cast<float>(i);
+    float out;
+    ASSERT_EQ(batcher.Submit(&inst, (i % 2 == 0), &out), 1U);
+    ASSERT_EQ(out, inst.fvalue);
+  }
+  ASSERT_LT(std::chrono::steady_clock::now() - start, timeout);
+}
+
+}  // namespace treelite
@@ -0,0 +1,95 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_mpmc_queue.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for multi-producer-multi-consumer queue
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "predictor/thread_pool/mpmc_queue.h"
+
+namespace treelite {
+
+TEST(MpmcQueue, FIFO) {
+  MpmcQueue<int> queue(4);
+  for (int i = 0; i < 3; ++i) {
+    queue.Push(i);
+  }
+  int out;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(queue.Pop(&out));
+    ASSERT_EQ(out, i);
+  }
+}
+
+TEST(MpmcQueue, DrainAfterKill) {
+  for (WaitPolicy policy : {WaitPolicy::kSpin, WaitPolicy::kSpinThenPark, WaitPolicy::kPark,
+                            WaitPolicy::kFutex}) {
+    MpmcQueue<int> queue(4, WaitConfig(policy, 10));
+    for (int i = 0; i < 3; ++i) {
+      queue.Push(i);
+    }
+    queue.SignalForKill();
+    int out;
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(queue.Pop(&out));
+      ASSERT_EQ(out, i);
+    }
+    ASSERT_FALSE(queue.Pop(&out));
+  }
+}
+
+void TestConcurrentProducersAndConsumers(WaitConfig wait) {
+  const int num_producer = 4;
+  const int num_consumer = 4;
+  const int num_item_per_producer = 20000;
+  MpmcQueue<int> queue(16, wait);  // small capacity, so that producers wrap around often
+  std::atomic<int64_t> sum{0};
+  std::atomic<int> num_consumed{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < num_consumer; ++i) {
+    consumers.emplace_back([&queue, &sum, &num_consumed]() {
+      int out;
+      while (queue.Pop(&out)) {
+        sum += out;
+        ++num_consumed;
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int i = 0; i < num_producer; ++i) {
+    producers.emplace_back([&queue]() {
+      for (int j = 1; j <= num_item_per_producer; ++j) {
+        queue.Push(j);
+      }
+    });
+  }
+  for (auto& e : producers) {
+    e.join();
+  }
+  while (num_consumed.load() < num_producer * num_item_per_producer) {
+    std::this_thread::yield();
+  }
+  queue.SignalForKill();
+  for (auto& e : consumers) {
+    e.join();
+  }
+  const int64_t expected
+    = static_cast<int64_t>(num_producer) * num_item_per_producer * (num_item_per_producer + 1) / 2;
+  ASSERT_EQ(sum.load(), expected);
+}
+
+TEST(MpmcQueue, ConcurrentProducersAndConsumers) {
+  TestConcurrentProducersAndConsumers(WaitConfig(WaitPolicy::kSpinThenPark, 100));
+}
+
+TEST(MpmcQueue, ConcurrentProducersAndConsumersWithWaitPolicy) {
+  TestConcurrentProducersAndConsumers(WaitConfig(WaitPolicy::kSpin, 0));
+  TestConcurrentProducersAndConsumers(WaitConfig(WaitPolicy::kPark, 0));
+  TestConcurrentProducersAndConsumers(WaitConfig(WaitPolicy::kFutex, 100));
+  TestConcurrentProducersAndConsumers(WaitConfig(WaitPolicy::kFutex, 0));
+}
+
+}  // namespace treelite
@@ -0,0 +1,253 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_predictor.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for the Predictor class
+ */
+#include <gtest/gtest.h>
+#include <treelite/tree.h>
+#include <treelite/predictor.h>
+#include <dmlc/logging.h>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "./test_util.h"
+#include "predictor/thread_pool/cpu_topology.h"
+
+namespace {
+
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+/*! \brief number of threads that a Predictor may use */
+int MaxNumThread() {
+  return treelite::cpu_topology::GetMaxConcurrency(treelite::cpu_topology::GetAllowedCPUs());
+}
+
+}  // anonymous namespace
+
+namespace treelite {
+
+TEST(Predictor, AsyncPredictBatch) {
+  Model model;
+  BuildStumpModel({1}, &model);
+  Predictor predictor(-1);
+  predictor.LoadModel(model);
+
+  const std::vector<float> data{0.0f, -1.0f,  0.0f, 1.0f,  0.0f, kNaN};
+  const DenseBatch dense_batch{data.data(), kNaN, 3, 2};
+  std::vector<float> out(predictor.QueryResultSize(&dense_batch));
+  std::promise<std::pair<size_t, std::exception_ptr>> callback_result;
+  PredictionFuture future = predictor.PredictBatchAsync(
+    &dense_batch, 0, false, out.data(),
+    [&callback_result](size_t result_size, std::exception_ptr error) {
+      callback_result.set_value({result_size, error});
+    });
+  ASSERT_TRUE(future.Valid());
+  ASSERT_EQ(future.Wait(), 3U);
+  ASSERT_TRUE(future.IsReady());
+  ASSERT_EQ(out, std::vector<float>({-1.0f, 1.0f, -1.0f}));
+  // Wait() may return before the callback finishes
+  const std::pair<size_t, std::exception_ptr> result = callback_result.get_future().get();
+  ASSERT_EQ(result.first, 3U);
+  ASSERT_EQ(result.second, nullptr);
+}
+
+TEST(Predictor, AsyncPropagateError) {
+  Model model;
+  BuildStumpModel({1}, &model);
+  Predictor predictor(-1);
+  predictor.LoadModel(model);
+
+  // NaN is not allowed unless it is the missing value
+  const std::vector<float> data{0.0f, -1.0f,  0.0f, kNaN};
+  const DenseBatch dense_batch{data.data(), 0.0f, 2, 2};
+  std::vector<float> out(predictor.QueryResultSize(&dense_batch));
+  std::promise<std::exception_ptr> callback_error;
+  PredictionFuture future = predictor.PredictBatchAsync(
+    &dense_batch, 0, false, out.data(),
+    [&callback_error](size_t, std::exception_ptr error) {
+      callback_error.set_value(error);
+    });
+  ASSERT_THROW(future.Wait(), dmlc::Error);
+  ASSERT_TRUE(future.IsReady());
+  // every call to Wait() reports the error
+  ASSERT_THROW(future.Wait(), dmlc::Error);
+  const std::exception_ptr error = callback_error.get_future().get();
+  ASSERT_NE(error, nullptr);
+  ASSERT_THROW(std::rethrow_exception(error), dmlc::Error);
+}
+
+TEST(Predictor, AsyncWaitInCallback) {
+  if (MaxNumThread() < 2) {
+    return;  // the callback must run on a worker thread, but there is no CPU for one
+  }
+  Model model;
+  BuildStumpModel({1}, &model);
+  Predictor predictor(2);  // one worker thread, so that the callback runs on it
+  predictor.LoadModel(model);
+
+  const std::vector<float> data{0.0f, -1.0f,  0.0f, 1.0f,  0.0f, kNaN};
+  const DenseBatch dense_batch{data.data(), kNaN, 3, 2};
+  std::vector<float> out(predictor.QueryResultSize(&dense_batch));
+  // the callback waits on the future of its own prediction
+  std::promise<PredictionFuture> future_promise;
+  std::shared_future<PredictionFuture> future_for_callback = future_promise.get_future().share();
+  std::promise<std::pair<bool, size_t>> callback_result;
+  PredictionFuture future = predictor.PredictBatchAsync(
+    &dense_batch, 0, false, out.data(),
+    [&](size_t result_size, std::exception_ptr error) {
+      const PredictionFuture& f = future_for_callback.get();
+      const bool ready = f.IsReady();
+      callback_result.set_value({ready, (error == nullptr) ? f.Wait() : 0});
+    });
+  future_promise.set_value(future);
+  std::future<std::pair<bool, size_t>> result = callback_result.get_future();
+  ASSERT_EQ(result.wait_for(std::chrono::seconds(30)), std::future_status::ready);
+  ASSERT_EQ(result.get(), std::make_pair(true, size_t(3)));
+  ASSERT_EQ(future.Wait(), 3U);
+  ASSERT_EQ(out, std::vector<float>({-1.0f, 1.0f, -1.0f}));
+}
+
+TEST(Predictor, AsyncPredictionsSurviveRestart) {
+  if (MaxNumThread() < 2) {
+    return;  // the predictions must be queued for a worker thread, but there is no CPU for one
+  }
+  Model model;
+  BuildStumpModel({1}, &model);
+  // the only worker thread takes the predictions one at a time, while the
+  // others wait in the queue
+  Predictor predictor(2);
+  predictor.LoadModel(model);
+
+  const size_t num_row = 2000;
+  const int num_prediction = 8;
+  std::vector<float> data(num_row * 2);
+  std::vector<float> expected(num_row);
+  for (size_t i = 0; i < num_row; ++i) {
+    data[i * 2] = 0.0f;
+    data[i * 2 + 1] = (i % 3 == 0) ? -1.0f : 1.0f;
+    expected[i] = data[i * 2 + 1];
+  }
+  const DenseBatch dense_batch{data.data(), kNaN, num_row, 2};
+  // restarting the worker threads, or loading a model, must not abandon the
+  // predictions still in the queue
+  for (int restart = 0; restart < 2; ++restart) {
+    std::vector<std::vector<float>> out(num_prediction, std::vector<float>(num_row));
+    std::vector<std::promise<size_t>> callback_result(num_prediction);
+    std::vector<PredictionFuture> futures;
+    for (int i = 0; i < num_prediction; ++i) {
+      std::promise<size_t>* result = &callback_result[i];
+      futures.push_back(predictor.PredictBatchAsync(&dense_batch, 0, false, out[i].data(),
+        [result](size_t result_size, std::exception_ptr) {
+          result->set_value(result_size);
+        }));
+    }
+    if (restart == 0) {
+      predictor.SetParam("spin_count", "1000");
+    } else {
+      predictor.LoadModel(model);
+    }
+    for (int i = 0; i < num_prediction; ++i) {
+      std::future<size_t> result = callback_result[i].get_future();
+      ASSERT_EQ(result.wait_for(std::chrono::seconds(30)), std::future_status::ready);
+      ASSERT_EQ(result.get(), num_row);
+      ASSERT_TRUE(futures[i].IsReady());
+      ASSERT_EQ(futures[i].Wait(), num_row);
+      ASSERT_EQ(out[i], expected);
+    }
+  }
+}
+
+TEST(Predictor, TooManyWorkerThreads) {
+  Model model;
+  BuildStumpModel({1}, &model);
+  {
+    Predictor predictor(MaxNumThread() + 1);
+    ASSERT_THROW(predictor.LoadModel(model), dmlc::Error);
+  }
+  if (MaxNumThread() < 2) {
+    return;
+  }
+  // restricting the CPUs must leave enough of them for the worker threads
+  Predictor predictor(2);
+  predictor.LoadModel(model);
+  const int cpu = treelite::cpu_topology::GetAllowedCPUs()[0];
+  ASSERT_THROW(predictor.SetParam("cpu_list", std::to_string(cpu)), dmlc::Error);
+  const std::vector<float> data{0.0f, -1.0f,  0.0f, 1.0f};
+  const DenseBatch dense_batch{data.data(), kNaN, 2, 2};
+  std::vector<float> out(2);
+  ASSERT_EQ(predictor.PredictBatch(&dense_batch, 0, false, out.data()), 2U);
+  ASSERT_EQ(out, std::vector<float>({-1.0f, 1.0f}));
+}
+
+TEST(Predictor, ConcurrentPredictBatch) {
+  Model model;
+  BuildStumpModel({0, 1, 1, 0, 1}, &model);
+  // small chunks and no minimum amount of work per thread, so that every
+  // batch of more than a few rows is divided among all worker threads
+  Predictor predictor(-1, {{"chunk_size", "16"}, {"min_work_per_thread_us", "0"}});
+  predictor.LoadModel(model);
+
+  // batches of various sizes, including ones smaller than a chunk
+  const std::vector<size_t> batch_sizes{1, 5, 15, 16, 17, 100, 1000};
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<std::vector<float>> data(batch_sizes.size());
+  std::vector<std::vector<float>> expected(batch_sizes.size());
+  for (size_t b = 0; b < batch_sizes.size(); ++b) {
+    data[b].resize(batch_sizes[b] * 2);
+    for (float& e : data[b]) {
+      e = dist(rng);
+    }
+    const DenseBatch batch{data[b].data(), kNaN, batch_sizes[b], 2};
+    expected[b].resize(batch_sizes[b]);
+    ASSERT_EQ(predictor.PredictBatch(&batch, 0, false, expected[b].data()), batch_sizes[b]);
+  }
+
+  const int num_client = 8;
+  const int num_iter = 50;
+  std::atomic<int> num_mismatch{0};
+  std::vector<std::thread> clients;
+  for (int tid = 0; tid < num_client; ++tid) {
+    clients.emplace_back([&, tid]() {
+      for (int iter = 0; iter < num_iter; ++iter) {
+        const size_t b = (tid + iter) % batch_sizes.size();
+        const size_t num_row = batch_sizes[b];
+        std::vector<float> out(num_row);
+        size_t result_size;
+        if (iter % 2 == 0) {
+          const DenseBatch batch{data[b].data(), kNaN, num_row, 2};
+          result_size = predictor.PredictBatch(&batch, 0, false, out.data());
+        } else {
+          // the same rows, as a sparse batch
+          std::vector<uint32_t> col_ind;
+          std::vector<size_t> row_ptr;
+          for (size_t i = 0; i < num_row; ++i) {
+            row_ptr.push_back(i * 2);
+            col_ind.push_back(0);
+            col_ind.push_back(1);
+          }
+          row_ptr.push_back(num_row * 2);
+          const CSRBatch batch{data[b].data(), col_ind.data(), row_ptr.data(), num_row, 2};
+          result_size = predictor.PredictBatch(&batch, 0, false, out.data());
+        }
+        if (result_size != num_row || out != expected[b]) {
+          ++num_mismatch;
+        }
+      }
+    });
+  }
+  for (auto& e : clients) {
+    e.join();
+  }
+  ASSERT_EQ(num_mismatch.load(), 0);
+}
+
+}  // namespace treelite
@@ -29,6 +29,15 @@ inline void TestRoundTrip(treelite::Model* model) {
   ASSERT_EQ(TreeliteToBytes(model), TreeliteToBytes(received_model.get()));
 }
 
+inline void TestReferenceRoundTrip(treelite::Model* model) {
+  std::string s = TreeliteToBytes(model);
+  std::unique_ptr<dmlc::Stream> mstrm{new dmlc::MemoryStringStream(&s)};
+  std::unique_ptr<treelite::Model> received_model{new treelite::Model()};
+  received_model->ReferenceDeserialize(mstrm.get());
+
+  ASSERT_EQ(TreeliteToBytes(model), TreeliteToBytes(received_model.get()));
+}
+
 }  // anonymous namespace
 
 namespace treelite {
@@ -115,6 +124,7 @@ TEST(PyBufferInterfaceRoundTrip, TreeDepth2) {
   std::unique_ptr<Model> model{new Model()};
   builder->CommitModel(model.get());
   TestRoundTrip(model.get());
+  TestReferenceRoundTrip(model.get());
 }
 
 TEST(PyBufferInterfaceRoundTrip, DeepFullTree) {
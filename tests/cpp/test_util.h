@@ -0,0 +1,45 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_util.h
+ * \author Hyunsu Cho
+ * \brief Helpers shared by the C++ tests
+ */
+#ifndef TREELITE_TESTS_CPP_TEST_UTIL_H_
+#define TREELITE_TESTS_CPP_TEST_UTIL_H_
+
+#include <treelite/frontend.h>
+#include <treelite/tree.h>
+#include <memory>
+#include <vector>
+
+namespace treelite {
+
+/*!
+ * \brief build a regression model with two features, made of one stump per
+ *        element of split_index. Each stump tests whether its feature is less
+ *        than 0, and outputs -1 if so (or if the feature is missing) and 1
+ *        otherwise.
+ * \param split_index feature tested by each stump
+ * \param model place to store the model
+ */
+inline void BuildStumpModel(const std::vector<unsigned>& split_index, Model* model) {
+  std::unique_ptr<frontend::ModelBuilder> builder{
+    new frontend::ModelBuilder(2, 1, false)
+  };
+  for (unsigned fid : split_index) {
+    std::unique_ptr<frontend::TreeBuilder> tree{new frontend::TreeBuilder()};
+    for (int j = 0; j < 3; ++j) {
+      tree->CreateNode(j);
+    }
+    tree->SetNumericalTestNode(0, fid, "<", 0.0f, true, 1, 2);
+    tree->SetRootNode(0);
+    tree->SetLeafNode(1, -1.0f);
+    tree->SetLeafNode(2, 1.0f);
+    builder->InsertTree(tree.get());
+  }
+  builder->CommitModel(model);
+}
+
+}  // namespace treelite
+
+#endif  // TREELITE_TESTS_CPP_TEST_UTIL_H_
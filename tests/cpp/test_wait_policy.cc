@@ -0,0 +1,54 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_wait_policy.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for policies of waiting threads
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "predictor/thread_pool/wait_policy.h"
+
+namespace treelite {
+
+TEST(WaitPolicy, SpinCount) {
+  ASSERT_EQ(WaitConfig(WaitPolicy::kPark, 1000).SpinCount(), 0);
+  ASSERT_EQ(WaitConfig(WaitPolicy::kSpinThenPark, 1000).SpinCount(), 1000);
+  ASSERT_GT(WaitConfig(WaitPolicy::kSpin, 1000).SpinCount(), 1000);
+  PredictorParam param;
+  param.Init(std::vector<std::pair<std::string, std::string>>{
+    {"wait_policy", "park"}, {"spin_count", "10"}});
+  const WaitConfig wait(param);
+  ASSERT_EQ(wait.policy, WaitPolicy::kPark);
+  ASSERT_EQ(wait.spin_count, 10);
+}
+
+TEST(WaitPolicy, CompletionEvent) {
+  const int num_waiter = 4;
+  for (WaitPolicy policy : {WaitPolicy::kSpin, WaitPolicy::kSpinThenPark,
+                            WaitPolicy::kPark, WaitPolicy::kFutex}) {
+    for (int trial = 0; trial < 100; ++trial) {
+      CompletionEvent event;
+      std::atomic<int> num_woken{0};
+      std::vector<std::thread> waiters;
+      for (int i = 0; i < num_waiter; ++i) {
+        waiters.emplace_back([&event, &num_woken, policy]() {
+          event.Wait(WaitConfig(policy, 10));
+          ++num_woken;
+        });
+      }
+      ASSERT_FALSE(event.IsSet());
+      event.Set();
+      for (auto& e : waiters) {
+        e.join();
+      }
+      ASSERT_TRUE(event.IsSet());
+      ASSERT_EQ(num_woken.load(), num_waiter);
+    }
+  }
+}
+
+}  // namespace treelite
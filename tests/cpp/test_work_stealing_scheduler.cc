@@ -0,0 +1,88 @@
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file test_work_stealing_scheduler.cc
+ * \author Hyunsu Cho
+ * \brief C++ tests for work-stealing row scheduler
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "predictor/thread_pool/work_stealing_scheduler.h"
+
+namespace treelite {
+
+TEST(WorkStealingScheduler, SingleWorker) {
+  WorkStealingScheduler scheduler(10, 1, 4);
+  size_t rbegin, rend;
+  std::vector<std::pair<size_t, size_t>> chunks;
+  while (scheduler.Next(0, &rbegin, &rend)) {
+    chunks.emplace_back(rbegin, rend);
+  }
+  const std::vector<std::pair<size_t, size_t>> expected{{0, 4}, {4, 8}, {8, 10}};
+  ASSERT_EQ(chunks, expected);
+}
+
+TEST(WorkStealingScheduler, Steal) {
+  // worker 0 owns rows [0, 50) and worker 1 owns rows [50, 100)
+  WorkStealingScheduler scheduler(100, 2, 10);
+  size_t rbegin, rend;
+  ASSERT_TRUE(scheduler.Next(1, &rbegin, &rend));
+  ASSERT_EQ(rbegin, 50);
+  ASSERT_EQ(rend, 60);
+  // worker 0 finishes its share before worker 1 claims another chunk
+  size_t claimed = 0;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(scheduler.Next(0, &rbegin, &rend));
+    claimed += rend - rbegin;
+  }
+  ASSERT_EQ(claimed, 50);
+  // worker 0 now steals the back half of [60, 100)
+  ASSERT_TRUE(scheduler.Next(0, &rbegin, &rend));
+  ASSERT_EQ(rbegin, 80);
+  ASSERT_EQ(rend, 90);
+  ASSERT_TRUE(scheduler.Next(1, &rbegin, &rend));
+  ASSERT_EQ(rbegin, 60);
+  ASSERT_EQ(rend, 70);
+}
+
+TEST(WorkStealingScheduler, AutoChunkSize) {
+  WorkStealingScheduler scheduler(1000, 4, 0);
+  ASSERT_GT(scheduler.ChunkSize(), 0);
+  ASSERT_LT(scheduler.ChunkSize(), 250);
+  WorkStealingScheduler tiny(3, 4, 0);
+  ASSERT_EQ(tiny.ChunkSize(), 1);
+}
+
+TEST(WorkStealingScheduler, EveryRowClaimedOnce) {
+  const size_t num_row = 100003;
+  const int num_worker = 8;
+  WorkStealingScheduler scheduler(num_row, num_worker, 7);
+  std::vector<std::atomic<int>> count(num_row);
+  for (auto& e : count) {
+    e.store(0);
+  }
+  std::vector<std::thread> workers;
+  for (int tid = 0; tid < num_worker; ++tid) {
+    workers.emplace_back([&scheduler, &count, tid]() {
+      size_t rbegin, rend;
+      while (scheduler.Next(tid, &rbegin, &rend)) {
+        ASSERT_LT(rbegin, rend);
+        for (size_t rid = rbegin; rid < rend; ++rid) {
+          ++count[rid];
+          if (tid == 0) {  // slow worker, so that its share gets stolen
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+  for (auto& e : workers) {
+    e.join();
+  }
+  for (size_t rid = 0; rid < num_row; ++rid) {
+    ASSERT_EQ(count[rid].load(), 1) << "row " << rid;
+  }
+}
+
+}  // namespace treelite
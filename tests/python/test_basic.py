@@ -7,12 +7,15 @@ import subprocess
 from zipfile import ZipFile
 
 import pytest
+import numpy as np
 from scipy.sparse import csr_matrix
 import treelite
 import treelite_runtime
+from treelite.util import has_sklearn
 from treelite.contrib import _libext
 from .metadata import dataset_db
-from .util import os_platform, os_compatible_toolchains, does_not_raise, check_predictor
+from .util import os_platform, os_compatible_toolchains, does_not_raise, check_predictor, \
+    check_predictor_output
 
 
 @pytest.mark.parametrize('dataset,use_annotation,parallel_comp,quantize,toolchain',
@@ -72,6 +75,236 @@ def test_failsafe_compiler(tmpdir, dataset, use_elf, toolchain):
         check_predictor(predictor, dataset)
 
 
+@pytest.mark.parametrize('toolchain', os_compatible_toolchains())
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology'])
+def test_quickscorer_compiler(tmpdir, dataset, toolchain):
+    """Test 'quickscorer' compiler"""
+    libpath = os.path.join(tmpdir, dataset_db[dataset].libname + _libext())
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    model.export_lib(compiler='quickscorer', toolchain=toolchain, libpath=libpath, verbose=True)
+    predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+    check_predictor(predictor, dataset)
+
+
+def test_quickscorer_present_nan(tmpdir):
+    """Test that 'quickscorer' treats a NaN stored in a sparse matrix as 'ast_native' does:
+    the NaN is not missing, and it fails every comparison"""
+    builder = treelite.ModelBuilder(num_feature=2)
+    for opname in ['<', '<=', '>', '>=']:
+        for default_left in [True, False]:
+            for threshold in [0.5, float('inf'), float('-inf')]:
+                tree = treelite.ModelBuilder.Tree()
+                tree[0].set_numerical_test_node(
+                    feature_id=0, opname=opname, threshold=threshold,
+                    default_left=default_left, left_child_key=1, right_child_key=2)
+                # the sum of the leaf values tells which way each tree went
+                tree[1].set_leaf_node(leaf_value=2.0 ** len(builder))
+                tree[2].set_leaf_node(leaf_value=-2.0 ** len(builder))
+                tree[0].set_root()
+                builder.append(tree)
+    model = builder.commit()
+
+    # row 0: feature 0 is missing; row 1: feature 0 is a stored NaN; row 2: a value
+    X = csr_matrix(([1.0, np.nan, 1.0, 0.0, 1.0], ([0, 1, 1, 2, 2], [1, 0, 1, 0, 1])),
+                   shape=(3, 2))
+    assert X.nnz == 5
+    batch = treelite_runtime.Batch.from_csr(X)
+    toolchain = os_compatible_toolchains()[0]
+    out_margin = {}
+    for compiler in ['ast_native', 'quickscorer']:
+        libpath = os.path.join(tmpdir, compiler + _libext())
+        model.export_lib(compiler=compiler, toolchain=toolchain, libpath=libpath, verbose=True)
+        predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+        out_margin[compiler] = predictor.predict(batch, pred_margin=True)
+    np.testing.assert_array_equal(out_margin['quickscorer'], out_margin['ast_native'])
+
+
+@pytest.mark.parametrize('compiler,code_folding_req',
+                         [('ast_native', 0.0), ('failsafe', None)])
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology', 'toy_categorical'])
+def test_compact_nodes(tmpdir, dataset, compiler, code_folding_req):
+    """Test compact, cache-aligned node arrays"""
+    if compiler == 'failsafe' and dataset_db[dataset].format != 'xgboost':
+        pytest.skip('failsafe compiler is only available for XGBoost models')
+    libpath = os.path.join(tmpdir, dataset_db[dataset].libname + _libext())
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    params = {'compact_nodes': 1}
+    if code_folding_req is not None:
+        params['code_folding_req'] = code_folding_req
+    toolchain = os_compatible_toolchains()[0]
+    model.export_lib(compiler=compiler, toolchain=toolchain, libpath=libpath, params=params,
+                     verbose=True)
+    predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+    check_predictor(predictor, dataset)
+
+
+@pytest.mark.parametrize('code_folding_req,compact_nodes,parallel_comp',
+                         [(None, 0, None), (None, 0, 2), (1.0, 0, None), (1.0, 1, None)])
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology'])
+def test_profile_layout(tmpdir, annotation, dataset, code_folding_req, compact_nodes,
+                        parallel_comp):
+    """Test laying out the code with the help of branch annotation"""
+    libpath = os.path.join(tmpdir, dataset_db[dataset].libname + _libext())
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    annotation_path = os.path.join(tmpdir, 'annotation.json')
+    with open(annotation_path, 'w') as f:
+        f.write(annotation[dataset])
+    params = {'annotate_in': annotation_path, 'profile_layout': 1,
+              'compact_nodes': compact_nodes}
+    if code_folding_req is not None:
+        params['code_folding_req'] = code_folding_req
+    if parallel_comp is not None:
+        params['parallel_comp'] = parallel_comp
+    toolchain = os_compatible_toolchains()[0]
+    model.export_lib(toolchain=toolchain, libpath=libpath, params=params, verbose=True)
+    predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+    check_predictor(predictor, dataset)
+
+
+@pytest.mark.parametrize('unit_partition', ['balanced', 'feature'])
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology'])
+def test_unit_partition(tmpdir, dataset, unit_partition):
+    """Test dividing trees into translation units by cost"""
+    libpath = os.path.join(tmpdir, dataset_db[dataset].libname + _libext())
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    params = {'parallel_comp': 4, 'unit_partition': unit_partition, 'nthread': 2}
+    toolchain = os_compatible_toolchains()[0]
+    model.export_lib(toolchain=toolchain, libpath=libpath, params=params, verbose=True)
+    predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+    check_predictor(predictor, dataset)
+
+
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology'])
+def test_unit_partition_matches_single_unit(tmpdir, dataset):
+    """Test that dividing trees into translation units changes predictions by rounding error at
+    most. Each unit adds up the outputs of its own trees, so the order of summation depends on the
+    partition."""
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    toolchain = os_compatible_toolchains()[0]
+    batch = treelite_runtime.Batch.from_csr(treelite.DMatrix(dataset_db[dataset].dtest))
+
+    def predict_margin(name, params):
+        libpath = os.path.join(tmpdir, name + _libext())
+        model.export_lib(toolchain=toolchain, libpath=libpath, params=params, verbose=True)
+        predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+        return predictor.predict(batch, pred_margin=True)
+
+    expected_margin = predict_margin('single_unit', {})
+    for unit_partition in ['round_robin', 'balanced', 'feature']:
+        out_margin = predict_margin(unit_partition, {'parallel_comp': 4,
+                                                     'unit_partition': unit_partition})
+        np.testing.assert_allclose(out_margin, expected_margin, rtol=1e-5, atol=1e-5)
+
+
+@pytest.mark.skipif(not has_sklearn(), reason='Needs scikit-learn')
+@pytest.mark.parametrize('compiler,parallel_comp',
+                         [('ast_native', None), ('ast_native', 4), ('failsafe', None),
+                          ('quickscorer', None)])
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology'])
+def test_dense_input(tmpdir, dataset, compiler, parallel_comp):
+    """Test prediction function that reads rows of a dense matrix without copying them"""
+    libpath = os.path.join(tmpdir, dataset_db[dataset].libname + _libext())
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    params = {'dense_input': 1}
+    if parallel_comp:
+        params['parallel_comp'] = parallel_comp
+    toolchain = os_compatible_toolchains()[0]
+    model.export_lib(compiler=compiler, toolchain=toolchain, libpath=libpath, params=params,
+                     verbose=True)
+    predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+
+    from sklearn.datasets import load_svmlight_file
+
+    # Rows must be as wide as the training data for the runtime to read them in place
+    X_test, _ = load_svmlight_file(dataset_db[dataset].dtest, zero_based=True,
+                                   n_features=predictor.num_feature)
+    X_test = X_test.toarray()
+    for missing in [0.0, np.nan]:
+        if np.isnan(missing):
+            np.place(X_test, X_test == 0.0, [np.nan])
+        batch = treelite_runtime.Batch.from_npy2d(X_test, missing=missing)
+        out_margin = predictor.predict(batch, pred_margin=True)
+        out_prob = predictor.predict(batch)
+        check_predictor_output(dataset, X_test.shape, out_margin, out_prob)
+
+
+@pytest.mark.skipif(not has_sklearn(), reason='Needs scikit-learn')
+@pytest.mark.parametrize('parallel_comp', [None, 4])
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology'])
+def test_quantized_input(tmpdir, dataset, parallel_comp):
+    """Test prediction function that takes features already converted into bins"""
+    libpath = os.path.join(tmpdir, dataset_db[dataset].libname + _libext())
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    params = {'quantize': 1}
+    if parallel_comp:
+        params['parallel_comp'] = parallel_comp
+    toolchain = os_compatible_toolchains()[0]
+    model.export_lib(toolchain=toolchain, libpath=libpath, params=params, verbose=True)
+    predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+    assert predictor.bin_size in [1, 2, 4]
+
+    from sklearn.datasets import load_svmlight_file
+
+    X_test, _ = load_svmlight_file(dataset_db[dataset].dtest, zero_based=True,
+                                   n_features=predictor.num_feature)
+    X_test = X_test.toarray()
+    np.place(X_test, X_test == 0.0, [np.nan])
+    dtype = {1: np.uint8, 2: np.uint16, 4: np.uint32}[predictor.bin_size]
+    bins = np.full(X_test.shape, np.iinfo(dtype).max, dtype=dtype)
+    for fid, cut_points in enumerate(predictor.cut_points):
+        x = X_test[:, fid].astype(np.float32)
+        present = ~np.isnan(x)
+        bins[present, fid] = (np.searchsorted(cut_points, x[present], side='left')
+                              + np.searchsorted(cut_points, x[present], side='right'))
+    batch = treelite_runtime.Batch.from_quantized(bins)
+    out_margin = predictor.predict(batch, pred_margin=True)
+    out_prob = predictor.predict(batch)
+    check_predictor_output(dataset, X_test.shape, out_margin, out_prob)
+
+
+@pytest.mark.parametrize('from_file', [True, False])
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology', 'letor', 'toy_categorical'])
+def test_interpreter(tmpdir, dataset, from_file):
+    """Test scoring a model in-process, without compiling it"""
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    if from_file:
+        model_path = os.path.join(tmpdir, 'model.bin')
+        model.serialize(model_path)
+        predictor = treelite_runtime.Predictor(model=model_path, verbose=True)
+    else:
+        predictor = treelite_runtime.Predictor(model=model, verbose=True)
+        del model  # the predictor keeps its own copy of the trees
+    check_predictor(predictor, dataset)
+
+
+@pytest.mark.parametrize('dataset', ['mushroom', 'dermatology'])
+def test_compile_cache(tmpdir, dataset):
+    """Test reusing libraries and object files from the compile cache"""
+    libpath = os.path.join(tmpdir, dataset_db[dataset].libname + _libext())
+    cache_dir = os.path.join(tmpdir, 'cache')
+    model = treelite.Model.load(dataset_db[dataset].model, model_format=dataset_db[dataset].format)
+    toolchain = os_compatible_toolchains()[0]
+    params = {'parallel_comp': 4}
+    model.export_lib(toolchain=toolchain, libpath=libpath, params=params, verbose=True,
+                     cache_dir=cache_dir)
+    cached = set(os.listdir(cache_dir))
+    assert len([x for x in cached if x.endswith(_libext())]) == 1
+
+    # same model and parameters: the library is taken from the cache
+    os.remove(libpath)
+    model.export_lib(toolchain=toolchain, libpath=libpath, params=params, verbose=True,
+                     cache_dir=cache_dir)
+    assert set(os.listdir(cache_dir)) == cached
+    check_predictor(treelite_runtime.Predictor(libpath=libpath, verbose=True), dataset)
+
+    # different parameters: a new library is built
+    params['quantize'] = 1
+    model.export_lib(toolchain=toolchain, libpath=libpath, params=params, verbose=True,
+                     cache_dir=cache_dir)
+    assert len([x for x in os.listdir(cache_dir) if x.endswith(_libext())]) == 2
+    check_predictor(treelite_runtime.Predictor(libpath=libpath, verbose=True), dataset)
+
+
 @pytest.mark.skipif(os_platform() == 'windows', reason='Make unavailable on Windows')
 @pytest.mark.parametrize('toolchain', os_compatible_toolchains())
 @pytest.mark.parametrize('dataset', ['mushroom', 'dermatology', 'letor', 'toy_categorical'])
@@ -15,7 +15,8 @@ from .util import os_compatible_toolchains, check_predictor_output
 @pytest.mark.skipif(not has_sklearn(), reason='Needs scikit-learn')
 @pytest.mark.parametrize('toolchain', os_compatible_toolchains())
 @pytest.mark.parametrize('dataset', ['mushroom', 'dermatology', 'toy_categorical'])
-def test_single_inst(tmpdir, annotation, dataset, toolchain):
+@pytest.mark.parametrize('inst_num_thread', [1, 0])
+def test_single_inst(tmpdir, annotation, dataset, toolchain, inst_num_thread):
     # pylint: disable=too-many-locals
     """Run end-to-end test"""
     libpath = os.path.join(tmpdir, dataset_db[dataset].libname + _libext())
@@ -33,7 +34,9 @@ def test_single_inst(tmpdir, annotation, dataset, toolchain):
         'quantize': 1, 'parallel_comp': model.num_tree
     }
     model.export_lib(toolchain=toolchain, libpath=libpath, params=params, verbose=True)
-    predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True)
+    # inst_num_thread=0 divides the translation units among all threads
+    predictor = treelite_runtime.Predictor(libpath=libpath, verbose=True,
+                                           params={'inst_num_thread': inst_num_thread})
 
     from sklearn.datasets import load_svmlight_file
 